@@ -0,0 +1,144 @@
+// Copyright 2020 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <inttypes.h>
+#include <lib/console.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ktl/algorithm.h>
+#include <lockdep/lockdep.h>
+
+#if WITH_LOCK_STATS
+
+namespace {
+
+using lockdep::LockClassState;
+using lockdep::LockClassStatistics;
+
+// The most lock classes a single dump reports.
+constexpr size_t kMaxDumpEntries = 32;
+
+enum class SortKey { Contended, Wait, Hold, Acquisitions };
+
+uint64_t GetSortValue(const LockClassStatistics::Snapshot& snapshot, SortKey key) {
+  switch (key) {
+    case SortKey::Contended:
+      return snapshot.contended;
+    case SortKey::Wait:
+      return snapshot.wait_total;
+    case SortKey::Hold:
+      return snapshot.hold_total;
+    case SortKey::Acquisitions:
+    default:
+      return snapshot.acquisitions;
+  }
+}
+
+bool ParseSortKey(const char* str, SortKey* key) {
+  if (strcmp(str, "contended") == 0) {
+    *key = SortKey::Contended;
+  } else if (strcmp(str, "wait") == 0) {
+    *key = SortKey::Wait;
+  } else if (strcmp(str, "hold") == 0) {
+    *key = SortKey::Hold;
+  } else if (strcmp(str, "count") == 0) {
+    *key = SortKey::Acquisitions;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Prints the |count| lock classes with the largest values of |key|, largest
+// first. The statistics keep changing while this runs, so the dump is only
+// approximately ordered on a busy system.
+void DumpLockStatistics(SortKey key, size_t count) {
+  struct Entry {
+    LockClassState* state;
+    uint64_t value;
+  };
+  Entry entries[kMaxDumpEntries];
+  size_t entry_count = 0;
+
+  // Insertion sort into the fixed-size table, dropping the smallest entries
+  // once the table is full.
+  for (auto& state : LockClassState::Iter()) {
+    const uint64_t value = GetSortValue(state.statistics().Read(), key);
+    if (value == 0) {
+      continue;
+    }
+    size_t i = entry_count;
+    if (entry_count < count) {
+      entry_count++;
+    } else if (entries[count - 1].value >= value) {
+      continue;
+    } else {
+      i = count - 1;
+    }
+    for (; i > 0 && entries[i - 1].value < value; i--) {
+      entries[i] = entries[i - 1];
+    }
+    entries[i] = {&state, value};
+  }
+
+  printf("%12s %10s %12s %10s %12s %10s  %s\n", "acquisitions", "contended", "wait_us",
+         "wait_max", "hold_us", "hold_max", "lock class");
+  for (size_t i = 0; i < entry_count; i++) {
+    const LockClassStatistics::Snapshot snapshot = entries[i].state->statistics().Read();
+    printf("%12" PRIu64 " %10" PRIu64 " %12" PRIu64 " %10" PRIu64 " %12" PRIu64 " %10" PRIu64
+           "  %s\n",
+           snapshot.acquisitions, snapshot.contended, snapshot.wait_total / 1000,
+           snapshot.wait_max / 1000, snapshot.hold_total / 1000, snapshot.hold_max / 1000,
+           entries[i].state->name());
+  }
+}
+
+void ResetLockStatistics() {
+  for (auto& state : LockClassState::Iter()) {
+    state.statistics().Reset();
+  }
+}
+
+int CommandLockStat(int argc, const cmd_args* argv, uint32_t flags) {
+  if (argc < 2) {
+    printf("Not enough arguments:\n");
+  usage:
+    printf("%s dump [contended|wait|hold|count] [n] : dump the top n lock classes\n",
+           argv[0].str);
+    printf("%s reset                                 : reset lock statistics\n", argv[0].str);
+    return -1;
+  }
+
+  if (strcmp(argv[1].str, "dump") == 0) {
+    SortKey key = SortKey::Contended;
+    if (argc >= 3 && !ParseSortKey(argv[2].str, &key)) {
+      printf("Unrecognized sort key: '%s'\n", argv[2].str);
+      goto usage;
+    }
+    size_t count = 20;
+    if (argc >= 4) {
+      count = argv[3].u;
+    }
+    count = ktl::clamp<size_t>(count, 1, kMaxDumpEntries);
+    DumpLockStatistics(key, count);
+  } else if (strcmp(argv[1].str, "reset") == 0) {
+    ResetLockStatistics();
+  } else {
+    printf("Unrecognized subcommand: '%s'\n", argv[1].str);
+    goto usage;
+  }
+
+  return 0;
+}
+
+}  // anonymous namespace
+
+STATIC_COMMAND_START
+STATIC_COMMAND("lockstat", "kernel lock contention statistics", &CommandLockStat)
+STATIC_COMMAND_END(lockstat)
+
+#endif
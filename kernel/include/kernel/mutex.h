@@ -53,6 +53,10 @@ class TA_CAP("mutex") Mutex {
   // a lock. The asserts may be optimized away in release builds.
   void AssertHeld() const TA_ASSERT() { DEBUG_ASSERT(IsHeld()); }
 
+  // Is the mutex held by any thread? The answer may be stale by the time the
+  // caller sees it; this is only suitable for statistics.
+  bool IsLocked() const { return val() != STATE_FREE; }
+
  private:
   enum class ThreadLockState : bool { NotHeld = false, Held = true };
 
@@ -72,6 +76,10 @@ class TA_CAP("mutex") Mutex {
 
   Thread* holder() const { return holder_from_val(val()); }
 
+  // Whether the holder named by |observed_state| is running on a CPU, so that
+  // spinning for it to release the mutex is worthwhile.
+  bool HolderIsRunning(uintptr_t observed_state) const;
+
   fbl::Canary<MAGIC> magic_;
   ktl::atomic<uintptr_t> val_{STATE_FREE};
   OwnedWaitQueue wait_;
@@ -101,6 +109,12 @@ struct MutexPolicy {
     lock.AssertHeld();
   }
 
+  // Samples whether the lock is held, for lock statistics.
+  template <typename LockType>
+  static bool IsLocked(const LockType& lock) {
+    return lock.IsLocked();
+  }
+
   // A enum tag that can be passed to Guard<Mutex>::Release(...) to
   // select the special-case release method below.
   enum SelectThreadLockHeld { ThreadLockHeld };
@@ -63,6 +63,11 @@ class Scheduler {
   // Returns the number of the CPU this scheduler instance is associated with.
   cpu_num_t this_cpu() const { return this_cpu_; }
 
+  // Returns whether |thread| is the active thread of any CPU. The answer may be
+  // stale by the time the caller sees it. |thread| is only compared by address
+  // and never dereferenced, so it may name a thread that has already exited.
+  static bool IsActiveOnAnyCpu(const Thread* thread);
+
   zx_duration_t predicted_queue_time_ns() const {
     return exported_total_expected_runtime_ns_.load().raw_value();
   }
@@ -406,6 +411,10 @@ class Scheduler {
   RelaxedAtomic<SchedDuration> exported_total_expected_runtime_ns_{SchedNs(0)};
   RelaxedAtomic<SchedUtilization> exported_total_deadline_utilization_{SchedUtilization{0}};
 
+  // Mirror of |active_thread_|, so that other CPUs can tell whether a thread is
+  // running without looking at the thread itself.
+  RelaxedAtomic<const Thread*> exported_active_thread_{nullptr};
+
   // The CPU this scheduler instance is associated with.
   // NOTE: This member is not initialized to prevent clobbering the value set
   // by sched_early_init(), which is called before the global ctors that
@@ -36,6 +36,10 @@ class Semaphore {
   // of ZX_ERR_INTERNAL_INTR errors if the thread had a signal delivered.
   zx_status_t Wait(const Deadline& deadline);
 
+  // Decrement the count by as much as it can without going below zero, up to
+  // |max|, and return the amount it was decremented by.  Never waits.
+  uint64_t TryWait(uint64_t max);
+
   // Observe the current internal count of the semaphore.
   uint64_t count() {
     Guard<SpinLock, IrqSave> guard{ThreadLock::Get()};
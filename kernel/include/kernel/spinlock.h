@@ -116,6 +116,7 @@ struct NoIrqSavePolicy {
   static void AssertHeld(const SpinLock& lock) TA_ASSERT(lock) {
     const_cast<SpinLock*>(&lock)->AssertHeld();
   }
+  static bool IsLocked(const SpinLock& lock) { return lock.HolderCpu() != INVALID_CPU; }
 };
 
 // Configure Guard<SpinLock, NoIrqSave> to use the above policy to acquire and
@@ -139,6 +140,7 @@ struct IrqSavePolicy {
   static void AssertHeld(const SpinLock& lock) TA_ASSERT(lock) {
     const_cast<SpinLock*>(&lock)->AssertHeld();
   }
+  static bool IsLocked(const SpinLock& lock) { return lock.HolderCpu() != INVALID_CPU; }
 };
 
 // Configure Guard<SpinLock, IrqSave> to use the above policy to acquire and
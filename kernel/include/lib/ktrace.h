@@ -50,10 +50,10 @@ static inline uint64_t ktrace_timestamp() { return current_ticks(); }
 #define KTRACE_STRING_REF_CAT(a, b) a##b
 #define KTRACE_STRING_REF(string) KTRACE_STRING_REF_CAT(string, _stringref)
 
-// Allocates a new trace record in the trace buffer. Returns a pointer to the
-// start of the record or nullptr if tracing is disabled or the end of the
-// buffer is reached.
-void* ktrace_open(uint32_t tag, uint64_t ts = ktrace_timestamp());
+// Writes a trace record with the given tag, copying its payload from |payload|.
+// Returns false if tracing is disabled or the record could not be written.
+// The record only becomes visible to readers once it has been filled in.
+bool ktrace_write(uint32_t tag, const void* payload, uint64_t ts = ktrace_timestamp());
 
 // Emits a tiny trace record.
 void ktrace_tiny(uint32_t tag, uint32_t arg);
@@ -66,12 +66,8 @@ inline void ktrace(TraceEnabled<enabled>, TraceContext context, uint32_t tag, ui
   if constexpr (enabled) {
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
-    if (uint32_t* data = static_cast<uint32_t*>(ktrace_open(effective_tag, explicit_ts))) {
-      data[0] = a;
-      data[1] = b;
-      data[2] = c;
-      data[3] = d;
-    }
+    const uint32_t args[] = {a, b, c, d};
+    ktrace_write(effective_tag, args, explicit_ts);
   } else {
     (void)context;
     (void)tag;
@@ -105,7 +101,7 @@ inline void ktrace_probe(TraceEnabled<enabled>, TraceContext context, StringRef*
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    ktrace_open(effective_tag);
+    ktrace_write(effective_tag, nullptr);
   } else {
     (void)context;
     (void)string_ref;
@@ -120,12 +116,8 @@ inline void ktrace_probe(TraceEnabled<enabled>, TraceContext context, StringRef*
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint32_t* const args = static_cast<uint32_t*>(payload);
-    if (args) {
-      args[0] = a;
-      args[1] = b;
-    }
+    const uint32_t args[] = {a, b};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)string_ref;
@@ -142,11 +134,8 @@ inline void ktrace_probe(TraceEnabled<enabled>, TraceContext context, StringRef*
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint64_t* const args = static_cast<uint64_t*>(payload);
-    if (args) {
-      args[0] = a;
-    }
+    const uint64_t args[] = {a};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)string_ref;
@@ -162,12 +151,8 @@ inline void ktrace_probe(TraceEnabled<enabled>, TraceContext context, StringRef*
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint64_t* const args = static_cast<uint64_t*>(payload);
-    if (args) {
-      args[0] = a;
-      args[1] = b;
-    }
+    const uint64_t args[] = {a, b};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)string_ref;
@@ -184,7 +169,7 @@ inline void ktrace_begin_duration(TraceEnabled<enabled>, TraceContext context, u
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    ktrace_open(effective_tag);
+    ktrace_write(effective_tag, nullptr);
   } else {
     (void)context;
     (void)group;
@@ -200,7 +185,7 @@ inline void ktrace_end_duration(TraceEnabled<enabled>, TraceContext context, uin
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    ktrace_open(effective_tag);
+    ktrace_write(effective_tag, nullptr);
   } else {
     (void)context;
     (void)group;
@@ -216,12 +201,8 @@ inline void ktrace_begin_duration(TraceEnabled<enabled>, TraceContext context, u
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint64_t* const args = static_cast<uint64_t*>(payload);
-    if (args) {
-      args[0] = a;
-      args[1] = b;
-    }
+    const uint64_t args[] = {a, b};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)group;
@@ -239,12 +220,8 @@ inline void ktrace_end_duration(TraceEnabled<enabled>, TraceContext context, uin
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint64_t* const args = static_cast<uint64_t*>(payload);
-    if (args) {
-      args[0] = a;
-      args[1] = b;
-    }
+    const uint64_t args[] = {a, b};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)group;
@@ -262,12 +239,8 @@ inline void ktrace_flow_begin(TraceEnabled<enabled>, TraceContext context, uint3
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint64_t* const args = static_cast<uint64_t*>(payload);
-    if (args) {
-      args[0] = flow_id;
-      args[1] = a;
-    }
+    const uint64_t args[] = {flow_id, a};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)group;
@@ -285,12 +258,8 @@ inline void ktrace_flow_end(TraceEnabled<enabled>, TraceContext context, uint32_
     const uint32_t effective_tag =
         KTRACE_TAG_FLAGS(tag, context == TraceContext::Thread ? 0 : KTRACE_FLAGS_CPU);
 
-    void* const payload = ktrace_open(effective_tag);
-    uint64_t* const args = static_cast<uint64_t*>(payload);
-    if (args) {
-      args[0] = flow_id;
-      args[1] = a;
-    }
+    const uint64_t args[] = {flow_id, a};
+    ktrace_write(effective_tag, args);
   } else {
     (void)context;
     (void)group;
@@ -306,11 +275,8 @@ inline void ktrace_counter(TraceEnabled<enabled>, uint32_t group, StringRef* str
   if constexpr (enabled) {
     const uint32_t tag =
         KTRACE_TAG_FLAGS(TAG_COUNTER(string_ref->GetId(), group), KTRACE_FLAGS_CPU);
-    void* const payload = ktrace_open(tag);
-    if (payload) {
-      static_cast<uint64_t*>(payload)[0] = counter_id;
-      static_cast<int64_t*>(payload)[1] = value;
-    }
+    const uint64_t args[] = {counter_id, static_cast<uint64_t>(value)};
+    ktrace_write(tag, args);
   } else {
     (void)group;
     (void)string_ref;
@@ -325,6 +291,16 @@ static inline void ktrace_name(uint32_t tag, uint32_t id, uint32_t arg, const ch
   ktrace_name_etc(tag, id, arg, name, false);
 }
 
+// Copies trace records to the user buffer |ptr|. While tracing is active, records are drained:
+// whole records are returned and their space is released to writers. Each read must continue the
+// stream, so |off| must be the total number of bytes returned since tracing was last rewound,
+// modulo 2^32; other offsets fail with ZX_ERR_INVALID_ARGS. Once tracing is stopped, the remaining
+// records can be read at any offset. A null |ptr| returns the number of bytes available.
+//
+// Records are kept per cpu, in blocks of up to a page. The stream holds the name records first,
+// then blocks of other records. A streaming read returns blocks in the order of the timestamp of
+// their first record; once tracing is stopped, the blocks of each cpu follow those of the one
+// before. Neither makes the records as a whole ordered by timestamp, so readers must sort them.
 ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len);
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr);
 
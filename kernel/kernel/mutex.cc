@@ -23,6 +23,7 @@
 #include <lib/affine/ratio.h>
 #include <lib/affine/utils.h>
 #include <lib/arch/intrin.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
 #include <platform.h>
 #include <trace.h>
@@ -36,6 +37,10 @@
 
 #define LOCAL_TRACE 0
 
+KCOUNTER(mutex_spin_acquire_count, "kernel.mutex.acquire.spin")
+KCOUNTER(mutex_block_count, "kernel.mutex.acquire.block")
+KCOUNTER(mutex_spin_holder_stopped_count, "kernel.mutex.spin.holder_stopped")
+
 namespace {
 
 enum class KernelMutexTracingLevel {
@@ -156,6 +161,7 @@ void Mutex::Acquire(zx_duration_t spin_max_duration) {
       // Same as above in the fastest path: leave accounting to later contending
       // threads.
       KTracer{}.KernelMutexUncontestedAcquire(this);
+      kcounter_add(mutex_spin_acquire_count, 1);
       return;
     }
 
@@ -165,6 +171,14 @@ void Mutex::Acquire(zx_duration_t spin_max_duration) {
       break;
     }
 
+    // Stop spinning if the holder is not running. It cannot release the mutex
+    // until it is scheduled again, which is at least as long as it would take
+    // us to block.
+    if (!HolderIsRunning(old_mutex_state)) {
+      kcounter_add(mutex_spin_holder_stopped_count, 1);
+      break;
+    }
+
     // Give the arch a chance to relax the CPU.
     arch::Yield();
   } while (current_ticks() < spin_until_ticks);
@@ -204,6 +218,7 @@ void Mutex::Acquire(zx_duration_t spin_max_duration) {
     // proper queue owner as we block.
     Thread* cur_owner = holder_from_val(old_mutex_state);
     KTracer{}.KernelMutexBlock(this, cur_owner, wait_.Count() + 1);
+    kcounter_add(mutex_block_count, 1);
     zx_status_t ret = wait_.BlockAndAssignOwner(Deadline::infinite(), cur_owner,
                                                 ResourceOwnership::Normal, Interruptible::No);
 
@@ -219,6 +234,16 @@ void Mutex::Acquire(zx_duration_t spin_max_duration) {
   }
 }
 
+bool Mutex::HolderIsRunning(uintptr_t observed_state) const {
+  // The holder may drop the mutex and exit as soon as |observed_state| was
+  // read, so its Thread must not be touched here. Instead, look for it among
+  // the threads each CPU's scheduler has published as active; the holder is
+  // only compared by address. If the mutex changed hands in the meantime,
+  // report the holder as running so that the caller simply tries again.
+  const Thread* holder = holder_from_val(observed_state);
+  return Scheduler::IsActiveOnAnyCpu(holder) || (val() != observed_state);
+}
+
 // Shared implementation of release
 template <Mutex::ThreadLockState TLS>
 void Mutex::ReleaseInternal(const bool allow_reschedule) {
@@ -244,6 +244,15 @@ size_t Scheduler::GetRunnableTasks() const {
   return static_cast<size_t>(total_runnable_tasks);
 }
 
+bool Scheduler::IsActiveOnAnyCpu(const Thread* thread) {
+  for (cpu_num_t i = 0; i < percpu::processor_count(); i++) {
+    if (percpu::Get(i).scheduler.exported_active_thread_.load() == thread) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Performs an augmented binary search for the task with the earliest finish
 // time that is also equal to or later than the given eligible time.
 //
@@ -756,6 +765,7 @@ void Scheduler::RescheduleCommon(SchedTime now, EndTraceCallback end_outer_trace
   }
 
   active_thread_ = next_thread;
+  exported_active_thread_ = next_thread;
 
   // Update the expected runtime of the current thread and the per-CPU total.
   // Only update the thread and aggregate values if the current thread is still
@@ -42,3 +42,11 @@ zx_status_t Semaphore::Wait(const Deadline& deadline) {
   // the wait operation ended.
   return waitq_.Block(deadline, Interruptible::Yes);
 }
+
+uint64_t Semaphore::TryWait(uint64_t max) {
+  Guard<SpinLock, IrqSave> guard{ThreadLock::Get()};
+
+  const uint64_t taken = (count_ < max) ? count_ : max;
+  count_ -= taken;
+  return taken;
+}
@@ -309,6 +309,53 @@ static bool test_confine() {
   END_TEST;
 }
 
+static bool cpu_caches() {
+  BEGIN_TEST;
+
+  constexpr int preserve = 8;
+  constexpr char magic[preserve + 1] = "preserve";
+
+  // Use more objects than a single CPU cache can hold so that frees also drain back to the shared
+  // free list.
+  constexpr int kSize = 64;
+  constexpr int count = PAGE_SIZE / kSize;
+  GPArena<preserve, kSize> arena;
+  ASSERT_EQ(arena.Init("test", count), ZX_OK);
+  ASSERT_EQ(arena.EnableCpuCaches(), ZX_OK);
+  void* allocs[count];
+
+  for (int i = 0; i < count; i++) {
+    allocs[i] = arena.Alloc();
+    ASSERT_NONNULL(allocs[i]);
+    memcpy(allocs[i], magic, preserve);
+  }
+  EXPECT_NULL(arena.Alloc());
+  EXPECT_EQ(static_cast<size_t>(count), arena.DiagnosticCount());
+
+  for (int i = 0; i < count; i++) {
+    arena.Free(allocs[i]);
+  }
+  EXPECT_EQ(0u, arena.DiagnosticCount());
+
+  // Every object must be allocatable again, regardless of which CPU's cache it ended up in, and
+  // must still hold its preserved data.
+  for (int i = 0; i < count; i++) {
+    allocs[i] = arena.Alloc();
+    ASSERT_NONNULL(allocs[i]);
+    EXPECT_EQ(memcmp(allocs[i], magic, preserve), 0);
+  }
+  EXPECT_NULL(arena.Alloc());
+
+  // Cleanup. Draining the caches returns everything to the shared free list.
+  for (int i = 0; i < count; i++) {
+    arena.Free(allocs[i]);
+  }
+  arena.DrainCpuCaches();
+  EXPECT_EQ(0u, arena.DiagnosticCountUpperBound());
+
+  END_TEST;
+}
+
 #define GPARENA_UNITTEST(fname) UNITTEST(#fname, fname)
 
 UNITTEST_START_TESTCASE(gparena_tests)
@@ -320,4 +367,5 @@ GPARENA_UNITTEST(committed_monotonic)
 GPARENA_UNITTEST(parallel_alloc)
 GPARENA_UNITTEST(parallel_grow_memory)
 GPARENA_UNITTEST(test_confine)
+GPARENA_UNITTEST(cpu_caches)
 UNITTEST_END_TESTCASE(gparena_tests, "gparena_tests", "GPArena test")
@@ -8,9 +8,13 @@
 #define ZIRCON_KERNEL_LIB_FBL_INCLUDE_FBL_GPARENA_H_
 
 #include <align.h>
+#include <arch/ops.h>
+#include <fbl/alloc_checker.h>
 #include <fbl/auto_call.h>
 #include <fbl/confine_array_index.h>
+#include <kernel/align.h>
 #include <kernel/mutex.h>
+#include <kernel/spinlock.h>
 #include <vm/vm_address_region.h>
 #include <vm/vm_aspace.h>
 #include <vm/vm_object_paged.h>
@@ -20,11 +24,20 @@ namespace fbl {
 // Growable Persistant Arena (GPArena) is an arena that allows for fast allocation and deallocation
 // of a single kind of object. Compared to other arena style allocators it additionally guarantees
 // that a portion of the objects memory will be preserved between calls to Free+Alloc.
+//
+// By default all objects are allocated from, and freed to, a single lock-free free list. Arenas
+// with many concurrent users can additionally call EnableCpuCaches() so that the common Alloc and
+// Free paths touch only state belonging to the current CPU.
 template <size_t PersistSize, size_t ObjectSize>
 class __OWNER(void) GPArena {
  public:
   GPArena() = default;
   ~GPArena() {
+    CpuCache* caches = cpu_caches_.load(ktl::memory_order_relaxed);
+    if (caches != nullptr) {
+      DrainCpuCaches();
+      delete[] caches;
+    }
     DEBUG_ASSERT(count_ == 0);
     if (vmar_ != nullptr) {
       // Unmap all of our memory and free our resources.
@@ -89,63 +102,88 @@ class __OWNER(void) GPArena {
     return ZX_OK;
   }
 
+  // Enable the per-CPU free object caches. Once enabled, Free places objects in a small cache
+  // belonging to the current CPU and Alloc takes them back from it, only falling back to the shared
+  // free list to refill or drain a cache in batches of |kCpuCacheBatch| objects. Refilling a cache
+  // never grows the arena; if the arena is full, Alloc takes objects from other CPUs' caches before
+  // failing.
+  //
+  // Enabling the caches does not change the Persist guarantee, but objects are no longer reused in
+  // strict last-in-first-out order across CPUs.
+  //
+  // May only be called after a successful Init. Returns ZX_ERR_NO_MEMORY if the caches could not be
+  // allocated, in which case the arena continues to work without them.
+  zx_status_t EnableCpuCaches() {
+    DEBUG_ASSERT(vmar_ != nullptr);
+    if (cpu_caches_.load(ktl::memory_order_relaxed) != nullptr) {
+      return ZX_OK;
+    }
+    const size_t count = arch_max_num_cpus();
+    fbl::AllocChecker ac;
+    CpuCache* caches = new (&ac) CpuCache[count];
+    if (!ac.check()) {
+      return ZX_ERR_NO_MEMORY;
+    }
+    cpu_cache_count_ = count;
+    // Use release so that cpu_cache_count_ and the constructed caches are visible to anyone who
+    // observes the pointer.
+    cpu_caches_.store(caches, ktl::memory_order_release);
+    return ZX_OK;
+  }
+
+  // Return all objects held in the per-CPU caches to the shared free list.
+  void DrainCpuCaches() {
+    CpuCache* caches = cpu_caches_.load(ktl::memory_order_acquire);
+    if (caches == nullptr) {
+      return;
+    }
+    for (size_t i = 0; i < cpu_cache_count_; i++) {
+      FreeNode* list;
+      {
+        Guard<SpinLock, IrqSave> guard{&caches[i].lock};
+        list = caches[i].head;
+        caches[i].head = nullptr;
+        caches[i].count.store(0, ktl::memory_order_relaxed);
+      }
+      FreePoolList(list);
+    }
+  }
+
   // Returns a raw pointer and not a reference to an object of type T so that the memory can be
   // inspected prior to construction taking place.
   void* Alloc() {
-    // Take a local copy/snapshot of the current head node.
-    // Use an acquire to match with the release in Free.
-    HeadNode head_node = head_node_.load(ktl::memory_order_acquire);
-    while (head_node.head) {
-      const HeadNode next_head_node(head_node.head->next, head_node.gen + 1);
-      if (head_node_.compare_exchange_strong(head_node, next_head_node, ktl::memory_order_acquire,
-                                             ktl::memory_order_acquire)) {
-        count_.fetch_add(1, ktl::memory_order_relaxed);
-        return reinterpret_cast<void*>(head_node.head);
-      }
-      // There is no pause here as we don't need to wait for anyone before trying again,
-      // rather the sooner we retry the *more* likely we are to succeed given that we just
-      // received the most up to date copy of head_node.
+    CpuCache* caches = cpu_caches_.load(ktl::memory_order_acquire);
+    if (caches != nullptr) {
+      const cpu_num_t cpu = arch_curr_cpu_num();
+      DEBUG_ASSERT(cpu < cpu_cache_count_);
+      return AllocFromCpuCache(&caches[cpu]);
     }
-
-    // Nothing in the free list, we need to grow.
-    uintptr_t top = top_.load(ktl::memory_order_relaxed);
-    uintptr_t next_top;
-    do {
-      // Every time the compare_exchange below fails top becomes the current value and so
-      // we recalculate our potential next_top every iteration from it.
-      next_top = top + ObjectSize;
-      // See if we need to commit more memory.
-      if (next_top > committed_.load(ktl::memory_order_relaxed)) {
-        if (!Grow(next_top)) {
-          return nullptr;
-        }
-      }
-    } while (!top_.compare_exchange_strong(top, next_top, ktl::memory_order_relaxed,
-                                           ktl::memory_order_relaxed));
-    count_.fetch_add(1, ktl::memory_order_relaxed);
-    return reinterpret_cast<void*>(top);
+    return AllocFromPool();
   }
 
   // Takes a raw pointer as the destructor is expected to have already been run.
   void Free(void* node) {
-    FreeNode* free_node = reinterpret_cast<FreeNode*>(node);
-    // Take a local copy/snapshot of the current head node.
-    HeadNode head_node = head_node_.load(ktl::memory_order_relaxed);
-    HeadNode next_head_node;
-    do {
-      // Every time the compare_exchange below fails head_node becomes the current value and so
-      // we need to reset our intended next pointer every iteration.
-      free_node->next = head_node.head;
-      // Build our candidate next head node.
-      next_head_node = HeadNode(free_node, head_node.gen + 1);
-      // Use release semantics so that any writes to the Persist area, and our write to
-      // free_node->next, are visible before the node can be seen in the free list and reused.
-    } while (!head_node_.compare_exchange_strong(
-        head_node, next_head_node, ktl::memory_order_release, ktl::memory_order_relaxed));
-    count_.fetch_sub(1, ktl::memory_order_relaxed);
+    CpuCache* caches = cpu_caches_.load(ktl::memory_order_acquire);
+    if (caches != nullptr) {
+      const cpu_num_t cpu = arch_curr_cpu_num();
+      DEBUG_ASSERT(cpu < cpu_cache_count_);
+      FreeToCpuCache(&caches[cpu], reinterpret_cast<FreeNode*>(node));
+      return;
+    }
+    FreeToPool(reinterpret_cast<FreeNode*>(node));
+  }
+
+  // Returns the number of allocated objects. With per-CPU caches enabled this must visit every
+  // cache and is only approximate whilst other CPUs are allocating or freeing.
+  size_t DiagnosticCount() const {
+    size_t count = count_.load(ktl::memory_order_relaxed);
+    const size_t cached = CachedCount();
+    return count > cached ? count - cached : 0;
   }
 
-  size_t DiagnosticCount() const { return count_.load(ktl::memory_order_relaxed); }
+  // Returns an upper bound on DiagnosticCount that is cheap enough to check on every allocation.
+  // The bound exceeds the allocated count by at most the number of objects in per-CPU caches.
+  size_t DiagnosticCountUpperBound() const { return count_.load(ktl::memory_order_relaxed); }
 
   bool Committed(void* node) const {
     uintptr_t n = reinterpret_cast<uintptr_t>(node);
@@ -184,6 +222,9 @@ class __OWNER(void) GPArena {
     printf(" end 0x%#zx (%zu slots total)\n", end_, tslots);
     const size_t free_list = nslots - count_;
     printf(" free list length %zu\n", free_list);
+    if (cpu_caches_.load(ktl::memory_order_relaxed) != nullptr) {
+      printf(" cpu caches %zu objects\n", CachedCount());
+    }
   }
 
  private:
@@ -226,12 +267,184 @@ class __OWNER(void) GPArena {
     // This struct is explicitly not packed to allow for the next field to be naturally aligned.
     // As a result we *may* preserve more than PersistSize, but that is fine. This is not an atomic
     // as reads and writes will be serialized with our updates to head_node_, which acts like a
-    // lock.
+    // lock, or with the lock of the per-CPU cache holding the node.
     FreeNode* next;
   };
   static_assert(sizeof(FreeNode) <= ObjectSize, "Not enough free space in object");
   static_assert((ObjectSize % alignof(FreeNode)) == 0,
                 "ObjectSize must be common alignment multiple");
+
+  // Maximum number of objects moved from the shared free list into a per-CPU cache at a time, and
+  // the number of objects a cache may hold before it is drained back down.
+  static constexpr size_t kCpuCacheBatch = 16;
+  static constexpr size_t kCpuCacheMax = 2 * kCpuCacheBatch;
+
+  // Per-CPU cache of free objects, linked through FreeNode::next exactly like the shared free list
+  // so that the Persist area is untouched. |count| is only modified with |lock| held, but is atomic
+  // so that the diagnostic counts can read it without taking every lock.
+  struct __CPU_ALIGN CpuCache {
+    DECLARE_SPINLOCK(GPArena::CpuCache) lock;
+    FreeNode* head TA_GUARDED(lock) = nullptr;
+    ktl::atomic<size_t> count = 0;
+  };
+
+  // Allocates an object from the shared free list, growing the arena if the list is empty.
+  void* AllocFromPool() {
+    FreeNode* node = PopFreeList();
+    if (node != nullptr) {
+      return node;
+    }
+
+    // Nothing in the free list, we need to grow.
+    uintptr_t top = top_.load(ktl::memory_order_relaxed);
+    uintptr_t next_top;
+    do {
+      // Every time the compare_exchange below fails top becomes the current value and so
+      // we recalculate our potential next_top every iteration from it.
+      next_top = top + ObjectSize;
+      // See if we need to commit more memory.
+      if (next_top > committed_.load(ktl::memory_order_relaxed)) {
+        if (!Grow(next_top)) {
+          return nullptr;
+        }
+      }
+    } while (!top_.compare_exchange_strong(top, next_top, ktl::memory_order_relaxed,
+                                           ktl::memory_order_relaxed));
+    count_.fetch_add(1, ktl::memory_order_relaxed);
+    return reinterpret_cast<void*>(top);
+  }
+
+  // Removes the head of the shared free list, without growing the arena.
+  FreeNode* PopFreeList() {
+    // Take a local copy/snapshot of the current head node.
+    // Use an acquire to match with the release in FreeToPool.
+    HeadNode head_node = head_node_.load(ktl::memory_order_acquire);
+    while (head_node.head) {
+      const HeadNode next_head_node(head_node.head->next, head_node.gen + 1);
+      if (head_node_.compare_exchange_strong(head_node, next_head_node, ktl::memory_order_acquire,
+                                             ktl::memory_order_acquire)) {
+        count_.fetch_add(1, ktl::memory_order_relaxed);
+        return head_node.head;
+      }
+      // There is no pause here as we don't need to wait for anyone before trying again,
+      // rather the sooner we retry the *more* likely we are to succeed given that we just
+      // received the most up to date copy of head_node.
+    }
+    return nullptr;
+  }
+
+  void FreeToPool(FreeNode* free_node) {
+    // Take a local copy/snapshot of the current head node.
+    HeadNode head_node = head_node_.load(ktl::memory_order_relaxed);
+    HeadNode next_head_node;
+    do {
+      // Every time the compare_exchange below fails head_node becomes the current value and so
+      // we need to reset our intended next pointer every iteration.
+      free_node->next = head_node.head;
+      // Build our candidate next head node.
+      next_head_node = HeadNode(free_node, head_node.gen + 1);
+      // Use release semantics so that any writes to the Persist area, and our write to
+      // free_node->next, are visible before the node can be seen in the free list and reused.
+    } while (!head_node_.compare_exchange_strong(
+        head_node, next_head_node, ktl::memory_order_release, ktl::memory_order_relaxed));
+    count_.fetch_sub(1, ktl::memory_order_relaxed);
+  }
+
+  // Returns every object on a null terminated list to the shared free list.
+  void FreePoolList(FreeNode* list) {
+    while (list != nullptr) {
+      FreeNode* next = list->next;
+      FreeToPool(list);
+      list = next;
+    }
+  }
+
+  void* AllocFromCpuCache(CpuCache* cache) {
+    {
+      Guard<SpinLock, IrqSave> guard{&cache->lock};
+      FreeNode* node = cache->head;
+      if (node != nullptr) {
+        cache->head = node->next;
+        cache->count.store(cache->count.load(ktl::memory_order_relaxed) - 1,
+                           ktl::memory_order_relaxed);
+        return node;
+      }
+    }
+
+    // The cache is empty. Allocate the caller's object first, as this is the only step that may
+    // need to grow the arena, and then move up to a batch of already free objects into the cache.
+    void* node = AllocFromPool();
+    if (node == nullptr) {
+      return StealFromCpuCaches();
+    }
+
+    Guard<SpinLock, IrqSave> guard{&cache->lock};
+    size_t count = cache->count.load(ktl::memory_order_relaxed);
+    while (count < kCpuCacheBatch) {
+      FreeNode* extra = PopFreeList();
+      if (extra == nullptr) {
+        break;
+      }
+      extra->next = cache->head;
+      cache->head = extra;
+      count++;
+    }
+    cache->count.store(count, ktl::memory_order_relaxed);
+    return node;
+  }
+
+  void FreeToCpuCache(CpuCache* cache, FreeNode* free_node) {
+    FreeNode* drain = nullptr;
+    {
+      Guard<SpinLock, IrqSave> guard{&cache->lock};
+      free_node->next = cache->head;
+      cache->head = free_node;
+      size_t count = cache->count.load(ktl::memory_order_relaxed) + 1;
+      if (count > kCpuCacheMax) {
+        // Keep the most recently freed objects, which are the most likely to still be in the cache,
+        // and return the rest to the shared free list outside of the lock.
+        FreeNode* last = cache->head;
+        for (size_t i = 1; i < kCpuCacheMax - kCpuCacheBatch; i++) {
+          last = last->next;
+        }
+        drain = last->next;
+        last->next = nullptr;
+        count = kCpuCacheMax - kCpuCacheBatch;
+      }
+      cache->count.store(count, ktl::memory_order_relaxed);
+    }
+    FreePoolList(drain);
+  }
+
+  // Called when the shared free list is empty and the arena cannot grow. Objects may still be held
+  // in the caches of other CPUs, so take one from the first cache that has any.
+  void* StealFromCpuCaches() {
+    CpuCache* caches = cpu_caches_.load(ktl::memory_order_acquire);
+    for (size_t i = 0; i < cpu_cache_count_; i++) {
+      Guard<SpinLock, IrqSave> guard{&caches[i].lock};
+      FreeNode* node = caches[i].head;
+      if (node != nullptr) {
+        caches[i].head = node->next;
+        caches[i].count.store(caches[i].count.load(ktl::memory_order_relaxed) - 1,
+                              ktl::memory_order_relaxed);
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  size_t CachedCount() const {
+    CpuCache* caches = cpu_caches_.load(ktl::memory_order_acquire);
+    if (caches == nullptr) {
+      return 0;
+    }
+    size_t cached = 0;
+    for (size_t i = 0; i < cpu_cache_count_; i++) {
+      cached += caches[i].count.load(ktl::memory_order_relaxed);
+    }
+    return cached;
+  }
+
   fbl::RefPtr<VmAddressRegion> vmar_;
   fbl::RefPtr<VmMapping> mapping_;
 
@@ -246,8 +459,14 @@ class __OWNER(void) GPArena {
 
   DECLARE_MUTEX(GPArena) mapping_lock_;
 
+  // Number of objects that are not on the shared free list. This includes objects held in the
+  // per-CPU caches, which DiagnosticCount subtracts back out.
   ktl::atomic<size_t> count_ = 0;
 
+  // One cache per CPU, allocated by EnableCpuCaches() and only freed by the destructor.
+  ktl::atomic<CpuCache*> cpu_caches_ = nullptr;
+  size_t cpu_cache_count_ = 0;
+
   // Stores the current head pointer and a generation count. The generation count prevents races
   // where one thread is modifying the list whilst another thread rapidly adds and removes. Every
   // time a HeadNode is modified the generation count should be incremented to generate a unique
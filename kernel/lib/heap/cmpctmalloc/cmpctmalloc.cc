@@ -114,6 +114,17 @@
 //   Exception: to avoid OS free/alloc churn when right on the edge, the heap
 //   will try to hold onto one entirely-free, non-large OS allocation instead of
 //   returning it to the OS. See cached_os_alloc.
+//
+// Per-CPU caches:
+//   Small allocations (up to CACHE_MAX_SIZE bytes) are served from a per-CPU
+//   cache of memory areas before taking the global heap lock. Cached areas
+//   keep their allocated header and are chained through their payload, one
+//   list per free bucket. An empty list is refilled with CACHE_BATCH areas
+//   from the free buckets under a single acquisition of the heap lock, and a
+//   list that grows past CACHE_MAX_OBJECTS flushes CACHE_BATCH areas back.
+//   Cached areas count as used, not free, in cmpct_get_info(). cmpct_trim()
+//   flushes all caches. The caches are not used with kernel ASAN, since every
+//   free must go through the quarantine.
 
 #if defined(DEBUG) || LK_DEBUGLEVEL > 2
 #include <platform.h>
@@ -123,11 +134,16 @@
 
 #ifdef _KERNEL
 #include <debug.h>
+#include <lib/counters.h>
 #include <trace.h>
 
+#include <arch/ops.h>
+#include <kernel/spinlock.h>
+
 using LockGuard = ::Guard<Mutex>;
 
 #else
+#include <atomic>
 
 class __TA_SCOPED_CAPABILITY LockGuard {
  public:
@@ -146,6 +162,12 @@ class __TA_SCOPED_CAPABILITY LockGuard {
 
 #endif
 
+#if KERNEL_ASAN
+#define CMPCT_CPU_CACHES 0
+#else
+#define CMPCT_CPU_CACHES 1
+#endif
+
 #define LOCAL_TRACE 0
 
 // Use HEAP_ENABLE_TESTS to enable internal testing. The tests are not useful
@@ -247,6 +269,79 @@ struct heap {
 // Heap static vars.
 static struct heap theheap TA_GUARDED(TheHeapLock::Get());
 
+// Largest usable size of an area that is kept in the per-CPU caches.
+#define CACHE_MAX_SIZE size_t(256)
+
+// Number of free buckets covered by the caches; the bucket of CACHE_MAX_SIZE
+// plus one. Checked in cmpct_init().
+#define CACHE_BUCKETS 24
+
+// Number of areas moved between a cache and the free buckets at once, and the
+// most areas a cache holds per bucket.
+#define CACHE_BATCH 8
+#define CACHE_MAX_OBJECTS (2 * CACHE_BATCH)
+
+#ifdef _KERNEL
+#define CACHE_COUNT SMP_MAX_CPUS
+
+using CacheLockGuard = ::Guard<SpinLock, IrqSave>;
+
+// A thread may migrate after picking a cache; that only costs locality since
+// each cache has its own lock.
+static inline unsigned current_cache_index() { return arch_curr_cpu_num(); }
+
+KCOUNTER(heap_cache_alloc_hit, "heap.cache.alloc_hit")
+KCOUNTER(heap_cache_alloc_miss, "heap.cache.alloc_miss")
+KCOUNTER(heap_cache_free_hit, "heap.cache.free_hit")
+KCOUNTER(heap_cache_flush, "heap.cache.flush")
+
+#define CACHE_COUNTER_ADD(counter, n) kcounter_add(counter, n)
+#else
+#define CACHE_COUNT 16
+
+using CacheLockGuard = LockGuard;
+
+// Host builds have no notion of the current CPU; threads are spread over the
+// caches instead.
+static unsigned current_cache_index() {
+  static std::atomic<unsigned> next_index;
+  thread_local unsigned index = next_index.fetch_add(1) % CACHE_COUNT;
+  return index;
+}
+
+#define CACHE_COUNTER_ADD(counter, n)
+#endif
+
+// A cached memory area. Its header is the one it had when allocated, so FREE_BIT
+// cannot tell it apart from an allocated area; |tag| is set to cached_tag() while
+// the area is in a cache instead. It overlaps free_t's |prev|, so flushing an
+// area to the free buckets overwrites it.
+typedef struct cached_struct {
+  header_t header;
+  struct cached_struct* next;
+  uintptr_t tag;
+} cached_t;
+
+static_assert(sizeof(cached_t) <= sizeof(free_t), "");
+
+static inline uintptr_t cached_tag(const cached_t* area) {
+  return (uintptr_t)area ^ 0xcac4edca11edcac4;
+}
+
+struct alignas(64) cpu_cache {
+#ifdef _KERNEL
+  DECLARE_SPINLOCK(cpu_cache) lock;
+#else
+  std::mutex lock;
+#endif
+
+  // Cached areas, bucketed like the free lists.
+  cached_t* objects[CACHE_BUCKETS] TA_GUARDED(lock);
+  size_t count[CACHE_BUCKETS] TA_GUARDED(lock);
+};
+
+static cpu_cache cpu_caches[CACHE_COUNT];
+
 NO_ASAN static void dump_free(header_t* header) TA_REQ(TheHeapLock::Get()) {
   // This function accesses header->size so it has to be NO_ASAN
   dprintf(INFO, "\t\tbase %p, end %#" PRIxPTR ", len %#zx (%zu)\n", header,
@@ -339,6 +434,14 @@ NO_ASAN static inline bool is_tagged_as_free(const header_t* header) TA_REQ(TheH
   return ((uintptr_t)(header->left) & FREE_BIT) != 0;
 }
 
+// Like is_tagged_as_free(), for areas being freed to a cache. Other threads only
+// rewrite the address portion of an allocated area's |left| field (see
+// FixLeftPointer()), so FREE_BIT is stable unless the area is freed twice.
+NO_ASAN static inline bool is_tagged_as_free_unlocked(const header_t* header)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
+  return ((uintptr_t)__atomic_load_n(&header->left, __ATOMIC_RELAXED) & FREE_BIT) != 0;
+}
+
 static inline header_t* untag(const void* left) TA_REQ(TheHeapLock::Get()) {
   return (header_t*)((uintptr_t)left & ~HEADER_LEFT_BIT_MASK);
 }
@@ -483,10 +586,12 @@ NO_ASAN static void FixLeftPointer(header_t* right, header_t* new_left) TA_REQ(T
 }
 
 #ifdef CMPCT_DEBUG
-[[maybe_unused]] NO_ASAN static void check_free_fill(void* ptr, size_t size)
-    TA_REQ(TheHeapLock::Get()) {
+// Only reads the area being allocated, which the caller owns, so this does
+// not need the heap lock.
+[[maybe_unused]] NO_ASAN static void check_free_fill(void* ptr, size_t size) {
   // The first 16 bytes of the region won't have free fill due to overlap
-  // with the allocator bookkeeping.
+  // with the allocator bookkeeping. Cached areas keep their bookkeeping in
+  // the same bytes, as cached_t is no larger than free_t.
   const size_t start = sizeof(free_t) - sizeof(header_t);
   for (size_t i = start; i < size; ++i) {
     uint8_t byte = ((uint8_t*)ptr)[i];
@@ -837,6 +942,217 @@ static void cmpct_test_return_to_os(void) TA_EXCL(TheHeapLock::Get()) {
 }
 #endif  // HEAP_ENABLE_TESTS
 
+// Carves an area of |rounded_up| bytes (including the header) out of the free
+// buckets, growing the heap if needed. |size| is the requested size.
+NO_ASAN static void* alloc_locked(size_t size, size_t rounded_up, int start_bucket)
+    TA_REQ(TheHeapLock::Get()) {
+  int bucket = find_nonempty_bucket(start_bucket);
+  if (bucket == -1) {
+    // Grow heap by at least 12% if we can.
+    size_t growby = std::min(HEAP_LARGE_ALLOC_BYTES,
+                             std::max(theheap.size >> 3, std::max(HEAP_GROW_SIZE, rounded_up)));
+    // Try to add a new OS allocation to the heap, reducing the size until
+    // we succeed or get too small.
+    while (heap_grow(growby) < 0) {
+      if (growby <= rounded_up) {
+        return NULL;
+      }
+      growby = std::max(growby >> 1, rounded_up);
+    }
+    bucket = find_nonempty_bucket(start_bucket);
+  }
+  free_t* head = theheap.free_lists[bucket];
+  size_t left_over = head->header.size - rounded_up;
+  // We can't carve off the rest for a new free space if it's smaller than the
+  // free-list linked structure.  We also don't carve it off if it's less than
+  // 1.6% the size of the allocation.  This is to avoid small long-lived
+  // allocations being placed right next to large allocations, hindering
+  // coalescing and returning pages to the OS.
+  if (left_over >= sizeof(free_t) && left_over > (size >> 6)) {
+    header_t* right = right_header(&head->header);
+    unlink_free(head, bucket);
+    void* free = (char*)head + rounded_up;
+    create_free_area(free, head, left_over);
+    FixLeftPointer(right, (header_t*)free);
+    head->header.size -= left_over;
+  } else {
+    unlink_free(head, bucket);
+  }
+  return create_allocation_header(head, 0, head->header.size, head->header.left);
+}
+
+// Returns the allocated area at |header| to the free buckets, coalescing it
+// with free neighbors.
+NO_ASAN static void free_locked(header_t* header) TA_REQ(TheHeapLock::Get()) {
+  size_t size = header->size;
+  header_t* left = header->left;
+  if (left != NULL && is_tagged_as_free(left)) {
+    // Coalesce with left free object.
+    unlink_free_unknown_bucket((free_t*)left);
+    header_t* right = right_header(header);
+    if (is_tagged_as_free(right)) {
+      // Coalesce both sides.
+      unlink_free_unknown_bucket((free_t*)right);
+      header_t* right_right = right_header(right);
+      FixLeftPointer(right_right, left);
+      free_memory(left, left->left, left->size + size + right->size);
+    } else {
+      // Coalesce only left.
+      FixLeftPointer(right, left);
+      free_memory(left, left->left, left->size + size);
+    }
+  } else {
+    header_t* right = right_header(header);
+    if (is_tagged_as_free(right)) {
+      // Coalesce only right.
+      header_t* right_right = right_header(right);
+      unlink_free_unknown_bucket((free_t*)right);
+      FixLeftPointer(right_right, header);
+      free_memory(header, left, size + right->size);
+    } else {
+      free_memory(header, left, size);
+    }
+  }
+}
+
+#if CMPCT_CPU_CACHES
+// Returns a chain of cached areas to the free buckets.
+NO_ASAN static void cache_flush_areas(cached_t* areas) TA_EXCL(TheHeapLock::Get()) {
+  LockGuard guard(TheHeapLock::Get());
+  while (areas != NULL) {
+    cached_t* next = areas->next;
+    areas->tag = 0;
+    free_locked(&areas->header);
+    areas = next;
+  }
+}
+
+// Returns an area of |rounded_up| bytes (including the header) from the
+// current cache's list for |bucket|. An empty list is refilled with a batch
+// of areas from the free buckets.
+NO_ASAN static void* cache_alloc(int bucket, size_t rounded_up, int start_bucket)
+    TA_EXCL(TheHeapLock::Get()) {
+  cpu_cache& cache = cpu_caches[current_cache_index()];
+  {
+    CacheLockGuard guard(&cache.lock);
+    cached_t* area = cache.objects[bucket];
+    if (area != NULL) {
+      cache.objects[bucket] = area->next;
+      cache.count[bucket]--;
+      area->tag = 0;
+      CACHE_COUNTER_ADD(heap_cache_alloc_hit, 1);
+      return &area->header + 1;
+    }
+  }
+  CACHE_COUNTER_ADD(heap_cache_alloc_miss, 1);
+
+  const size_t size = rounded_up - sizeof(header_t);
+  void* result;
+  cached_t* batch = NULL;
+  {
+    LockGuard guard(TheHeapLock::Get());
+    result = alloc_locked(size, rounded_up, start_bucket);
+    if (result == NULL) {
+      return NULL;
+    }
+    for (int i = 0; i < CACHE_BATCH - 1; i++) {
+      void* payload = alloc_locked(size, rounded_up, start_bucket);
+      if (payload == NULL) {
+        break;
+      }
+      cached_t* area = (cached_t*)((header_t*)payload - 1);
+      area->tag = cached_tag(area);
+      area->next = batch;
+      batch = area;
+    }
+  }
+
+  if (batch != NULL) {
+    // The thread may have migrated, or the list been refilled by another
+    // thread, in the meantime. Whatever doesn't fit is returned.
+    CacheLockGuard guard(&cache.lock);
+    while (batch != NULL && cache.count[bucket] < CACHE_MAX_OBJECTS) {
+      cached_t* next = batch->next;
+      batch->next = cache.objects[bucket];
+      cache.objects[bucket] = batch;
+      cache.count[bucket]++;
+      batch = next;
+    }
+  }
+  if (batch != NULL) {
+    cache_flush_areas(batch);
+  }
+  return result;
+}
+
+// Puts the allocated area at |header| in the current cache if it is small
+// enough. Returns false if the area must be freed to the free buckets.
+NO_ASAN static bool cache_free(header_t* header) TA_EXCL(TheHeapLock::Get()) {
+  const size_t size = header->size - sizeof(header_t);
+  if (size > CACHE_MAX_SIZE) {
+    return false;
+  }
+  const int bucket = size_to_index_freeing(size);
+
+  cached_t* area = (cached_t*)header;
+  ZX_DEBUG_ASSERT(!is_tagged_as_free_unlocked(header));  // Double free!
+  ZX_DEBUG_ASSERT(area->tag != cached_tag(area));      // Double free!
+  area->tag = cached_tag(area);
+#ifdef CMPCT_DEBUG
+  memset(area + 1, FREE_FILL, header->size - sizeof(cached_t));
+#endif
+
+  cpu_cache& cache = cpu_caches[current_cache_index()];
+  cached_t* flush = NULL;
+  {
+    CacheLockGuard guard(&cache.lock);
+    area->next = cache.objects[bucket];
+    cache.objects[bucket] = area;
+    cache.count[bucket]++;
+    if (cache.count[bucket] > CACHE_MAX_OBJECTS) {
+      // Keep the most recently freed areas and flush the rest.
+      cached_t* last = area;
+      for (int i = 1; i < CACHE_MAX_OBJECTS - CACHE_BATCH; i++) {
+        last = last->next;
+      }
+      flush = last->next;
+      last->next = NULL;
+      cache.count[bucket] = CACHE_MAX_OBJECTS - CACHE_BATCH;
+    }
+  }
+  CACHE_COUNTER_ADD(heap_cache_free_hit, 1);
+
+  if (flush != NULL) {
+    CACHE_COUNTER_ADD(heap_cache_flush, 1);
+    cache_flush_areas(flush);
+  }
+  return true;
+}
+
+// Returns every cached area to the free buckets.
+NO_ASAN static void cache_flush_all() TA_EXCL(TheHeapLock::Get()) {
+  for (cpu_cache& cache : cpu_caches) {
+    cached_t* areas = NULL;
+    {
+      CacheLockGuard guard(&cache.lock);
+      for (int i = 0; i < CACHE_BUCKETS; i++) {
+        while (cache.objects[i] != NULL) {
+          cached_t* area = cache.objects[i];
+          cache.objects[i] = area->next;
+          area->next = areas;
+          areas = area;
+        }
+        cache.count[i] = 0;
+      }
+    }
+    if (areas != NULL) {
+      CACHE_COUNTER_ADD(heap_cache_flush, 1);
+      cache_flush_areas(areas);
+    }
+  }
+}
+#endif  // CMPCT_CPU_CACHES
+
 /****************************************************
  *
  * Public API
@@ -868,48 +1184,35 @@ NO_ASAN void* cmpct_alloc(size_t size) {
   size_t rounded_up;
   int start_bucket = size_to_index_allocating(size, &rounded_up);
 
+#if CMPCT_CPU_CACHES
+  if (rounded_up <= CACHE_MAX_SIZE) {
+    void* result =
+        cache_alloc(size_to_index_freeing(rounded_up), rounded_up + sizeof(header_t), start_bucket);
+#ifdef CMPCT_DEBUG
+    if (result != NULL) {
+      check_free_fill(result, size);
+      memset(result, ALLOC_FILL, size);
+      memset(((char*)result) + size, PADDING_FILL, rounded_up - size);
+    }
+#endif
+    return result;
+  }
+#endif  // CMPCT_CPU_CACHES
+
   rounded_up += sizeof(header_t);
 
   LockGuard guard(TheHeapLock::Get());
-  int bucket = find_nonempty_bucket(start_bucket);
-  if (bucket == -1) {
-    // Grow heap by at least 12% if we can.
-    size_t growby = std::min(HEAP_LARGE_ALLOC_BYTES,
-                             std::max(theheap.size >> 3, std::max(HEAP_GROW_SIZE, rounded_up)));
-    // Try to add a new OS allocation to the heap, reducing the size until
-    // we succeed or get too small.
-    while (heap_grow(growby) < 0) {
-      if (growby <= rounded_up) {
-        return NULL;
-      }
-      growby = std::max(growby >> 1, rounded_up);
-    }
-    bucket = find_nonempty_bucket(start_bucket);
-  }
-  free_t* head = theheap.free_lists[bucket];
-  size_t left_over = head->header.size - rounded_up;
-  // We can't carve off the rest for a new free space if it's smaller than the
-  // free-list linked structure.  We also don't carve it off if it's less than
-  // 1.6% the size of the allocation.  This is to avoid small long-lived
-  // allocations being placed right next to large allocations, hindering
-  // coalescing and returning pages to the OS.
-  if (left_over >= sizeof(free_t) && left_over > (size >> 6)) {
-    header_t* right = right_header(&head->header);
-    unlink_free(head, bucket);
-    void* free = (char*)head + rounded_up;
-    create_free_area(free, head, left_over);
-    FixLeftPointer(right, (header_t*)free);
-    head->header.size -= left_over;
-  } else {
-    unlink_free(head, bucket);
+  void* result = alloc_locked(size, rounded_up, start_bucket);
+  if (result == NULL) {
+    return NULL;
   }
-  void* result = create_allocation_header(head, 0, head->header.size, head->header.left);
 #ifdef CMPCT_DEBUG
   check_free_fill(result, size);
   memset(result, ALLOC_FILL, size);
   memset(((char*)result) + size, PADDING_FILL, rounded_up - size - sizeof(header_t));
 #endif
 #if KERNEL_ASAN
+  header_t* head = (header_t*)result - 1;
   const uintptr_t redzone_start = reinterpret_cast<uintptr_t>(result) + alloc_size;
 
   asan_poison_shadow(reinterpret_cast<uintptr_t>(head), sizeof(header_t),
@@ -943,9 +1246,16 @@ NO_ASAN void cmpct_free(void* payload) {
     return;
   }
 
+  header_t* header = (header_t*)payload - 1;
+
+#if CMPCT_CPU_CACHES
+  if (cache_free(header)) {
+    return;
+  }
+#endif  // CMPCT_CPU_CACHES
+
   LockGuard guard(TheHeapLock::Get());
 
-  header_t* header = (header_t*)payload - 1;
   ZX_DEBUG_ASSERT(!is_tagged_as_free(header));  // Double free!
 
 #if KERNEL_ASAN
@@ -957,35 +1267,7 @@ NO_ASAN void cmpct_free(void* payload) {
   }
 #endif  // KERNEL_ASAN
 
-  size_t size = header->size;
-  header_t* left = header->left;
-  if (left != NULL && is_tagged_as_free(left)) {
-    // Coalesce with left free object.
-    unlink_free_unknown_bucket((free_t*)left);
-    header_t* right = right_header(header);
-    if (is_tagged_as_free(right)) {
-      // Coalesce both sides.
-      unlink_free_unknown_bucket((free_t*)right);
-      header_t* right_right = right_header(right);
-      FixLeftPointer(right_right, left);
-      free_memory(left, left->left, left->size + size + right->size);
-    } else {
-      // Coalesce only left.
-      FixLeftPointer(right, left);
-      free_memory(left, left->left, left->size + size);
-    }
-  } else {
-    header_t* right = right_header(header);
-    if (is_tagged_as_free(right)) {
-      // Coalesce only right.
-      header_t* right_right = right_header(right);
-      unlink_free_unknown_bucket((free_t*)right);
-      FixLeftPointer(right_right, header);
-      free_memory(header, left, size + right->size);
-    } else {
-      free_memory(header, left, size);
-    }
-  }
+  free_locked(header);
 }
 
 NO_ASAN void* cmpct_memalign(size_t alignment, size_t size) {
@@ -1031,6 +1313,19 @@ NO_ASAN void* cmpct_memalign(size_t alignment, size_t size) {
 
 void cmpct_init(void) {
   LTRACE_ENTRY;
+
+#if CMPCT_CPU_CACHES
+  ZX_ASSERT(size_to_index_freeing(CACHE_MAX_SIZE) + 1 == CACHE_BUCKETS);
+  // Any cached areas belong to a previous heap.
+  for (cpu_cache& cache : cpu_caches) {
+    CacheLockGuard guard(&cache.lock);
+    for (int i = 0; i < CACHE_BUCKETS; i++) {
+      cache.objects[i] = NULL;
+      cache.count[i] = 0;
+    }
+  }
+#endif  // CMPCT_CPU_CACHES
+
   LockGuard guard(TheHeapLock::Get());
 
   // Initialize the free lists.
@@ -1142,6 +1437,11 @@ void cmpct_test(void) {}
 #endif  // HEAP_ENABLE_TESTS
 
 void cmpct_trim(void) {
+#if CMPCT_CPU_CACHES
+  // Cached areas may be keeping free memory from coalescing.
+  cache_flush_all();
+#endif  // CMPCT_CPU_CACHES
+
   // Look at free list entries that are at least as large as one page plus a
   // header. They might be at the start or the end of a block, so we can trim
   // them and free the page(s).
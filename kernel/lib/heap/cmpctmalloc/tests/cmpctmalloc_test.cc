@@ -11,7 +11,9 @@
 #include <math.h>
 
 #include <algorithm>
+#include <chrono>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include <zxtest/zxtest.h>
@@ -246,4 +248,96 @@ TEST_F(CmpctmallocTest, CachedAllocationIsEfficientlyUsed) {
   EXPECT_GT(heap_cached_bytes(), 0);
 }
 
+TEST_F(CmpctmallocTest, SmallAllocationsAreReused) {
+  // A small allocation that is freed and allocated again on the same thread
+  // should come straight back.
+  constexpr size_t kSizes[] = {1, 16, 24, 100, 128, 200, 256};
+  for (size_t size : kSizes) {
+    void* p = cmpct_alloc(size);
+    ASSERT_NOT_NULL(p);
+    cmpct_free(p);
+    void* q = cmpct_alloc(size);
+    EXPECT_EQ(p, q);
+    cmpct_free(q);
+  }
+}
+
+TEST_F(CmpctmallocTest, TrimReturnsCachedAllocations) {
+  std::vector<void*> allocations;
+  for (int i = 0; i < 1000; i++) {
+    allocations.push_back(cmpct_alloc(8 + (i % 32) * 8));
+    ASSERT_NOT_NULL(allocations.back());
+  }
+  for (void* p : allocations) {
+    cmpct_free(p);
+  }
+
+  // Once the cached allocations are returned, every OS allocation is entirely
+  // free, so all that remains is the one the heap holds on to.
+  cmpct_trim();
+  EXPECT_EQ(0, heap_free_bytes());
+  EXPECT_EQ(heap_cached_bytes(), heap_used_bytes());
+}
+
+// Allocates and frees small objects from many threads at once, handing some of
+// them to the next thread to free, and reports the throughput.
+TEST_F(CmpctmallocTest, MultiThreadedStress) {
+  constexpr size_t kIterations = 20000;
+  constexpr size_t kLiveAllocations = 64;
+  constexpr size_t kMaxSize = 512;
+  const size_t num_threads = std::max(4u, std::thread::hardware_concurrency());
+
+  // Each thread frees the allocations its predecessor left in its slot.
+  std::vector<std::vector<void*>> handoff(num_threads);
+  std::vector<std::thread> threads;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([t, &handoff]() {
+      std::default_random_engine generator(kRandomSeed + static_cast<uint32_t>(t));
+      std::uniform_int_distribution<size_t> sizes(1, kMaxSize);
+      std::vector<std::pair<unsigned char*, size_t>> live(kLiveAllocations, {nullptr, 0});
+      for (size_t i = 0; i < kIterations; i++) {
+        auto& slot = live[i % kLiveAllocations];
+        if (slot.first != nullptr) {
+          // Check that nobody else wrote to our allocation.
+          ZX_ASSERT(std::all_of(slot.first, slot.first + slot.second,
+                                [&](unsigned char c) { return c == (t & 0xff); }));
+          cmpct_free(slot.first);
+        }
+        const size_t size = sizes(generator);
+        slot.first = static_cast<unsigned char*>(cmpct_alloc(size));
+        ZX_ASSERT(slot.first != nullptr);
+        slot.second = size;
+        memset(slot.first, static_cast<int>(t & 0xff), size);
+      }
+      for (auto& slot : live) {
+        handoff[t].push_back(slot.first);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Free the remaining allocations from other threads than the ones that
+  // made them.
+  threads.clear();
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&handoff, t, num_threads]() {
+      for (void* p : handoff[(t + 1) % num_threads]) {
+        cmpct_free(p);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  printf("%zu threads: %.0f alloc/free pairs per second\n", num_threads,
+         static_cast<double>(num_threads * kIterations) / seconds);
+}
+
 }  // namespace
@@ -4,6 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://opensource.org/licenses/MIT
 
+#include <align.h>
 #include <debug.h>
 #include <err.h>
 #include <lib/cmdline.h>
@@ -19,11 +20,18 @@
 #include <arch/user_copy.h>
 #include <fbl/alloc_checker.h>
 #include <hypervisor/ktrace.h>
+#include <kernel/align.h>
+#include <kernel/lockdep.h>
+#include <kernel/mp.h>
+#include <kernel/mutex.h>
+#include <ktl/algorithm.h>
 #include <ktl/iterator.h>
 #include <lk/init.h>
 #include <object/thread_dispatcher.h>
 #include <vm/vm_aspace.h>
 
+#include "ktrace_internal.h"
+
 #define ktrace_ticks_per_ms() (ticks_per_second() / 1000)
 
 namespace {
@@ -75,62 +83,366 @@ static void ktrace_report_probes(void) {
   }
 }
 
+namespace internal {
+
+void KtraceCpuBuffer::Init(uint8_t* data, uint32_t size, KtraceBlock* blocks) {
+  DEBUG_ASSERT(size % kBlockSize == 0 && size >= 2 * kBlockSize);
+  data_ = data;
+  size_ = size;
+  blocks_ = blocks;
+  Reset();
+}
+
+void KtraceCpuBuffer::Reset() {
+  head_.store(0);
+  tail_.store(0);
+  for (uint32_t i = 0; i < size_ / kBlockSize; i++) {
+    blocks_[i].end.store(0);
+    blocks_[i].committed.store(0);
+  }
+}
+
+bool KtraceCpuBuffer::CompleteBlockLen(uint64_t block, uint64_t head, uint32_t* len) const {
+  const KtraceBlock& state = blocks_[BlockIndex(block)];
+  const uint64_t lap_start = block / size_ * kBlockSize;
+  const uint64_t committed = state.committed.load(ktl::memory_order_acquire);
+
+  // The block writers are filling is complete when everything up to the head has been committed.
+  if (head < block + kBlockSize) {
+    if (committed != lap_start + (head - block)) {
+      return false;
+    }
+    *len = static_cast<uint32_t>(head - block);
+    return true;
+  }
+
+  if (committed != lap_start + kBlockSize) {
+    return false;
+  }
+  // The seal is written before the bytes that complete the block are committed.
+  const uint64_t end = state.end.load(ktl::memory_order_acquire);
+  DEBUG_ASSERT(end > block && end <= block + kBlockSize);
+  *len = static_cast<uint32_t>(end - block);
+  return true;
+}
+
+void* KtraceCpuBuffer::Reserve(uint32_t len, bool circular, uint64_t* pos_out, bool* full) {
+  DEBUG_ASSERT(len > 0 && len <= kBlockSize);
+  *full = false;
+
+  uint64_t pos = head_.load(ktl::memory_order_relaxed);
+  uint64_t start, end;
+  for (;;) {
+    const uint64_t block_offset = pos % kBlockSize;
+    start = block_offset + len > kBlockSize ? pos - block_offset + kBlockSize : pos;
+    end = start + len;
+
+    uint64_t tail = tail_.load(ktl::memory_order_acquire);
+    if (end - tail > size_) {
+      if (!circular) {
+        *full = true;
+        return nullptr;
+      }
+      // Release the oldest block. This never passes the block being written to since the ring
+      // holds at least two blocks. A block holding a record that is still being filled in is never
+      // overwritten; the new record is dropped instead.
+      uint32_t unused;
+      if (!CompleteBlockLen(tail, pos, &unused)) {
+        return nullptr;
+      }
+      tail_.compare_exchange_strong(tail, tail + kBlockSize, ktl::memory_order_acq_rel,
+                                    ktl::memory_order_relaxed);
+      pos = head_.load(ktl::memory_order_relaxed);
+      continue;
+    }
+
+    if (head_.compare_exchange_weak(pos, end, ktl::memory_order_relaxed,
+                                    ktl::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  // Seal the block we moved out of, if any, and commit the unused end of it.
+  if (start != pos) {
+    blocks_[BlockIndex(pos)].end.store(pos, ktl::memory_order_release);
+    Commit(pos, static_cast<uint32_t>(start - pos));
+  }
+  if (end % kBlockSize == 0) {
+    blocks_[BlockIndex(start)].end.store(end, ktl::memory_order_release);
+  }
+
+  *pos_out = start;
+  return data_ + start % size_;
+}
+
+void KtraceCpuBuffer::Commit(uint64_t pos, uint32_t len) {
+  blocks_[BlockIndex(pos)].committed.fetch_add(len, ktl::memory_order_release);
+}
+
+const uint8_t* KtraceCpuBuffer::PeekBlock(uint32_t* len) const {
+  const uint64_t head = head_.load(ktl::memory_order_acquire);
+  const uint64_t block = tail_.load(ktl::memory_order_acquire);
+  if (block + kBlockSize > head || !CompleteBlockLen(block, head, len)) {
+    return nullptr;
+  }
+  return data_ + block % size_;
+}
+
+zx_status_t KtraceCpuBuffer::DrainBlock(uint8_t* dest, uint32_t max_len, uint32_t* len) {
+  for (;;) {
+    const uint64_t head = head_.load(ktl::memory_order_acquire);
+    uint64_t block = tail_.load(ktl::memory_order_acquire);
+    if (block + kBlockSize > head || !CompleteBlockLen(block, head, len)) {
+      return ZX_ERR_SHOULD_WAIT;
+    }
+    if (*len > max_len) {
+      return ZX_ERR_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(dest, data_ + block % size_, *len);
+    // Writers only reuse a block after moving the tail past it, so the copy is intact if the tail
+    // has not moved.
+    if (tail_.compare_exchange_strong(block, block + kBlockSize, ktl::memory_order_acq_rel,
+                                      ktl::memory_order_acquire)) {
+      return ZX_OK;
+    }
+  }
+}
+
+}  // namespace internal
+
+// Records other than names are written to per-CPU buffers so that concurrent writers do not
+// contend on a shared write offset. In linear mode a CPU stops taking records once its buffer is
+// full, and tracing stops once every online CPU has. In circular mode writers discard the oldest
+// block instead.
+//
+// Name records are written to a shared region at the start of the buffer, since they are rare and
+// must survive wrap-around. A name record's tag is written last, so a zero tag marks a record that
+// has been reserved but not filled in yet. Once a streaming read has drained every name record,
+// the region is zeroed and reused.
+
+// Serializes reads and control operations.
+DECLARE_SINGLETON_MUTEX(KtraceLock);
+
 typedef struct ktrace_state {
-  // where the next record will be written
+  // where the next name record will be written; never moves past |bufsize|
   ktl::atomic<uint32_t> offset;
 
   // mask of groups we allow, 0 == tracing disabled
   ktl::atomic<int> grpmask;
 
-  // total size of the trace buffer
+  // size of the name record region at the start of the trace buffer
   uint32_t bufsize;
 
   // offset where tracing was stopped, 0 if tracing active
-  uint32_t marker;
+  uint32_t marker TA_GUARDED(KtraceLock::Get());
+
+  // offset of the first name record not yet drained by a streaming read
+  uint32_t read_offset TA_GUARDED(KtraceLock::Get());
+
+  // number of bytes returned by streaming reads since the trace was last rewound
+  uint64_t stream_offset TA_GUARDED(KtraceLock::Get());
 
   // raw trace buffer
   uint8_t* buffer;
 
   // buffer is full or not
   ktl::atomic<bool> buffer_full;
+
+  // in linear mode, whether each cpu's buffer has filled up, and how many have
+  ktl::atomic<bool>* cpu_full;
+  ktl::atomic<uint32_t> full_cpu_count;
+
+  // overwrite the oldest records instead of stopping when a cpu buffer is full
+  ktl::atomic<bool> circular;
+
+  // per-cpu record buffers
+  internal::KtraceCpuBuffer* cpus;
+  uint32_t cpu_count;
 } ktrace_state_t;
 
 static ktrace_state_t KTRACE_STATE;
 
-ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
-  ktrace_state_t* ks = &KTRACE_STATE;
+// Staging buffer for streaming reads. A block is copied here first so that it can be discarded if
+// a writer overwrites it during the copy.
+static uint8_t ktrace_read_block[internal::KtraceCpuBuffer::kBlockSize] TA_GUARDED(
+    KtraceLock::Get());
+
+// Returns the length of the whole, filled in name records in [start, end) of the name region.
+static uint32_t ktrace_name_records_len(ktrace_state_t* ks, uint32_t start, uint32_t end) {
+  uint32_t off = start;
+  while (off + sizeof(uint32_t) <= end) {
+    const uint32_t tag =
+        __atomic_load_n(reinterpret_cast<uint32_t*>(ks->buffer + off), __ATOMIC_ACQUIRE);
+    const uint32_t len = KTRACE_LEN(tag);
+    if (len == 0 || off + len > end) {
+      break;
+    }
+    off += len;
+  }
+  return off - start;
+}
 
-  // Buffer size is limited by the marker if set,
-  // otherwise limited by offset (last written point).
-  // Offset can end up pointing past the end, so clip
-  // it to the actual buffer size to be safe.
-  uint32_t max;
+static uint32_t ktrace_name_region_end(ktrace_state_t* ks) TA_REQ(KtraceLock::Get()) {
   if (ks->marker) {
-    max = ks->marker;
-  } else {
-    max = ks->offset.load();
-    if (max > ks->bufsize) {
-      max = ks->bufsize;
+    return ks->marker;
+  }
+  return ks->offset.load();
+}
+
+// Reuses the name region once a streaming read has drained every name record in it. The metadata
+// records at the start of the buffer are kept for KTRACE_ACTION_REWIND.
+static void ktrace_recycle_names(ktrace_state_t* ks) TA_REQ(KtraceLock::Get()) {
+  constexpr uint32_t kNamesStart = KTRACE_RECSIZE * 2;
+  uint32_t end = ks->read_offset;
+  if (end <= kNamesStart || ks->offset.load() != end) {
+    return;
+  }
+  // Every reserved record has been drained, so no writer touches the region until the offset is
+  // moved back.
+  memset(ks->buffer + kNamesStart, 0, end - kNamesStart);
+  if (ks->offset.compare_exchange_strong(end, kNamesStart, ktl::memory_order_release,
+                                         ktl::memory_order_relaxed)) {
+    ks->read_offset = kNamesStart;
+  }
+}
+
+// Copies |len| bytes at |off| of the stopped trace to |ptr|. The stopped trace is the undrained
+// name records followed by the retained records of each cpu in order. Records which writers have
+// not finished filling in, and everything after them, are left out.
+static ssize_t ktrace_read_stopped(ktrace_state_t* ks, void* ptr, uint32_t off, size_t len)
+    TA_REQ(KtraceLock::Get()) {
+  size_t pos = 0;
+  size_t copied = 0;
+  auto copy_segment = [&](const uint8_t* src, size_t seg_len) -> zx_status_t {
+    if (ptr != nullptr && copied < len && off < pos + seg_len) {
+      const size_t seg_off = off + copied - pos;
+      const size_t n = ktl::min(seg_len - seg_off, len - copied);
+      zx_status_t status = arch_copy_to_user(static_cast<uint8_t*>(ptr) + copied, src + seg_off, n);
+      if (status != ZX_OK) {
+        return status;
+      }
+      copied += n;
+    }
+    pos += seg_len;
+    return ZX_OK;
+  };
+
+  const uint32_t name_len =
+      ktrace_name_records_len(ks, ks->read_offset, ktrace_name_region_end(ks));
+  if (copy_segment(ks->buffer + ks->read_offset, name_len) != ZX_OK) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+
+  for (uint32_t cpu = 0; cpu < ks->cpu_count; cpu++) {
+    zx_status_t status = ks->cpus[cpu].ForEachBlock(
+        true, [&](const uint8_t* data, uint32_t block_len) {
+          return copy_segment(data, block_len);
+        });
+    if (status != ZX_OK) {
+      return ZX_ERR_INVALID_ARGS;
     }
   }
 
   // null read is a query for trace buffer size
   if (ptr == nullptr) {
-    return max;
+    return pos;
   }
+  return copied;
+}
 
-  // constrain read to available buffer
-  if (off >= max) {
-    return 0;
+// Moves whole records that writers are done with to |ptr|, releasing their space in the buffer.
+static ssize_t ktrace_read_streaming(ktrace_state_t* ks, void* ptr, uint32_t off, size_t len)
+    TA_REQ(KtraceLock::Get()) {
+  size_t copied = 0;
+
+  const uint32_t name_end = ktrace_name_region_end(ks);
+  if (ptr == nullptr) {
+    copied += ktrace_name_records_len(ks, ks->read_offset, name_end);
+    for (uint32_t cpu = 0; cpu < ks->cpu_count; cpu++) {
+      ks->cpus[cpu].ForEachBlock(false, [&copied](const uint8_t* data, uint32_t block_len) {
+        copied += block_len;
+        return ZX_OK;
+      });
+    }
+    return copied;
   }
-  if (len > (max - off)) {
-    len = max - off;
+
+  // A streaming read continues where the previous one left off, so |off| must be the number of
+  // bytes read so far. It is compared modulo 2^32 since the stream may outgrow |off|.
+  if (off != static_cast<uint32_t>(ks->stream_offset)) {
+    return ZX_ERR_INVALID_ARGS;
   }
 
-  if (arch_copy_to_user(ptr, ks->buffer + off, len) != ZX_OK) {
+  const uint32_t name_len = ktrace_name_records_len(
+      ks, ks->read_offset, static_cast<uint32_t>(ktl::min<size_t>(name_end, ks->read_offset + len)));
+  if (arch_copy_to_user(ptr, ks->buffer + ks->read_offset, name_len) != ZX_OK) {
     return ZX_ERR_INVALID_ARGS;
   }
-  return len;
+  ks->read_offset += name_len;
+  ks->stream_offset += name_len;
+  copied += name_len;
+  ktrace_recycle_names(ks);
+
+  // Each cpu's records are drained a block at a time. Drain next from the cpu whose oldest block
+  // starts earliest, so that the stream holds blocks in timestamp order rather than all the blocks
+  // of one cpu followed by those of the next.
+  for (;;) {
+    internal::KtraceCpuBuffer* next = nullptr;
+    uint64_t next_ts = 0;
+    for (uint32_t cpu = 0; cpu < ks->cpu_count; cpu++) {
+      uint32_t block_len;
+      const uint8_t* data = ks->cpus[cpu].PeekBlock(&block_len);
+      if (data == nullptr || block_len < KTRACE_HDRSIZE) {
+        continue;
+      }
+      const uint64_t ts = reinterpret_cast<const ktrace_header_t*>(data)->ts;
+      if (next == nullptr || ts < next_ts) {
+        next = &ks->cpus[cpu];
+        next_ts = ts;
+      }
+    }
+    if (next == nullptr) {
+      break;
+    }
+
+    uint32_t block_len;
+    zx_status_t status = next->DrainBlock(
+        ktrace_read_block, static_cast<uint32_t>(ktl::min<size_t>(len - copied, UINT32_MAX)),
+        &block_len);
+    if (status == ZX_ERR_SHOULD_WAIT) {
+      // A circular writer reused the block after it was looked at; look again.
+      continue;
+    }
+    if (status == ZX_ERR_BUFFER_TOO_SMALL) {
+      return copied > 0 ? static_cast<ssize_t>(copied) : ZX_ERR_BUFFER_TOO_SMALL;
+    }
+    // The block has already been released, so a failed copy loses its records.
+    if (arch_copy_to_user(static_cast<uint8_t*>(ptr) + copied, ktrace_read_block, block_len) !=
+        ZX_OK) {
+      return ZX_ERR_INVALID_ARGS;
+    }
+    ks->stream_offset += block_len;
+    copied += block_len;
+  }
+
+  return copied;
+}
+
+ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
+  ktrace_state_t* ks = &KTRACE_STATE;
+  if (ks->buffer == nullptr) {
+    return 0;
+  }
+
+  Guard<Mutex> guard{KtraceLock::Get()};
+
+  // While tracing is active reads drain the buffer. Once tracing stops, the remaining records can
+  // be read at any offset.
+  if (ks->grpmask.load() != 0) {
+    return ktrace_read_streaming(ks, ptr, off, len);
+  }
+  return ktrace_read_stopped(ks, ptr, off, len);
 }
 
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
@@ -138,33 +450,47 @@ zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
 
   switch (action) {
     case KTRACE_ACTION_START:
+    case KTRACE_ACTION_START_CIRCULAR: {
+      Guard<Mutex> guard{KtraceLock::Get()};
       options = KTRACE_GRP_TO_MASK(options);
       ks->marker = 0;
+      ks->circular.store(action == KTRACE_ACTION_START_CIRCULAR);
       ks->grpmask.store(options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
       ktrace_report_live_processes();
       ktrace_report_live_threads();
       break;
+    }
 
     case KTRACE_ACTION_STOP: {
+      Guard<Mutex> guard{KtraceLock::Get()};
       ks->grpmask.store(0);
-      uint32_t n = ks->offset.load();
-      if (n > ks->bufsize) {
-        ks->marker = ks->bufsize;
-      } else {
-        ks->marker = n;
-      }
+      ks->marker = ks->offset.load();
       break;
     }
 
-    case KTRACE_ACTION_REWIND:
-      // roll back to just after the metadata
+    case KTRACE_ACTION_REWIND: {
+      Guard<Mutex> guard{KtraceLock::Get()};
+      // roll back to just after the metadata, clearing the tags of the name records so that they
+      // are not mistaken for new ones
+      const uint32_t names_end = ks->offset.load();
+      if (names_end > KTRACE_RECSIZE * 2) {
+        memset(ks->buffer + KTRACE_RECSIZE * 2, 0, names_end - KTRACE_RECSIZE * 2);
+      }
+      ks->marker = 0;
+      ks->read_offset = 0;
+      ks->stream_offset = 0;
       ks->offset.store(KTRACE_RECSIZE * 2);
+      for (uint32_t cpu = 0; cpu < ks->cpu_count; cpu++) {
+        ks->cpus[cpu].Reset();
+        ks->cpu_full[cpu].store(false);
+      }
+      ks->full_cpu_count.store(0);
       ks->buffer_full.store(false);
       ktrace_report_syscalls();
       ktrace_report_probes();
       ktrace_report_vcpu_meta();
       break;
-
+    }
     case KTRACE_ACTION_NEW_PROBE: {
       const char* const string_in = static_cast<const char*>(ptr);
 
@@ -228,12 +554,59 @@ void ktrace_init(unsigned level) {
     return;
   }
 
-  // The last packet written can overhang the end of the buffer,
-  // so we reduce the reported size by the max size of a record
-  ks->bufsize = mb - 256;
+  // An eighth of the buffer holds name records; the rest is split evenly between the cpus.
+  constexpr uint32_t kBlockSize = internal::KtraceCpuBuffer::kBlockSize;
+  const uint32_t name_size = ROUNDUP_PAGE_SIZE(mb / 8);
+  const uint32_t cpu_count = arch_max_num_cpus();
+  const uint32_t cpu_bufsize = ROUNDDOWN((mb - name_size) / cpu_count, kBlockSize);
+  const uint32_t blocks = cpu_bufsize / kBlockSize;
+  if (blocks < 2) {
+    dprintf(INFO, "ktrace: buffer too small for %u cpus\n", cpu_count);
+    ks->buffer = nullptr;
+    return;
+  }
+
+  fbl::AllocChecker ac;
+  internal::KtraceCpuBuffer* cpus = new (&ac) internal::KtraceCpuBuffer[cpu_count];
+  if (!ac.check()) {
+    dprintf(INFO, "ktrace: cannot alloc cpu buffers\n");
+    ks->buffer = nullptr;
+    return;
+  }
+  internal::KtraceBlock* block_state = new (&ac) internal::KtraceBlock[cpu_count * blocks];
+  if (!ac.check()) {
+    dprintf(INFO, "ktrace: cannot alloc cpu buffers\n");
+    delete[] cpus;
+    ks->buffer = nullptr;
+    return;
+  }
+  ktl::atomic<bool>* cpu_full = new (&ac) ktl::atomic<bool>[cpu_count];
+  if (!ac.check()) {
+    dprintf(INFO, "ktrace: cannot alloc cpu buffers\n");
+    delete[] block_state;
+    delete[] cpus;
+    ks->buffer = nullptr;
+    return;
+  }
+  for (uint32_t cpu = 0; cpu < cpu_count; cpu++) {
+    cpus[cpu].Init(ks->buffer + name_size + cpu * cpu_bufsize, cpu_bufsize,
+                   block_state + cpu * blocks);
+  }
+  for (uint32_t cpu = 0; cpu < cpu_count; cpu++) {
+    cpu_full[cpu].store(false);
+  }
+  ks->cpus = cpus;
+  ks->cpu_count = cpu_count;
+  ks->cpu_full = cpu_full;
+  ks->full_cpu_count.store(0);
+
+  // Name records are never reserved past the end of the region.
+  ks->bufsize = name_size;
   ks->buffer_full.store(false);
+  ks->circular.store(gCmdline.GetBool("ktrace.circular", false));
 
-  dprintf(INFO, "ktrace: buffer at %p (%u bytes)\n", ks->buffer, mb);
+  dprintf(INFO, "ktrace: buffer at %p (%u bytes, %u per cpu%s)\n", ks->buffer, mb, cpu_bufsize,
+          ks->circular.load() ? ", circular" : "");
 
   // write metadata to the first two event slots
   uint64_t n = ktrace_ticks_per_ms();
@@ -274,42 +647,73 @@ static inline void ktrace_disable(ktrace_state_t* ks) {
   ks->buffer_full.store(true);
 }
 
+// Reserves |len| bytes in the current cpu's buffer. Returns nullptr if the record cannot be
+// written. Once a linear buffer is full, that cpu takes no more records, and the trace stops when
+// every online cpu is in the same state.
+static void* ktrace_reserve(ktrace_state_t* ks, uint32_t len, internal::KtraceCpuBuffer** cpu,
+                            uint64_t* pos) {
+  // The thread may migrate after reading the cpu number; the record then lands in another cpu's
+  // buffer, which is harmless since reservations are atomic.
+  const cpu_num_t cpu_num = arch_curr_cpu_num();
+  const bool circular = ks->circular.load(ktl::memory_order_relaxed);
+  // A streaming read may have drained some of a full buffer since. Keep it stopped regardless, so
+  // that its records do not resume after a gap.
+  if (!circular && ks->cpu_full[cpu_num].load(ktl::memory_order_relaxed)) {
+    return nullptr;
+  }
+  *cpu = &ks->cpus[cpu_num];
+  bool full;
+  void* rec = (*cpu)->Reserve(len, circular, pos, &full);
+  if (full && !ks->cpu_full[cpu_num].exchange(true, ktl::memory_order_relaxed)) {
+    const uint32_t full_cpus = ks->full_cpu_count.fetch_add(1, ktl::memory_order_relaxed) + 1;
+    if (full_cpus >= static_cast<uint32_t>(__builtin_popcount(mp_get_online_mask()))) {
+      ktrace_disable(ks);
+    }
+  }
+  return rec;
+}
+
 void ktrace_tiny(uint32_t tag, uint32_t arg) {
   ktrace_state_t* ks = &KTRACE_STATE;
   if (ktrace_enabled(tag, ks)) {
     tag = (tag & 0xFFFFFFF0) | 2;
-    uint32_t off;
-    if ((off = (ks->offset.fetch_add(KTRACE_HDRSIZE))) >= (ks->bufsize)) {
-      // if we arrive at the end, stop
-      ktrace_disable(ks);
-    } else {
-      ktrace_header_t* hdr = reinterpret_cast<ktrace_header_t*>(ks->buffer + off);
+    internal::KtraceCpuBuffer* cpu;
+    uint64_t pos;
+    void* rec = ktrace_reserve(ks, KTRACE_HDRSIZE, &cpu, &pos);
+    if (rec != nullptr) {
+      ktrace_header_t* hdr = static_cast<ktrace_header_t*>(rec);
       hdr->ts = ktrace_timestamp();
       hdr->tag = tag;
       hdr->tid = arg;
+      cpu->Commit(pos, KTRACE_HDRSIZE);
     }
   }
 }
 
-void* ktrace_open(uint32_t tag, uint64_t ts) {
+bool ktrace_write(uint32_t tag, const void* payload, uint64_t ts) {
   ktrace_state_t* ks = &KTRACE_STATE;
   if (!ktrace_enabled(tag, ks))
-    return nullptr;
-
-  uint32_t off;
-  if ((off = ks->offset.fetch_add(KTRACE_LEN(tag))) >= (ks->bufsize)) {
-    // if we arrive at the end, stop
-    ktrace_disable(ks);
-    return nullptr;
+    return false;
+
+  const uint32_t len = KTRACE_LEN(tag);
+  internal::KtraceCpuBuffer* cpu;
+  uint64_t pos;
+  void* rec = ktrace_reserve(ks, len, &cpu, &pos);
+  if (rec == nullptr) {
+    return false;
   }
 
-  ktrace_header_t* hdr = reinterpret_cast<ktrace_header_t*>(ks->buffer + off);
+  ktrace_header_t* hdr = static_cast<ktrace_header_t*>(rec);
   hdr->ts = ts;
   hdr->tag = tag;
   hdr->tid = KTRACE_FLAGS(tag) & KTRACE_FLAGS_CPU
                  ? arch_curr_cpu_num()
                  : static_cast<uint32_t>(Thread::Current::Get()->user_tid_);
-  return hdr + 1;
+  if (len > KTRACE_HDRSIZE) {
+    memcpy(hdr + 1, payload, len - KTRACE_HDRSIZE);
+  }
+  cpu->Commit(pos, len);
+  return true;
 }
 
 void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name, bool always) {
@@ -320,18 +724,24 @@ void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name,
     // set size to: sizeof(hdr) + len + 1, round up to multiple of 8
     tag = (tag & 0xFFFFFFF0) | ((KTRACE_NAMESIZE + len + 1 + 7) >> 3);
 
-    uint32_t off;
-    if ((off = ks->offset.fetch_add(KTRACE_LEN(tag))) >= (ks->bufsize)) {
-      // if we arrive at the end, stop
-      ktrace_disable(ks);
-    } else {
-      ktrace_rec_name_t* rec = reinterpret_cast<ktrace_rec_name_t*>(ks->buffer + off);
-      rec->tag = tag;
-      rec->id = id;
-      rec->arg = arg;
-      memcpy(rec->name, name, len);
-      rec->name[len] = 0;
-    }
+    // The offset never moves past the end of the region. When the region is full, name records are
+    // dropped; records in the cpu buffers are still useful without names.
+    uint32_t off = ks->offset.load(ktl::memory_order_relaxed);
+    do {
+      if (off + KTRACE_LEN(tag) > ks->bufsize) {
+        return;
+      }
+    } while (!ks->offset.compare_exchange_weak(off, off + KTRACE_LEN(tag),
+                                               ktl::memory_order_acquire,
+                                               ktl::memory_order_relaxed));
+
+    ktrace_rec_name_t* rec = reinterpret_cast<ktrace_rec_name_t*>(ks->buffer + off);
+    rec->id = id;
+    rec->arg = arg;
+    memcpy(rec->name, name, len);
+    rec->name[len] = 0;
+    // Readers treat a record with a zero tag as not written yet.
+    __atomic_store_n(&rec->tag, tag, __ATOMIC_RELEASE);
   }
 }
 
@@ -0,0 +1,117 @@
+// Copyright 2020 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#ifndef ZIRCON_KERNEL_LIB_KTRACE_KTRACE_INTERNAL_H_
+#define ZIRCON_KERNEL_LIB_KTRACE_KTRACE_INTERNAL_H_
+
+#include <stdint.h>
+#include <zircon/types.h>
+
+#include <kernel/align.h>
+#include <ktl/atomic.h>
+
+namespace internal {
+
+// Per-block state of a KtraceCpuBuffer.
+struct KtraceBlock {
+  // Logical position where the records in the block end, written when a writer moves past the
+  // block.
+  ktl::atomic<uint64_t> end;
+
+  // Number of bytes committed to the block over every lap of the ring, counting both records and
+  // the unused end of the block that writers skipped. Since writers only reuse a block once every
+  // byte of its previous lap was committed, a block at logical position |pos| is complete when this
+  // reaches (pos / size + 1) * kBlockSize.
+  ktl::atomic<uint64_t> committed;
+};
+
+// A ring of fixed size blocks holding the trace records written on one cpu, addressed by logical,
+// monotonically increasing positions. A record never straddles a block, so the unused end of a
+// block is skipped when the next record does not fit.
+//
+// Writers reserve space by moving the head, fill in the record and then commit it. A block may
+// only be read or reused once every record in it has been committed, so neither readers nor
+// writers wrapping around the ring see a record that a preempted writer is still filling in.
+class __CPU_ALIGN KtraceCpuBuffer {
+ public:
+  static constexpr uint32_t kBlockSize = 4096;
+
+  // |data| holds |size| bytes, a multiple of kBlockSize of at least two blocks, and |blocks| holds
+  // one entry per block.
+  void Init(uint8_t* data, uint32_t size, KtraceBlock* blocks);
+
+  // Discards every record. Must not race with writers.
+  void Reset();
+
+  // Reserves |len| bytes, at most kBlockSize, returning a pointer to them and setting |*pos| to the
+  // logical position to pass to Commit once the record has been filled in.
+  //
+  // When the ring is full, a linear buffer returns nullptr and sets |*full|. A circular buffer
+  // releases its oldest block instead; if that block still holds a record which has not been
+  // committed, it returns nullptr without setting |*full| and the new record is dropped.
+  void* Reserve(uint32_t len, bool circular, uint64_t* pos, bool* full);
+
+  // Commits the |len| byte record reserved at |pos|.
+  void Commit(uint64_t pos, uint32_t len);
+
+  // Copies the records of the oldest block to |dest| and releases the block to writers. Only
+  // complete blocks which writers have moved past are drained.
+  //
+  // Returns ZX_ERR_SHOULD_WAIT if there is no such block, and ZX_ERR_BUFFER_TOO_SMALL if the
+  // records do not fit in |max_len| bytes. Sets |*len| to the length of the records in either case.
+  zx_status_t DrainBlock(uint8_t* dest, uint32_t max_len, uint32_t* len);
+
+  // Returns the records of the block DrainBlock would drain next and sets |*len| to their length,
+  // or returns nullptr if there is no such block. Writers of a circular buffer may reuse the block
+  // at any time, so its records are only a hint.
+  const uint8_t* PeekBlock(uint32_t* len) const;
+
+  // Calls |func(data, len)| for the records of each complete block from the oldest, stopping at the
+  // first block holding a record which has not been committed. The block writers are filling is
+  // left out unless |include_current| is set. Returns the first error returned by |func|.
+  template <typename Func>
+  zx_status_t ForEachBlock(bool include_current, Func func) const {
+    const uint64_t head = head_.load(ktl::memory_order_acquire);
+    for (uint64_t block = tail_.load(ktl::memory_order_acquire); block < head;
+         block += kBlockSize) {
+      if (!include_current && block + kBlockSize > head) {
+        break;
+      }
+      uint32_t len;
+      if (!CompleteBlockLen(block, head, &len)) {
+        break;
+      }
+      zx_status_t status = func(data_ + block % size_, len);
+      if (status != ZX_OK) {
+        return status;
+      }
+    }
+    return ZX_OK;
+  }
+
+ private:
+  uint32_t BlockIndex(uint64_t pos) const {
+    return static_cast<uint32_t>((pos % size_) / kBlockSize);
+  }
+
+  // Returns true and sets |*len| to the length of its records if every byte reserved in the block
+  // at logical position |block| has been committed.
+  bool CompleteBlockLen(uint64_t block, uint64_t head, uint32_t* len) const;
+
+  // logical position where the next record will be written
+  ktl::atomic<uint64_t> head_ = 0;
+
+  // logical position of the oldest retained block
+  ktl::atomic<uint64_t> tail_ = 0;
+
+  uint8_t* data_ = nullptr;
+  uint32_t size_ = 0;
+  KtraceBlock* blocks_ = nullptr;
+};
+
+}  // namespace internal
+
+#endif  // ZIRCON_KERNEL_LIB_KTRACE_KTRACE_INTERNAL_H_
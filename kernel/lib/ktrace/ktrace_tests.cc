@@ -0,0 +1,379 @@
+// Copyright 2020 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/unittest/unittest.h>
+#include <string.h>
+
+#include <fbl/alloc_checker.h>
+#include <kernel/thread.h>
+#include <ktl/unique_ptr.h>
+
+#include "ktrace_internal.h"
+
+namespace {
+
+using internal::KtraceBlock;
+using internal::KtraceCpuBuffer;
+
+constexpr uint32_t kBlockSize = KtraceCpuBuffer::kBlockSize;
+constexpr uint64_t kCheckMask = 0x5a5a5a5a5a5a5a5a;
+
+// A 24 byte record, which leaves the end of each block unused.
+struct TestRecord {
+  uint64_t seq;
+  uint32_t writer;
+  uint32_t reserved;
+  uint64_t check;
+};
+static_assert(sizeof(TestRecord) == 24, "");
+static_assert(kBlockSize % sizeof(TestRecord) != 0, "");
+
+constexpr uint32_t kRecordsPerBlock = kBlockSize / sizeof(TestRecord);
+
+// A KtraceCpuBuffer along with the memory backing it.
+struct TestBuffer {
+  bool Init(uint32_t blocks) {
+    fbl::AllocChecker ac;
+    data = ktl::make_unique<uint8_t[]>(&ac, blocks * kBlockSize);
+    if (!ac.check()) {
+      return false;
+    }
+    block_state = ktl::make_unique<KtraceBlock[]>(&ac, blocks);
+    if (!ac.check()) {
+      return false;
+    }
+    buffer.Init(data.get(), blocks * kBlockSize, block_state.get());
+    return true;
+  }
+
+  ktl::unique_ptr<uint8_t[]> data;
+  ktl::unique_ptr<KtraceBlock[]> block_state;
+  KtraceCpuBuffer buffer;
+};
+
+bool WriteRecord(KtraceCpuBuffer* buffer, bool circular, uint32_t writer, uint64_t seq,
+                 bool* full) {
+  uint64_t pos;
+  void* rec = buffer->Reserve(sizeof(TestRecord), circular, &pos, full);
+  if (rec == nullptr) {
+    return false;
+  }
+  TestRecord record = {seq, writer, 0, seq ^ kCheckMask};
+  memcpy(rec, &record, sizeof(record));
+  buffer->Commit(pos, sizeof(TestRecord));
+  return true;
+}
+
+// Checks that |data| holds whole records, none of them torn, and calls |func| for each of them.
+template <typename Func>
+bool ForEachRecord(const uint8_t* data, uint32_t len, Func func) {
+  if (len % sizeof(TestRecord) != 0) {
+    return false;
+  }
+  for (uint32_t off = 0; off < len; off += sizeof(TestRecord)) {
+    TestRecord record;
+    memcpy(&record, data + off, sizeof(record));
+    if (record.check != (record.seq ^ kCheckMask)) {
+      return false;
+    }
+    func(record);
+  }
+  return true;
+}
+
+// Checks that records delivered to Check hold consecutive sequence numbers from |next|.
+struct SequenceChecker {
+  bool Check(const uint8_t* data, uint32_t len) {
+    return ForEachRecord(data, len, [this](const TestRecord& record) {
+      if (record.seq != next) {
+        ok = false;
+      }
+      next++;
+    });
+  }
+
+  uint64_t next;
+  bool ok = true;
+};
+
+bool circular_wraparound() {
+  BEGIN_TEST;
+
+  TestBuffer test;
+  ASSERT_TRUE(test.Init(2));
+
+  constexpr uint64_t kRecords = 10 * kRecordsPerBlock + 7;
+  for (uint64_t seq = 0; seq < kRecords; seq++) {
+    bool full;
+    ASSERT_TRUE(WriteRecord(&test.buffer, true, 0, seq, &full));
+    EXPECT_FALSE(full);
+  }
+
+  // The retained records are the most recent ones, in order and without gaps: the whole previous
+  // block and the records written to the current one.
+  SequenceChecker checker{kRecords - kRecordsPerBlock - 7};
+  ASSERT_EQ(ZX_OK, test.buffer.ForEachBlock(true, [&checker](const uint8_t* data, uint32_t len) {
+    return checker.Check(data, len) ? ZX_OK : ZX_ERR_INTERNAL;
+  }));
+  EXPECT_TRUE(checker.ok);
+  EXPECT_EQ(kRecords, checker.next);
+
+  END_TEST;
+}
+
+bool linear_full() {
+  BEGIN_TEST;
+
+  TestBuffer test;
+  ASSERT_TRUE(test.Init(2));
+
+  uint64_t seq = 0;
+  bool full = false;
+  while (WriteRecord(&test.buffer, false, 0, seq, &full)) {
+    seq++;
+  }
+  EXPECT_TRUE(full);
+  EXPECT_EQ(2 * kRecordsPerBlock, seq);
+
+  // Nothing was overwritten.
+  SequenceChecker checker{0};
+  ASSERT_EQ(ZX_OK, test.buffer.ForEachBlock(true, [&checker](const uint8_t* data, uint32_t len) {
+    return checker.Check(data, len) ? ZX_OK : ZX_ERR_INTERNAL;
+  }));
+  EXPECT_TRUE(checker.ok);
+  EXPECT_EQ(seq, checker.next);
+
+  END_TEST;
+}
+
+bool peek_matches_drain() {
+  BEGIN_TEST;
+
+  TestBuffer test;
+  ASSERT_TRUE(test.Init(4));
+
+  // Only the block writers are filling is there, so there is nothing to peek at.
+  uint64_t seq = 0;
+  bool full;
+  ASSERT_TRUE(WriteRecord(&test.buffer, false, 0, seq++, &full));
+  uint32_t len;
+  EXPECT_NULL(test.buffer.PeekBlock(&len));
+
+  while (seq < 2 * kRecordsPerBlock + 1) {
+    ASSERT_TRUE(WriteRecord(&test.buffer, false, 0, seq++, &full));
+  }
+
+  // Peeking shows each block DrainBlock then drains, and leaves it in place.
+  uint8_t dest[kBlockSize];
+  for (uint64_t first = 0; first < 2 * kRecordsPerBlock; first += kRecordsPerBlock) {
+    const uint8_t* peeked = test.buffer.PeekBlock(&len);
+    ASSERT_NONNULL(peeked);
+    EXPECT_EQ(static_cast<uint32_t>(kRecordsPerBlock * sizeof(TestRecord)), len);
+    TestRecord record;
+    memcpy(&record, peeked, sizeof(record));
+    EXPECT_EQ(first, record.seq);
+
+    uint32_t drained_len;
+    ASSERT_EQ(ZX_OK, test.buffer.DrainBlock(dest, sizeof(dest), &drained_len));
+    EXPECT_EQ(len, drained_len);
+    EXPECT_EQ(0, memcmp(dest, &record, sizeof(record)));
+  }
+  EXPECT_NULL(test.buffer.PeekBlock(&len));
+
+  END_TEST;
+}
+
+bool uncommitted_record_is_not_overwritten() {
+  BEGIN_TEST;
+
+  TestBuffer test;
+  ASSERT_TRUE(test.Init(2));
+
+  // Reserve a record at the start of the ring as a preempted writer would, without committing it.
+  uint64_t pending_pos;
+  bool full;
+  void* pending = test.buffer.Reserve(sizeof(TestRecord), true, &pending_pos, &full);
+  ASSERT_NONNULL(pending);
+
+  uint64_t seq = 1;
+  while (WriteRecord(&test.buffer, true, 0, seq, &full)) {
+    seq++;
+  }
+  // The ring filled up, but the oldest block was not released while the record was pending.
+  EXPECT_FALSE(full);
+  EXPECT_EQ(2 * kRecordsPerBlock, seq);
+
+  // Neither is it drained or read.
+  uint8_t dest[kBlockSize];
+  uint32_t len;
+  EXPECT_EQ(ZX_ERR_SHOULD_WAIT, test.buffer.DrainBlock(dest, sizeof(dest), &len));
+  uint32_t blocks_read = 0;
+  test.buffer.ForEachBlock(true, [&blocks_read](const uint8_t* data, uint32_t block_len) {
+    blocks_read++;
+    return ZX_OK;
+  });
+  EXPECT_EQ(0u, blocks_read);
+
+  TestRecord record = {0, 0, 0, kCheckMask};
+  memcpy(pending, &record, sizeof(record));
+  test.buffer.Commit(pending_pos, sizeof(TestRecord));
+
+  // Once committed, the oldest block holds every record written to it.
+  EXPECT_EQ(ZX_ERR_BUFFER_TOO_SMALL, test.buffer.DrainBlock(dest, sizeof(TestRecord), &len));
+  ASSERT_EQ(ZX_OK, test.buffer.DrainBlock(dest, sizeof(dest), &len));
+  EXPECT_EQ(kRecordsPerBlock * sizeof(TestRecord), len);
+  SequenceChecker checker{0};
+  EXPECT_TRUE(checker.Check(dest, len));
+  EXPECT_TRUE(checker.ok);
+  EXPECT_EQ(kRecordsPerBlock, checker.next);
+
+  // And writers can make progress again.
+  EXPECT_TRUE(WriteRecord(&test.buffer, true, 0, seq, &full));
+
+  END_TEST;
+}
+
+constexpr uint32_t kWriters = 4;
+constexpr uint64_t kRecordsPerWriter = 4000;
+
+struct WriterArgs {
+  KtraceCpuBuffer* buffer;
+  uint32_t writer;
+  // Wait for the buffer to be drained instead of giving up when it is full.
+  bool wait;
+};
+
+int writer_thread(void* arg) {
+  WriterArgs* args = static_cast<WriterArgs*>(arg);
+  for (uint64_t seq = 0; seq < kRecordsPerWriter; seq++) {
+    bool full;
+    while (!WriteRecord(args->buffer, false, args->writer, seq, &full)) {
+      if (!args->wait) {
+        return -1;
+      }
+      Thread::Current::Yield();
+    }
+  }
+  return 0;
+}
+
+// Checks that the records of each writer are all there, once and in order, as blocks are
+// delivered to Check.
+struct WriterChecker {
+  bool Check(const uint8_t* data, uint32_t len) {
+    return ForEachRecord(data, len, [this](const TestRecord& record) {
+      if (record.writer >= kWriters || record.seq != next[record.writer]) {
+        ok = false;
+        return;
+      }
+      next[record.writer]++;
+    });
+  }
+
+  bool Done() const {
+    for (uint64_t n : next) {
+      if (n != kRecordsPerWriter) {
+        return false;
+      }
+    }
+    return ok;
+  }
+
+  uint64_t next[kWriters] = {};
+  bool ok = true;
+};
+
+bool RunWriters(KtraceCpuBuffer* buffer, bool wait, Thread** threads, WriterArgs* args) {
+  for (uint32_t i = 0; i < kWriters; i++) {
+    args[i] = {buffer, i, wait};
+    threads[i] = Thread::Create("ktrace writer", writer_thread, &args[i], DEFAULT_PRIORITY);
+    if (threads[i] == nullptr) {
+      return false;
+    }
+    threads[i]->Resume();
+  }
+  return true;
+}
+
+bool concurrent_writers() {
+  BEGIN_TEST;
+
+  // Large enough to hold every record.
+  constexpr uint32_t kBlocks =
+      static_cast<uint32_t>(kWriters * kRecordsPerWriter / kRecordsPerBlock + 2);
+  TestBuffer test;
+  ASSERT_TRUE(test.Init(kBlocks));
+
+  Thread* threads[kWriters];
+  WriterArgs args[kWriters];
+  ASSERT_TRUE(RunWriters(&test.buffer, false, threads, args));
+  for (Thread* thread : threads) {
+    int retcode;
+    ASSERT_EQ(ZX_OK, thread->Join(&retcode, ZX_TIME_INFINITE));
+    EXPECT_EQ(0, retcode);
+  }
+
+  WriterChecker checker;
+  ASSERT_EQ(ZX_OK, test.buffer.ForEachBlock(true, [&checker](const uint8_t* data, uint32_t len) {
+    return checker.Check(data, len) ? ZX_OK : ZX_ERR_INTERNAL;
+  }));
+  EXPECT_TRUE(checker.Done());
+
+  END_TEST;
+}
+
+bool concurrent_writers_and_drain() {
+  BEGIN_TEST;
+
+  // Much smaller than the records written, so writers wait on the drain.
+  TestBuffer test;
+  ASSERT_TRUE(test.Init(4));
+
+  Thread* threads[kWriters];
+  WriterArgs args[kWriters];
+  ASSERT_TRUE(RunWriters(&test.buffer, true, threads, args));
+
+  WriterChecker checker;
+  uint8_t dest[kBlockSize];
+  for (Thread* thread : threads) {
+    for (;;) {
+      uint32_t len;
+      zx_status_t status = test.buffer.DrainBlock(dest, sizeof(dest), &len);
+      if (status == ZX_OK) {
+        EXPECT_TRUE(checker.Check(dest, len));
+        continue;
+      }
+      EXPECT_EQ(ZX_ERR_SHOULD_WAIT, status);
+      int retcode;
+      if (thread->Join(&retcode, current_time()) == ZX_OK) {
+        EXPECT_EQ(0, retcode);
+        break;
+      }
+      Thread::Current::Yield();
+    }
+  }
+
+  // Every writer is done, so the rest of the records can be read in place.
+  ASSERT_EQ(ZX_OK, test.buffer.ForEachBlock(true, [&checker](const uint8_t* data, uint32_t len) {
+    return checker.Check(data, len) ? ZX_OK : ZX_ERR_INTERNAL;
+  }));
+  EXPECT_TRUE(checker.Done());
+
+  END_TEST;
+}
+
+}  // namespace
+
+#define KTRACE_UNITTEST(fname) UNITTEST(#fname, fname)
+
+UNITTEST_START_TESTCASE(ktrace_tests)
+KTRACE_UNITTEST(circular_wraparound)
+KTRACE_UNITTEST(linear_full)
+KTRACE_UNITTEST(peek_matches_drain)
+KTRACE_UNITTEST(uncommitted_record_is_not_overwritten)
+KTRACE_UNITTEST(concurrent_writers)
+KTRACE_UNITTEST(concurrent_writers_and_drain)
+UNITTEST_END_TESTCASE(ktrace_tests, "ktrace_tests", "ktrace test")
@@ -0,0 +1,43 @@
+// Copyright 2020 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/counters.h>
+#include <platform.h>
+
+#include <arch/interrupt.h>
+
+#include <lockdep/lockdep.h>
+
+#if WITH_LOCK_STATS
+
+// Kernel-wide totals of contended acquisitions. Per-class statistics are
+// reported by the "lockstat" console command.
+KCOUNTER(lock_contended_count, "lockdep.stats.contended")
+KCOUNTER(lock_contended_wait_ns, "lockdep.stats.contended_wait_ns")
+KCOUNTER_DECLARE(lock_contended_wait_max_ns, "lockdep.stats.contended_wait_max_ns", Max)
+
+namespace lockdep {
+
+// Returns the monotonic time in nanoseconds.
+uint64_t SystemGetLockStatisticsTimestamp() { return current_time(); }
+
+// Updates the contention kcounters.
+void SystemLockContended(LockClassState* /*lock_class_state*/, uint64_t wait) {
+  const int64_t wait_ns = static_cast<int64_t>(wait);
+  kcounter_add(lock_contended_count, 1);
+  kcounter_add(lock_contended_wait_ns, wait_ns);
+
+  // The max is kept per cpu, so the read and the update must not be split by a migration or by an
+  // interrupt contending a lock in between.
+  InterruptDisableGuard irqd;
+  if (lock_contended_wait_max_ns.Value() < wait_ns) {
+    lock_contended_wait_max_ns.Set(wait_ns);
+  }
+}
+
+}  // namespace lockdep
+
+#endif
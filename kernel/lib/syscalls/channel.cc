@@ -298,6 +298,18 @@ static __WARN_UNUSED_RESULT zx_status_t msg_put_handles(ProcessDispatcher* up, M
   return status;
 }
 
+// Creates the MessagePacket for a write or call. With ZX_CHANNEL_WRITE_USE_IOVEC, |user_bytes| is
+// an array of |num_bytes| zx_iovec_t, and the message is gathered straight from the buffers they
+// describe.
+static zx_status_t msg_create(uint32_t options, user_in_ptr<const void> user_bytes,
+                              uint32_t num_bytes, uint32_t num_handles, MessagePacketPtr* msg) {
+  if (options & ZX_CHANNEL_WRITE_USE_IOVEC) {
+    return MessagePacket::CreateIovec(user_bytes.reinterpret<const zx_iovec_t>(), num_bytes,
+                                      num_handles, msg);
+  }
+  return MessagePacket::Create(user_bytes.reinterpret<const char>(), num_bytes, num_handles, msg);
+}
+
 template <typename UserHandles>
 static zx_status_t channel_write(zx_handle_t handle_value, uint32_t options,
                                  user_in_ptr<const void> user_bytes, uint32_t num_bytes,
@@ -309,7 +321,7 @@ static zx_status_t channel_write(zx_handle_t handle_value, uint32_t options,
 
   auto cleanup = fbl::MakeAutoCall([&]() { RemoveUserHandles(user_handles, num_handles, up); });
 
-  if (options != 0u) {
+  if (options & ~ZX_CHANNEL_WRITE_USE_IOVEC) {
     return ZX_ERR_INVALID_ARGS;
   }
 
@@ -320,11 +332,11 @@ static zx_status_t channel_write(zx_handle_t handle_value, uint32_t options,
   }
 
   MessagePacketPtr msg;
-  status =
-      MessagePacket::Create(user_bytes.reinterpret<const char>(), num_bytes, num_handles, &msg);
+  status = msg_create(options, user_bytes, num_bytes, num_handles, &msg);
   if (status != ZX_OK) {
     return status;
   }
+  const uint32_t data_size = msg->data_size();
 
   if (num_handles > 0u) {
     status = msg_put_handles(up, msg.get(), user_handles, num_handles,
@@ -339,7 +351,7 @@ static zx_status_t channel_write(zx_handle_t handle_value, uint32_t options,
   if (status != ZX_OK)
     return status;
 
-  ktrace(TAG_CHANNEL_WRITE, (uint32_t)channel->get_koid(), num_bytes, num_handles, 0);
+  ktrace(TAG_CHANNEL_WRITE, (uint32_t)channel->get_koid(), data_size, num_handles, 0);
   return ZX_OK;
 }
 
@@ -375,7 +387,7 @@ zx_status_t sys_channel_call_noretry(zx_handle_t handle_value, uint32_t options,
   if (status != ZX_OK)
     return status;
 
-  user_in_ptr<const char> user_bytes = make_user_in_ptr(static_cast<const char*>(args.wr_bytes));
+  user_in_ptr<const void> user_bytes = make_user_in_ptr(args.wr_bytes);
   user_in_ptr<const zx_handle_t> user_handles = make_user_in_ptr(args.wr_handles);
 
   uint32_t num_bytes = args.wr_num_bytes;
@@ -385,7 +397,11 @@ zx_status_t sys_channel_call_noretry(zx_handle_t handle_value, uint32_t options,
 
   auto cleanup = fbl::MakeAutoCall([&]() { RemoveUserHandles(user_handles, num_handles, up); });
 
-  if (options || num_bytes < sizeof(zx_txid_t)) {
+  if (options & ~ZX_CHANNEL_WRITE_USE_IOVEC) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+  // With iovecs the size of the message is not known until it is gathered below.
+  if (!(options & ZX_CHANNEL_WRITE_USE_IOVEC) && num_bytes < sizeof(zx_txid_t)) {
     return ZX_ERR_INVALID_ARGS;
   }
 
@@ -397,10 +413,13 @@ zx_status_t sys_channel_call_noretry(zx_handle_t handle_value, uint32_t options,
 
   // Prepare a MessagePacket for writing
   MessagePacketPtr msg;
-  status = MessagePacket::Create(user_bytes, num_bytes, num_handles, &msg);
+  status = msg_create(options, user_bytes, num_bytes, num_handles, &msg);
   if (status != ZX_OK) {
     return status;
   }
+  if (msg->data_size() < sizeof(zx_txid_t)) {
+    return ZX_ERR_INVALID_ARGS;
+  }
 
   // msg_put_handles() always consumes all handles (or there are zero handles,
   // and so there's nothing to be done).
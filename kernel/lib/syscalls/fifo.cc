@@ -17,6 +17,7 @@
 #include <object/fifo_dispatcher.h>
 #include <object/handle.h>
 #include <object/process_dispatcher.h>
+#include <object/vm_object_dispatcher.h>
 
 #include "priv.h"
 
@@ -88,3 +89,32 @@ zx_status_t sys_fifo_read(zx_handle_t handle, size_t elem_size, user_out_ptr<voi
   }
   return ZX_OK;
 }
+
+// zx_status_t zx_fifo_get_vmo
+zx_status_t sys_fifo_get_vmo(zx_handle_t handle, uint32_t options, user_out_handle* out) {
+  if (options != 0)
+    return ZX_ERR_INVALID_ARGS;
+
+  auto up = ProcessDispatcher::GetCurrent();
+  zx_status_t status = up->EnforceBasicPolicy(ZX_POL_NEW_VMO);
+  if (status != ZX_OK)
+    return status;
+
+  fbl::RefPtr<FifoDispatcher> fifo;
+  status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ | ZX_RIGHT_WRITE, &fifo);
+  if (status != ZX_OK)
+    return status;
+
+  fbl::RefPtr<VmObject> vmo;
+  status = fifo->GetRingVmo(&vmo);
+  if (status != ZX_OK)
+    return status;
+
+  KernelHandle<VmObjectDispatcher> kernel_handle;
+  zx_rights_t rights;
+  status = VmObjectDispatcher::Create(ktl::move(vmo), &kernel_handle, &rights);
+  if (status != ZX_OK)
+    return status;
+
+  return out->make(ktl::move(kernel_handle), rights & ~ZX_RIGHT_EXECUTE);
+}
@@ -13,6 +13,7 @@
 
 #include <fbl/alloc_checker.h>
 #include <fbl/ref_ptr.h>
+#include <ktl/algorithm.h>
 #include <object/handle.h>
 #include <object/port_dispatcher.h>
 #include <object/process_dispatcher.h>
@@ -21,6 +22,13 @@
 
 #define LOCAL_TRACE 0
 
+namespace {
+
+// zx_port_wait_many stages packets on the kernel stack, and copies them out this many at a time.
+constexpr size_t kPortWaitManyBatch = 16;
+
+}  // namespace
+
 // zx_status_t zx_port_create
 zx_status_t sys_port_create(uint32_t options, user_out_handle* out) {
   LTRACEF("options %u\n", options);
@@ -94,6 +102,58 @@ zx_status_t sys_port_wait(zx_handle_t handle, zx_time_t deadline,
   return ZX_OK;
 }
 
+// zx_status_t zx_port_wait_many
+zx_status_t sys_port_wait_many(zx_handle_t handle, zx_time_t deadline,
+                               user_out_ptr<zx_port_packet_t> packets, size_t num_packets,
+                               user_out_ptr<size_t> actual) {
+  LTRACEF("handle %x\n", handle);
+
+  if (!packets || num_packets == 0)
+    return ZX_ERR_INVALID_ARGS;
+
+  auto up = ProcessDispatcher::GetCurrent();
+
+  fbl::RefPtr<PortDispatcher> port;
+  zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ, &port);
+  if (status != ZX_OK)
+    return status;
+
+  const Deadline slackDeadline(deadline, up->GetTimerSlackPolicy());
+
+  ktrace(TAG_PORT_WAIT, (uint32_t)port->get_koid(), 0, 0, 0);
+
+  // Only the first packet is waited for. After that, take whatever else is already queued.
+  zx_port_packet_t batch[kPortWaitManyBatch];
+  zx_status_t st = port->Dequeue(slackDeadline, &batch[0]);
+
+  ktrace(TAG_PORT_WAIT_DONE, (uint32_t)port->get_koid(), st, 0, 0);
+
+  if (st != ZX_OK)
+    return st;
+
+  size_t staged = 1;
+  size_t copied = 0;
+  while (true) {
+    const size_t room = ktl::min(kPortWaitManyBatch, num_packets - copied) - staged;
+    staged += port->TryDequeue(&batch[staged], room);
+    status = packets.copy_array_to_user(batch, staged, copied);
+    if (status != ZX_OK)
+      return status;
+    copied += staged;
+    if (copied == num_packets || staged < kPortWaitManyBatch)
+      break;
+    staged = 0;
+  }
+
+  if (actual) {
+    status = actual.copy_to_user(copied);
+    if (status != ZX_OK)
+      return status;
+  }
+
+  return ZX_OK;
+}
+
 // zx_status_t zx_port_cancel
 zx_status_t sys_port_cancel(zx_handle_t handle, zx_handle_t source, uint64_t key) {
   auto up = ProcessDispatcher::GetCurrent();
@@ -7,15 +7,42 @@
 #include "object/fifo_dispatcher.h"
 
 #include <lib/counters.h>
+#include <stddef.h>
 #include <string.h>
 #include <zircon/rights.h>
+#include <zircon/syscalls/fifo.h>
 
 #include <fbl/alloc_checker.h>
+#include <fbl/auto_call.h>
 #include <fbl/auto_lock.h>
 #include <object/handle.h>
+#include <vm/vm_object_paged.h>
 
 KCOUNTER(dispatcher_fifo_create_count, "dispatcher.fifo.create")
 KCOUNTER(dispatcher_fifo_destroy_count, "dispatcher.fifo.destroy")
+KCOUNTER(dispatcher_fifo_shared_ring_create_count, "dispatcher.fifo.shared_ring.create")
+KCOUNTER(dispatcher_fifo_shared_ring_doorbell_count, "dispatcher.fifo.shared_ring.doorbell")
+
+namespace {
+
+zx_status_t CreateRingVmo(fbl::RefPtr<VmObject>* ring_vmo) {
+  fbl::RefPtr<VmObject> vmo;
+  zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, ZX_FIFO_RING_VMO_SIZE, &vmo);
+  if (status != ZX_OK)
+    return status;
+
+  // Commit up front so that ringing the doorbell never has to allocate, and pin the pages so that
+  // no holder of the VMO can decommit the rings from under the endpoints. This pin is owned by the
+  // first endpoint.
+  status = vmo->CommitRangePinned(0, ZX_FIFO_RING_VMO_SIZE);
+  if (status != ZX_OK)
+    return status;
+
+  *ring_vmo = ktl::move(vmo);
+  return ZX_OK;
+}
+
+}  // namespace
 
 // static
 zx_status_t FifoDispatcher::Create(size_t count, size_t elemsize, uint32_t options,
@@ -28,6 +55,25 @@ zx_status_t FifoDispatcher::Create(size_t count, size_t elemsize, uint32_t optio
       (elemsize > kMaxSizeBytes) || ((count * elemsize) > kMaxSizeBytes)) {
     return ZX_ERR_OUT_OF_RANGE;
   }
+  if (options & ~ZX_FIFO_SHARED_RING)
+    return ZX_ERR_INVALID_ARGS;
+
+  // Shared ring fifos keep their elements in |ring_vmo| instead of a kernel buffer.
+  const bool shared_ring = (options & ZX_FIFO_SHARED_RING) != 0;
+  fbl::RefPtr<VmObject> ring_vmo;
+  if (shared_ring) {
+    zx_status_t status = CreateRingVmo(&ring_vmo);
+    if (status != ZX_OK)
+      return status;
+  }
+
+  // Each endpoint owns a pin on |ring_vmo| and drops it when destroyed. A pin taken before the
+  // endpoint owning it exists is dropped here on failure.
+  bool ring_pinned = shared_ring;
+  auto unpin_ring = fbl::MakeAutoCall([&ring_vmo, &ring_pinned]() {
+    if (ring_pinned)
+      ring_vmo->Unpin(0, ZX_FIFO_RING_VMO_SIZE);
+  });
 
   fbl::AllocChecker ac;
   auto holder0 = fbl::AdoptRef(new (&ac) PeerHolder<FifoDispatcher>());
@@ -35,29 +81,58 @@ zx_status_t FifoDispatcher::Create(size_t count, size_t elemsize, uint32_t optio
     return ZX_ERR_NO_MEMORY;
   auto holder1 = holder0;
 
-  auto data0 = ktl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
-  if (!ac.check())
-    return ZX_ERR_NO_MEMORY;
+  ktl::unique_ptr<uint8_t[]> data0;
+  if (!shared_ring) {
+    data0 = ktl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
+    if (!ac.check())
+      return ZX_ERR_NO_MEMORY;
+  }
 
-  KernelHandle fifo0(fbl::AdoptRef(
-      new (&ac) FifoDispatcher(ktl::move(holder0), options, static_cast<uint32_t>(count),
-                               static_cast<uint32_t>(elemsize), ktl::move(data0))));
+  KernelHandle fifo0(fbl::AdoptRef(new (&ac) FifoDispatcher(
+      ktl::move(holder0), options, static_cast<uint32_t>(count), static_cast<uint32_t>(elemsize),
+      ktl::move(data0), ring_vmo, 0u)));
   if (!ac.check())
     return ZX_ERR_NO_MEMORY;
+  ring_pinned = false;
 
-  auto data1 = ktl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
-  if (!ac.check())
-    return ZX_ERR_NO_MEMORY;
+  if (shared_ring) {
+    zx_status_t status = ring_vmo->CommitRangePinned(0, ZX_FIFO_RING_VMO_SIZE);
+    if (status != ZX_OK)
+      return status;
+    ring_pinned = true;
+  }
+
+  ktl::unique_ptr<uint8_t[]> data1;
+  if (!shared_ring) {
+    data1 = ktl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
+    if (!ac.check())
+      return ZX_ERR_NO_MEMORY;
+  }
 
-  KernelHandle fifo1(fbl::AdoptRef(
-      new (&ac) FifoDispatcher(ktl::move(holder1), options, static_cast<uint32_t>(count),
-                               static_cast<uint32_t>(elemsize), ktl::move(data1))));
+  KernelHandle fifo1(fbl::AdoptRef(new (&ac) FifoDispatcher(
+      ktl::move(holder1), options, static_cast<uint32_t>(count), static_cast<uint32_t>(elemsize),
+      ktl::move(data1), ring_vmo, 1u)));
   if (!ac.check())
     return ZX_ERR_NO_MEMORY;
+  ring_pinned = false;
 
   fifo0.dispatcher()->Init(fifo1.dispatcher());
   fifo1.dispatcher()->Init(fifo0.dispatcher());
 
+  if (shared_ring) {
+    // Record which endpoint writes each ring so that userspace can find its own.
+    const FifoDispatcher* fifos[] = {fifo0.dispatcher().get(), fifo1.dispatcher().get()};
+    for (const FifoDispatcher* fifo : fifos) {
+      const zx_koid_t koid = fifo->get_koid();
+      const uint64_t offset =
+          ZX_FIFO_RING_HEADER_OFFSET(fifo->ring_index_) + offsetof(zx_fifo_ring_t, writer_koid);
+      zx_status_t status = ring_vmo->Write(&koid, offset, sizeof(koid));
+      if (status != ZX_OK)
+        return status;
+    }
+    kcounter_add(dispatcher_fifo_shared_ring_create_count, 1);
+  }
+
   *rights = default_rights();
   *handle0 = ktl::move(fifo0);
   *handle1 = ktl::move(fifo1);
@@ -65,18 +140,25 @@ zx_status_t FifoDispatcher::Create(size_t count, size_t elemsize, uint32_t optio
 }
 
 FifoDispatcher::FifoDispatcher(fbl::RefPtr<PeerHolder<FifoDispatcher>> holder, uint32_t /*options*/,
-                               uint32_t count, uint32_t elem_size, ktl::unique_ptr<uint8_t[]> data)
+                               uint32_t count, uint32_t elem_size, ktl::unique_ptr<uint8_t[]> data,
+                               fbl::RefPtr<VmObject> ring_vmo, uint32_t ring_index)
     : PeeredDispatcher(ktl::move(holder), ZX_FIFO_WRITABLE),
       elem_count_(count),
       elem_size_(elem_size),
       mask_(count - 1),
       head_(0u),
       tail_(0u),
-      data_(ktl::move(data)) {
+      data_(ktl::move(data)),
+      ring_vmo_(ktl::move(ring_vmo)),
+      ring_index_(ring_index) {
   kcounter_add(dispatcher_fifo_create_count, 1);
 }
 
-FifoDispatcher::~FifoDispatcher() { kcounter_add(dispatcher_fifo_destroy_count, 1); }
+FifoDispatcher::~FifoDispatcher() {
+  kcounter_add(dispatcher_fifo_destroy_count, 1);
+  if (ring_vmo_)
+    ring_vmo_->Unpin(0, ZX_FIFO_RING_VMO_SIZE);
+}
 
 // Thread safety analysis disabled as this happens during creation only,
 // when no other thread could be accessing the object.
@@ -107,6 +189,14 @@ zx_status_t FifoDispatcher::WriteFromUser(size_t elem_size, user_in_ptr<const ui
   Guard<Mutex> guard{get_lock()};
   if (!peer_)
     return ZX_ERR_PEER_CLOSED;
+  if (shared_ring()) {
+    if (elem_size != elem_size_)
+      return ZX_ERR_OUT_OF_RANGE;
+    if (count != 0)
+      return ZX_ERR_BAD_STATE;
+    *actual = 0;
+    return RingDoorbellLocked();
+  }
   return peer_->WriteSelfLocked(elem_size, ptr, count, actual);
 }
 
@@ -175,11 +265,18 @@ zx_status_t FifoDispatcher::ReadToUser(size_t elem_size, user_out_ptr<uint8_t> p
 
   if (elem_size != elem_size_)
     return ZX_ERR_OUT_OF_RANGE;
-  if (count == 0)
+  if (count == 0 && !shared_ring())
     return ZX_ERR_OUT_OF_RANGE;
 
   Guard<Mutex> guard{get_lock()};
 
+  if (shared_ring()) {
+    if (count != 0)
+      return ZX_ERR_BAD_STATE;
+    *actual = 0;
+    return RingDoorbellLocked();
+  }
+
   uint32_t old_tail = tail_;
 
   // total number of available entries to read from the fifo
@@ -227,3 +324,45 @@ zx_status_t FifoDispatcher::ReadToUser(size_t elem_size, user_out_ptr<uint8_t> p
   *actual = (tail_ - old_tail);
   return ZX_OK;
 }
+
+zx_status_t FifoDispatcher::GetRingVmo(fbl::RefPtr<VmObject>* vmo) {
+  canary_.Assert();
+
+  if (!shared_ring())
+    return ZX_ERR_BAD_STATE;
+  // Hand out a slice so that every caller gets a VMO, and a dispatcher, of its own.
+  return ring_vmo_->CreateChildSlice(0u, ZX_FIFO_RING_VMO_SIZE, false, vmo);
+}
+
+zx_status_t FifoDispatcher::RingDoorbellLocked() TA_NO_THREAD_SAFETY_ANALYSIS {
+  canary_.Assert();
+
+  kcounter_add(dispatcher_fifo_shared_ring_doorbell_count, 1);
+
+  zx_fifo_ring_t rings[ZX_FIFO_RING_COUNT];
+  zx_status_t status = ring_vmo_->Read(rings, 0u, sizeof(rings));
+  if (status != ZX_OK)
+    return status;
+
+  // The counters are written by userspace and are only trusted to drive the signals; a peer that
+  // corrupts them can only confuse the endpoints it already talks to.
+  const uint32_t tx_fill = rings[ring_index_].head - rings[ring_index_].tail;
+  const uint32_t rx_fill = rings[1u - ring_index_].head - rings[1u - ring_index_].tail;
+
+  zx_signals_t self = 0u;
+  if (rx_fill != 0)
+    self |= ZX_FIFO_READABLE;
+  if (peer_ && tx_fill < elem_count_)
+    self |= ZX_FIFO_WRITABLE;
+  UpdateStateLocked((ZX_FIFO_READABLE | ZX_FIFO_WRITABLE) & ~self, self);
+
+  if (peer_) {
+    zx_signals_t peer = 0u;
+    if (tx_fill != 0)
+      peer |= ZX_FIFO_READABLE;
+    if (rx_fill < elem_count_)
+      peer |= ZX_FIFO_WRITABLE;
+    peer_->UpdateStateLocked((ZX_FIFO_READABLE | ZX_FIFO_WRITABLE) & ~peer, peer);
+  }
+  return ZX_OK;
+}
@@ -231,7 +231,9 @@ FutexContext::~FutexContext() {
 
   // All of the threads should have removed themselves from wait queues and
   // destroyed themselves by the time the process has exited.
-  DEBUG_ASSERT(active_futexes_.is_empty());
+  for (__UNUSED FutexBucket& bucket : buckets_) {
+    DEBUG_ASSERT(bucket.active_futexes.is_empty());
+  }
   DEBUG_ASSERT(free_futexes_.is_empty());
 }
 
@@ -597,30 +599,18 @@ zx_status_t FutexContext::FutexRequeueInternal(
   uintptr_t requeue_id = reinterpret_cast<uintptr_t>(requeue_ptr.get());
   KTracer::FutexActive requeue_futex_was_active;
 
-  Guard<SpinLock, IrqSave> ref_lookup_guard{&pool_lock_};
-  FutexState::PendingOpRef wake_futex_ref = ActivateFutexLocked(wake_id);
-  FutexState::PendingOpRef requeue_futex_ref = ActivateFutexLocked(requeue_id);
+  // The two futexes may live in different buckets, so they are activated one at
+  // a time.  This is safe as every thread contributes two FutexStates to the
+  // pool (see GrowFutexStatePool).
+  bool requeue_futex_activated;
+  FutexState::PendingOpRef wake_futex_ref = ActivateFutex(wake_id);
+  FutexState::PendingOpRef requeue_futex_ref = ActivateFutex(requeue_id, &requeue_futex_activated);
 
   DEBUG_ASSERT(wake_futex_ref != nullptr);
   DEBUG_ASSERT(requeue_futex_ref != nullptr);
 
-  // Check to see if the requeue target was active or not when we fetched it by
-  // looking at the pending operation ref count.  If it is exactly 1, then we
-  // just activated it.  Note that the only reason why we can get away with this
-  // is that we are still inside of the pool lock.
-  requeue_futex_was_active = (requeue_futex_ref->pending_operation_count() == 1)
-                                 ? KTracer::FutexActive::No
-                                 : KTracer::FutexActive::Yes;
-
-  // Manually release the ref lookup guard.  While we would typically do this
-  // using scope, the PendingOpRefs need to live outside of just the locking
-  // scope.  We cannot declare the PendingOpRefs outside of the scope because we
-  // do not allow default construction of PendingOpRefs, nor do we allow move
-  // assignment.  This is done on purpose; pending op refs should only ever be
-  // constructed during lookup operations, and they really should not be moved
-  // around.  We need to have a move constructor, but there is no reason for a
-  // move assignment.
-  ref_lookup_guard.Release();
+  requeue_futex_was_active =
+      requeue_futex_activated ? KTracer::FutexActive::No : KTracer::FutexActive::Yes;
 
   ResetBlockingFutexIdState wake_op;
   SetBlockingFutexIdState requeue_op(requeue_id);
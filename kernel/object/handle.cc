@@ -57,7 +57,13 @@ static_assert((kHandleReservedBitsMask | kHandleGenerationMask | kHandleIndexMas
 
 fbl::GPArena<Handle::PreserveSize, sizeof(Handle)> HandleTableArena::arena_;
 
-void Handle::Init() { HandleTableArena::arena_.Init("handles", kMaxHandleCount); }
+void Handle::Init() {
+  HandleTableArena::arena_.Init("handles", kMaxHandleCount);
+  // Every process allocates and frees its handles from the one arena, so give each CPU a cache of
+  // free handles. If the caches cannot be allocated the arena still works, just with more
+  // contention.
+  HandleTableArena::arena_.EnableCpuCaches();
+}
 
 void Handle::set_process_id(zx_koid_t pid) {
   process_id_.store(pid, ktl::memory_order_relaxed);
@@ -92,7 +98,12 @@ void* HandleTableArena::Alloc(const fbl::RefPtr<Dispatcher>& dispatcher, const c
   size_t outstanding_handles;
   {
     void* addr = arena_.Alloc();
-    outstanding_handles = arena_.DiagnosticCount();
+    // Only pay for an exact count, which visits every CPU's cache, once the cheap bound says we
+    // might be over the warning level.
+    outstanding_handles = arena_.DiagnosticCountUpperBound();
+    if (unlikely(outstanding_handles > kHighHandleCount)) {
+      outstanding_handles = arena_.DiagnosticCount();
+    }
     if (likely(addr)) {
       if (outstanding_handles > kHighHandleCount) {
         // TODO: Avoid calling this for every handle after
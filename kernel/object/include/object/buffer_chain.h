@@ -137,7 +137,8 @@ class BufferChain {
 
   // Copies |size| bytes from |src| to this chain starting at offset |dst_offset|.
   //
-  // |dst_offset| must be in the range [0, kContig).
+  // Unlike CopyOut, |dst_offset| may lie beyond the first buffer, which lets a message be gathered
+  // from several sources.
   zx_status_t CopyIn(user_in_ptr<const char> src, size_t dst_offset, size_t size) {
     return CopyInCommon(src, dst_offset, size);
   }
@@ -185,11 +186,16 @@ class BufferChain {
   // |PTR_IN| is a user_in_ptr-like type.
   template <typename PTR_IN>
   zx_status_t CopyInCommon(PTR_IN src, size_t dst_offset, size_t size) {
-    DEBUG_ASSERT(dst_offset < buffers_.front().size());
     size_t copy_offset = dst_offset;
     size_t rem = size;
     const auto end = buffers_.end();
-    for (auto iter = buffers_.begin(); rem > 0 && iter != end; ++iter) {
+    auto iter = buffers_.begin();
+    while (iter != end && copy_offset >= iter->size()) {
+      copy_offset -= iter->size();
+      ++iter;
+    }
+    DEBUG_ASSERT(rem == 0 || iter != end);
+    for (; rem > 0 && iter != end; ++iter) {
       const size_t copy_len = ktl::min(rem, iter->size() - copy_offset);
       char* dst = iter->data() + copy_offset;
       const zx_status_t status = src.copy_array_from_user(dst, copy_len);
@@ -17,6 +17,7 @@
 #include <kernel/mutex.h>
 #include <object/dispatcher.h>
 #include <object/handle.h>
+#include <vm/vm_object.h>
 
 class FifoDispatcher final : public PeeredDispatcher<FifoDispatcher, ZX_DEFAULT_FIFO_RIGHTS> {
  public:
@@ -32,14 +33,23 @@ class FifoDispatcher final : public PeeredDispatcher<FifoDispatcher, ZX_DEFAULT_
                             size_t* actual);
   zx_status_t ReadToUser(size_t elem_size, user_out_ptr<uint8_t> dst, size_t count, size_t* actual);
 
+  // Returns a VMO aliasing the rings of a ZX_FIFO_SHARED_RING fifo. The layout is described in
+  // <zircon/syscalls/fifo.h>.
+  zx_status_t GetRingVmo(fbl::RefPtr<VmObject>* vmo);
+
   // PeeredDispatcher implementation.
   void on_zero_handles_locked() TA_REQ(get_lock());
   void OnPeerZeroHandlesLocked() TA_REQ(get_lock());
 
  private:
   FifoDispatcher(fbl::RefPtr<PeerHolder<FifoDispatcher>> holder, uint32_t options,
-                 uint32_t elem_count, uint32_t elem_size, ktl::unique_ptr<uint8_t[]> data);
+                 uint32_t elem_count, uint32_t elem_size, ktl::unique_ptr<uint8_t[]> data,
+                 fbl::RefPtr<VmObject> ring_vmo, uint32_t ring_index);
   void Init(fbl::RefPtr<FifoDispatcher> other);
+  bool shared_ring() const { return ring_vmo_ != nullptr; }
+  // Recomputes ZX_FIFO_READABLE and ZX_FIFO_WRITABLE on both endpoints from the counters in
+  // |ring_vmo_|.
+  zx_status_t RingDoorbellLocked() TA_REQ(get_lock());
   zx_status_t WriteSelfLocked(size_t elem_size, user_in_ptr<const uint8_t> ptr, size_t count,
                               size_t* actual) TA_REQ(get_lock());
   zx_status_t UserSignalSelfLocked(uint32_t clear_mask, uint32_t set_mask) TA_REQ(get_lock());
@@ -52,6 +62,11 @@ class FifoDispatcher final : public PeeredDispatcher<FifoDispatcher, ZX_DEFAULT_
   uint32_t tail_ TA_GUARDED(get_lock());
   ktl::unique_ptr<uint8_t[]> data_ TA_GUARDED(get_lock());
 
+  // Only set for ZX_FIFO_SHARED_RING fifos, which have no |data_|. Both endpoints hold the same
+  // VMO, and each holds a pin on its pages; |ring_index_| is the ring this endpoint writes to.
+  const fbl::RefPtr<VmObject> ring_vmo_;
+  const uint32_t ring_index_;
+
   static constexpr uint32_t kMaxSizeBytes = ZX_FIFO_MAX_SIZE_BYTES;
 };
 
@@ -11,12 +11,14 @@
 #include <zircon/types.h>
 
 #include <fbl/intrusive_double_list.h>
-#include <fbl/intrusive_hash_table.h>
 #include <fbl/ref_ptr.h>
+#include <kernel/align.h>
 #include <kernel/lockdep.h>
 #include <kernel/mutex.h>
 #include <kernel/owned_wait_queue.h>
+#include <kernel/spinlock.h>
 #include <kernel/thread_lock.h>
+#include <ktl/atomic.h>
 #include <ktl/move.h>
 #include <ktl/unique_ptr.h>
 
@@ -36,6 +38,11 @@ class ThreadDispatcher;
 // when it has any waiters.  See (Grow|Shrink)FutexStatePool comments as well as
 // the FutexState's notes (below) for more details.
 //
+// Active FutexStates are kept in a fixed size table of buckets, selected by
+// hashing the futex ID, each with its own lock.  Operations on futexes which
+// hash to different buckets do not contend with each other; only activating a
+// futex or returning it to the free pool briefly takes the pool lock.
+//
 // The remaining methods in the public interface implement the 3 primary futex
 // syscall operations (Wait, Wake, and Requeue) as well as the one
 // test/diagnostic operation (GetOwner).  See the zircon syscall documentation
@@ -151,11 +158,13 @@ class FutexContext {
   // thread exits, it take two FutexStates out of the free pool and lets them
   // expire.
   //
-  // There is a master spin lock for each process which protects the sets of
-  // active and free FutexStates.  Any time a thread needs to work with futex
-  // ID X, it must first obtain the process-wide pool lock and either find the
-  // FutexState in the active set with that ID, or activate one from the free
-  // list.  After this, the process wide pool lock is immediately released.
+  // The active FutexStates are spread over a table of hash buckets, each
+  // protected by its own spin lock, and the free FutexStates are protected by
+  // the process-wide pool lock.  Any time a thread needs to work with futex ID
+  // X, it must first obtain the lock of the bucket X hashes to and either find
+  // the FutexState in that bucket with that ID, or activate one from the free
+  // list (taking the pool lock only for the time it takes to pop it).  After
+  // this, the bucket lock is immediately released.
   //
   // In order to keep this FutexState from disappearing out from under
   // the thread during its Wait/Wake/Requeue operation, a "pending operation"
@@ -165,7 +174,7 @@ class FutexContext {
   // FutexState objects are managed using ktl::unique_ptr.  At all times, a
   // FutexState will be in one of three states.
   //
-  // 1) A member of a FutexContext's active_futexes_ hashtable.  Futexes in this state are
+  // 1) A member of one of a FutexContext's buckets_.  Futexes in this state are
   //    currently involved in at least one futex operation.  Their futex ID will
   //    be non-zero as will their pending operation count..
   // 2) A member of a FutexContext's free_futexes_ list.  These futexes are
@@ -183,7 +192,7 @@ class FutexContext {
     // PendingOpRef to represent the borrow from the pool instead of a raw
     // FutexState pointer.  By default, these object will release a pending
     // operation reference when they go out of scope.  They do this under the
-    // protection of the outer FutexContext's pool_lock_, returning the
+    // protection of the lock of the FutexState's bucket, returning the
     // FutexState to the FutexContext's free pool when the pending operation
     // count reaches zero.
     //
@@ -232,7 +241,9 @@ class FutexContext {
     // Finally, during a requeue operation, we are moving threads which are
     // currently blocked on futex A over to futex B.  As we do this, we need to
     // make sure to move their pending operation references at the same time.
-    // TakeRefs is the method which allows us to do this.
+    // TakeRefs is the method which allows us to do this.  Since both op refs
+    // hold at least one reference of their own which they are not giving up,
+    // neither count can reach zero here and no bucket lock is needed.
     class PendingOpRef {
      public:
       PendingOpRef(FutexContext* ctx, FutexState* state) : ctx_(ctx), state_(state) {
@@ -260,14 +271,13 @@ class FutexContext {
       }
 
       void TakeRefs(PendingOpRef* other, uint32_t count) {
-        Guard<SpinLock, IrqSave> pool_lock_guard{&ctx_->pool_lock_};
         DEBUG_ASSERT(state_ != nullptr);
         DEBUG_ASSERT(other->state_ != nullptr);
-        DEBUG_ASSERT(state_->pending_operation_count_ > 0);
-        DEBUG_ASSERT(other->state_->pending_operation_count_ > count);
+        DEBUG_ASSERT(state_->pending_operation_count() > 0);
+        DEBUG_ASSERT(other->state_->pending_operation_count() > count);
 
-        state_->pending_operation_count_ += count;
-        other->state_->pending_operation_count_ -= count;
+        state_->pending_operation_count_.fetch_add(count, ktl::memory_order_relaxed);
+        other->state_->pending_operation_count_.fetch_sub(count, ktl::memory_order_relaxed);
       }
 
       void CancelRef() {
@@ -284,18 +294,21 @@ class FutexContext {
      private:
       void Release() {
         if (state_ != nullptr) {
-          Guard<SpinLock, IrqSave> pool_lock_guard{&ctx_->pool_lock_};
+          DEBUG_ASSERT(state_->id() != 0);
+          FutexBucket& bucket = ctx_->GetBucket(state_->id());
+          Guard<SpinLock, IrqSave> bucket_guard{&bucket.lock};
           uint32_t release_count = 1 + extra_refs_;
 
-          DEBUG_ASSERT(state_ != nullptr);
-          DEBUG_ASSERT(state_->id() != 0);
-          DEBUG_ASSERT(state_->pending_operation_count_ >= release_count);
+          const uint32_t prev =
+              state_->pending_operation_count_.fetch_sub(release_count, ktl::memory_order_relaxed);
+          DEBUG_ASSERT(prev >= release_count);
+          if (prev == release_count) {
+            ktl::unique_ptr<FutexState> free_state = bucket.active_futexes.erase(*state_);
+            free_state->id_ = 0;
+            free_state->waiters_.AssertNotOwned();
 
-          state_->pending_operation_count_ -= release_count;
-          if (state_->pending_operation_count_ == 0) {
-            ctx_->free_futexes_.push_front(ctx_->active_futexes_.erase(*state_));
-            state_->id_ = 0;
-            state_->waiters_.AssertNotOwned();
+            Guard<SpinLock, IrqSave> pool_lock_guard{&ctx_->pool_lock_};
+            ctx_->free_futexes_.push_front(ktl::move(free_state));
           }
 
           state_ = nullptr;
@@ -312,10 +325,6 @@ class FutexContext {
 
     uintptr_t id() const { return id_; }
 
-    // hashtable support
-    uintptr_t GetKey() const { return id(); }
-    static size_t GetHash(uintptr_t key) { return (key >> 3); }
-
    private:
     friend typename ktl::unique_ptr<FutexState>::deleter_type;
     friend class FutexContext;
@@ -328,14 +337,20 @@ class FutexContext {
     FutexState& operator=(const FutexState&) = delete;
     FutexState& operator=(FutexState&&) = delete;
 
-    uint32_t pending_operation_count() const { return pending_operation_count_; }
+    uint32_t pending_operation_count() const {
+      return pending_operation_count_.load(ktl::memory_order_relaxed);
+    }
 
     uintptr_t id_ = 0;
     OwnedWaitQueue waiters_;
 
-    // pending operation count is protected by the outer FutexContext pool lock.
-    // Sadly, there is no good way to express this using static annotations.
-    uint32_t pending_operation_count_ = 0;
+    // The pending operation count may only be raised from zero, or dropped to
+    // zero, with the lock of the FutexState's bucket held; this is what keeps
+    // lookups from finding a FutexState which is being returned to the pool.
+    // Transfers between two FutexStates which both hold references (see
+    // TakeRefs) may happen without it.  Sadly, there is no good way to express
+    // this using static annotations.
+    ktl::atomic<uint32_t> pending_operation_count_ = 0;
 
     DECLARE_MUTEX(FutexContext) lock_ TA_ACQ_BEFORE(thread_lock);
   };
@@ -366,21 +381,46 @@ class FutexContext {
   static void* operator new(size_t) = delete;
   static void* operator new[](size_t) = delete;
 
+  // A single bucket of the active futex table.  Buckets are padded out to a
+  // cache line so that threads operating on futexes in neighboring buckets do
+  // not contend on the same line.
+  //
+  // Note that lockdep tracking is disabled on this lock because it is acquired
+  // while holding the thread lock.
+  struct __CPU_ALIGN FutexBucket {
+    DECLARE_SPINLOCK(FutexContext::FutexBucket, lockdep::LockFlagsTrackingDisabled) lock;
+    fbl::DoublyLinkedList<ktl::unique_ptr<FutexState>> active_futexes TA_GUARDED(lock);
+  };
+
+  // Number of buckets in the active futex table.  Must be a power of two.
+  static constexpr size_t kNumBuckets = 32;
+  static_assert((kNumBuckets & (kNumBuckets - 1)) == 0, "kNumBuckets must be a power of 2");
+
+  FutexBucket& GetBucket(uintptr_t id) {
+    // Futexes are 4 byte aligned, and are frequently packed together, so mix
+    // the remaining bits before selecting a bucket.
+    const uint64_t hash = static_cast<uint64_t>(id >> 2) * 0x9E3779B97F4A7C15ull;
+    return buckets_[hash >> (64 - __builtin_ctzll(kNumBuckets))];
+  }
+
   // Find the futex state for a given ID in the futex table, increment its
   // pending operation reference count, and return an RAII helper which helps to
   // manage the pending operation references.
-  FutexState::PendingOpRef FindActiveFutex(uintptr_t id) TA_EXCL(pool_lock_) {
-    Guard<SpinLock, IrqSave> pool_lock_guard{&pool_lock_};
-    return FindActiveFutexLocked(id);
+  FutexState::PendingOpRef FindActiveFutex(uintptr_t id) {
+    FutexBucket& bucket = GetBucket(id);
+    Guard<SpinLock, IrqSave> bucket_guard{&bucket.lock};
+    return FindActiveFutexLocked(bucket, id);
   }
 
-  FutexState::PendingOpRef FindActiveFutexLocked(uintptr_t id) TA_REQ(pool_lock_) {
-    auto iter = active_futexes_.find(id);
-
-    if (iter.IsValid()) {
-      DEBUG_ASSERT(iter->pending_operation_count_ > 0);
-      ++(iter->pending_operation_count_);
-      return {this, &(*iter)};
+  FutexState::PendingOpRef FindActiveFutexLocked(FutexBucket& bucket, uintptr_t id)
+      TA_REQ(bucket.lock) {
+    for (FutexState& state : bucket.active_futexes) {
+      if (state.id() == id) {
+        __UNUSED const uint32_t prev =
+            state.pending_operation_count_.fetch_add(1, ktl::memory_order_relaxed);
+        DEBUG_ASSERT(prev > 0);
+        return {this, &state};
+      }
     }
 
     return {this, nullptr};
@@ -388,53 +428,60 @@ class FutexContext {
 
   // Find a futex with the specified ID, increment its pending_operation_count
   // and return it to the caller.  If the given futex ID is not currently
-  // active, grab a free one and activate it.
-  FutexState::PendingOpRef ActivateFutex(uintptr_t id) TA_EXCL(pool_lock_) {
-    Guard<SpinLock, IrqSave> pool_lock_guard{&pool_lock_};
-    return ActivateFutexLocked(id);
-  }
-
-  FutexState::PendingOpRef ActivateFutexLocked(uintptr_t id) TA_REQ(pool_lock_) {
-    if (auto ret = FindActiveFutexLocked(id); ret != nullptr) {
+  // active, grab a free one and activate it.  If |activated| is non-null, it
+  // is set to whether this call was the one which activated the futex.
+  FutexState::PendingOpRef ActivateFutex(uintptr_t id, bool* activated = nullptr) {
+    FutexBucket& bucket = GetBucket(id);
+    Guard<SpinLock, IrqSave> bucket_guard{&bucket.lock};
+
+    if (auto ret = FindActiveFutexLocked(bucket, id); ret != nullptr) {
+      if (activated) {
+        *activated = false;
+      }
       return ret;
     }
 
-    ktl::unique_ptr<FutexState> new_state = free_futexes_.pop_front();
+    ktl::unique_ptr<FutexState> new_state;
+    {
+      Guard<SpinLock, IrqSave> pool_lock_guard{&pool_lock_};
+      new_state = free_futexes_.pop_front();
+    }
 
     // Sanity checks.
     DEBUG_ASSERT(new_state != nullptr);
     DEBUG_ASSERT(new_state->id() == 0);
-    DEBUG_ASSERT(new_state->pending_operation_count_ == 0);
+    DEBUG_ASSERT(new_state->pending_operation_count() == 0);
     new_state->waiters_.AssertNotOwned();
 
     FutexState* ptr = new_state.get();
     ptr->id_ = id;
-    ++ptr->pending_operation_count_;
-    active_futexes_.insert(ktl::move(new_state));
+    ptr->pending_operation_count_.store(1, ktl::memory_order_relaxed);
+    bucket.active_futexes.push_front(ktl::move(new_state));
 
+    if (activated) {
+      *activated = true;
+    }
     return {this, ptr};
   }
 
-  // Protects the free futex pool, and active futex table.  This is an
-  // irq-disable spin lock because it should _never_ be held during any blocking
-  // operations.  Only when putting FutexStates into and out of the free pool,
-  // and when moving Futexes states to and from the active table.
+  // The active futex table.  A bucket's lock is always acquired before the
+  // pool lock, and never while holding another bucket's lock.
+  FutexBucket buckets_[kNumBuckets];
+
+  // Protects the free futex pool.  This is an irq-disable spin lock because it
+  // should _never_ be held during any blocking operations.  Only when putting
+  // FutexStates into and out of the free pool.
   //
   // There are times where an individual futex state must be held invariant
   // while a decision to return a futex into the free pool needs to be made.  In
-  // these cases, the pool lock must be acquired *after* the individual
-  // FutexState lock.  Sadly, I don't know a good way to express this with
-  // static analysis.
+  // these cases, the bucket and pool locks must be acquired *after* the
+  // individual FutexState lock.  Sadly, I don't know a good way to express this
+  // with static analysis.
   //
   // Note that lockdep tracking is disabled on this lock because it is acquired
   // while holding the thread lock.
   DECLARE_SPINLOCK(FutexContext, lockdep::LockFlagsTrackingDisabled) pool_lock_;
 
-  // Hash table for FutexStates currently in use (eg; futexes with waiters).
-  fbl::HashTable<uintptr_t, ktl::unique_ptr<FutexState>,
-                 fbl::DoublyLinkedList<ktl::unique_ptr<FutexState>>>
-      active_futexes_ TA_GUARDED(pool_lock_);
-
   // Free list for all futexes which are currently not in use.
   fbl::DoublyLinkedList<ktl::unique_ptr<FutexState>> free_futexes_ TA_GUARDED(pool_lock_);
 };
@@ -12,6 +12,8 @@
 #include <zircon/types.h>
 
 #include <fbl/intrusive_single_list.h>
+#include <fbl/ref_ptr.h>
+#include <vm/vm_object.h>
 
 // MBufChain is a container for storing a stream of bytes or a sequence of datagrams.
 //
@@ -27,6 +29,14 @@ class MBufChain {
   // Returns an error on failure.
   zx_status_t WriteStream(user_in_ptr<const char> src, size_t len, size_t* written);
 
+  // Appends up to |len| bytes of stream data held in |vmo| starting at |offset| without copying
+  // them, and sets |written| to the number of bytes appended. The chain keeps a reference to |vmo|
+  // until the bytes are read, so the caller must not modify that range of it afterwards.
+  //
+  // Returns an error on failure.
+  zx_status_t WriteStreamLoaned(const fbl::RefPtr<VmObject>& vmo, uint64_t offset, size_t len,
+                                size_t* written);
+
   // Writes a datagram of |len| bytes from |src| and sets |written| to number of bytes written.
   //
   // This operation is atomic in that either the entire datagram is written successfully or the
@@ -67,13 +77,13 @@ class MBufChain {
   }
 
   // Returns the maximum number of bytes that can be stored in the chain.
-  size_t max_size() const { return kSizeMax; }
+  static constexpr size_t max_size() { return kSizeMax; }
 
  private:
   // An MBuf is a small fixed-size chainable memory buffer.
   struct MBuf : public fbl::SinglyLinkedListable<MBuf*> {
-    // 8 for the linked list and 4 for the explicit uint32_t fields.
-    static constexpr size_t kHeaderSize = 8 + (4 * 4);
+    // 8 for the linked list, 4 for the explicit uint32_t fields and 8 for the vmo reference.
+    static constexpr size_t kHeaderSize = 8 + (4 * 4) + 8;
     // 16 is for the malloc header.
     static constexpr size_t kMallocSize = 2048 - 16;
     static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
@@ -90,8 +100,10 @@ class MBufChain {
     // Always 0 in ZX_SOCKET_STREAM mode.
     uint32_t pkt_len_ = 0u;
     uint32_t unused_;
+    // When set, the bytes of this mbuf are [off_, off_ + len_) of vmo_ rather than of data_, which
+    // is left unused. Only used in ZX_SOCKET_STREAM mode.
+    fbl::RefPtr<VmObject> vmo_;
     char data_[kPayloadSize] = {0};
-    // TODO: maybe union data_ with char* blocks for large messages
   };
   static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
 
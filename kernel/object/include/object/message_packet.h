@@ -19,10 +19,12 @@
 
 constexpr uint32_t kMaxMessageSize = 65536u;
 constexpr uint32_t kMaxMessageHandles = 64u;
+constexpr uint32_t kMaxMessageIovecs = 64u;
 
 // ensure public constants are aligned
 static_assert(ZX_CHANNEL_MAX_MSG_BYTES == kMaxMessageSize, "");
 static_assert(ZX_CHANNEL_MAX_MSG_HANDLES == kMaxMessageHandles, "");
+static_assert(ZX_CHANNEL_MAX_MSG_IOVECS == kMaxMessageIovecs, "");
 
 class Handle;
 class MessagePacket;
@@ -44,6 +46,10 @@ class MessagePacket final : public fbl::DoublyLinkedListable<MessagePacketPtr> {
                             MessagePacketPtr* msg);
   static zx_status_t Create(const char* data, uint32_t data_size, uint32_t num_handles,
                             MessagePacketPtr* msg);
+  // Creates a message packet whose data is gathered, in order, from the |num_iovecs| user buffers
+  // described by |iovecs|, and with space for |num_handles| handles as above.
+  static zx_status_t CreateIovec(user_in_ptr<const zx_iovec_t> iovecs, uint32_t num_iovecs,
+                                 uint32_t num_handles, MessagePacketPtr* msg);
 
   uint32_t data_size() const { return data_size_; }
 
@@ -197,6 +197,9 @@ class PortDispatcher final : public SoloDispatcher<PortDispatcher, ZX_DEFAULT_PO
   zx_status_t QueueUser(const zx_port_packet_t& packet);
   bool QueueInterruptPacket(PortInterruptPacket* port_packet, zx_time_t timestamp);
   zx_status_t Dequeue(const Deadline& deadline, zx_port_packet_t* packet);
+  // Dequeues up to |count| packets that are already queued, without blocking, and returns the
+  // number dequeued. Used to drain a busy port after a |Dequeue|.
+  size_t TryDequeue(zx_port_packet_t* packets, size_t count);
   bool RemoveInterruptPacket(PortInterruptPacket* port_packet);
 
   // This method determines the observer's fate. Upon return, one of the following will have
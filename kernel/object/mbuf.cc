@@ -12,6 +12,7 @@
 #include <fbl/alloc_checker.h>
 #include <ktl/algorithm.h>
 #include <ktl/type_traits.h>
+#include <vm/vm_aspace.h>
 
 #define LOCAL_TRACE 0
 
@@ -20,7 +21,13 @@ constexpr size_t MBufChain::MBuf::kMallocSize;
 constexpr size_t MBufChain::MBuf::kPayloadSize;
 constexpr size_t MBufChain::kSizeMax;
 
-size_t MBufChain::MBuf::rem() const { return kPayloadSize - (off_ + len_); }
+size_t MBufChain::MBuf::rem() const {
+  // Nothing more can be appended to loaned bytes.
+  if (vmo_) {
+    return 0;
+  }
+  return kPayloadSize - (off_ + len_);
+}
 
 MBufChain::~MBufChain() {
   while (!tail_.is_empty())
@@ -56,11 +63,22 @@ zx_status_t MBufChain::ReadHelper(T* chain, user_out_ptr<char> dst, size_t len,
   size_t pos = 0;
   auto iter = chain->tail_.begin();
   while (pos < len && iter != chain->tail_.end()) {
-    const char* src = iter->data_ + iter->off_;
     size_t copy_len = ktl::min(static_cast<size_t>(iter->len_), len - pos);
-    zx_status_t status = dst.byte_offset(pos).copy_array_to_user(src, copy_len);
-    if (status != ZX_OK) {
-      return status;
+    zx_status_t status;
+    if (iter->vmo_) {
+      VmAspace* aspace = VmAspace::vaddr_to_aspace(reinterpret_cast<uintptr_t>(dst.get()));
+      status = aspace ? iter->vmo_->ReadUser(aspace, dst.byte_offset(pos), iter->off_, copy_len)
+                      : ZX_ERR_INVALID_ARGS;
+      // Report a bad buffer the same way the copy below does.
+      if (status != ZX_OK) {
+        return ZX_ERR_INVALID_ARGS;
+      }
+    } else {
+      const char* src = iter->data_ + iter->off_;
+      status = dst.byte_offset(pos).copy_array_to_user(src, copy_len);
+      if (status != ZX_OK) {
+        return status;
+      }
     }
 
     pos += copy_len;
@@ -201,6 +219,34 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const char> src, size_t len, size
   return ZX_OK;
 }
 
+zx_status_t MBufChain::WriteStreamLoaned(const fbl::RefPtr<VmObject>& vmo, uint64_t offset,
+                                         size_t len, size_t* written) {
+  DEBUG_ASSERT(vmo);
+  DEBUG_ASSERT(offset + len <= UINT32_MAX);
+
+  len = ktl::min(len, kSizeMax - ktl::min(size_, kSizeMax));
+  if (len == 0)
+    return ZX_ERR_SHOULD_WAIT;
+
+  MBuf* buf = AllocMBuf();
+  if (buf == nullptr)
+    return ZX_ERR_SHOULD_WAIT;
+  buf->vmo_ = vmo;
+  buf->off_ = static_cast<uint32_t>(offset);
+  buf->len_ = static_cast<uint32_t>(len);
+
+  if (head_ == nullptr) {
+    tail_.push_front(buf);
+  } else {
+    tail_.insert_after(tail_.make_iterator(*head_), buf);
+  }
+  head_ = buf;
+
+  *written = len;
+  size_ += len;
+  return ZX_OK;
+}
+
 MBufChain::MBuf* MBufChain::AllocMBuf() {
   if (freelist_.is_empty()) {
     fbl::AllocChecker ac;
@@ -213,5 +259,6 @@ MBufChain::MBuf* MBufChain::AllocMBuf() {
 void MBufChain::FreeMBuf(MBuf* buf) {
   buf->off_ = 0u;
   buf->len_ = 0u;
+  buf->vmo_.reset();
   freelist_.push_front(buf);
 }
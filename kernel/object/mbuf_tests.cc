@@ -298,6 +298,30 @@ static bool stream_peek_underflow() {
   END_TEST;
 }
 
+// Tests that loaned bytes are read back in order with copied ones.
+static bool stream_write_loaned() {
+  BEGIN_TEST;
+
+  fbl::RefPtr<VmObject> vmo;
+  ASSERT_EQ(ZX_OK, VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, PAGE_SIZE, &vmo));
+  ASSERT_EQ(ZX_OK, vmo->Write("xxdefgxx", 0, 8));
+
+  MBufChain chain;
+  ASSERT_TRUE(WriteHelper(&chain, "abc", MessageType::kStream));
+  size_t written = 0;
+  ASSERT_EQ(ZX_OK, chain.WriteStreamLoaned(vmo, 2, 4, &written));
+  EXPECT_EQ(4u, written);
+  ASSERT_TRUE(WriteHelper(&chain, "hi", MessageType::kStream));
+  EXPECT_EQ(9u, chain.size());
+
+  EXPECT_TRUE(Equal(ReadHelper(&chain, 10, MessageType::kStream, ReadType::kPeek), "abcdefghi"));
+  EXPECT_TRUE(Equal(ReadHelper(&chain, 5, MessageType::kStream, ReadType::kRead), "abcde"));
+  EXPECT_TRUE(Equal(ReadHelper(&chain, 10, MessageType::kStream, ReadType::kRead), "fghi"));
+  EXPECT_TRUE(chain.is_empty());
+
+  END_TEST;
+}
+
 // Tests reading a datagram when chain is empty.
 static bool datagram_read_empty() {
   BEGIN_TEST;
@@ -561,6 +585,7 @@ UNITTEST("stream_peek", stream_peek)
 UNITTEST("stream_peek_empty", stream_peek_empty)
 UNITTEST("stream_peek_zero", stream_peek_zero)
 UNITTEST("stream_peek_underflow", stream_peek_underflow)
+UNITTEST("stream_write_loaned", stream_write_loaned)
 UNITTEST("datagram_read_empty", datagram_read_empty)
 UNITTEST("datagram_read_zero", datagram_read_zero)
 UNITTEST("datagram_read_buffer_too_small", datagram_read_buffer_too_small)
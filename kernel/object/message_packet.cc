@@ -106,6 +106,50 @@ zx_status_t MessagePacket::Create(const char* data, uint32_t data_size, uint32_t
   return ZX_OK;
 }
 
+// static
+zx_status_t MessagePacket::CreateIovec(user_in_ptr<const zx_iovec_t> iovecs, uint32_t num_iovecs,
+                                       uint32_t num_handles, MessagePacketPtr* msg) {
+  if (unlikely(num_iovecs > kMaxMessageIovecs)) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+
+  zx_iovec_t vec[kMaxMessageIovecs];
+  zx_status_t status = iovecs.copy_array_from_user(vec, num_iovecs);
+  if (unlikely(status != ZX_OK)) {
+    return status;
+  }
+
+  // Sum the sizes first, as the whole message must be allocated up front. The individual
+  // capacities are bounded before adding them so that the sum cannot overflow.
+  size_t data_size = 0;
+  for (uint32_t i = 0; i < num_iovecs; ++i) {
+    if (unlikely(vec[i].capacity > kMaxMessageSize)) {
+      return ZX_ERR_OUT_OF_RANGE;
+    }
+    data_size += vec[i].capacity;
+  }
+  if (unlikely(data_size > kMaxMessageSize)) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+
+  MessagePacketPtr new_msg;
+  status = CreateCommon(static_cast<uint32_t>(data_size), num_handles, &new_msg);
+  if (unlikely(status != ZX_OK)) {
+    return status;
+  }
+  size_t offset = PayloadOffset(num_handles);
+  for (uint32_t i = 0; i < num_iovecs; ++i) {
+    status = new_msg->buffer_chain_->CopyIn(
+        make_user_in_ptr(static_cast<const char*>(vec[i].buffer)), offset, vec[i].capacity);
+    if (unlikely(status != ZX_OK)) {
+      return status;
+    }
+    offset += vec[i].capacity;
+  }
+  *msg = ktl::move(new_msg);
+  return ZX_OK;
+}
+
 void MessagePacket::recycle(MessagePacket* packet) {
   // Grab the buffer chain for this packet
   BufferChain* chain = packet->buffer_chain_;
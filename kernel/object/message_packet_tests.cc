@@ -8,6 +8,7 @@
 #include <lib/unittest/user_memory.h>
 #include <lib/user_copy/user_ptr.h>
 
+#include <fbl/algorithm.h>
 #include <ktl/unique_ptr.h>
 
 #include "object/message_packet.h"
@@ -74,6 +75,70 @@ static bool create_void_star() {
   END_TEST;
 }
 
+// Create a MessagePacket gathered from several iovecs, whose pieces straddle the packet's buffers,
+// and call CopyDataTo.
+static bool create_iovec() {
+  BEGIN_TEST;
+  constexpr size_t kSize = 3 * PAGE_SIZE + 17;
+  constexpr size_t kPieces[] = {1, PAGE_SIZE - 3, 0, kSize - PAGE_SIZE - 8, 10};
+  ktl::unique_ptr<UserMemory> mem = UserMemory::Create(kSize);
+  auto mem_in = mem->user_in<char>();
+  auto mem_out = mem->user_out<char>();
+
+  fbl::AllocChecker ac;
+  auto buf = ktl::unique_ptr<char[]>(new (&ac) char[kSize]);
+  ASSERT_TRUE(ac.check());
+  for (size_t i = 0; i < kSize; ++i) {
+    buf[i] = static_cast<char>(i * 7);
+  }
+  ASSERT_EQ(ZX_OK, mem_out.copy_array_to_user(buf.get(), kSize));
+
+  constexpr uint32_t kNumIovecs = fbl::count_of(kPieces);
+  zx_iovec_t iovecs[kNumIovecs];
+  size_t offset = 0;
+  for (uint32_t i = 0; i < kNumIovecs; ++i) {
+    iovecs[i] = {const_cast<char*>(mem_in.get()) + offset, kPieces[i]};
+    offset += kPieces[i];
+  }
+  ASSERT_EQ(kSize, offset);
+  ktl::unique_ptr<UserMemory> iovec_mem = UserMemory::Create(sizeof(iovecs));
+  ASSERT_EQ(ZX_OK, iovec_mem->user_out<zx_iovec_t>().copy_array_to_user(iovecs, kNumIovecs));
+
+  constexpr uint32_t kNumHandles = 3;
+  MessagePacketPtr mp;
+  EXPECT_EQ(ZX_OK, MessagePacket::CreateIovec(iovec_mem->user_in<zx_iovec_t>(), kNumIovecs,
+                                              kNumHandles, &mp));
+  ASSERT_EQ(kSize, mp->data_size());
+  EXPECT_EQ(kNumHandles, mp->num_handles());
+
+  auto result_buf = ktl::unique_ptr<char[]>(new (&ac) char[kSize]);
+  ASSERT_TRUE(ac.check());
+  memset(result_buf.get(), 0, kSize);
+  ASSERT_EQ(ZX_OK, mem_out.copy_array_to_user(result_buf.get(), kSize));
+  ASSERT_EQ(ZX_OK, mp->CopyDataTo(mem_out));
+  ASSERT_EQ(ZX_OK, mem_in.copy_array_from_user(result_buf.get(), kSize));
+  EXPECT_EQ(0, memcmp(buf.get(), result_buf.get(), kSize));
+  END_TEST;
+}
+
+// Attempt to create a MessagePacket from iovecs that add up to more than the maximum message size.
+static bool create_iovec_too_large() {
+  BEGIN_TEST;
+  ktl::unique_ptr<UserMemory> mem = UserMemory::Create(1);
+  char* const base = const_cast<char*>(mem->user_in<char>().get());
+
+  zx_iovec_t iovecs[] = {{base, kMaxMessageSize}, {base, 1}};
+  ktl::unique_ptr<UserMemory> iovec_mem = UserMemory::Create(sizeof(iovecs));
+  ASSERT_EQ(ZX_OK, iovec_mem->user_out<zx_iovec_t>().copy_array_to_user(iovecs, 2));
+
+  MessagePacketPtr mp;
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE,
+            MessagePacket::CreateIovec(iovec_mem->user_in<zx_iovec_t>(), 2, 0, &mp));
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, MessagePacket::CreateIovec(iovec_mem->user_in<zx_iovec_t>(),
+                                                            kMaxMessageIovecs + 1, 0, &mp));
+  END_TEST;
+}
+
 // Create a MessagePacket with zero-length data.
 static bool create_zero() {
   BEGIN_TEST;
@@ -147,6 +212,8 @@ static bool copy_bad_mem() {
 UNITTEST_START_TESTCASE(message_packet_tests)
 UNITTEST("create", create)
 UNITTEST("create_void_star", create_void_star)
+UNITTEST("create_iovec", create_iovec)
+UNITTEST("create_iovec_too_large", create_iovec_too_large)
 UNITTEST("create_zero", create_zero)
 UNITTEST("create_too_many_handles", create_too_many_handles)
 UNITTEST("create_bad_mem", create_bad_mem)
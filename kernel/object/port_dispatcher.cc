@@ -62,6 +62,15 @@ ArenaPortAllocator port_allocator;
 bool IsDefaultAllocatedEphemeral(const PortPacket& port_packet) {
   return port_packet.allocator == &port_allocator && port_packet.is_ephemeral();
 }
+
+void FillInterruptPacket(const PortInterruptPacket& port_interrupt_packet,
+                         zx_port_packet_t* out_packet) {
+  *out_packet = {};
+  out_packet->key = port_interrupt_packet.key;
+  out_packet->type = ZX_PKT_TYPE_INTERRUPT;
+  out_packet->status = ZX_OK;
+  out_packet->interrupt.timestamp = port_interrupt_packet.timestamp;
+}
 }  // namespace.
 
 zx_status_t ArenaPortAllocator::Init() { return arena_.Init("packets", kMaxAllocatedPacketCount); }
@@ -330,11 +339,7 @@ zx_status_t PortDispatcher::Dequeue(const Deadline& deadline, zx_port_packet_t*
       Guard<SpinLock, IrqSave> guard{&spinlock_};
       PortInterruptPacket* port_interrupt_packet = interrupt_packets_.pop_front();
       if (port_interrupt_packet != nullptr) {
-        *out_packet = {};
-        out_packet->key = port_interrupt_packet->key;
-        out_packet->type = ZX_PKT_TYPE_INTERRUPT;
-        out_packet->status = ZX_OK;
-        out_packet->interrupt.timestamp = port_interrupt_packet->timestamp;
+        FillInterruptPacket(*port_interrupt_packet, out_packet);
         break;
       }
     }
@@ -375,6 +380,56 @@ zx_status_t PortDispatcher::Dequeue(const Deadline& deadline, zx_port_packet_t*
   return ZX_OK;
 }
 
+size_t PortDispatcher::TryDequeue(zx_port_packet_t* packets, size_t count) {
+  canary_.Assert();
+
+  // Claim as many of the queued packets as we have room for in one go. As in Dequeue, a claimed
+  // packet may have been canceled before we get to it, so we can come up short.
+  const size_t claimed = static_cast<size_t>(sema_.TryWait(count));
+  if (claimed == 0) {
+    return 0;
+  }
+
+  size_t dequeued = 0;
+  if (options_ == ZX_PORT_BIND_TO_INTERRUPT) {
+    Guard<SpinLock, IrqSave> guard{&spinlock_};
+    while (dequeued < claimed) {
+      PortInterruptPacket* port_interrupt_packet = interrupt_packets_.pop_front();
+      if (port_interrupt_packet == nullptr) {
+        break;
+      }
+      FillInterruptPacket(*port_interrupt_packet, &packets[dequeued++]);
+    }
+  }
+
+  fbl::DoublyLinkedList<PortPacket*> to_free;
+  if (dequeued < claimed) {
+    Guard<Mutex> guard{get_lock()};
+    while (dequeued < claimed) {
+      PortPacket* port_packet = packets_.pop_front();
+      if (port_packet == nullptr) {
+        break;
+      }
+      if (IsDefaultAllocatedEphemeral(*port_packet)) {
+        --num_ephemeral_packets_;
+      }
+      packets[dequeued++] = port_packet->packet;
+      port_packet->observer.reset();
+      // See Dequeue for why is_ephemeral must be read under the lock.
+      if (port_packet->is_ephemeral()) {
+        to_free.push_back(port_packet);
+      }
+    }
+  }
+  while (!to_free.is_empty()) {
+    to_free.pop_front()->Free();
+  }
+
+  kcounter_add(port_dequeue_count, dequeued);
+  kcounter_add(port_dequeue_spurious_count, claimed - dequeued);
+  return dequeued;
+}
+
 void PortDispatcher::MaybeReap(PortObserver* observer, PortPacket* port_packet) {
   canary_.Assert();
 
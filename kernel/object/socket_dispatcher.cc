@@ -17,6 +17,7 @@
 
 #include <fbl/alloc_checker.h>
 #include <fbl/auto_lock.h>
+#include <ktl/algorithm.h>
 #include <object/handle.h>
 #include <vm/vm_aspace.h>
 #include <vm/vm_object.h>
@@ -26,6 +27,44 @@
 
 KCOUNTER(dispatcher_socket_create_count, "dispatcher.socket.create")
 KCOUNTER(dispatcher_socket_destroy_count, "dispatcher.socket.destroy")
+KCOUNTER(dispatcher_socket_loaned_bytes, "dispatcher.socket.loaned_bytes")
+KCOUNTER(dispatcher_socket_loan_failures, "dispatcher.socket.loan_failures")
+
+namespace {
+
+// Stream writes of at least this many bytes are copied into a staging vmo which is queued in the
+// socket as a single mbuf, instead of being copied into a chain of small mbufs. Below this, setting
+// up the vmo costs more than walking the mbufs.
+constexpr size_t kLoanMinSize = 16 * PAGE_SIZE;
+
+// Copies the |len| bytes of user memory at |src| into a new vmo. The writer's own vmo is only read
+// from; taking a copy-on-write clone of it instead would reparent it under a hidden vmo, which
+// makes it stop supporting decommit and toggle ZX_VMO_ZERO_CHILDREN, and makes every later write to
+// it merge with the clone. Like the copy into mbufs, this runs with the socket lock held, once the
+// socket is known to be writable.
+zx_status_t StageUserBytes(user_in_ptr<const char> src, size_t len,
+                           fbl::RefPtr<VmObject>* staging) {
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(len));
+
+  VmAspace* aspace = VmAspace::vaddr_to_aspace(reinterpret_cast<vaddr_t>(src.get()));
+  if (!aspace || !aspace->is_user()) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+
+  fbl::RefPtr<VmObject> vmo;
+  zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, len, &vmo);
+  if (status != ZX_OK) {
+    return status;
+  }
+  status = vmo->WriteUser(aspace, src, 0, len);
+  if (status != ZX_OK) {
+    return status;
+  }
+  *staging = ktl::move(vmo);
+  return ZX_OK;
+}
+
+}  // namespace
 
 // static
 zx_status_t SocketDispatcher::Create(uint32_t flags, KernelHandle<SocketDispatcher>* handle0,
@@ -196,7 +235,24 @@ zx_status_t SocketDispatcher::WriteSelfLocked(user_in_ptr<const char> src, size_
   if (flags_ & ZX_SOCKET_DATAGRAM) {
     status = data_.WriteDatagram(src, len, &st);
   } else {
-    status = data_.WriteStream(src, len, &st);
+    // Only stage as much as the chain has room for, so that a nearly full socket does not pay for
+    // a copy it then drops.
+    const size_t loan_len = ROUNDDOWN(ktl::min(len, data_.max_size() - data_.size()), PAGE_SIZE);
+    fbl::RefPtr<VmObject> loaned;
+    if (loan_len >= kLoanMinSize) {
+      if (StageUserBytes(src, loan_len, &loaned) != ZX_OK) {
+        kcounter_add(dispatcher_socket_loan_failures, 1);
+        loaned.reset();
+      }
+    }
+    if (loaned) {
+      status = data_.WriteStreamLoaned(loaned, 0, loaned->size(), &st);
+      if (status == ZX_OK) {
+        kcounter_add(dispatcher_socket_loaned_bytes, st);
+      }
+    } else {
+      status = data_.WriteStream(src, len, &st);
+    }
   }
   if (status)
     return status;
@@ -21,6 +21,7 @@
 #include <kernel/mutex.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread.h>
+#include <ktl/algorithm.h>
 #include <ktl/type_traits.h>
 
 #include "tests.h"
@@ -299,6 +300,64 @@ __NO_INLINE static void bench_mutex() {
          c, count, c / count);
 }
 
+// Threads repeatedly taking a mutex around a short critical section.
+struct MutexContenders {
+  DECLARE_MUTEX(MutexContenders) lock;
+  zx_duration_t spin_max_duration;
+  uint32_t iterations;
+};
+
+static int mutex_contender(void* arg) {
+  auto contenders = static_cast<MutexContenders*>(arg);
+  for (uint32_t i = 0; i < contenders->iterations; i++) {
+    Guard<Mutex> guard{&contenders->lock, contenders->spin_max_duration};
+    for (int j = 0; j < 64; j++) {
+      __asm__ volatile("");
+    }
+  }
+  return 0;
+}
+
+// Measures the time from one thread releasing a contended mutex to the next
+// one holding it, with contenders blocking right away and with them spinning
+// while the holder runs.
+__NO_INLINE static void bench_mutex_contended() {
+  constexpr uint32_t kIterations = 100000;
+  constexpr uint kMaxThreads = 8;
+  const uint max_threads = ktl::min(arch_max_num_cpus(), kMaxThreads);
+  const zx_duration_t spin_durations[] = {0, Mutex::SPIN_MAX_DURATION};
+
+  for (uint num_threads = 2; num_threads <= max_threads; num_threads *= 2) {
+    for (zx_duration_t spin_max_duration : spin_durations) {
+      MutexContenders contenders;
+      contenders.spin_max_duration = spin_max_duration;
+      contenders.iterations = kIterations;
+
+      Thread* threads[kMaxThreads];
+      for (uint i = 0; i < num_threads; i++) {
+        threads[i] = Thread::Create("mutex contender", &mutex_contender, &contenders,
+                                    DEFAULT_PRIORITY);
+      }
+
+      const zx_time_t start = current_time();
+      for (uint i = 0; i < num_threads; i++) {
+        threads[i]->Resume();
+      }
+      for (uint i = 0; i < num_threads; i++) {
+        threads[i]->Join(nullptr, ZX_TIME_INFINITE);
+      }
+      const uint64_t elapsed =
+          ktl::max<zx_duration_t>(zx_time_sub_time(current_time(), start), 1);
+
+      const uint64_t acquisitions = static_cast<uint64_t>(num_threads) * kIterations;
+      printf("%u threads contending for a mutex, spinning up to %" PRId64 " ns: %" PRIu64
+             " acquisitions/sec, %" PRIu64 " ns per handoff\n",
+             num_threads, spin_max_duration, acquisitions * ZX_SEC(1) / elapsed,
+             elapsed / acquisitions);
+    }
+  }
+}
+
 template <typename LockType>
 __NO_INLINE static void bench_rwlock() {
   LockType rw;
@@ -344,6 +403,7 @@ int benchmarks(int, const cmd_args*, uint32_t) {
 
   bench_spinlock();
   bench_mutex();
+  bench_mutex_contended();
   bench_rwlock<BrwLockPi>();
   bench_rwlock<BrwLockNoPi>();
 
@@ -1025,9 +1025,51 @@ static bool lock_dep_static_analysis_tests() {
   END_TEST;
 }
 
+#if WITH_LOCK_STATS
+// Tests that guarded acquisitions are recorded in the lock class statistics.
+static bool lock_dep_statistics_tests() {
+  BEGIN_TEST;
+
+  using lockdep::Guard;
+  using lockdep::LockClassStatistics;
+
+  struct Counted {
+    LOCK_DEP_INSTRUMENT(Counted, Mutex) lock;
+  };
+  Counted counted;
+
+  auto& statistics = lockdep::LockClassState::GetStatistics(counted.lock.id());
+  statistics.Reset();
+
+  constexpr uint64_t kIterations = 10;
+  for (uint64_t i = 0; i < kIterations; i++) {
+    Guard<Mutex> guard{&counted.lock};
+    Thread::Current::SleepRelative(ZX_USEC(10));
+  }
+
+  LockClassStatistics::Snapshot snapshot = statistics.Read();
+  EXPECT_EQ(kIterations, snapshot.acquisitions);
+  EXPECT_EQ(0u, snapshot.contended);
+  EXPECT_GE(snapshot.hold_total, kIterations * ZX_USEC(10));
+  EXPECT_GE(snapshot.hold_max, static_cast<uint64_t>(ZX_USEC(10)));
+  EXPECT_LE(snapshot.hold_max, snapshot.hold_total);
+  EXPECT_LE(snapshot.wait_max, snapshot.wait_total);
+
+  statistics.Reset();
+  snapshot = statistics.Read();
+  EXPECT_EQ(0u, snapshot.acquisitions);
+  EXPECT_EQ(0u, snapshot.hold_total);
+
+  END_TEST;
+}
+#endif
+
 UNITTEST_START_TESTCASE(lock_dep_tests)
 UNITTEST("lock_dep_dynamic_analysis_tests", lock_dep_dynamic_analysis_tests)
 UNITTEST("lock_dep_static_analysis_tests", lock_dep_static_analysis_tests)
+#if WITH_LOCK_STATS
+UNITTEST("lock_dep_statistics_tests", lock_dep_statistics_tests)
+#endif
 UNITTEST_END_TESTCASE(lock_dep_tests, "lock_dep_tests", "lock_dep_tests")
 
 #endif
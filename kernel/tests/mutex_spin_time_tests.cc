@@ -12,6 +12,7 @@
 
 #include <fbl/auto_call.h>
 #include <kernel/auto_preempt_disabler.h>
+#include <kernel/event.h>
 #include <kernel/mp.h>
 #include <ktl/atomic.h>
 #include <ktl/popcount.h>
@@ -151,8 +152,66 @@ bool mutex_spin_time_test(void) {
 
   END_TEST;
 }
+
+// A thread which finds the mutex held by a thread that is not running should
+// give up spinning and block right away, no matter how long it was allowed to
+// spin for.
+bool mutex_spin_holder_blocked_test(void) {
+  BEGIN_TEST;
+
+  constexpr zx::duration kSpinMaxDuration = zx::sec(10);
+
+  struct Args {
+    DECLARE_MUTEX(Args) the_mutex;
+    Event held;
+    Event release;
+  } args;
+
+  auto holder_thunk = [](void* ctx) -> int {
+    auto& args = *(static_cast<Args*>(ctx));
+    Guard<Mutex> guard{&args.the_mutex};
+    args.held.Signal();
+    args.release.Wait();
+    return 0;
+  };
+
+  auto spinner_thunk = [](void* ctx) -> int {
+    auto& args = *(static_cast<Args*>(ctx));
+    Guard<Mutex> guard{&args.the_mutex, kSpinMaxDuration.get()};
+    return 0;
+  };
+
+  Thread* holder = Thread::Create("mutex holder", holder_thunk, &args, DEFAULT_PRIORITY);
+  ASSERT_NONNULL(holder, "Failed to create holder thread");
+  holder->Resume();
+  ASSERT_EQ(args.held.Wait(), ZX_OK);
+
+  // The holder is now blocked on |release| with the mutex held.
+  Thread* spinner = Thread::Create("mutex spinner", spinner_thunk, &args, DEFAULT_PRIORITY);
+  ASSERT_NONNULL(spinner, "Failed to create spinner thread");
+  const zx::time start(current_time());
+  spinner->Resume();
+
+  thread_state s;
+  do {
+    Thread::Current::SleepRelative(ZX_USEC(100));
+    Guard<SpinLock, IrqSave> thread_lock_guard{ThreadLock::Get()};
+    s = spinner->state_;
+  } while (s != THREAD_BLOCKED);
+  const zx::duration blocked_after = zx::time(current_time()) - start;
+
+  args.release.Signal();
+  ASSERT_EQ(holder->Join(nullptr, current_time() + ZX_SEC(30)), ZX_OK);
+  ASSERT_EQ(spinner->Join(nullptr, current_time() + ZX_SEC(30)), ZX_OK);
+
+  EXPECT_LT(blocked_after.get(), kSpinMaxDuration.get(), "Spun on a holder that was not running");
+  printf("Blocked after %ld nSec.\n", blocked_after.get());
+
+  END_TEST;
+}
 }  // namespace
 
 UNITTEST_START_TESTCASE(mutex_spin_time_tests)
 UNITTEST("Mutex spin timeouts", (mutex_spin_time_test))
+UNITTEST("Mutex spin stops when the holder blocks", (mutex_spin_holder_blocked_test))
 UNITTEST_END_TESTCASE(mutex_spin_time_tests, "mutex_spin_time", "mutex_spin_time tests")
@@ -0,0 +1,262 @@
+// Copyright 2020 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <assert.h>
+#include <lib/counters.h>
+#include <platform.h>
+#include <stdlib.h>
+#include <string.h>
+#include <trace.h>
+#include <zircon/time.h>
+
+#include <new>
+
+#include <kernel/lockdep.h>
+#include <kernel/mutex.h>
+#include <ktl/algorithm.h>
+#include <ktl/atomic.h>
+#include <vm/compression.h>
+
+#include "vm_priv.h"
+
+#define LOCAL_TRACE VM_GLOBAL_TRACE(0)
+
+namespace {
+
+// Compressed pages are made of a series of sequences. Each sequence starts with a token byte, the
+// high nibble of which holds a literal count and the low nibble a match length minus kMinMatch. A
+// nibble of 15 means the value continues in subsequent bytes, each adding up to 255, with the first
+// byte less than 255 ending the run. The token is followed by the literals themselves, and then a
+// 16-bit little endian offset back into the already decompressed output from which the match is
+// copied. The final sequence of a page has literals only, and is recognized by the input ending.
+constexpr size_t kMinMatch = 4;
+constexpr uint8_t kNibbleMax = 15;
+
+constexpr uint32_t kHashBits = 10;
+constexpr size_t kHashEntries = 1u << kHashBits;
+
+// Page offsets fit in 16 bits, which keeps the match table small.
+static_assert(PAGE_SIZE <= UINT16_MAX + 1);
+
+// The match table and output staging buffer are too large to place on the kernel stack, and as
+// compression is performed by the scanner there is little benefit in having more than one of them.
+DECLARE_SINGLETON_MUTEX(CompressionLock);
+struct CompressionWorkspace {
+  uint16_t table[kHashEntries];
+  uint8_t out[VmCompressedPage::kMaxCompressedSize];
+};
+CompressionWorkspace compression_workspace TA_GUARDED(CompressionLock::Get());
+
+ktl::atomic<uint64_t> stored_pages_total;
+ktl::atomic<uint64_t> stored_bytes_total;
+
+KCOUNTER(compression_compressed, "vm.compression.compressed")
+KCOUNTER(compression_rejected, "vm.compression.rejected")
+KCOUNTER(compression_decompressed, "vm.compression.decompressed")
+KCOUNTER(compression_freed, "vm.compression.freed")
+KCOUNTER(compression_stored_pages, "vm.compression.stored_pages")
+KCOUNTER(compression_stored_bytes, "vm.compression.stored_bytes")
+KCOUNTER(compression_decompress_time, "vm.compression.decompress_time_ns")
+
+inline uint32_t Load32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Hash(uint32_t v) { return (v * 2654435761u) >> (32 - kHashBits); }
+
+bool WriteLength(uint8_t** op, const uint8_t* op_end, size_t len) {
+  while (len >= 255) {
+    if (*op == op_end) {
+      return false;
+    }
+    *(*op)++ = 255;
+    len -= 255;
+  }
+  if (*op == op_end) {
+    return false;
+  }
+  *(*op)++ = static_cast<uint8_t>(len);
+  return true;
+}
+
+size_t ReadLength(const uint8_t** ip, const uint8_t* ip_end) {
+  size_t len = 0;
+  uint8_t b;
+  do {
+    ASSERT(*ip < ip_end);
+    b = *(*ip)++;
+    len += b;
+  } while (b == 255);
+  return len;
+}
+
+// Writes a sequence of |lit_len| literals from |lit|, followed by a match of |match_len| bytes at
+// distance |offset|. A |match_len| of zero writes the final, literal only, sequence. Returns false
+// if the output would exceed |op_end|.
+bool WriteSequence(uint8_t** op, const uint8_t* op_end, const uint8_t* lit, size_t lit_len,
+                   size_t offset, size_t match_len) {
+  if (*op == op_end) {
+    return false;
+  }
+  const size_t match_code = match_len ? match_len - kMinMatch : 0;
+  uint8_t* token = (*op)++;
+  *token = static_cast<uint8_t>((ktl::min<size_t>(lit_len, kNibbleMax) << 4) |
+                                ktl::min<size_t>(match_code, kNibbleMax));
+  if (lit_len >= kNibbleMax && !WriteLength(op, op_end, lit_len - kNibbleMax)) {
+    return false;
+  }
+  if (static_cast<size_t>(op_end - *op) < lit_len) {
+    return false;
+  }
+  memcpy(*op, lit, lit_len);
+  *op += lit_len;
+  if (match_len == 0) {
+    return true;
+  }
+  if (op_end - *op < 2) {
+    return false;
+  }
+  *(*op)++ = static_cast<uint8_t>(offset);
+  *(*op)++ = static_cast<uint8_t>(offset >> 8);
+  return match_code < kNibbleMax || WriteLength(op, op_end, match_code - kNibbleMax);
+}
+
+// Compresses a page from |src| into |dst|, returning the compressed size or 0 if it would not fit
+// within |dst_len| bytes.
+size_t CompressBlock(const uint8_t* src, uint8_t* dst, size_t dst_len, uint16_t* table) {
+  memset(table, 0, sizeof(uint16_t) * kHashEntries);
+
+  const uint8_t* const end = src + PAGE_SIZE;
+  const uint8_t* const match_limit = end - kMinMatch;
+  const uint8_t* ip = src;
+  const uint8_t* anchor = src;
+  uint8_t* op = dst;
+  const uint8_t* const op_end = dst + dst_len;
+
+  while (ip <= match_limit) {
+    const uint32_t seq = Load32(ip);
+    const uint32_t h = Hash(seq);
+    const uint8_t* ref = src + table[h];
+    table[h] = static_cast<uint16_t>(ip - src);
+    if (ref >= ip || Load32(ref) != seq) {
+      // Skip ahead faster the longer we go without finding a match, so that incompressible pages
+      // are rejected quickly.
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+    size_t len = kMinMatch;
+    while (ip + len < end && ref[len] == ip[len]) {
+      len++;
+    }
+    if (!WriteSequence(&op, op_end, anchor, ip - anchor, ip - ref, len)) {
+      return 0;
+    }
+    ip += len;
+    anchor = ip;
+  }
+  if (!WriteSequence(&op, op_end, anchor, end - anchor, 0, 0)) {
+    return 0;
+  }
+  return op - dst;
+}
+
+void DecompressBlock(const uint8_t* src, size_t src_len, uint8_t* dst) {
+  const uint8_t* ip = src;
+  const uint8_t* const ip_end = src + src_len;
+  uint8_t* op = dst;
+  uint8_t* const op_end = dst + PAGE_SIZE;
+
+  while (true) {
+    ASSERT(ip < ip_end);
+    const uint8_t token = *ip++;
+    size_t lit_len = token >> 4;
+    if (lit_len == kNibbleMax) {
+      lit_len += ReadLength(&ip, ip_end);
+    }
+    ASSERT(lit_len <= static_cast<size_t>(ip_end - ip));
+    ASSERT(lit_len <= static_cast<size_t>(op_end - op));
+    memcpy(op, ip, lit_len);
+    ip += lit_len;
+    op += lit_len;
+    if (ip == ip_end) {
+      break;
+    }
+
+    ASSERT(ip_end - ip >= 2);
+    const size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    size_t match_len = (token & kNibbleMax) + kMinMatch;
+    if ((token & kNibbleMax) == kNibbleMax) {
+      match_len += ReadLength(&ip, ip_end);
+    }
+    ASSERT(offset > 0 && offset <= static_cast<size_t>(op - dst));
+    ASSERT(match_len <= static_cast<size_t>(op_end - op));
+    // Matches may overlap the output being written, so this must be a forward byte copy.
+    const uint8_t* match = op - offset;
+    for (size_t i = 0; i < match_len; i++) {
+      op[i] = match[i];
+    }
+    op += match_len;
+  }
+  ASSERT(op == op_end);
+}
+
+}  // namespace
+
+VmCompressedPage* VmCompressedPage::Compress(const void* page_data) {
+  Guard<Mutex> guard{CompressionLock::Get()};
+
+  const size_t len = CompressBlock(static_cast<const uint8_t*>(page_data), compression_workspace.out,
+                                   sizeof(compression_workspace.out), compression_workspace.table);
+  if (len == 0) {
+    compression_rejected.Add(1);
+    return nullptr;
+  }
+
+  void* mem = malloc(sizeof(VmCompressedPage) + len);
+  if (!mem) {
+    return nullptr;
+  }
+  VmCompressedPage* page = new (mem) VmCompressedPage;
+  page->size_ = static_cast<uint32_t>(len);
+  memcpy(page->data(), compression_workspace.out, len);
+
+  LTRACEF("compressed page to %zu bytes\n", len);
+
+  stored_pages_total.fetch_add(1, ktl::memory_order_relaxed);
+  stored_bytes_total.fetch_add(len, ktl::memory_order_relaxed);
+  compression_compressed.Add(1);
+  compression_stored_pages.Add(1);
+  compression_stored_bytes.Add(len);
+  return page;
+}
+
+void VmCompressedPage::Free(VmCompressedPage* page) {
+  DEBUG_ASSERT(page);
+  const size_t len = page->size_;
+  page->~VmCompressedPage();
+  free(page);
+
+  stored_pages_total.fetch_sub(1, ktl::memory_order_relaxed);
+  stored_bytes_total.fetch_sub(len, ktl::memory_order_relaxed);
+  compression_freed.Add(1);
+  compression_stored_pages.Add(-1);
+  compression_stored_bytes.Add(-static_cast<int64_t>(len));
+}
+
+void VmCompressedPage::Decompress(void* page_data) const {
+  const zx_time_t start = current_time();
+  DecompressBlock(data(), size_, static_cast<uint8_t*>(page_data));
+  compression_decompress_time.Add(zx_time_sub_time(current_time(), start));
+  compression_decompressed.Add(1);
+}
+
+VmCompressedPage::Stats VmCompressedPage::GetStats() {
+  return Stats{stored_pages_total.load(ktl::memory_order_relaxed),
+               stored_bytes_total.load(ktl::memory_order_relaxed)};
+}
@@ -0,0 +1,65 @@
+// Copyright 2020 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#ifndef ZIRCON_KERNEL_VM_INCLUDE_VM_COMPRESSION_H_
+#define ZIRCON_KERNEL_VM_INCLUDE_VM_COMPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zircon/types.h>
+
+#include <arch/defines.h>
+#include <fbl/macros.h>
+
+// The compressed contents of a single page. A VmCompressedPage is allocated out of the kernel heap
+// sized to exactly fit its compressed payload, and is owned by whichever VmPageOrMarker slot holds
+// a reference to it. Instances are only created by |Compress| and must be destroyed with |Free|.
+//
+// The encoding is a byte oriented LZ77 variant, in the style of LZ4, that favors compression and
+// decompression speed over ratio as it sits on the page fault path.
+class VmCompressedPage {
+ public:
+  // Pages that do not compress to at most this many bytes are not worth storing compressed, as the
+  // heap overhead would eat most of the savings.
+  static constexpr size_t kMaxCompressedSize = (PAGE_SIZE * 3) / 4;
+
+  // Attempts to compress the PAGE_SIZE bytes at |page_data|. Returns nullptr if the data does not
+  // compress to at most kMaxCompressedSize bytes, or if the heap allocation for the result fails.
+  static VmCompressedPage* Compress(const void* page_data);
+
+  // Releases the storage for |page|. Must be called exactly once for each successful |Compress|.
+  static void Free(VmCompressedPage* page);
+
+  // Expands the compressed contents into the PAGE_SIZE bytes at |page_data|. Records the time taken
+  // in the decompression kcounters, as this is done on behalf of a page fault.
+  void Decompress(void* page_data) const;
+
+  // Number of bytes of compressed payload.
+  size_t size() const { return size_; }
+
+  // Global statistics on compressed storage, primarily for diagnostics.
+  struct Stats {
+    uint64_t stored_pages = 0;
+    uint64_t stored_bytes = 0;
+  };
+  static Stats GetStats();
+
+ private:
+  VmCompressedPage() = default;
+  ~VmCompressedPage() = default;
+  DISALLOW_COPY_ASSIGN_AND_MOVE(VmCompressedPage);
+
+  const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+
+  uint32_t size_ = 0;
+};
+
+// VmPageOrMarker tags references in the low bits of the stored pointer, which requires at least
+// this much alignment from the heap.
+static_assert(alignof(VmCompressedPage) >= 4);
+
+#endif  // ZIRCON_KERNEL_VM_INCLUDE_VM_COMPRESSION_H_
@@ -63,6 +63,7 @@ typedef struct vm_page {
   // offset 0x29
 
   struct {
+    // VM_PAGE_FLAG_* bits.
     uint8_t flags;
     // logically private; use |state()| and |set_state()|
     uint8_t state_priv : VM_PAGE_STATE_BITS;
@@ -102,6 +103,11 @@ typedef struct vm_page {
 // assert that the page structure isn't growing uncontrollably
 static_assert(sizeof(vm_page) == 0x30, "");
 
+// The page is known to be filled with zeros. The pmm sets this on free pages in its zero pool and
+// on pages it returns for PMM_ALLOC_FLAG_ZEROED allocations. It is cleared when the page is freed
+// or becomes part of a vm object.
+#define VM_PAGE_FLAG_ZEROED (1u << 0)
+
 // helpers
 const char* page_state_to_string(unsigned int state);
 
@@ -51,6 +51,10 @@ class PageQueues {
   void SetUnswappable(vm_page_t* page);
   // Moves page from whichever queue it is currently in, to the unswappable queue.
   void MoveToUnswappable(vm_page_t* page);
+  // Place page in the unswappable queue, keeping a back reference so that RotateUnswappable can
+  // find its object. Must not already be in a page queue. Same rules for back pointers apply as for
+  // SetPagerBacked.
+  void SetUnswappableBacklinked(vm_page_t* page, VmObjectPaged* object, uint64_t page_offset);
   // Place page in the pager backed queue. Must not already be in a page queue. Sets the back
   // reference information. If the page is removed from the referenced object (especially if it's
   // due to the object being destroyed) then this back reference *must* be updated, either by
@@ -106,9 +110,17 @@ class PageQueues {
   // Moves a page from from the unswappable zero fork queue into the unswappable queue and returns
   // the backlink information. If the zero fork queue is empty then a nullopt is returned, otherwise
   // if it has_value the vmo field may be null to indicate that the vmo is running its destructor
-  // (see VmoBacklink for more details).
+  // (see VmoBacklink for more details). The page retains its backlink in the unswappable queue, so
+  // the same rules for back pointers apply as for SetPagerBacked.
   ktl::optional<VmoBacklink> PopUnswappableZeroFork();
 
+  // Moves the oldest page in the unswappable queue to the head of the queue and returns its
+  // backlink information. If the unswappable queue is empty then a nullopt is returned. Pages only
+  // have a backlink if they reached the unswappable queue via PopUnswappableZeroFork, and so if it
+  // has_value the vmo field may be null either because the page has no backlink, or because the
+  // vmo is running its destructor.
+  ktl::optional<VmoBacklink> RotateUnswappable();
+
   // Looks at the pager_backed queues from highest down to |lowest_queue| and returns backlink
   // information of the first page found. If no page was found a nullopt is returned, otherwise if
   // it has_value the vmo field may be null to indicate that the vmo is running its destructor (see
@@ -148,7 +160,8 @@ class PageQueues {
   // be evicted such that the pager could re-create the page.
   list_node_t pager_backed_[kNumPagerBacked] TA_GUARDED(lock_) = {LIST_INITIAL_CLEARED_VALUE};
   // unswappable_ pages have no user level mechanism to swap/evict them, but are modifiable by the
-  // kernel and could have compression etc applied to them.
+  // kernel and could have compression etc applied to them. Pages that were moved here from the
+  // unswappable_zero_fork_ queue retain their backlinks, all others have a null object.
   list_node_t unswappable_ TA_GUARDED(lock_) = LIST_INITIAL_CLEARED_VALUE;
   // wired pages include kernel data structures or memory pinned for devices and these pages must
   // not be touched in any way, removing both eviction and other strategies such as compression.
@@ -52,6 +52,9 @@ zx_status_t pmm_get_arena_info(size_t count, uint64_t i, pmm_arena_info_t* buffe
 #define PMM_ALLOC_FLAG_LO_MEM (1 << 0)  // allocate only from arenas marked LO_MEM
 // the caller can handle allocation failures with a delayed page_request_t request.
 #define PMM_ALLOC_DELAY_OK (1 << 1)
+// the allocated pages must be zero filled. Pages are taken from the pre-zeroed pool when possible
+// and zeroed by the allocator otherwise; either way they are returned with VM_PAGE_FLAG_ZEROED set.
+#define PMM_ALLOC_FLAG_ZEROED (1 << 2)
 
 // Debugging flag that can be used to induce artificial delayed page allocation by randomly
 // rejecting some fraction of the synchronous allocations which have PMM_ALLOC_DELAY_OK set.
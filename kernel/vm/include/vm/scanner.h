@@ -48,4 +48,11 @@ void scanner_trigger_reclaim(uint64_t free_mem_target, bool print = false);
 // of free pages. This may acquire arbitrary vmo and aspace locks.
 uint64_t scanner_evict_pager_backed(uint64_t max_pages, list_node_t *free_list);
 
+// Performs a synchronous request to compress up to the requested number of pages. Candidates are
+// pulled from the unswappable page queue, and any that were accessed since they were last
+// considered are skipped. The pages replaced by compressed copies are placed in the passed
+// |free_list| and become owned by the caller, with the return value being the number of such
+// pages. This may acquire arbitrary vmo and aspace locks.
+uint64_t scanner_compress_unswappable(uint64_t max_pages, list_node_t *free_list);
+
 #endif  // ZIRCON_KERNEL_VM_INCLUDE_VM_SCANNER_H_
@@ -72,6 +72,12 @@ static inline paddr_t vm_get_zero_page_paddr(void) {
   return zero_page_paddr;
 }
 
+// Size of the large pages the VM maps when a range of a VMO is backed by a physically contiguous
+// run aligned to this size. Both x86 and arm64 (with 4KiB pages) map these with a single entry at
+// the second level of their page tables.
+#define LARGE_PAGE_SIZE_SHIFT 21
+#define LARGE_PAGE_SIZE (1UL << LARGE_PAGE_SIZE_SHIFT)
+
 // List of the kernel program's various segments.
 struct kernel_region {
   const char* name;
@@ -54,6 +54,9 @@
 #define VMAR_FLAG_ALLOW_FAULTS (1 << 8)
 // Treat the offset as an upper limit when allocating a VMO or child VMAR.
 #define VMAR_FLAG_OFFSET_IS_UPPER_LIMIT (1 << 9)
+// Hint that a VmMapping will be accessed sequentially, so faults on pager-backed
+// VMOs should request the pages that follow as well.
+#define VMAR_FLAG_SEQUENTIAL (1 << 10)
 
 #define VMAR_CAN_RWX_FLAGS \
   (VMAR_FLAG_CAN_MAP_READ | VMAR_FLAG_CAN_MAP_WRITE | VMAR_FLAG_CAN_MAP_EXECUTE)
@@ -333,6 +336,10 @@ class VmAddressRegion : public VmAddressRegionOrMapping {
   void Dump(uint depth, bool verbose) const override;
   zx_status_t PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) override;
 
+  // Recursively finds the mapping that contains |va|, or returns nullptr if
+  // there is none. Must be called with the aspace lock held.
+  fbl::RefPtr<VmMapping> FindMappingLocked(vaddr_t va);
+
  protected:
   // constructor for use in creating a VmAddressRegionDummy
   explicit VmAddressRegion();
@@ -491,6 +498,16 @@ class VmMapping final : public VmAddressRegionOrMapping,
   void Dump(uint depth, bool verbose) const override;
   zx_status_t PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) override;
 
+  // Page fault in |va| without holding the aspace lock, so that faults in
+  // other mappings, and map, unmap and protect operations on the aspace, are
+  // not held up while pages are allocated, copied or read from a pager.
+  // |object| must be the vmo that this mapping referenced when it was found
+  // under the aspace lock. The mapping is revalidated under the vmo lock; if
+  // it no longer contains |va|, |*stale| is set to true and the caller must
+  // look the address up again.
+  zx_status_t SpeculativePageFault(const fbl::RefPtr<VmObject>& object, vaddr_t va, uint pf_flags,
+                                   PageRequest* page_request, bool* stale);
+
   // Apis intended for use by VmObject
 
   Lock<Mutex>* object_lock() TA_RET_CAP(object_->lock()) { return object_->lock(); }
@@ -540,6 +557,20 @@ class VmMapping final : public VmAddressRegionOrMapping,
 
   void Activate() override;
 
+  // Implementation for PageFault() and SpeculativePageFault(), once the
+  // mapping is known to contain |va|. |object| is the vmo being mapped.
+  zx_status_t PageFaultLocked(VmObject* object, vaddr_t va, uint pf_flags,
+                              PageRequest* page_request) TA_REQ(object->lock());
+
+  // Maps the pages of |object| around |va| that are already committed, with |mmu_flags|, so that
+  // walking through resident memory does not take a fault for every page.
+  void FaultAroundLocked(VmObject* object, vaddr_t va, uint mmu_flags) TA_REQ(object->lock());
+
+  // Maps the whole LARGE_PAGE_SIZE block containing |va| with a single large page if it lies
+  // within this mapping, is not mapped yet, and |object| has it committed as one aligned,
+  // contiguous run. Returns whether it did so.
+  bool MapLargePageLocked(VmObject* object, vaddr_t va) TA_REQ(object->lock());
+
   // Version of Activate that does not take the object_ lock.
   // Should be annotated TA_REQ(object_->lock()), but due to limitations
   // in Clang around capability aliasing, we need to relax the analysis.
@@ -251,6 +251,36 @@ class VmObject : public fbl::RefCountedUpgradeable<VmObject>,
     return ZX_ERR_NOT_SUPPORTED;
   }
 
+  // Completes a batched |page_request| that GetPageLocked() started for the page at |offset| and
+  // returned ZX_ERR_NEXT for. Following pages, up to |len| bytes from |offset| in total, are added
+  // to the request while they are absent from the vmo, and the request is then sent to the page
+  // source.
+  //
+  // Returns ZX_ERR_SHOULD_WAIT if the caller should wait on |page_request|, or an error if the
+  // request cannot be fulfilled.
+  virtual zx_status_t FinalizePageRequestLocked(uint64_t offset, uint64_t len, uint pf_flags,
+                                                PageRequest* page_request) TA_REQ(lock_) {
+    return ZX_ERR_NOT_SUPPORTED;
+  }
+
+  // Calls |lookup_fn| for each page in [offset, offset + len) that is already committed in this
+  // vmo. Unlike Lookup(), missing pages are skipped rather than looked up in a parent or faulted
+  // in, and compressed pages are not expanded. |lookup_fn| may return ZX_ERR_STOP to end the walk
+  // early.
+  virtual zx_status_t LookupCommittedLocked(uint64_t offset, uint64_t len,
+                                            vmo_lookup_fn_t lookup_fn, void* context)
+      TA_REQ(lock_) {
+    return ZX_ERR_NOT_SUPPORTED;
+  }
+
+  // Returns ZX_OK with the physical address of the first page in |pa| if every page in
+  // [offset, offset + len) is already committed in this vmo, and the pages form one physically
+  // contiguous run that can be mapped writable without breaking copy-on-write.
+  virtual zx_status_t LookupContiguousLocked(uint64_t offset, uint64_t len, paddr_t* pa)
+      TA_REQ(lock_) {
+    return ZX_ERR_NOT_SUPPORTED;
+  }
+
   Lock<Mutex>* lock() const TA_RET_CAP(lock_) { return &lock_; }
   Lock<Mutex>& lock_ref() const TA_RET_CAP(lock_) { return lock_; }
 
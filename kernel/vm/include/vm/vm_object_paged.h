@@ -39,6 +39,9 @@ class VmObjectPaged final : public VmObject {
   static constexpr uint32_t kContiguous = (1u << 1);
   static constexpr uint32_t kHidden = (1u << 2);
   static constexpr uint32_t kSlice = (1u << 3);
+  // Commits of whole, aligned large pages are backed by contiguous runs where possible, so that
+  // user mappings of them can use large page table entries.
+  static constexpr uint32_t kLargePages = (1u << 4);
 
   static zx_status_t Create(uint32_t pmm_alloc_flags, uint32_t options, uint64_t size,
                             fbl::RefPtr<VmObject>* vmo);
@@ -141,6 +144,12 @@ class VmObjectPaged final : public VmObject {
   zx_status_t GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
                             PageRequest* page_request, vm_page_t**, paddr_t*) override
       TA_REQ(lock_);
+  zx_status_t FinalizePageRequestLocked(uint64_t offset, uint64_t len, uint pf_flags,
+                                        PageRequest* page_request) override TA_REQ(lock_);
+  zx_status_t LookupCommittedLocked(uint64_t offset, uint64_t len, vmo_lookup_fn_t lookup_fn,
+                                    void* context) override TA_REQ(lock_);
+  zx_status_t LookupContiguousLocked(uint64_t offset, uint64_t len, paddr_t* pa) override
+      TA_REQ(lock_);
 
   zx_status_t CreateClone(Resizability resizable, CloneType type, uint64_t offset, uint64_t size,
                           bool copy_name, fbl::RefPtr<VmObject>* child_vmo) override;
@@ -181,6 +190,18 @@ class VmObjectPaged final : public VmObject {
   // marker put in its place.
   bool DedupZeroPage(vm_page_t* page, uint64_t offset);
 
+  // Attempts to replace the given page at the specified offset with a compressed copy of its
+  // contents. As with DedupZeroPage `page` need only be *some* valid vm_page_t. This function
+  // returns false if
+  //  * page is either not from this VMO, or not found at the specified offset
+  //  * page is pinned
+  //  * vmo has a page source, a parent or children, or is uncached
+  //  * page was accessed since the previous attempt
+  //  * page did not compress well enough to be worth storing
+  // Otherwise 'true' is returned, the page has been removed from the VMO and page queues and is
+  // now owned by the caller.
+  bool CompressPage(vm_page_t* page, uint64_t offset);
+
  private:
   // private constructor (use Create())
   VmObjectPaged(uint32_t options, uint32_t pmm_alloc_flags, uint64_t size,
@@ -216,6 +237,16 @@ class VmObjectPaged final : public VmObject {
   // Unified function that implements both CommitRange and CommitRangePinned
   zx_status_t CommitRangeInternal(uint64_t offset, uint64_t len, bool pin, Guard<Mutex>&& adopt);
 
+  // Commits each empty, LARGE_PAGE_SIZE aligned chunk in [offset, end) with an aligned, physically
+  // contiguous run of pages so that it can be mapped as a large page. Chunks that cannot be are
+  // left for the caller to commit a page at a time.
+  void CommitLargePagesLocked(uint64_t offset, uint64_t end) TA_REQ(lock_);
+
+  // Commits every empty or marker slot in [offset, end) with a zeroed page from |page_list|, which
+  // must hold enough pages, filling a whole page list node per lookup. Only valid without a parent
+  // or page source.
+  void CommitZeroPagesLocked(uint64_t offset, uint64_t end, list_node* page_list) TA_REQ(lock_);
+
   void UnpinLocked(uint64_t offset, uint64_t len) TA_REQ(lock_);
 
   // Internal decommit range helper that expects the lock to be held. On success it will populate
@@ -353,6 +384,18 @@ class VmObjectPaged final : public VmObject {
   // Places a newly added page into the appropriate non wired page queue.
   void SetNotWired(vm_page_t* page, uint64_t offset);
 
+  // Returns whether pages in this VMO may currently be replaced with compressed references.
+  bool CanCompressLocked() const TA_REQ(lock_);
+
+  // Expands the compressed reference in |slot|, which is at |offset|, back into a page. The page is
+  // taken from |free_list| if it is non-null and non-empty, and otherwise allocated.
+  zx_status_t DecompressPageLocked(VmPageOrMarker* slot, uint64_t offset, list_node_t* free_list)
+      TA_REQ(lock_);
+
+  // Expands every compressed reference in the VMO. Must be called before the VMO gains children, a
+  // different cache policy, or has its pages taken.
+  zx_status_t DecompressAllLocked() TA_REQ(lock_);
+
   // Updates any meta data for accessing a page. Currently this moves pager backed pages around in
   // the page queue to track which ones were recently accessed for the purposes of eviction. In
   // terms of functional correctness this never has to be called.
@@ -459,6 +502,11 @@ class VmObjectPaged final : public VmObject {
   // a contiguous vmo.
   uint64_t pinned_page_count_ TA_GUARDED(lock_) = 0;
 
+  // Set when a page is compressed and only cleared by DecompressAllLocked, so may be true even
+  // after all compressed pages have been removed. Allows skipping the page list walk in the common
+  // case of there never having been any compressed pages.
+  bool has_compressed_pages_ TA_GUARDED(lock_) = false;
+
   // The page source, if any.
   const fbl::RefPtr<PageSource> page_source_;
 
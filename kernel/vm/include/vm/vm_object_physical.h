@@ -48,6 +48,8 @@ class VmObjectPhysical final : public VmObject {
   zx_status_t GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
                             PageRequest* page_request, vm_page_t**, paddr_t* pa) override
       TA_REQ(lock_);
+  zx_status_t LookupContiguousLocked(uint64_t offset, uint64_t len, paddr_t* pa) override
+      TA_REQ(lock_);
 
   uint32_t GetMappingCachePolicy() const override;
   zx_status_t SetMappingCachePolicy(const uint32_t cache_policy) override;
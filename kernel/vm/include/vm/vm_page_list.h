@@ -16,22 +16,26 @@
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/macros.h>
 #include <ktl/unique_ptr.h>
+#include <vm/compression.h>
 #include <vm/page.h>
 #include <vm/pmm.h>
 #include <vm/vm.h>
 
 // RAII helper for representing owned pages in a page list node. This supports being in one of
-// three states
+// four states
 //  * Empty - Contains nothing
 //  * Page p - Contains a vm_page 'p'. This 'p' is considered owned by this wrapper and
 //             `ReleasePage` must be called to give up ownership.
 //  * Marker - Indicates that whilst not a page, it is also not empty. Markers can be used to
 //             separate the distinction between "there's no page because we've deduped to the zero
 //             page" and "there's no page because our parent contains the content".
+//  * Reference r - Contains the compressed content of a page that was removed to save memory. As
+//             with pages the reference is owned by this wrapper and `ReleaseReference` must be
+//             called to give up ownership.
 class VmPageOrMarker {
  public:
   VmPageOrMarker() : page_(nullptr) {}
-  ~VmPageOrMarker() { DEBUG_ASSERT(!IsPage()); }
+  ~VmPageOrMarker() { DEBUG_ASSERT(!IsPage() && !IsReference()); }
   VmPageOrMarker(VmPageOrMarker&& other) : page_(other.Release()) {}
   VmPageOrMarker(const VmPageOrMarker&) = delete;
   VmPageOrMarker& operator=(const VmPageOrMarker&) = delete;
@@ -42,6 +46,13 @@ class VmPageOrMarker {
     return page_;
   }
 
+  // Returns the underlying compressed page. Is only valid to call if `IsReference` is true.
+  VmCompressedPage* Reference() const {
+    DEBUG_ASSERT(IsReference());
+    return reinterpret_cast<VmCompressedPage*>(reinterpret_cast<uintptr_t>(page_) &
+                                               ~kReferenceTag);
+  }
+
   // If this is a page, moves the underlying vm_page* out and returns it. After this IsPage will
   // be false and IsEmpty will be true.
   vm_page* ReleasePage() {
@@ -49,15 +60,25 @@ class VmPageOrMarker {
     return Release();
   }
 
-  bool IsPage() const { return !IsMarker() && !IsEmpty(); }
+  // If this is a reference, moves the underlying compressed page out and returns it. After this
+  // IsReference will be false and IsEmpty will be true.
+  VmCompressedPage* ReleaseReference() {
+    VmCompressedPage* ref = Reference();
+    Release();
+    return ref;
+  }
+
+  bool IsPage() const { return !IsMarker() && !IsEmpty() && !IsReference(); }
 
   bool IsMarker() const { return page_ == RawMarker(); }
 
   bool IsEmpty() const { return page_ == nullptr; }
 
+  bool IsReference() const { return reinterpret_cast<uintptr_t>(page_) & kReferenceTag; }
+
   VmPageOrMarker& operator=(VmPageOrMarker&& other) {
-    // Forbid overriding a page, as that would leak it.
-    DEBUG_ASSERT(!IsPage());
+    // Forbid overriding a page or reference, as that would leak it.
+    DEBUG_ASSERT(!IsPage() && !IsReference());
     page_ = other.Release();
     return *this;
   }
@@ -75,9 +96,18 @@ class VmPageOrMarker {
     return {p};
   }
 
+  static VmPageOrMarker Reference(VmCompressedPage* ref) {
+    DEBUG_ASSERT(ref);
+    DEBUG_ASSERT((reinterpret_cast<uintptr_t>(ref) & kReferenceTag) == 0);
+    return {reinterpret_cast<vm_page*>(reinterpret_cast<uintptr_t>(ref) | kReferenceTag)};
+  }
+
  private:
   VmPageOrMarker(vm_page* p) : page_(p) {}
 
+  // References are tagged in a low bit that is clear in both vm_page pointers and the marker.
+  static constexpr uintptr_t kReferenceTag = 0b10;
+
   static vm_page* RawMarker() { return reinterpret_cast<vm_page*>(1); }
 
   vm_page* Release() {
@@ -293,17 +323,25 @@ class VmPageList final {
   // of memory or due to offset being invalid.
   VmPageOrMarker* LookupOrAllocate(uint64_t offset);
 
+  // Similar to `LookupOrAllocate` but returns the run of consecutive slots starting at |offset|
+  // that share a single node, so that callers filling a range need only one tree lookup per node.
+  // On success |*count| is set to the number of slots in the run, which is at least one and does
+  // not extend past |end_offset|. Slot i of the run is at offset |offset + i * PAGE_SIZE|.
+  VmPageOrMarker* LookupOrAllocateRun(uint64_t offset, uint64_t end_offset, size_t* count);
+
   // Removes any page at |offset| from the list and returns it, or VmPageOrMarker::Empty() if none.
   VmPageOrMarker RemovePage(uint64_t offset);
 
   // Release every page in the in the page list and calls free_page_fn on each one, giving it
-  // ownership. Any markers are cleared.
+  // ownership. Any markers are cleared and any compressed references are freed.
   template <typename T>
   void RemoveAllPages(T free_page_fn) {
     // per page get a reference to the page pointer inside the page list node
     auto per_page_func = [&free_page_fn](VmPageOrMarker& p, uint64_t offset) {
       if (p.IsPage()) {
         free_page_fn(p.ReleasePage());
+      } else if (p.IsReference()) {
+        VmCompressedPage::Free(p.ReleaseReference());
       }
       p = VmPageOrMarker::Empty();
       return ZX_ERR_NEXT;
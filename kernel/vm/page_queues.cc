@@ -81,6 +81,19 @@ void PageQueues::MoveToUnswappable(vm_page_t* page) {
   MoveToUnswappableLocked(page);
 }
 
+void PageQueues::SetUnswappableBacklinked(vm_page_t* page, VmObjectPaged* object,
+                                          uint64_t page_offset) {
+  DEBUG_ASSERT(page->state() == VM_PAGE_STATE_OBJECT);
+  DEBUG_ASSERT(!page->is_free());
+  DEBUG_ASSERT(page->object.pin_count == 0);
+  DEBUG_ASSERT(object);
+  Guard<SpinLock, IrqSave> guard{&lock_};
+  DEBUG_ASSERT(!list_in_list(&page->queue_node));
+  page->object.set_object(object);
+  page->object.set_page_offset(page_offset);
+  list_add_head(&unswappable_, &page->queue_node);
+}
+
 void PageQueues::SetPagerBacked(vm_page_t* page, VmObjectPaged* object, uint64_t page_offset) {
   DEBUG_ASSERT(page->state() == VM_PAGE_STATE_OBJECT);
   DEBUG_ASSERT(!page->is_free());
@@ -222,9 +235,9 @@ ktl::optional<PageQueues::VmoBacklink> PageQueues::PopUnswappableZeroFork() {
   uint64_t page_offset = page->object.get_page_offset();
   DEBUG_ASSERT(vmop);
 
-  page->object.set_object(0);
-  page->object.set_page_offset(0);
-
+  // Leave the backlink in place so that the page can later be found by RotateUnswappable. This is
+  // safe as any code that moves or removes the page has to treat it as potentially being in the
+  // zero fork queue anyway, and so already updates the backlink.
   list_delete(&page->queue_node);
   list_add_head(&unswappable_, &page->queue_node);
 
@@ -260,3 +273,23 @@ ktl::optional<PageQueues::VmoBacklink> PageQueues::PeekPagerBacked(size_t lowest
   // a chance to run.
   return VmoBacklink{fbl::MakeRefPtrUpgradeFromRaw(vmop, guard), page, page_offset};
 }
+
+ktl::optional<PageQueues::VmoBacklink> PageQueues::RotateUnswappable() {
+  Guard<SpinLock, IrqSave> guard{&lock_};
+  vm_page_t* page = list_peek_tail_type(&unswappable_, vm_page_t, queue_node);
+  if (!page) {
+    return ktl::nullopt;
+  }
+
+  list_delete(&page->queue_node);
+  list_add_head(&unswappable_, &page->queue_node);
+
+  VmObjectPaged* vmop = reinterpret_cast<VmObjectPaged*>(page->object.get_object());
+  if (!vmop) {
+    return VmoBacklink{};
+  }
+
+  // See PopUnswappableZeroFork for why it is safe to attempt to upgrade this back pointer.
+  return VmoBacklink{fbl::MakeRefPtrUpgradeFromRaw(vmop, guard), page,
+                     page->object.get_page_offset()};
+}
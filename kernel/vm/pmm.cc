@@ -176,6 +176,26 @@ static void init_request_thread(unsigned int level) { pmm_node.InitRequestThread
 
 LK_INIT_HOOK(pmm, init_request_thread, LK_INIT_LEVEL_THREADING)
 
+static void pmm_cpu_cache_init(unsigned int level) {
+  if (gCmdline.GetBool("kernel.pmm.cpu-cache.enable", true)) {
+    zx_status_t status = pmm_node.EnableCpuCaches();
+    if (status != ZX_OK) {
+      printf("PMM: failed to enable per-CPU page caches: %d\n", status);
+    }
+  }
+}
+
+LK_INIT_HOOK(pmm_cpu_cache, pmm_cpu_cache_init, LK_INIT_LEVEL_THREADING)
+
+static void pmm_zero_pool_init(unsigned int level) {
+  const uint64_t pages = gCmdline.GetUInt64("kernel.pmm.zero-pool-pages", 1024);
+  if (pages > 0) {
+    pmm_node.EnableZeroPool(pages);
+  }
+}
+
+LK_INIT_HOOK(pmm_zero_pool, pmm_zero_pool_init, LK_INIT_LEVEL_THREADING)
+
 static int cmd_pmm(int argc, const cmd_args* argv, uint32_t flags) {
   bool is_panic = flags & CMD_FLAG_PANIC;
 
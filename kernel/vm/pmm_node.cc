@@ -13,8 +13,11 @@
 
 #include <new>
 
+#include <arch/ops.h>
+#include <fbl/alloc_checker.h>
 #include <kernel/mp.h>
 #include <kernel/thread.h>
+#include <ktl/move.h>
 #include <pretty/sizes.h>
 #include <vm/bootalloc.h>
 #include <vm/page_request.h>
@@ -27,11 +30,49 @@
 #define LOCAL_TRACE VM_GLOBAL_TRACE(0)
 
 KCOUNTER(pmm_alloc_async, "vm.pmm.alloc.async")
+KCOUNTER(pmm_cpu_cache_alloc_hit, "vm.pmm.cpu_cache.alloc_hit")
+KCOUNTER(pmm_cpu_cache_free_hit, "vm.pmm.cpu_cache.free_hit")
+KCOUNTER(pmm_cpu_cache_refill, "vm.pmm.cpu_cache.refill")
+KCOUNTER(pmm_cpu_cache_drain, "vm.pmm.cpu_cache.drain")
+KCOUNTER(pmm_zero_pool_fill, "vm.pmm.zero_pool.pages_zeroed")
+KCOUNTER(pmm_zero_pool_hit, "vm.pmm.zero_pool.alloc_hit")
+KCOUNTER(pmm_zero_pool_miss, "vm.pmm.zero_pool.alloc_miss")
 
 namespace {
 
 void noop_callback(void* context, uint8_t idx) {}
 
+// Zeroes the pages on |list| that are not already known to be zero, and marks them all as zeroed.
+void ZeroAllocatedPages(list_node* list) {
+  vm_page* page;
+  list_for_every_entry (list, page, vm_page, queue_node) {
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+      kcounter_add(pmm_zero_pool_hit, 1);
+      continue;
+    }
+    kcounter_add(pmm_zero_pool_miss, 1);
+    arch_zero_page(paddr_to_physmap(page->paddr()));
+    page->flags |= VM_PAGE_FLAG_ZEROED;
+  }
+}
+
+// Clears VM_PAGE_FLAG_ZEROED on the pages on |list|, which may have come from the zero pool. Only
+// callers that asked for PMM_ALLOC_FLAG_ZEROED are promised zeroed pages, and the others are free
+// to write to them without clearing the flag.
+void ClearZeroedFlags(list_node* list) {
+  vm_page* page;
+  list_for_every_entry (list, page, vm_page, queue_node) { page->flags &= ~VM_PAGE_FLAG_ZEROED; }
+}
+
+// Adds the pages on |pages| to the end of |list|, which may already hold pages.
+void AppendPages(list_node* pages, list_node* list) {
+  if (list_is_empty(list)) {
+    list_move(pages, list);
+  } else {
+    list_splice_after(pages, list_peek_tail(list));
+  }
+}
+
 }  // namespace
 
 // Poison a page |p| with value |value|. Accesses to a poisoned page via the physmap are not
@@ -57,6 +98,13 @@ PmmNode::PmmNode() {
 }
 
 PmmNode::~PmmNode() {
+  if (zero_pool_thread_) {
+    zero_pool_thread_live_ = false;
+    zero_pool_evt_.Signal();
+    int res = 0;
+    zero_pool_thread_->Join(&res, ZX_TIME_INFINITE);
+    DEBUG_ASSERT(res == 0);
+  }
   if (request_thread_) {
     request_thread_live_ = false;
     request_evt_.Signal();
@@ -150,6 +198,7 @@ void PmmNode::AddFreePages(list_node* list) TA_NO_THREAD_SAFETY_ANALYSIS {
   vm_page *temp, *page;
   list_for_every_entry_safe (list, page, temp, vm_page, queue_node) {
     list_delete(&page->queue_node);
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
     list_add_tail(&free_list_, &page->queue_node);
     free_count_++;
   }
@@ -183,6 +232,8 @@ void PmmNode::CheckAllFreePages() {
 
   vm_page* page;
   list_for_every_entry (&free_list_, page, vm_page, queue_node) { checker_.AssertPattern(page); }
+  // The zero pool is emptied when the checker is enabled and not refilled while it is.
+  DEBUG_ASSERT(list_is_empty(&zeroed_list_));
 }
 
 #if __has_feature(address_sanitizer)
@@ -193,6 +244,9 @@ void PmmNode::PoisonAllFreePages() {
   list_for_every_entry (&free_list_, page, vm_page, queue_node) {
     AsanPoisonPage(page, kAsanPmmFreeMagic);
   };
+  list_for_every_entry (&zeroed_list_, page, vm_page, queue_node) {
+    AsanPoisonPage(page, kAsanPmmFreeMagic);
+  };
 }
 #endif  // __has_feature(address_sanitizer)
 
@@ -200,12 +254,20 @@ void PmmNode::EnableFreePageFilling(size_t fill_size) {
   Guard<Mutex> guard{&lock_};
   checker_.SetFillSize(fill_size);
   free_fill_enabled_ = true;
+  // Cached pages are not filled; bypass the caches and return their pages to the free list.
+  UpdateCpuCachesEnabledLocked();
+  // Neither are zeroed pages.
+  ReturnZeroedPagesLocked();
 }
 
 void PmmNode::DisableChecker() {
   Guard<Mutex> guard{&lock_};
   checker_.Disarm();
   free_fill_enabled_ = false;
+  UpdateCpuCachesEnabledLocked();
+  if (zero_pool_target_ > 0) {
+    zero_pool_evt_.SignalNoResched();
+  }
 }
 
 void PmmNode::AllocPageHelperLocked(vm_page_t* page) {
@@ -224,23 +286,57 @@ void PmmNode::AllocPageHelperLocked(vm_page_t* page) {
 }
 
 zx_status_t PmmNode::AllocPage(uint alloc_flags, vm_page_t** page_out, paddr_t* pa_out) {
-  Guard<Mutex> guard{&lock_};
+  // The per-CPU caches never hold zeroed pages, so skip them when the pool can satisfy a zeroed
+  // allocation.
+  vm_page* page = nullptr;
+  const bool want_zeroed = alloc_flags & PMM_ALLOC_FLAG_ZEROED;
+  if (!want_zeroed || CountZeroedPages() == 0) {
+    page = AllocPageFromCpuCache();
+  }
+  if (!page) {
+    Guard<Mutex> guard{&lock_};
 
-  if (unlikely(InOomStateLocked())) {
-    if (alloc_flags & PMM_ALLOC_DELAY_OK) {
-      // TODO(stevensd): Differentiate 'cannot allocate now' from 'can never allocate'
+    if (unlikely(InOomStateLocked())) {
+      if (alloc_flags & PMM_ALLOC_DELAY_OK) {
+        // TODO(stevensd): Differentiate 'cannot allocate now' from 'can never allocate'
+        return ZX_ERR_NO_MEMORY;
+      }
+    }
+
+    if (want_zeroed) {
+      page = TakeZeroedPageLocked();
+    }
+    if (!page) {
+      page = list_remove_head_type(&free_list_, vm_page, queue_node);
+    }
+    if (!page) {
+      page = TakeZeroedPageLocked();
+    }
+    if (!page && cached_count_.load(ktl::memory_order_relaxed) > 0) {
+      // The remaining free pages are held in the per-CPU caches.
+      DrainCpuCachesLocked();
+      page = list_remove_head_type(&free_list_, vm_page, queue_node);
+    }
+    if (!page) {
       return ZX_ERR_NO_MEMORY;
     }
-  }
 
-  vm_page* page = list_remove_head_type(&free_list_, vm_page, queue_node);
-  if (!page) {
-    return ZX_ERR_NO_MEMORY;
-  }
+    AllocPageHelperLocked(page);
 
-  AllocPageHelperLocked(page);
+    DecrementFreeCountLocked(1);
+  }
 
-  DecrementFreeCountLocked(1);
+  if (want_zeroed) {
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+      kcounter_add(pmm_zero_pool_hit, 1);
+    } else {
+      kcounter_add(pmm_zero_pool_miss, 1);
+      arch_zero_page(paddr_to_physmap(page->paddr()));
+      page->flags |= VM_PAGE_FLAG_ZEROED;
+    }
+  } else {
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
+  }
 
   if (pa_out) {
     *pa_out = page->paddr();
@@ -270,40 +366,62 @@ zx_status_t PmmNode::AllocPages(size_t count, uint alloc_flags, list_node* list)
     return status;
   }
 
-  Guard<Mutex> guard{&lock_};
+  list_node pages = LIST_INITIAL_VALUE(pages);
+  {
+    Guard<Mutex> guard{&lock_};
 
-  if (unlikely(count > free_count_)) {
-    return ZX_ERR_NO_MEMORY;
-  }
+    // Pages being zeroed by the pool thread are counted as free but cannot be handed out.
+    if (unlikely(count > free_count_ - zeroing_count_)) {
+      DrainCpuCachesLocked();
+      if (count > free_count_ - zeroing_count_) {
+        return ZX_ERR_NO_MEMORY;
+      }
+    }
 
-  DecrementFreeCountLocked(count);
+    DecrementFreeCountLocked(count);
 
-  if (unlikely(InOomStateLocked())) {
-    if (alloc_flags & PMM_ALLOC_DELAY_OK) {
-      IncrementFreeCountLocked(count);
-      // TODO(stevensd): Differentiate 'cannot allocate now' from 'can never allocate'
-      return ZX_ERR_NO_MEMORY;
+    if (unlikely(InOomStateLocked())) {
+      if (alloc_flags & PMM_ALLOC_DELAY_OK) {
+        IncrementFreeCountLocked(count);
+        // TODO(stevensd): Differentiate 'cannot allocate now' from 'can never allocate'
+        return ZX_ERR_NO_MEMORY;
+      }
     }
-  }
 
-  auto node = &free_list_;
-  while (count-- > 0) {
-    node = list_next(&free_list_, node);
-    AllocPageHelperLocked(containerof(node, vm_page, queue_node));
+    // Only zeroed allocations dip into the zero pool ahead of the free list.
+    size_t remaining = count;
+    if (alloc_flags & PMM_ALLOC_FLAG_ZEROED) {
+      remaining -= TakePagesLocked(&zeroed_list_, remaining, &pages);
+    }
+    remaining -= TakePagesLocked(&free_list_, remaining, &pages);
+    remaining -= TakePagesLocked(&zeroed_list_, remaining, &pages);
+    DEBUG_ASSERT(remaining == 0);
   }
 
-  list_node tmp_list = LIST_INITIAL_VALUE(tmp_list);
-  list_split_after(&free_list_, node, &tmp_list);
-  if (list_is_empty(list)) {
-    list_move(&free_list_, list);
+  if (alloc_flags & PMM_ALLOC_FLAG_ZEROED) {
+    ZeroAllocatedPages(&pages);
   } else {
-    list_splice_after(&free_list_, list_peek_tail(list));
+    ClearZeroedFlags(&pages);
   }
-  list_move(&tmp_list, &free_list_);
+  AppendPages(&pages, list);
 
   return ZX_OK;
 }
 
+size_t PmmNode::TakePagesLocked(list_node* source, size_t count, list_node* dest) {
+  size_t taken = 0;
+  for (; taken < count; taken++) {
+    vm_page* page = (source == &zeroed_list_) ? TakeZeroedPageLocked()
+                                              : list_remove_head_type(source, vm_page, queue_node);
+    if (!page) {
+      break;
+    }
+    AllocPageHelperLocked(page);
+    list_add_tail(dest, &page->queue_node);
+  }
+  return taken;
+}
+
 zx_status_t PmmNode::AllocRange(paddr_t address, size_t count, list_node* list) {
   LTRACEF("address %#" PRIxPTR ", count %zu\n", address, count);
 
@@ -319,6 +437,9 @@ zx_status_t PmmNode::AllocRange(paddr_t address, size_t count, list_node* list)
 
   Guard<Mutex> guard{&lock_};
 
+  // The requested pages may be held in a per-CPU cache.
+  DrainCpuCachesLocked();
+
   // walk through the arenas, looking to see if the physical page belongs to it
   for (auto& a : arena_list_) {
     while (allocated < count && a.address_in_arena(address)) {
@@ -332,6 +453,10 @@ zx_status_t PmmNode::AllocRange(paddr_t address, size_t count, list_node* list)
       }
 
       list_delete(&page->queue_node);
+      if (page->flags & VM_PAGE_FLAG_ZEROED) {
+        zeroed_count_.fetch_sub(1, ktl::memory_order_relaxed);
+        page->flags &= ~VM_PAGE_FLAG_ZEROED;
+      }
 
       AllocPageHelperLocked(page);
 
@@ -373,6 +498,9 @@ zx_status_t PmmNode::AllocContiguous(const size_t count, uint alloc_flags, uint8
 
   Guard<Mutex> guard{&lock_};
 
+  // Pages held in the per-CPU caches are free but must be on the free list to be part of a run.
+  DrainCpuCachesLocked();
+
   for (auto& a : arena_list_) {
     vm_page_t* p = a.FindFreeContiguous(count, alignment_log2);
     if (!p) {
@@ -382,19 +510,32 @@ zx_status_t PmmNode::AllocContiguous(const size_t count, uint alloc_flags, uint8
     *pa = p->paddr();
 
     // remove the pages from the run out of the free list
+    list_node run = LIST_INITIAL_VALUE(run);
     for (size_t i = 0; i < count; i++, p++) {
       DEBUG_ASSERT_MSG(p->is_free(), "p %p state %u\n", p, p->state());
       DEBUG_ASSERT(list_in_list(&p->queue_node));
 
       list_delete(&p->queue_node);
+      if (p->flags & VM_PAGE_FLAG_ZEROED) {
+        zeroed_count_.fetch_sub(1, ktl::memory_order_relaxed);
+      }
       p->set_state(VM_PAGE_STATE_ALLOC);
 
       DecrementFreeCountLocked(1);
       AsanUnpoisonPage(p);
       checker_.AssertPattern(p);
 
-      list_add_tail(list, &p->queue_node);
+      list_add_tail(&run, &p->queue_node);
+    }
+    guard.Release();
+
+    // Only the pages of this run are zeroed; |list| may already hold pages of the caller's.
+    if (alloc_flags & PMM_ALLOC_FLAG_ZEROED) {
+      ZeroAllocatedPages(&run);
+    } else {
+      ClearZeroedFlags(&run);
     }
+    AppendPages(&run, list);
 
     return ZX_OK;
   }
@@ -411,6 +552,7 @@ void PmmNode::FreePageHelperLocked(vm_page* page) {
 
   // mark it free
   page->set_state(VM_PAGE_STATE_FREE);
+  page->flags &= ~VM_PAGE_FLAG_ZEROED;
 
   if (unlikely(free_fill_enabled_)) {
     checker_.FillPattern(page);
@@ -420,11 +562,15 @@ void PmmNode::FreePageHelperLocked(vm_page* page) {
 }
 
 void PmmNode::FreePage(vm_page* page) {
-  Guard<Mutex> guard{&lock_};
-
   // pages freed individually shouldn't be in a queue
   DEBUG_ASSERT(!list_in_list(&page->queue_node));
 
+  if (FreePageToCpuCache(page)) {
+    return;
+  }
+
+  Guard<Mutex> guard{&lock_};
+
   FreePageHelperLocked(page);
 
   // add it to the free queue
@@ -456,6 +602,189 @@ void PmmNode::FreeList(list_node* list) {
   FreeListLocked(list);
 }
 
+zx_status_t PmmNode::EnableCpuCaches() {
+  const size_t count = arch_max_num_cpus();
+
+  Guard<Mutex> guard{&lock_};
+  if (!cpu_caches_) {
+    fbl::AllocChecker ac;
+    ktl::unique_ptr<CpuCache[]> caches{new (&ac) CpuCache[count]};
+    if (!ac.check()) {
+      return ZX_ERR_NO_MEMORY;
+    }
+    cpu_caches_ = ktl::move(caches);
+    cpu_cache_count_ = count;
+  }
+  cpu_caches_allowed_ = true;
+  UpdateCpuCachesEnabledLocked();
+  return ZX_OK;
+}
+
+void PmmNode::DrainCpuCaches() {
+  Guard<Mutex> guard{&lock_};
+  DrainCpuCachesLocked();
+}
+
+void PmmNode::UpdateCpuCachesEnabledLocked() {
+  const bool enable = cpu_caches_allowed_ && !free_fill_enabled_ && mem_avail_state_cur_index_ > 0;
+  cpu_caches_enabled_.store(enable, ktl::memory_order_release);
+  if (!enable) {
+    DrainCpuCachesLocked();
+  }
+}
+
+vm_page* PmmNode::AllocPageFromCpuCache() {
+  if (!cpu_caches_enabled_.load(ktl::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  // The thread may migrate after reading the CPU number; that only costs locality since every
+  // cache is protected by its own lock.
+  CpuCache& cache = cpu_caches_[arch_curr_cpu_num() % cpu_cache_count_];
+  vm_page* page;
+  {
+    Guard<SpinLock, IrqSave> guard{&cache.lock};
+    page = list_remove_head_type(&cache.free_list, vm_page, queue_node);
+    if (page) {
+      cache.count--;
+    }
+  }
+
+  if (page) {
+    kcounter_add(pmm_cpu_cache_alloc_hit, 1);
+    cached_count_.fetch_sub(1, ktl::memory_order_relaxed);
+  } else {
+    // Refill the cache with a batch of pages from the free list. The refill is skipped if it would
+    // move the node into a lower memory availability state; the caller then falls back to the
+    // locked path, which performs the transition one page at a time.
+    list_node batch = LIST_INITIAL_VALUE(batch);
+    {
+      Guard<Mutex> guard{&lock_};
+      if (!cpu_caches_enabled_.load(ktl::memory_order_relaxed) ||
+          free_count_ <= mem_avail_state_lower_bound_ + kCpuCacheBatch ||
+          FreeListCountLocked() < kCpuCacheBatch) {
+        return nullptr;
+      }
+      for (size_t i = 0; i < kCpuCacheBatch; i++) {
+        vm_page* p = list_remove_head_type(&free_list_, vm_page, queue_node);
+        DEBUG_ASSERT(p);
+        list_add_tail(&batch, &p->queue_node);
+      }
+      // Account for the batch minus the page returned to the caller as cached.
+      cached_count_.fetch_add(kCpuCacheBatch - 1, ktl::memory_order_relaxed);
+      DecrementFreeCountLocked(kCpuCacheBatch);
+    }
+    kcounter_add(pmm_cpu_cache_refill, 1);
+
+    page = list_remove_head_type(&batch, vm_page, queue_node);
+    {
+      Guard<SpinLock, IrqSave> guard{&cache.lock};
+
+      // Check again under the cache lock, as in FreePageToCpuCache: the caches may have been
+      // disabled and drained since |lock_| was dropped, in which case the batch must not be left
+      // in a cache that nothing will drain.
+      if (cpu_caches_enabled_.load(ktl::memory_order_relaxed)) {
+        list_splice_after(&batch, &cache.free_list);
+        cache.count += kCpuCacheBatch - 1;
+      }
+    }
+
+    if (!list_is_empty(&batch)) {
+      cached_count_.fetch_sub(kCpuCacheBatch - 1, ktl::memory_order_relaxed);
+      Guard<Mutex> guard{&lock_};
+      ReturnCachedPagesLocked(&batch);
+      IncrementFreeCountLocked(kCpuCacheBatch - 1);
+    }
+  }
+
+  LTRACEF("allocating page %p from cpu cache, pa %#" PRIxPTR "\n", page, page->paddr());
+  DEBUG_ASSERT(page->is_free());
+  AsanUnpoisonPage(page);
+  page->set_state(VM_PAGE_STATE_ALLOC);
+  return page;
+}
+
+bool PmmNode::FreePageToCpuCache(vm_page* page) {
+  if (!cpu_caches_enabled_.load(ktl::memory_order_acquire)) {
+    return false;
+  }
+
+  DEBUG_ASSERT(page->state() != VM_PAGE_STATE_OBJECT || page->object.pin_count == 0);
+  DEBUG_ASSERT(!page->is_free());
+
+  CpuCache& cache = cpu_caches_[arch_curr_cpu_num() % cpu_cache_count_];
+  list_node overflow = LIST_INITIAL_VALUE(overflow);
+  {
+    Guard<SpinLock, IrqSave> guard{&cache.lock};
+
+    // Check again under the cache lock: disabling the caches clears the flag before draining them,
+    // so a page added here is either seen by the drain or not added at all.
+    if (!cpu_caches_enabled_.load(ktl::memory_order_relaxed)) {
+      return false;
+    }
+
+    page->set_state(VM_PAGE_STATE_FREE);
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
+    AsanPoisonPage(page, kAsanPmmFreeMagic);
+    list_add_head(&cache.free_list, &page->queue_node);
+    cache.count++;
+
+    // Return the coldest batch of pages to the free list if the cache is full.
+    if (cache.count > kCpuCacheMax) {
+      for (size_t i = 0; i < kCpuCacheBatch; i++) {
+        list_node* node = list_remove_tail(&cache.free_list);
+        list_add_head(&overflow, node);
+      }
+      cache.count -= kCpuCacheBatch;
+    }
+  }
+  kcounter_add(pmm_cpu_cache_free_hit, 1);
+
+  if (list_is_empty(&overflow)) {
+    cached_count_.fetch_add(1, ktl::memory_order_relaxed);
+  } else {
+    cached_count_.fetch_sub(kCpuCacheBatch - 1, ktl::memory_order_relaxed);
+    Guard<Mutex> guard{&lock_};
+    ReturnCachedPagesLocked(&overflow);
+    IncrementFreeCountLocked(kCpuCacheBatch);
+  }
+  return true;
+}
+
+void PmmNode::ReturnCachedPagesLocked(list_node* list) {
+  // Cached pages are already marked free and poisoned, but were never filled.
+  if (unlikely(free_fill_enabled_)) {
+    vm_page* page;
+    list_for_every_entry (list, page, vm_page, queue_node) { checker_.FillPattern(page); }
+  }
+  list_splice_after(list, &free_list_);
+}
+
+void PmmNode::DrainCpuCachesLocked() {
+  for (size_t i = 0; i < cpu_cache_count_; i++) {
+    CpuCache& cache = cpu_caches_[i];
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    size_t count;
+    {
+      Guard<SpinLock, IrqSave> guard{&cache.lock};
+      count = cache.count;
+      list_move(&cache.free_list, &pages);
+      cache.count = 0;
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    kcounter_add(pmm_cpu_cache_drain, 1);
+    cached_count_.fetch_sub(count, ktl::memory_order_relaxed);
+    ReturnCachedPagesLocked(&pages);
+
+    // The count is adjusted directly instead of through IncrementFreeCountLocked, since draining is
+    // itself part of updating the memory availability state.
+    free_count_ += count;
+  }
+}
+
 void PmmNode::AllocPages(uint alloc_flags, page_request_t* req) {
   kcounter_add(pmm_alloc_async, 1);
 
@@ -561,7 +890,9 @@ void PmmNode::ProcessPendingRequests() {
   }
 }
 
-uint64_t PmmNode::CountFreePages() const TA_NO_THREAD_SAFETY_ANALYSIS { return free_count_; }
+uint64_t PmmNode::CountFreePages() const TA_NO_THREAD_SAFETY_ANALYSIS {
+  return free_count_ + cached_count_.load(ktl::memory_order_relaxed);
+}
 
 uint64_t PmmNode::CountTotalBytes() const TA_NO_THREAD_SAFETY_ANALYSIS {
   return arena_cumulative_size_;
@@ -575,8 +906,12 @@ void PmmNode::DumpFree() const TA_NO_THREAD_SAFETY_ANALYSIS {
 void PmmNode::Dump(bool is_panic) const {
   // No lock analysis here, as we want to just go for it in the panic case without the lock.
   auto dump = [this]() TA_NO_THREAD_SAFETY_ANALYSIS {
-    printf("pmm node %p: free_count %zu (%zu bytes), total size %zu\n", this, free_count_,
-           free_count_ * PAGE_SIZE, arena_cumulative_size_);
+    const uint64_t cached_count = cached_count_.load(ktl::memory_order_relaxed);
+    const uint64_t zeroed_count = zeroed_count_.load(ktl::memory_order_relaxed);
+    printf("pmm node %p: free_count %zu (%zu bytes), cpu cached %zu (%zu bytes), total size %zu\n",
+           this, free_count_, free_count_ * PAGE_SIZE, cached_count, cached_count * PAGE_SIZE,
+           arena_cumulative_size_);
+    printf("\tzero pool %zu pages (target %zu)\n", zeroed_count, zero_pool_target_);
     for (auto& a : arena_list_) {
       a.Dump(false, false);
     }
@@ -639,6 +974,14 @@ zx_status_t PmmNode::InitReclamation(const uint64_t* watermarks, uint8_t waterma
 }
 
 void PmmNode::UpdateMemAvailStateLocked() {
+  // Pages held in the per-CPU caches are free but are not counted in free_count_. Return them to
+  // the free list before moving to a lower state so the transition reflects the true amount of
+  // free memory.
+  if (free_count_ <= mem_avail_state_lower_bound_ &&
+      cached_count_.load(ktl::memory_order_relaxed) > 0) {
+    DrainCpuCachesLocked();
+  }
+
   // Find the smallest watermark which is greater than the number of free pages.
   uint8_t target = mem_avail_state_watermark_count_;
   for (uint8_t i = 0; i < mem_avail_state_watermark_count_; i++) {
@@ -680,6 +1023,17 @@ void PmmNode::SetMemAvailStateLocked(uint8_t mem_avail_state) {
     mem_avail_state_upper_bound_ = UINT64_MAX / PAGE_SIZE;
   }
 
+  // The per-CPU caches are bypassed in the OOM state so that frees are immediately visible to
+  // waiting allocations.
+  if (cpu_caches_allowed_) {
+    UpdateCpuCachesEnabledLocked();
+  }
+
+  // Refill the zero pool once memory is plentiful again.
+  if (mem_avail_state_cur_index_ == mem_avail_state_watermark_count_ && zero_pool_target_ > 0) {
+    zero_pool_evt_.SignalNoResched();
+  }
+
   mem_avail_state_callback_(mem_avail_state_context_, mem_avail_state_cur_index_);
 }
 
@@ -730,3 +1084,136 @@ void PmmNode::InitRequestThread() {
       Thread::Create("pmm-node-request-thread", pmm_node_request_loop, this, HIGH_PRIORITY);
   request_thread_->Resume();
 }
+
+vm_page* PmmNode::TakeZeroedPageLocked() {
+  vm_page* page = list_remove_head_type(&zeroed_list_, vm_page, queue_node);
+  if (!page) {
+    return nullptr;
+  }
+  DEBUG_ASSERT(page->flags & VM_PAGE_FLAG_ZEROED);
+  const uint64_t zeroed_count = zeroed_count_.fetch_sub(1, ktl::memory_order_relaxed) - 1;
+  // Start refilling at half the target rather than on every allocation, so the pool thread zeroes
+  // pages in batches.
+  if (zeroed_count + zeroing_count_ < zero_pool_target_ / 2) {
+    zero_pool_evt_.SignalNoResched();
+  }
+  return page;
+}
+
+void PmmNode::ReturnZeroedPagesLocked() {
+  vm_page* page;
+  list_for_every_entry (&zeroed_list_, page, vm_page, queue_node) {
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
+    if (unlikely(free_fill_enabled_)) {
+      AsanUnpoisonPage(page);
+      checker_.FillPattern(page);
+      AsanPoisonPage(page, kAsanPmmFreeMagic);
+    }
+  }
+  list_splice_after(&zeroed_list_, &free_list_);
+  list_initialize(&zeroed_list_);
+  zeroed_count_.store(0, ktl::memory_order_relaxed);
+}
+
+bool PmmNode::ZeroPoolNeedsPagesLocked() {
+  // Zeroing is deferred while free pages are filled with a pattern, and while memory is scarce, so
+  // that the pool never holds pages an allocation without PMM_ALLOC_FLAG_ZEROED would rather have.
+  return zero_pool_target_ > zeroed_count_.load(ktl::memory_order_relaxed) + zeroing_count_ &&
+         !free_fill_enabled_ && mem_avail_state_cur_index_ == mem_avail_state_watermark_count_ &&
+         FreeListCountLocked() > 0;
+}
+
+bool PmmNode::FillZeroPoolBatch() {
+  Guard<Mutex> pool_guard{&zero_pool_lock_};
+
+  list_node pages = LIST_INITIAL_VALUE(pages);
+  size_t count = 0;
+  {
+    Guard<Mutex> guard{&lock_};
+    if (!ZeroPoolNeedsPagesLocked()) {
+      return false;
+    }
+    const uint64_t wanted =
+        zero_pool_target_ - zeroed_count_.load(ktl::memory_order_relaxed) - zeroing_count_;
+    // Take the coldest pages from the tail of the free list. They remain counted in free_count_ but
+    // are marked allocated so that AllocRange and AllocContiguous skip them.
+    while (count < kZeroPoolBatch && count < wanted) {
+      list_node* node = list_remove_tail(&free_list_);
+      if (!node) {
+        break;
+      }
+      vm_page* page = containerof(node, vm_page, queue_node);
+      DEBUG_ASSERT(page->is_free());
+      page->set_state(VM_PAGE_STATE_ALLOC);
+      list_add_tail(&pages, node);
+      count++;
+    }
+    zeroing_count_ += count;
+  }
+
+  vm_page* page;
+  list_for_every_entry (&pages, page, vm_page, queue_node) {
+    AsanUnpoisonPage(page);
+    arch_zero_page(paddr_to_physmap(page->paddr()));
+    AsanPoisonPage(page, kAsanPmmFreeMagic);
+  }
+
+  Guard<Mutex> guard{&lock_};
+  zeroing_count_ -= count;
+  // The pool may have been disabled, or free page filling enabled, while the lock was dropped.
+  const bool keep = zero_pool_target_ > 0 && !free_fill_enabled_;
+  list_for_every_entry (&pages, page, vm_page, queue_node) {
+    page->set_state(VM_PAGE_STATE_FREE);
+    if (keep) {
+      page->flags |= VM_PAGE_FLAG_ZEROED;
+    } else if (unlikely(free_fill_enabled_)) {
+      AsanUnpoisonPage(page);
+      checker_.FillPattern(page);
+      AsanPoisonPage(page, kAsanPmmFreeMagic);
+    }
+  }
+  if (keep) {
+    list_splice_after(&pages, &zeroed_list_);
+    zeroed_count_.fetch_add(count, ktl::memory_order_relaxed);
+    kcounter_add(pmm_zero_pool_fill, count);
+  } else {
+    list_splice_after(&pages, free_list_.prev);
+  }
+  return keep;
+}
+
+int PmmNode::ZeroPoolThreadLoop() {
+  while (zero_pool_thread_live_) {
+    while (zero_pool_thread_live_ && FillZeroPoolBatch()) {
+    }
+    zero_pool_evt_.Wait(Deadline::infinite());
+  }
+  return 0;
+}
+
+static int pmm_node_zero_pool_loop(void* arg) {
+  return static_cast<PmmNode*>(arg)->ZeroPoolThreadLoop();
+}
+
+void PmmNode::EnableZeroPool(uint64_t target_pages) {
+  Guard<Mutex> guard{&lock_};
+  zero_pool_target_ = target_pages;
+  if (!zero_pool_thread_) {
+    // The pool is filled at the lowest priority so that zeroing only consumes otherwise idle time.
+    zero_pool_thread_ =
+        Thread::Create("pmm-zero-pool", pmm_node_zero_pool_loop, this, LOWEST_PRIORITY);
+    zero_pool_thread_->Resume();
+  }
+  zero_pool_evt_.SignalNoResched();
+}
+
+void PmmNode::DisableZeroPool() {
+  {
+    Guard<Mutex> guard{&lock_};
+    zero_pool_target_ = 0;
+  }
+  // Wait for any batch being zeroed to be returned to the free list.
+  Guard<Mutex> pool_guard{&zero_pool_lock_};
+  Guard<Mutex> guard{&lock_};
+  ReturnZeroedPagesLocked();
+}
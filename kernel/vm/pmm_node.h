@@ -8,9 +8,13 @@
 
 #include <fbl/canary.h>
 #include <fbl/intrusive_double_list.h>
+#include <kernel/align.h>
 #include <kernel/event.h>
 #include <kernel/lockdep.h>
 #include <kernel/mutex.h>
+#include <kernel/spinlock.h>
+#include <ktl/atomic.h>
+#include <ktl/unique_ptr.h>
 #include <vm/pmm.h>
 #include <vm/pmm_checker.h>
 
@@ -48,6 +52,8 @@ class PmmNode {
   int RequestThreadLoop();
   void InitRequestThread();
 
+  int ZeroPoolThreadLoop();
+
   uint64_t CountFreePages() const;
   uint64_t CountTotalBytes() const;
 
@@ -110,7 +116,71 @@ class PmmNode {
   // For test and diagnostic purposes.
   PmmChecker* Checker() { return &checker_; }
 
+  // Enable the per-CPU free page caches, which let single page allocations and frees on a CPU
+  // avoid |lock_| in the common case. The caches are filled and drained in batches of
+  // |kCpuCacheBatch| pages from the shared free list.
+  //
+  // Pages held in a cache are free and are included in CountFreePages(), but they are not part of
+  // the count used to compute the memory availability state. Refills that would move the node into
+  // a lower state are skipped, and the caches are drained back to the free list before the node
+  // transitions to a lower state, so cached pages never cause a spurious low memory transition. The
+  // caches are bypassed while the node is in the OOM state or the free fill checker is enabled.
+  //
+  // Returns ZX_ERR_NO_MEMORY if the caches could not be allocated.
+  zx_status_t EnableCpuCaches();
+
+  // Return all pages held in the per-CPU caches to the shared free list.
+  void DrainCpuCaches();
+
+  // Maximum number of pages moved between a per-CPU cache and the free list at a time, and the
+  // number of pages a cache may hold before it is drained.
+  static constexpr size_t kCpuCacheBatch = 32;
+  static constexpr size_t kCpuCacheMax = 2 * kCpuCacheBatch;
+
+  // Keep up to |target_pages| free pages zeroed ahead of time, so that PMM_ALLOC_FLAG_ZEROED
+  // allocations can skip zeroing. The pool is filled by a lowest priority thread, and only while
+  // the node is in its highest memory availability state and the free fill checker is disabled.
+  //
+  // Pages in the pool are free and counted as such; allocations without PMM_ALLOC_FLAG_ZEROED use
+  // them only once the rest of the free list is exhausted.
+  void EnableZeroPool(uint64_t target_pages);
+
+  // Stop filling the zero pool and return its pages to the free list. Waits for a batch being
+  // zeroed to finish.
+  void DisableZeroPool();
+
+  // Returns the number of pages in the zero pool.
+  uint64_t CountZeroedPages() const { return zeroed_count_.load(ktl::memory_order_relaxed); }
+
+  // Maximum number of pages zeroed by the pool thread between acquisitions of |lock_|.
+  static constexpr size_t kZeroPoolBatch = 16;
+
  private:
+  // Per-CPU cache of free pages. Pages in a cache are in the FREE state and are linked through
+  // their queue_node, exactly like pages on |free_list_|.
+  struct __CPU_ALIGN CpuCache {
+    DECLARE_SPINLOCK(PmmNode::CpuCache) lock;
+    list_node free_list TA_GUARDED(lock) = LIST_INITIAL_VALUE(free_list);
+    size_t count TA_GUARDED(lock) = 0;
+  };
+
+  vm_page* AllocPageFromCpuCache();
+  bool FreePageToCpuCache(vm_page* page);
+  void DrainCpuCachesLocked() TA_REQ(lock_);
+  void ReturnCachedPagesLocked(list_node* list) TA_REQ(lock_);
+  void UpdateCpuCachesEnabledLocked() TA_REQ(lock_);
+
+  vm_page* TakeZeroedPageLocked() TA_REQ(lock_);
+  size_t TakePagesLocked(list_node* source, size_t count, list_node* dest) TA_REQ(lock_);
+  void ReturnZeroedPagesLocked() TA_REQ(lock_);
+  bool ZeroPoolNeedsPagesLocked() TA_REQ(lock_);
+  bool FillZeroPoolBatch();
+
+  // Returns the number of pages on |free_list_|.
+  uint64_t FreeListCountLocked() const TA_REQ(lock_) {
+    return free_count_ - zeroing_count_ - zeroed_count_.load(ktl::memory_order_relaxed);
+  }
+
   void FreePageHelperLocked(vm_page* page) TA_REQ(lock_);
   void FreeListLocked(list_node* list) TA_REQ(lock_);
 
@@ -139,9 +209,9 @@ class PmmNode {
 
   void AllocPageHelperLocked(vm_page_t* page) TA_REQ(lock_);
 
-  void AsanPoisonPage(vm_page_t*, uint8_t) TA_REQ(lock_);
+  void AsanPoisonPage(vm_page_t*, uint8_t);
 
-  void AsanUnpoisonPage(vm_page_t*) TA_REQ(lock_);
+  void AsanUnpoisonPage(vm_page_t*);
 
   fbl::Canary<fbl::magic("PNOD")> canary_;
 
@@ -179,6 +249,31 @@ class PmmNode {
 
   bool free_fill_enabled_ TA_GUARDED(lock_) = false;
   PmmChecker checker_ TA_GUARDED(lock_);
+
+  // One cache per CPU, allocated by EnableCpuCaches() and never freed while the node is alive.
+  // |cpu_caches_enabled_| is only set once the array is published, and is cleared whenever the
+  // caches must be bypassed. It is written under |lock_| and read locklessly by the fast paths.
+  ktl::unique_ptr<CpuCache[]> cpu_caches_;
+  size_t cpu_cache_count_ = 0;
+  bool cpu_caches_allowed_ TA_GUARDED(lock_) = false;
+  ktl::atomic<bool> cpu_caches_enabled_ = false;
+
+  // Number of free pages currently held in the per-CPU caches.
+  ktl::atomic<uint64_t> cached_count_ = 0;
+
+  // Free pages known to be zero filled, marked with VM_PAGE_FLAG_ZEROED. Together with the pages
+  // being zeroed by the pool thread they are counted in |free_count_| but are not on |free_list_|.
+  // Pages being zeroed are in the ALLOC state so that range and contiguous allocations skip them.
+  list_node zeroed_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(zeroed_list_);
+  ktl::atomic<uint64_t> zeroed_count_ = 0;
+  uint64_t zeroing_count_ TA_GUARDED(lock_) = 0;
+  uint64_t zero_pool_target_ TA_GUARDED(lock_) = 0;
+
+  // Held by the pool thread while it zeroes a batch, so that DisableZeroPool() can wait for it.
+  DECLARE_MUTEX(PmmNode) zero_pool_lock_;
+  AutounsignalEvent zero_pool_evt_;
+  Thread* zero_pool_thread_ = nullptr;
+  ktl::atomic<bool> zero_pool_thread_live_ = true;
 };
 
 // We don't need to hold the arena lock while executing this, since it is
@@ -14,6 +14,7 @@
 #include <kernel/thread.h>
 #include <ktl/algorithm.h>
 #include <lk/init.h>
+#include <vm/compression.h>
 #include <vm/scanner.h>
 #include <vm/vm.h>
 #include <vm/vm_aspace.h>
@@ -35,6 +36,12 @@ constexpr uint32_t kScannerOpHarvestAccessed = 1u << 7;
 constexpr zx_duration_t kQueueRotateTime = ZX_SEC(10);
 
 const char *kEvictionCmdLineFlag = "kernel.page-scanner.enable-user-pager-eviction";
+const char *kCompressionCmdLineFlag = "kernel.page-scanner.enable-compression";
+
+// Maximum number of unswappable pages to consider in a single call to scanner_compress_unswappable.
+// Most pages in the unswappable queue either have no backlink or were recently accessed, and so
+// this bounds the time spent walking the queue without finding anything to compress.
+constexpr uint64_t kMaxCompressionCandidates = 4096;
 
 // If not set on the cmdline this becomes the default zero page scans per second to target. This
 // value was chosen to consume, in the worst case, 5% CPU on a lower-end arm device. Individual
@@ -48,6 +55,9 @@ uint64_t zero_page_scans_per_second = 0;
 // Eviction is globally enabled/disabled on startup through the kernel cmdline.
 bool eviction_enabled = false;
 
+// Compression is globally enabled/disabled on startup through the kernel cmdline.
+bool compression_enabled = false;
+
 // Tracks what the scanner should do when it is next woken up.
 ktl::atomic<uint32_t> scanner_operation = 0;
 
@@ -72,6 +82,9 @@ KCOUNTER(zero_scan_pages_deduped, "vm.scanner.zero_scan.pages_deduped")
 
 KCOUNTER(eviction_pages_evicted, "vm.scanner.eviction.pages_evicted")
 
+KCOUNTER(compression_pages_considered, "vm.scanner.compression.pages_considered")
+KCOUNTER(compression_pages_compressed, "vm.scanner.compression.pages_compressed")
+
 void scanner_print_stats(zx_duration_t time_till_queue_rotate) {
   uint64_t zero_pages = VmObject::ScanAllForZeroPages(false);
   printf("[SCAN]: Found %lu zero pages across all of memory\n", zero_pages);
@@ -82,6 +95,15 @@ void scanner_print_stats(zx_duration_t time_till_queue_rotate) {
   }
   printf("[SCAN]: Next queue rotation in %ld ms\n", time_till_queue_rotate / ZX_MSEC(1));
   printf("[SCAN]: Found %lu zero forked pages\n", queue_counts.unswappable_zero_fork);
+  printf("[SCAN]: Found %lu unswappable pages\n", queue_counts.unswappable);
+  const VmCompressedPage::Stats compression = VmCompressedPage::GetStats();
+  printf("[SCAN]: %lu pages stored compressed in %lu bytes", compression.stored_pages,
+         compression.stored_bytes);
+  if (compression.stored_bytes > 0) {
+    printf(" (ratio %lu.%02lu)", compression.stored_pages * PAGE_SIZE / compression.stored_bytes,
+           (compression.stored_pages * PAGE_SIZE * 100 / compression.stored_bytes) % 100);
+  }
+  printf("\n");
 }
 
 zx_time_t calc_next_zero_scan_deadline(zx_time_t current) {
@@ -116,7 +138,12 @@ uint64_t scanner_do_reclaim() {
     const uint64_t pages_to_free = (target_mem - free_mem) / PAGE_SIZE;
     list_node_t free_list;
     list_initialize(&free_list);
-    const uint64_t pages_freed = scanner_evict_pager_backed(pages_to_free, &free_list);
+    uint64_t pages_freed = scanner_evict_pager_backed(pages_to_free, &free_list);
+    // Eviction is preferred as it frees the entire page, whereas compression still has to retain
+    // some memory for the compressed copy, so only compress to cover any shortfall.
+    if (pages_freed < pages_to_free) {
+      pages_freed += scanner_compress_unswappable(pages_to_free - pages_freed, &free_list);
+    }
     pmm_free(&free_list);
     total_pages_freed += pages_freed;
 
@@ -190,7 +217,7 @@ int scanner_request_thread(void *) {
       op &= ~kScannerOpReclaim;
       const uint64_t pages = scanner_do_reclaim();
       if (print) {
-        printf("[SCAN]: Evicted %lu user pager backed pages\n", pages);
+        printf("[SCAN]: Evicted or compressed %lu pages\n", pages);
       }
     }
     if (op & kScannerOpDump) {
@@ -292,6 +319,34 @@ uint64_t scanner_evict_pager_backed(uint64_t max_pages, list_node_t *free_list)
   return count;
 }
 
+uint64_t scanner_compress_unswappable(uint64_t max_pages, list_node_t *free_list) {
+  if (!compression_enabled) {
+    return 0;
+  }
+
+  uint64_t count = 0;
+  uint64_t considered;
+  for (considered = 0; considered < kMaxCompressionCandidates && count < max_pages;
+       considered++) {
+    if (ktl::optional<PageQueues::VmoBacklink> backlink =
+            pmm_page_queues()->RotateUnswappable()) {
+      if (!backlink->vmo) {
+        continue;
+      }
+      if (backlink->vmo->CompressPage(backlink->page, backlink->offset)) {
+        list_add_tail(free_list, &backlink->page->queue_node);
+        count++;
+      }
+    } else {
+      break;
+    }
+  }
+
+  compression_pages_considered.Add(considered);
+  compression_pages_compressed.Add(count);
+  return count;
+}
+
 void scanner_push_disable_count() {
   Guard<Mutex> guard{scanner_disabled_lock::Get()};
   if (scanner_disable_count == 0) {
@@ -318,6 +373,7 @@ static void scanner_init_func(uint level) {
       Thread::Create("scanner-request-thread", scanner_request_thread, nullptr, LOW_PRIORITY);
   DEBUG_ASSERT(thread);
   eviction_enabled = gCmdline.GetBool(kEvictionCmdLineFlag, false);
+  compression_enabled = gCmdline.GetBool(kCompressionCmdLineFlag, false);
   zero_page_scans_per_second = gCmdline.GetUInt64("kernel.page-scanner.zero-page-scans-per-second",
                                                   kDefaultZeroPageScansPerSecond);
   if (!gCmdline.GetBool("kernel.page-scanner.start-at-boot", true)) {
@@ -364,11 +420,11 @@ static int cmd_scanner(int argc, const cmd_args *argv, uint32_t flags) {
     if (argc < 3) {
       goto usage;
     }
-    if (!eviction_enabled) {
+    if (!eviction_enabled && !compression_enabled) {
       printf(
-          "%s is false, reclamation request will have "
+          "%s and %s are false, reclamation request will have "
           "no effect\n",
-          kEvictionCmdLineFlag);
+          kEvictionCmdLineFlag, kCompressionCmdLineFlag);
     }
     // To free the requested memory we set our target free memory level to current free memory +
     // desired amount to free.
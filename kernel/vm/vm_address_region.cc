@@ -224,7 +224,7 @@ zx_status_t VmAddressRegion::CreateVmMapping(size_t mapping_offset, size_t size,
 
   // Check that only allowed flags have been set
   if (vmar_flags & ~(VMAR_FLAG_SPECIFIC | VMAR_FLAG_SPECIFIC_OVERWRITE | VMAR_CAN_RWX_FLAGS |
-                     VMAR_FLAG_OFFSET_IS_UPPER_LIMIT)) {
+                     VMAR_FLAG_OFFSET_IS_UPPER_LIMIT | VMAR_FLAG_SEQUENTIAL)) {
     return ZX_ERR_INVALID_ARGS;
   }
 
@@ -369,15 +369,26 @@ zx_status_t VmAddressRegion::PageFault(vaddr_t va, uint pf_flags, PageRequest* p
   canary_.Assert();
   DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
 
+  fbl::RefPtr<VmMapping> mapping = FindMappingLocked(va);
+  if (!mapping) {
+    return ZX_ERR_NOT_FOUND;
+  }
+  return mapping->PageFault(va, pf_flags, page_request);
+}
+
+fbl::RefPtr<VmMapping> VmAddressRegion::FindMappingLocked(vaddr_t va) {
+  canary_.Assert();
+  DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
+
   auto vmar = fbl::RefPtr(this);
   while (auto next = vmar->subregions_.FindRegion(va)) {
     if (next->is_mapping()) {
-      return next->PageFault(va, pf_flags, page_request);
+      return next->as_vm_mapping();
     }
     vmar = next->as_vm_address_region();
   }
 
-  return ZX_ERR_NOT_FOUND;
+  return nullptr;
 }
 
 bool VmAddressRegion::CheckGapLocked(VmAddressRegionOrMapping* prev, VmAddressRegionOrMapping* next,
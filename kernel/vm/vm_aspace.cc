@@ -10,6 +10,7 @@
 #include <err.h>
 #include <inttypes.h>
 #include <lib/cmdline.h>
+#include <lib/counters.h>
 #include <lib/crypto/global_prng.h>
 #include <lib/crypto/prng.h>
 #include <lib/userabi/vdso.h>
@@ -37,6 +38,8 @@
 
 #define LOCAL_TRACE VM_GLOBAL_TRACE(0)
 
+KCOUNTER(vm_aspace_fault_retries, "vm.aspace.fault.retries")
+
 #define GUEST_PHYSICAL_ASPACE_BASE 0UL
 #define GUEST_PHYSICAL_ASPACE_SIZE (1UL << MMU_GUEST_SIZE_SHIFT)
 
@@ -560,27 +563,40 @@ zx_status_t VmAspace::PageFault(vaddr_t va, uint flags) {
     flags |= VMM_PF_FLAG_GUEST;
   }
 
-  zx_status_t status = ZX_OK;
-  PageRequest page_request;
-  do {
+  // Allow batching so that faults on pager-backed vmos can ask for the following pages as well.
+  PageRequest page_request(true);
+  for (;;) {
+    fbl::RefPtr<VmMapping> mapping;
+    fbl::RefPtr<VmObject> object;
     {
-      // for now, hold the aspace lock across the page fault operation,
-      // which stops any other operations on the address space from moving
-      // the region out from underneath it
+      // Only hold the aspace lock while finding the mapping. The fault itself is resolved under
+      // the vmo lock, so that threads faulting in different mappings, or mapping and unmapping
+      // elsewhere in the aspace, do not wait on each other while pages are allocated, copied or
+      // supplied by a pager.
       Guard<Mutex> guard{&lock_};
-
-      status = root_vmar_->PageFault(va, flags, &page_request);
+      mapping = root_vmar_->FindMappingLocked(va);
+      if (!mapping) {
+        return ZX_ERR_NOT_FOUND;
+      }
+      object = mapping->vmo_locked();
     }
 
-    if (status == ZX_ERR_SHOULD_WAIT) {
-      zx_status_t st = page_request.Wait();
-      if (st != ZX_OK) {
-        return st;
-      }
+    bool stale = false;
+    zx_status_t status = mapping->SpeculativePageFault(object, va, flags, &page_request, &stale);
+    if (stale) {
+      // The mapping was changed after we found it; look again.
+      vm_aspace_fault_retries.Add(1);
+      continue;
+    }
+    if (status != ZX_ERR_SHOULD_WAIT) {
+      return status;
     }
-  } while (status == ZX_ERR_SHOULD_WAIT);
 
-  return status;
+    status = page_request.Wait();
+    if (status != ZX_OK) {
+      return status;
+    }
+  }
 }
 
 zx_status_t VmAspace::SoftFault(vaddr_t va, uint flags) {
@@ -8,23 +8,39 @@
 #include <assert.h>
 #include <err.h>
 #include <inttypes.h>
+#include <lib/counters.h>
 #include <trace.h>
 #include <zircon/types.h>
 
 #include <fbl/alloc_checker.h>
 #include <fbl/auto_call.h>
+#include <ktl/algorithm.h>
 #include <ktl/iterator.h>
 #include <ktl/move.h>
 #include <vm/fault.h>
 #include <vm/vm.h>
 #include <vm/vm_aspace.h>
 #include <vm/vm_object.h>
+#include <vm/vm_page_list.h>
 
 #include "vm/vm_address_region.h"
 #include "vm_priv.h"
 
 #define LOCAL_TRACE VM_GLOBAL_TRACE(0)
 
+// Dividing pages_mapped by faults gives the average number of pages each fault maps.
+KCOUNTER(vm_fault_faults, "vm.fault.faults")
+KCOUNTER(vm_fault_pages_mapped, "vm.fault.pages_mapped")
+KCOUNTER(vm_fault_around_pages, "vm.fault.around_pages")
+KCOUNTER(vm_mapping_large_pages, "vm.mapping.large_pages")
+
+namespace {
+
+// How far past the faulting page to ask a pager for pages in a VMAR_FLAG_SEQUENTIAL mapping.
+constexpr uint64_t kSequentialReadaheadPages = 32;
+
+}  // namespace
+
 VmMapping::VmMapping(VmAddressRegion& parent, vaddr_t base, size_t size, uint32_t vmar_flags,
                      fbl::RefPtr<VmObject> vmo, uint64_t vmo_offset, uint arch_mmu_flags)
     : VmAddressRegionOrMapping(base, size, vmar_flags, parent.aspace_.get(), &parent),
@@ -480,7 +496,7 @@ namespace {
 
 class VmMappingCoalescer {
  public:
-  VmMappingCoalescer(VmMapping* mapping, vaddr_t base);
+  VmMappingCoalescer(VmMapping* mapping, vaddr_t base, uint mmu_flags);
   ~VmMappingCoalescer();
 
   // Add a page to the mapping run.  If this fails, the VmMappingCoalescer is
@@ -513,13 +529,14 @@ class VmMappingCoalescer {
 
   VmMapping* mapping_;
   vaddr_t base_;
+  const uint mmu_flags_;
   paddr_t phys_[16];
   size_t count_;
   bool aborted_;
 };
 
-VmMappingCoalescer::VmMappingCoalescer(VmMapping* mapping, vaddr_t base)
-    : mapping_(mapping), base_(base), count_(0), aborted_(false) {}
+VmMappingCoalescer::VmMappingCoalescer(VmMapping* mapping, vaddr_t base, uint mmu_flags)
+    : mapping_(mapping), base_(base), mmu_flags_(mmu_flags), count_(0), aborted_(false) {}
 
 VmMappingCoalescer::~VmMappingCoalescer() {
   // Make sure we've flushed or aborted
@@ -531,10 +548,10 @@ zx_status_t VmMappingCoalescer::Flush() {
     return ZX_OK;
   }
 
-  uint flags = mapping_->arch_mmu_flags();
-  if (flags & ARCH_MMU_FLAG_PERM_RWX_MASK) {
+  if (mmu_flags_ & ARCH_MMU_FLAG_PERM_RWX_MASK) {
     size_t mapped;
-    zx_status_t ret = mapping_->aspace()->arch_aspace().Map(base_, phys_, count_, flags, &mapped);
+    zx_status_t ret =
+        mapping_->aspace()->arch_aspace().Map(base_, phys_, count_, mmu_flags_, &mapped);
     if (ret != ZX_OK) {
       TRACEF("error %d mapping %zu pages starting at va %#" PRIxPTR "\n", ret, count_, base_);
       aborted_ = true;
@@ -581,7 +598,8 @@ zx_status_t VmMapping::MapRangeLocked(size_t offset, size_t len, bool commit) {
   }
 
   // grab the lock for the vmo
-  Guard<Mutex> object_guard{object_->lock()};
+  VmObject* vmo = object_.get();
+  Guard<Mutex> object_guard{vmo->lock()};
 
   // set the currently faulting flag for any recursive calls the vmo may make back into us.
   DEBUG_ASSERT(!currently_faulting_);
@@ -591,13 +609,27 @@ zx_status_t VmMapping::MapRangeLocked(size_t offset, size_t len, bool commit) {
   // iterate through the range, grabbing a page from the underlying object and
   // mapping it in
   size_t o;
-  VmMappingCoalescer coalescer(this, base_ + offset);
+  VmMappingCoalescer coalescer(this, base_ + offset, arch_mmu_flags_);
   for (o = offset; o < offset + len; o += PAGE_SIZE) {
     uint64_t vmo_offset = object_offset_ + o;
 
     zx_status_t status;
     paddr_t pa;
-    status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, nullptr, nullptr, &pa);
+
+    // Map whole large pages directly where the range covers them. The coalescer has to be flushed
+    // first so that the mappings are made in order.
+    if (IS_ALIGNED(base_ + o, LARGE_PAGE_SIZE) && offset + len - o >= LARGE_PAGE_SIZE) {
+      status = coalescer.Flush();
+      if (status != ZX_OK) {
+        return status;
+      }
+      if (MapLargePageLocked(vmo, base_ + o)) {
+        o += LARGE_PAGE_SIZE - PAGE_SIZE;
+        continue;
+      }
+    }
+
+    status = vmo->GetPageLocked(vmo_offset, pf_flags, nullptr, nullptr, nullptr, &pa);
     if (status != ZX_OK) {
       // no page to map
       if (commit) {
@@ -692,6 +724,39 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
 
   DEBUG_ASSERT(va >= base_ && va <= base_ + size_ - 1);
 
+  // grab the lock for the vmo
+  VmObject* object = object_.get();
+  Guard<Mutex> guard{object->lock()};
+  return PageFaultLocked(object, va, pf_flags, page_request);
+}
+
+zx_status_t VmMapping::SpeculativePageFault(const fbl::RefPtr<VmObject>& object, vaddr_t va,
+                                            const uint pf_flags, PageRequest* page_request,
+                                            bool* stale) {
+  canary_.Assert();
+  DEBUG_ASSERT(object);
+
+  VmObject* vmo = object.get();
+  Guard<Mutex> guard{vmo->lock()};
+
+  // Unmap, Protect and Destroy change base_, size_, object_offset_ and arch_mmu_flags_, and update
+  // the page tables to match, with the vmo lock held. So if we still contain |va| now, we will
+  // until the lock is dropped, and any later change will also apply to the page mapped below. A
+  // destroyed mapping has already had its size_ set to zero.
+  if (va < base_ || va - base_ >= size_) {
+    LTRACEF("%p no longer contains va %#" PRIxPTR "\n", this, va);
+    *stale = true;
+    return ZX_ERR_NOT_FOUND;
+  }
+
+  return PageFaultLocked(vmo, va, pf_flags, page_request);
+}
+
+zx_status_t VmMapping::PageFaultLocked(VmObject* object, vaddr_t va, const uint pf_flags,
+                                       PageRequest* page_request) {
+  DEBUG_ASSERT(object->lock()->lock().IsHeld());
+  DEBUG_ASSERT(va >= base_ && va <= base_ + size_ - 1);
+
   va = ROUNDDOWN(va, PAGE_SIZE);
   uint64_t vmo_offset = va - base_ + object_offset_;
 
@@ -721,9 +786,6 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
     return ZX_ERR_ACCESS_DENIED;
   }
 
-  // grab the lock for the vmo
-  Guard<Mutex> guard{object_->lock()};
-
   // set the currently faulting flag for any recursive calls the vmo may make back into us
   // The specific path we're avoiding is if the VMO calls back into us during vmo->GetPageLocked()
   // via UnmapVmoRangeLocked(). Since we're responsible for that page, signal to ourself to skip
@@ -736,7 +798,18 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
   paddr_t new_pa;
   vm_page_t* page;
   zx_status_t status =
-      object_->GetPageLocked(vmo_offset, pf_flags, nullptr, page_request, &page, &new_pa);
+      object->GetPageLocked(vmo_offset, pf_flags, nullptr, page_request, &page, &new_pa);
+  if (status == ZX_ERR_NEXT) {
+    // The page has to come from a page source and |page_request| was started as a batch. If we
+    // expect sequential access, have the request cover the pages that follow as well, so that the
+    // pager is asked for them once rather than on every fault.
+    uint64_t len = PAGE_SIZE;
+    if (flags_ & VMAR_FLAG_SEQUENTIAL) {
+      len = ktl::min<uint64_t>(kSequentialReadaheadPages * PAGE_SIZE, base_ + size_ - va);
+    }
+    status = object->FinalizePageRequestLocked(vmo_offset, len, pf_flags, page_request);
+    DEBUG_ASSERT(status != ZX_OK && status != ZX_ERR_NEXT);
+  }
   if (status != ZX_OK) {
     // TODO(cpu): This trace was originally TRACEF() always on, but it fires if the
     // VMO was resized, rather than just when the system is running out of memory.
@@ -819,6 +892,14 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
     // assert that we're not accidentally mapping the zero page writable
     DEBUG_ASSERT((new_pa != vm_get_zero_page_paddr()) || !(mmu_flags & ARCH_MMU_FLAG_PERM_WRITE));
 
+    // If the page is part of a committed, contiguous large page, map all of it at once.
+    if (!(pf_flags & VMM_PF_FLAG_GUEST) && new_pa != vm_get_zero_page_paddr() &&
+        MapLargePageLocked(object, va)) {
+      vm_fault_faults.Add(1);
+      vm_fault_pages_mapped.Add(LARGE_PAGE_SIZE / PAGE_SIZE);
+      return ZX_OK;
+    }
+
     size_t mapped;
     status = aspace_->arch_aspace().MapContiguous(va, new_pa, 1, mmu_flags, &mapped);
     if (status != ZX_OK) {
@@ -826,6 +907,12 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
       return ZX_ERR_NO_MEMORY;
     }
     DEBUG_ASSERT(mapped == 1);
+    vm_fault_faults.Add(1);
+    vm_fault_pages_mapped.Add(1);
+
+    if (!(pf_flags & VMM_PF_FLAG_GUEST)) {
+      FaultAroundLocked(object, va, mmu_flags);
+    }
   }
 
 // TODO: figure out what to do with this
@@ -839,6 +926,126 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* p
   return ZX_OK;
 }
 
+void VmMapping::FaultAroundLocked(VmObject* object, vaddr_t va, uint mmu_flags) {
+  DEBUG_ASSERT(object->lock()->lock().IsHeld());
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(va));
+
+#if ARCH_ARM64
+  // Executable pages need their caches synced once mapped, which only the fault path does.
+  if (mmu_flags & ARCH_MMU_FLAG_PERM_EXECUTE) {
+    return;
+  }
+#endif
+
+  // Look at the window of the vmo that one VmPageList node covers around the faulting page,
+  // clipped to this mapping.
+  constexpr uint64_t kWindowSize = VmPageListNode::kPageFanOut * PAGE_SIZE;
+  const uint64_t vmo_offset = va - base_ + object_offset_;
+  const uint64_t start = ktl::max(ROUNDDOWN(vmo_offset, kWindowSize), object_offset_);
+  const uint64_t end = ktl::min(ROUNDDOWN(vmo_offset, kWindowSize) + kWindowSize,
+                                object_offset_ + size_);
+  const vaddr_t start_va = base_ + (start - object_offset_);
+
+  struct Context {
+    VmMapping* mapping;
+    VmMappingCoalescer* coalescer;
+    vaddr_t start_va;
+    vaddr_t fault_va;
+    size_t mapped;
+  };
+  VmMappingCoalescer coalescer(this, start_va, mmu_flags);
+  Context context = {this, &coalescer, start_va, va, 0};
+
+  auto map_page = [](void* ctx, size_t offset, size_t index, paddr_t pa) -> zx_status_t {
+    auto* context = static_cast<Context*>(ctx);
+    const vaddr_t page_va = context->start_va + index * PAGE_SIZE;
+    if (page_va == context->fault_va) {
+      return ZX_OK;
+    }
+    // Leave anything that is already mapped alone, it may have different permissions.
+    paddr_t mapped_pa;
+    uint mapped_flags;
+    if (context->mapping->aspace()->arch_aspace().Query(page_va, &mapped_pa, &mapped_flags) ==
+        ZX_OK) {
+      return ZX_OK;
+    }
+    zx_status_t status = context->coalescer->Append(page_va, pa);
+    if (status != ZX_OK) {
+      return status;
+    }
+    context->mapped++;
+    return ZX_OK;
+  };
+
+  zx_status_t status = object->LookupCommittedLocked(start, end - start, map_page, &context);
+  if (status == ZX_OK) {
+    status = coalescer.Flush();
+  } else {
+    coalescer.Abort();
+  }
+  // Mapping neighbours is only an optimization; any page not mapped here will fault normally.
+  if (status != ZX_OK) {
+    LTRACEF("fault around va %#" PRIxPTR " failed: %d\n", va, status);
+    return;
+  }
+  vm_fault_around_pages.Add(context.mapped);
+  vm_fault_pages_mapped.Add(context.mapped);
+}
+
+bool VmMapping::MapLargePageLocked(VmObject* object, vaddr_t va) {
+  DEBUG_ASSERT(object->lock()->lock().IsHeld());
+
+  // Changing part of a large page later on is only guaranteed to split it when protecting; on arm64
+  // unmapping part of one drops the whole block. User mappings simply fault the rest back in, but
+  // kernel mappings may not be able to.
+  if (!aspace_->is_user()) {
+    return false;
+  }
+
+#if ARCH_ARM64
+  // Executable pages need their caches synced once mapped, which is done a page at a time.
+  if (arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_EXECUTE) {
+    return false;
+  }
+#endif
+
+  const vaddr_t block = ROUNDDOWN(va, LARGE_PAGE_SIZE);
+  if (block < base_ || block + LARGE_PAGE_SIZE > base_ + size_) {
+    return false;
+  }
+
+  // The arch layer can only install a large page over an empty range. Checking the ends catches
+  // the common case of part of the block having been faulted in already.
+  paddr_t mapped_pa;
+  uint mapped_flags;
+  if (aspace_->arch_aspace().Query(block, &mapped_pa, &mapped_flags) == ZX_OK ||
+      aspace_->arch_aspace().Query(block + LARGE_PAGE_SIZE - PAGE_SIZE, &mapped_pa,
+                                   &mapped_flags) == ZX_OK) {
+    return false;
+  }
+
+  // The object only reports runs it owns outright, so it is safe to map them with the full
+  // permissions of the mapping. Anything that later changes a single page goes through the arch
+  // layer, which either splits the large page or unmaps all of it to be faulted back in.
+  paddr_t pa;
+  if (object->LookupContiguousLocked(block - base_ + object_offset_, LARGE_PAGE_SIZE, &pa) !=
+          ZX_OK ||
+      !IS_ALIGNED(pa, LARGE_PAGE_SIZE)) {
+    return false;
+  }
+
+  size_t mapped;
+  zx_status_t status = aspace_->arch_aspace().MapContiguous(
+      block, pa, LARGE_PAGE_SIZE / PAGE_SIZE, arch_mmu_flags_, &mapped);
+  if (status != ZX_OK) {
+    LTRACEF("large page at va %#" PRIxPTR " not mapped: %d\n", block, status);
+    return false;
+  }
+  DEBUG_ASSERT(mapped == LARGE_PAGE_SIZE / PAGE_SIZE);
+  vm_mapping_large_pages.Add(1);
+  return true;
+}
+
 void VmMapping::ActivateLocked() {
   DEBUG_ASSERT(state_ == LifeCycleState::NOT_READY);
   DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
@@ -10,6 +10,7 @@
 #include <err.h>
 #include <inttypes.h>
 #include <lib/console.h>
+#include <lib/counters.h>
 #include <stdlib.h>
 #include <string.h>
 #include <trace.h>
@@ -20,8 +21,10 @@
 #include <fbl/auto_call.h>
 #include <ktl/algorithm.h>
 #include <ktl/array.h>
+#include <ktl/atomic.h>
 #include <ktl/move.h>
 #include <vm/bootreserve.h>
+#include <vm/compression.h>
 #include <vm/fault.h>
 #include <vm/page_source.h>
 #include <vm/physmap.h>
@@ -32,6 +35,11 @@
 
 #define LOCAL_TRACE VM_GLOBAL_TRACE(0)
 
+KCOUNTER(vm_fault_readahead_pages, "vm.fault.readahead_pages")
+KCOUNTER(vm_large_page_commits, "vm.large_page.commits")
+KCOUNTER(vm_large_page_commit_failures, "vm.large_page.commit_failures")
+KCOUNTER(vm_large_page_commit_skips, "vm.large_page.commit_skips")
+
 namespace {
 
 void ZeroPage(paddr_t pa) {
@@ -55,9 +63,40 @@ bool IsZeroPage(vm_page_t* p) {
   return true;
 }
 
+// Backoff for large page commits. Once pmm_alloc_contiguous fails to find a run, the next
+// |large_page_skips_left| commits that could have used large pages go a page at a time without
+// searching again. The number skipped starts at kMinLargePageSkips and doubles with each failure
+// in a row, up to kMaxLargePageSkips; a successful run resets it. These are only a heuristic, so
+// racing updates are harmless.
+constexpr uint32_t kMinLargePageSkips = 16;
+constexpr uint32_t kMaxLargePageSkips = 4096;
+ktl::atomic<uint32_t> large_page_skips_left = 0;
+ktl::atomic<uint32_t> large_page_backoff = 0;
+
+bool ShouldSkipLargePages() {
+  uint32_t left = large_page_skips_left.load(ktl::memory_order_relaxed);
+  while (left > 0) {
+    if (large_page_skips_left.compare_exchange_weak(left, left - 1, ktl::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LargePageAllocFailed() {
+  uint32_t backoff = large_page_backoff.load(ktl::memory_order_relaxed);
+  backoff = backoff == 0 ? kMinLargePageSkips : ktl::min(backoff * 2, kMaxLargePageSkips);
+  large_page_backoff.store(backoff, ktl::memory_order_relaxed);
+  large_page_skips_left.store(backoff, ktl::memory_order_relaxed);
+}
+
+void LargePageAllocSucceeded() { large_page_backoff.store(0, ktl::memory_order_relaxed); }
+
 void InitializeVmPage(vm_page_t* p) {
   DEBUG_ASSERT(p->state() == VM_PAGE_STATE_ALLOC);
   p->set_state(VM_PAGE_STATE_OBJECT);
+  // The contents are no longer tracked once the page belongs to an object.
+  p->flags &= ~VM_PAGE_FLAG_ZEROED;
   p->object.pin_count = 0;
   p->object.cow_left_split = 0;
   p->object.cow_right_split = 0;
@@ -66,6 +105,11 @@ void InitializeVmPage(vm_page_t* p) {
 // Allocates a new page and populates it with the data at |parent_paddr|.
 bool AllocateCopyPage(uint32_t pmm_alloc_flags, paddr_t parent_paddr, list_node_t* free_list,
                       vm_page_t** clone) {
+  const bool zero_fill = parent_paddr == vm_get_zero_page_paddr();
+  if (zero_fill) {
+    pmm_alloc_flags |= PMM_ALLOC_FLAG_ZEROED;
+  }
+
   paddr_t pa_clone;
   vm_page_t* p_clone = nullptr;
   if (free_list) {
@@ -83,17 +127,18 @@ bool AllocateCopyPage(uint32_t pmm_alloc_flags, paddr_t parent_paddr, list_node_
     DEBUG_ASSERT(status == ZX_OK);
   }
 
+  const bool already_zero = p_clone->flags & VM_PAGE_FLAG_ZEROED;
   InitializeVmPage(p_clone);
 
   void* dst = paddr_to_physmap(pa_clone);
   DEBUG_ASSERT(dst);
 
-  if (parent_paddr != vm_get_zero_page_paddr()) {
+  if (!zero_fill) {
     // do a direct copy of the two pages
     const void* src = paddr_to_physmap(parent_paddr);
     DEBUG_ASSERT(src);
     memcpy(dst, src, PAGE_SIZE);
-  } else {
+  } else if (!already_zero) {
     // avoid pointless fetches by directly zeroing dst
     arch_zero_page(dst);
   }
@@ -146,11 +191,14 @@ class BatchPQRemove {
   }
 
   // Produces a callback suitable for passing to VmPageList::RemovePages that will |Push| any pages
+  // and free any compressed page references.
   auto RemovePagesCallback() {
     return [this](VmPageOrMarker* p, uint64_t off) {
       if (p->IsPage()) {
         vm_page_t* page = p->ReleasePage();
         Push(page);
+      } else if (p->IsReference()) {
+        VmCompressedPage::Free(p->ReleaseReference());
       }
       *p = VmPageOrMarker::Empty();
     };
@@ -697,6 +745,14 @@ zx_status_t VmObjectPaged::CreateChildSlice(uint64_t offset, uint64_t size, bool
     if (cache_policy_ != ARCH_MMU_FLAG_CACHED && !is_contiguous()) {
       return ZX_ERR_BAD_STATE;
     }
+
+    // The slice will look up pages directly in our page list, which must not contain compressed
+    // pages once we have children.
+    status = DecompressAllLocked();
+    if (status != ZX_OK) {
+      return status;
+    }
+
     vmo->cache_policy_ = cache_policy_;
     vmo->parent_offset_ = offset;
     vmo->parent_limit_ = size;
@@ -808,6 +864,13 @@ zx_status_t VmObjectPaged::CreateClone(Resizability resizable, CloneType type, u
       return ZX_ERR_BAD_STATE;
     }
 
+    // Compressed pages are only supported in VMOs without children, so expand them back into real
+    // pages before any content becomes shared.
+    status = DecompressAllLocked();
+    if (status != ZX_OK) {
+      return status;
+    }
+
     // TODO: ZX-692 make sure that the accumulated parent offset of the entire
     // parent chain doesn't wrap 64bit space.
     vmo->parent_offset_ = offset;
@@ -1158,9 +1221,12 @@ void VmObjectPaged::Dump(uint depth, bool verbose) {
   Guard<Mutex> guard{&lock_};
 
   size_t count = 0;
-  page_list_.ForEveryPage([&count](const auto& p, uint64_t) {
+  size_t compressed_count = 0;
+  page_list_.ForEveryPage([&count, &compressed_count](const auto& p, uint64_t) {
     if (p.IsPage()) {
       count++;
+    } else if (p.IsReference()) {
+      compressed_count++;
     }
     return ZX_ERR_NEXT;
   });
@@ -1169,9 +1235,9 @@ void VmObjectPaged::Dump(uint depth, bool verbose) {
     printf("  ");
   }
   printf("vmo %p/k%" PRIu64 " size %#" PRIx64 " offset %#" PRIx64 " limit %#" PRIx64
-         " pages %zu ref %d parent %p/k%" PRIu64 "\n",
-         this, user_id_, size_, parent_offset_, parent_limit_, count, ref_count_debug(),
-         parent_.get(), parent_id);
+         " pages %zu compressed %zu ref %d parent %p/k%" PRIu64 "\n",
+         this, user_id_, size_, parent_offset_, parent_limit_, count, compressed_count,
+         ref_count_debug(), parent_.get(), parent_id);
 
   if (page_source_) {
     for (uint i = 0; i < depth + 1; ++i) {
@@ -1187,6 +1253,8 @@ void VmObjectPaged::Dump(uint depth, bool verbose) {
       }
       if (p.IsMarker()) {
         printf("offset %#" PRIx64 " zero page marker\n", offset);
+      } else if (p.IsReference()) {
+        printf("offset %#" PRIx64 " compressed %zu bytes\n", offset, p.Reference()->size());
       } else {
         printf("offset %#" PRIx64 " page %p paddr %#" PRIxPTR "\n", offset, p.Page(),
                p.Page()->paddr());
@@ -1452,8 +1520,8 @@ zx_status_t VmObjectPaged::AddPageLocked(VmPageOrMarker* p, uint64_t offset, boo
   if (!page) {
     return ZX_ERR_NO_MEMORY;
   }
-  // Only fail on pages, we overwrite markers and empty slots.
-  if (page->IsPage()) {
+  // Only fail on pages and compressed pages, we overwrite markers and empty slots.
+  if (page->IsPage() || page->IsReference()) {
     return ZX_ERR_ALREADY_EXISTS;
   }
   // If this is actually a real page, we need to place it into the appropriate queue.
@@ -1773,6 +1841,14 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
   }
 
   VmPageOrMarker* page_or_mark = page_list_.Lookup(offset);
+  if (page_or_mark && page_or_mark->IsReference()) {
+    // Compressed content is always expanded back into a real page, regardless of |pf_flags|, as
+    // there is no other way to provide a vm_page_t for it.
+    zx_status_t status = DecompressPageLocked(page_or_mark, offset, free_list);
+    if (status != ZX_OK) {
+      return status;
+    }
+  }
   vm_page* p = nullptr;
   VmObjectPaged* page_owner;
   uint64_t owner_offset;
@@ -1911,6 +1987,243 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
   return ZX_OK;
 }
 
+zx_status_t VmObjectPaged::FinalizePageRequestLocked(uint64_t offset, uint64_t len,
+                                                     uint pf_flags, PageRequest* page_request) {
+  canary_.Assert();
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(offset));
+  DEBUG_ASSERT(page_request);
+
+  uint64_t new_len;
+  if (!TrimRange(offset, len, size_, &new_len)) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+
+  if (is_slice()) {
+    uint64_t parent_offset;
+    VmObjectPaged* parent = PagedParentOfSliceLocked(&parent_offset);
+    AssertHeld(parent->lock_);
+    return parent->FinalizePageRequestLocked(offset + parent_offset, new_len, pf_flags,
+                                             page_request);
+  }
+
+  // Extend the request over the pages that follow for as long as they have no content of their
+  // own. Anything already present, including markers and compressed pages, ends the run. Only read
+  // the pages ahead; they get forked on a later write fault like any other pager-backed page.
+  const uint64_t end = ROUNDUP_PAGE_SIZE(offset + new_len);
+  pf_flags &= ~VMM_PF_FLAG_WRITE;
+  zx_status_t status = ZX_ERR_NEXT;
+  for (uint64_t cur = offset + PAGE_SIZE; cur < end; cur += PAGE_SIZE) {
+    const VmPageOrMarker* p = page_list_.Lookup(cur);
+    if (p && !p->IsEmpty()) {
+      break;
+    }
+    status = GetPageLocked(cur, pf_flags, nullptr, page_request, nullptr, nullptr);
+    if (status != ZX_ERR_NEXT && status != ZX_ERR_SHOULD_WAIT) {
+      // The page came from elsewhere in the hierarchy, so the run ends here.
+      break;
+    }
+    vm_fault_readahead_pages.Add(1);
+    if (status == ZX_ERR_SHOULD_WAIT) {
+      // The page source ended the batch itself and has already sent the request.
+      return status;
+    }
+  }
+
+  fbl::RefPtr<PageSource> root_source = GetRootPageSourceLocked();
+  DEBUG_ASSERT(root_source);
+  return root_source->FinalizeRequest(page_request);
+}
+
+zx_status_t VmObjectPaged::LookupCommittedLocked(uint64_t offset, uint64_t len,
+                                                 vmo_lookup_fn_t lookup_fn, void* context) {
+  canary_.Assert();
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(offset));
+
+  uint64_t new_len;
+  if (!TrimRange(offset, len, size_, &new_len)) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+  if (new_len == 0) {
+    return ZX_OK;
+  }
+
+  if (is_slice()) {
+    uint64_t parent_offset;
+    VmObjectPaged* parent = PagedParentOfSliceLocked(&parent_offset);
+    AssertHeld(parent->lock_);
+    return parent->LookupCommittedLocked(offset + parent_offset, new_len, lookup_fn, context);
+  }
+
+  return page_list_.ForEveryPageInRange(
+      [lookup_fn, context, offset](const auto& p, uint64_t off) {
+        if (!p.IsPage()) {
+          return ZX_ERR_NEXT;
+        }
+        const size_t index = (off - offset) / PAGE_SIZE;
+        zx_status_t status = lookup_fn(context, off, index, p.Page()->paddr());
+        if (status != ZX_OK) {
+          if (unlikely(status == ZX_ERR_NEXT)) {
+            status = ZX_ERR_INTERNAL;
+          }
+          return status;
+        }
+        return ZX_ERR_NEXT;
+      },
+      offset, ROUNDUP_PAGE_SIZE(offset + new_len));
+}
+
+zx_status_t VmObjectPaged::LookupContiguousLocked(uint64_t offset, uint64_t len, paddr_t* pa) {
+  canary_.Assert();
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(offset) && IS_PAGE_ALIGNED(len));
+  DEBUG_ASSERT(pa);
+
+  if (len == 0 || !InRange(offset, len, size_)) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+
+  if (is_slice()) {
+    uint64_t parent_offset;
+    VmObjectPaged* parent = PagedParentOfSliceLocked(&parent_offset);
+    AssertHeld(parent->lock_);
+    return parent->LookupContiguousLocked(offset + parent_offset, len, pa);
+  }
+
+  // Pages from a page source are aged and evicted one at a time, so keep them in small mappings.
+  if (GetRootPageSourceLocked()) {
+    return ZX_ERR_NOT_SUPPORTED;
+  }
+
+  // Every page must be owned by us, rather than shared with a parent, and follow on from the last.
+  paddr_t base = 0;
+  zx_status_t status = page_list_.ForEveryPageAndGapInRange(
+      [offset, &base](const auto& p, uint64_t off) {
+        if (!p.IsPage()) {
+          return ZX_ERR_NOT_FOUND;
+        }
+        const paddr_t page_pa = p.Page()->paddr();
+        if (off == offset) {
+          base = page_pa;
+        } else if (page_pa != base + (off - offset)) {
+          return ZX_ERR_NOT_FOUND;
+        }
+        return ZX_ERR_NEXT;
+      },
+      [](uint64_t gap_start, uint64_t gap_end) { return ZX_ERR_NOT_FOUND; }, offset,
+      offset + len);
+  if (status != ZX_OK) {
+    return status;
+  }
+
+  *pa = base;
+  return ZX_OK;
+}
+
+void VmObjectPaged::CommitLargePagesLocked(uint64_t offset, uint64_t end) {
+  DEBUG_ASSERT(!parent_ && !GetRootPageSourceLocked());
+  DEBUG_ASSERT(cache_policy_ == ARCH_MMU_FLAG_CACHED);
+
+  const uint64_t first_chunk = ROUNDUP(offset, LARGE_PAGE_SIZE);
+  if (first_chunk >= end || end - first_chunk < LARGE_PAGE_SIZE) {
+    return;
+  }
+  // Searching for runs right after one failed to be found is likely to fail again.
+  if (ShouldSkipLargePages()) {
+    vm_large_page_commit_skips.Add(1);
+    return;
+  }
+
+  constexpr size_t kPagesPerLargePage = LARGE_PAGE_SIZE / PAGE_SIZE;
+  for (uint64_t chunk = first_chunk; chunk < end && end - chunk >= LARGE_PAGE_SIZE;
+       chunk += LARGE_PAGE_SIZE) {
+    // Only chunks with nothing at all in them are candidates.
+    bool empty = true;
+    page_list_.ForEveryPageInRange(
+        [&empty](const auto& p, uint64_t off) {
+          empty = false;
+          return ZX_ERR_STOP;
+        },
+        chunk, chunk + LARGE_PAGE_SIZE);
+    if (!empty) {
+      continue;
+    }
+
+    list_node_t pages;
+    list_initialize(&pages);
+    paddr_t pa;
+    if (pmm_alloc_contiguous(kPagesPerLargePage, pmm_alloc_flags_, LARGE_PAGE_SIZE_SHIFT, &pa,
+                             &pages) != ZX_OK) {
+      // Physical memory is too fragmented for a run; leave the rest of the range to be committed a
+      // page at a time rather than searching again for every chunk, and back off later commits.
+      vm_large_page_commit_failures.Add(1);
+      LargePageAllocFailed();
+      return;
+    }
+    LargePageAllocSucceeded();
+
+    for (uint64_t off = chunk; off < chunk + LARGE_PAGE_SIZE; off += PAGE_SIZE) {
+      vm_page_t* p = list_remove_head_type(&pages, vm_page_t, queue_node);
+      DEBUG_ASSERT(p);
+      InitializeVmPage(p);
+      ZeroPage(p);
+      VmPageOrMarker insert = VmPageOrMarker::Page(p);
+      zx_status_t status = AddPageLocked(&insert, off, false);
+      if (status != ZX_OK) {
+        // Only a failure to allocate a page list node can get us here. Keep the pages that made it
+        // in, they are committed like any others.
+        DEBUG_ASSERT(status == ZX_ERR_NO_MEMORY);
+        pmm_free_page(insert.ReleasePage());
+        pmm_free(&pages);
+        RangeChangeUpdateLocked(chunk, off - chunk, RangeChangeOp::Unmap);
+        return;
+      }
+    }
+    // Any mapping of this range could only have been of the zero page.
+    RangeChangeUpdateLocked(chunk, LARGE_PAGE_SIZE, RangeChangeOp::Unmap);
+    vm_large_page_commits.Add(1);
+  }
+}
+
+void VmObjectPaged::CommitZeroPagesLocked(uint64_t offset, uint64_t end, list_node* page_list) {
+  DEBUG_ASSERT(!parent_ && !GetRootPageSourceLocked());
+  DEBUG_ASSERT(end <= size_);
+
+  const uint64_t offset_start = offset;
+  bool inserted = false;
+  while (offset < end) {
+    size_t count;
+    VmPageOrMarker* slots = page_list_.LookupOrAllocateRun(offset, end, &count);
+    if (!slots) {
+      // Leave the rest of the range to the page at a time path, which reports the failure.
+      break;
+    }
+    for (size_t i = 0; i < count; i++, offset += PAGE_SIZE) {
+      VmPageOrMarker* slot = &slots[i];
+      // Compressed pages have content of their own, and are expanded by GetPageLocked.
+      if (slot->IsPage() || slot->IsReference()) {
+        continue;
+      }
+      vm_page_t* p = list_remove_head_type(page_list, vm_page_t, queue_node);
+      DEBUG_ASSERT(p);
+      if (!(p->flags & VM_PAGE_FLAG_ZEROED)) {
+        ZeroPage(p);
+      }
+      InitializeVmPage(p);
+      SetNotWired(p, offset);
+      // As in GetPageLocked, flush the zeroes for uncached objects.
+      if (cache_policy_ != ARCH_MMU_FLAG_CACHED) {
+        arch_clean_invalidate_cache_range((vaddr_t)paddr_to_physmap(p->paddr()), PAGE_SIZE);
+      }
+      *slot = VmPageOrMarker::Page(p);
+      inserted = true;
+    }
+  }
+
+  // Any mapping of this range could only have been of the zero page.
+  if (inserted) {
+    RangeChangeUpdateLocked(offset_start, end - offset_start, RangeChangeOp::Unmap);
+  }
+}
+
 zx_status_t VmObjectPaged::CommitRangeInternal(uint64_t offset, uint64_t len, bool pin,
                                                Guard<Mutex>&& adopt) {
   canary_.Assert();
@@ -1977,6 +2290,14 @@ zx_status_t VmObjectPaged::CommitRangeInternal(uint64_t offset, uint64_t len, bo
   list_node page_list;
   list_initialize(&page_list);
   if (root_source == nullptr) {
+    // Where whole large pages are being committed to a vmo that asked for them, try to back them
+    // with contiguous runs so that they can later be mapped with a single entry each. This is opt
+    // in, as it uses up the aligned runs that contiguous vmos need.
+    if ((options_ & kLargePages) && !parent_ && !is_contiguous() &&
+        cache_policy_ == ARCH_MMU_FLAG_CACHED) {
+      CommitLargePagesLocked(offset, end);
+    }
+
     // make a pass through the list to find out how many pages we need to allocate
     size_t count = (end - offset) / PAGE_SIZE;
     page_list_.ForEveryPageInRange(
@@ -1992,10 +2313,17 @@ zx_status_t VmObjectPaged::CommitRangeInternal(uint64_t offset, uint64_t len, bo
       return ZX_OK;
     }
 
-    zx_status_t status = pmm_alloc_pages(count, pmm_alloc_flags_, &page_list);
+    // Without a parent every new page is zero filled, so take pages from the zero pool if it has
+    // any and fill in whole page list nodes at a time.
+    const uint32_t alloc_flags =
+        parent_ ? pmm_alloc_flags_ : (pmm_alloc_flags_ | PMM_ALLOC_FLAG_ZEROED);
+    zx_status_t status = pmm_alloc_pages(count, alloc_flags, &page_list);
     if (status != ZX_OK) {
       return status;
     }
+    if (!parent_) {
+      CommitZeroPagesLocked(offset, end, &page_list);
+    }
   }
 
   auto list_cleanup = fbl::MakeAutoCall([&page_list]() {
@@ -2223,8 +2551,8 @@ zx_status_t VmObjectPaged::ZeroPartialPage(uint64_t page_base_offset, uint64_t z
     // This is already considered zero so no need to redundantly zero again.
     return ZX_OK;
   }
-  // If we don't have a committed page we need to check our parent.
-  if (!slot || !slot->IsPage()) {
+  // If we don't have a committed or compressed page we need to check our parent.
+  if (!slot || (!slot->IsPage() && !slot->IsReference())) {
     VmObjectPaged* page_owner;
     uint64_t owner_offset;
     if (!FindInitialPageContentLocked(page_base_offset, VMM_PF_FLAG_WRITE, &page_owner,
@@ -2420,6 +2748,8 @@ zx_status_t VmObjectPaged::ZeroRangeLocked(uint64_t offset, uint64_t len, list_n
         pmm_page_queues()->Remove(page);
         DEBUG_ASSERT(!list_in_list(&page->queue_node));
         list_add_tail(free_list, &page->queue_node);
+      } else if (slot && slot->IsReference()) {
+        VmCompressedPage::Free(page_list_.RemovePage(offset).ReleaseReference());
       }
       continue;
     }
@@ -3041,12 +3371,21 @@ zx_status_t VmObjectPaged::Lookup(uint64_t offset, uint64_t len, vmo_lookup_fn_t
   const uint64_t end_page_offset = ROUNDUP(offset + len, PAGE_SIZE);
 
   zx_status_t status = page_list_.ForEveryPageAndGapInRange(
-      [lookup_fn, context, start_page_offset](const auto& p, uint64_t off) {
+      [this, lookup_fn, context, start_page_offset](const auto& p, uint64_t off) {
         if (p.IsMarker()) {
           return ZX_ERR_NO_MEMORY;
         }
         const size_t index = (off - start_page_offset) / PAGE_SIZE;
-        paddr_t pa = p.Page()->paddr();
+        paddr_t pa;
+        if (p.IsReference()) {
+          // Compressed pages have no physical address until GetPageLocked expands them in place.
+          AssertHeld(this->lock_);
+          if (this->GetPageLocked(off, 0, nullptr, nullptr, nullptr, &pa) != ZX_OK) {
+            return ZX_ERR_NO_MEMORY;
+          }
+        } else {
+          pa = p.Page()->paddr();
+        }
         zx_status_t status = lookup_fn(context, off, index, pa);
         if (status != ZX_OK) {
           if (unlikely(status == ZX_ERR_NEXT || status == ZX_ERR_STOP)) {
@@ -3171,6 +3510,12 @@ zx_status_t VmObjectPaged::TakePages(uint64_t offset, uint64_t len, VmPageSplice
     return ZX_ERR_BAD_STATE;
   }
 
+  // The destination of the splice is pager backed, and so cannot hold compressed pages.
+  zx_status_t status = DecompressAllLocked();
+  if (status != ZX_OK) {
+    return status;
+  }
+
   page_list_.ForEveryPageInRange(
       [](const auto& p, uint64_t off) {
         if (p.IsPage()) {
@@ -3329,6 +3674,12 @@ zx_status_t VmObjectPaged::SetMappingCachePolicy(const uint32_t cache_policy) {
   // If transitioning from a cached policy we must clean/invalidate all the pages as the kernel may
   // have written to them on behalf of the user.
   if (cache_policy_ == ARCH_MMU_FLAG_CACHED && cache_policy != ARCH_MMU_FLAG_CACHED) {
+    // Compressed pages are decompressed through the cached physmap, so expand them now whilst
+    // that is still valid and let them be cleaned below.
+    zx_status_t status = DecompressAllLocked();
+    if (status != ZX_OK) {
+      return status;
+    }
     page_list_.ForEveryPage([](const auto& p, uint64_t off) {
       if (p.IsPage()) {
         vm_page_t* page = p.Page();
@@ -3463,3 +3814,129 @@ bool VmObjectPaged::EvictPage(vm_page_t* page, uint64_t offset) {
   // |page| is now owned by the caller.
   return true;
 }
+
+bool VmObjectPaged::CanCompressLocked() const {
+  // Compressed pages only live in VMOs that are the sole owner of their content. This avoids every
+  // clone chain and page source path from having to understand them, and those VMOs are
+  // decompressed before they can gain children.
+  if (page_source_ || parent_ || children_list_len_ > 0 || is_hidden() || is_contiguous()) {
+    return false;
+  }
+
+  // Skip uncached VMOs as their pages cannot be efficiently read through the physmap.
+  if ((cache_policy_ & ZX_CACHE_POLICY_MASK) != ZX_CACHE_POLICY_CACHED) {
+    return false;
+  }
+
+  // As with zero page de-duplication, kernel mappings indicate the VMO is in use by the kernel and
+  // we cannot safely remove its pages.
+  for (auto& m : mapping_list_) {
+    if (!m.aspace()->is_user()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool VmObjectPaged::CompressPage(vm_page_t* page, uint64_t offset) {
+  Guard<Mutex> guard{&lock_};
+
+  if (!CanCompressLocked()) {
+    return false;
+  }
+
+  // Check this page is still a part of this VMO.
+  VmPageOrMarker* page_or_marker = page_list_.Lookup(offset);
+  if (!page_or_marker || !page_or_marker->IsPage() || page_or_marker->Page() != page ||
+      page->object.pin_count > 0) {
+    return false;
+  }
+
+  // Give pages that have been accessed since the last time we looked a second chance. Harvesting
+  // clears the accessed bits, so the page becomes a candidate again if it is left alone.
+  bool accessed = false;
+  fbl::Function<bool(vm_page_t*, uint64_t)> f = [&accessed](vm_page_t*, uint64_t) {
+    accessed = true;
+    return true;
+  };
+  for (auto& m : mapping_list_) {
+    AssertHeld(*m.object_lock());
+    __UNUSED zx_status_t result = m.HarvestAccessVmoRangeLocked(offset, PAGE_SIZE, f);
+    DEBUG_ASSERT(result == ZX_OK);
+  }
+  if (accessed) {
+    return false;
+  }
+
+  // Prevent the page from being modified whilst we compress it, but leave read mappings in place
+  // so that we only pay for an unmap if the compression is worthwhile.
+  RangeChangeUpdateLocked(offset, PAGE_SIZE, RangeChangeOp::RemoveWrite);
+
+  VmCompressedPage* compressed = VmCompressedPage::Compress(paddr_to_physmap(page->paddr()));
+  if (!compressed) {
+    return false;
+  }
+
+  RangeChangeUpdateLocked(offset, PAGE_SIZE, RangeChangeOp::Unmap);
+  vm_page_t* p = page_or_marker->ReleasePage();
+  DEBUG_ASSERT(p == page);
+  pmm_page_queues()->Remove(page);
+  *page_or_marker = VmPageOrMarker::Reference(compressed);
+  has_compressed_pages_ = true;
+
+  // |page| is now owned by the caller.
+  return true;
+}
+
+zx_status_t VmObjectPaged::DecompressPageLocked(VmPageOrMarker* slot, uint64_t offset,
+                                                list_node_t* free_list) {
+  DEBUG_ASSERT(slot->IsReference());
+  DEBUG_ASSERT(cache_policy_ == ARCH_MMU_FLAG_CACHED);
+
+  vm_page_t* page = nullptr;
+  paddr_t pa;
+  if (free_list) {
+    page = list_remove_head_type(free_list, vm_page, queue_node);
+    if (page) {
+      pa = page->paddr();
+    }
+  }
+  if (!page) {
+    zx_status_t status = pmm_alloc_page(pmm_alloc_flags_, &page, &pa);
+    if (status != ZX_OK) {
+      return status;
+    }
+  }
+  InitializeVmPage(page);
+
+  VmCompressedPage* compressed = slot->ReleaseReference();
+  compressed->Decompress(paddr_to_physmap(pa));
+  VmCompressedPage::Free(compressed);
+  *slot = VmPageOrMarker::Page(page);
+
+  // The page holds data, so it goes in the regular unswappable queue rather than the zero fork one,
+  // which the zero page scanner walks. It keeps its backlink so that it can be compressed again.
+  pmm_page_queues()->SetUnswappableBacklinked(page, this, offset);
+  return ZX_OK;
+}
+
+zx_status_t VmObjectPaged::DecompressAllLocked() {
+  if (!has_compressed_pages_) {
+    return ZX_OK;
+  }
+  zx_status_t status = page_list_.ForEveryPage([this](auto& p, uint64_t off) -> zx_status_t {
+    if (p.IsReference()) {
+      AssertHeld(this->lock_);
+      zx_status_t result = DecompressPageLocked(&p, off, nullptr);
+      if (result != ZX_OK) {
+        return result;
+      }
+    }
+    return ZX_ERR_NEXT;
+  });
+  if (status != ZX_OK) {
+    return status;
+  }
+  has_compressed_pages_ = false;
+  return ZX_OK;
+}
@@ -206,6 +206,18 @@ zx_status_t VmObjectPhysical::Lookup(uint64_t offset, uint64_t len, vmo_lookup_f
   return ZX_OK;
 }
 
+zx_status_t VmObjectPhysical::LookupContiguousLocked(uint64_t offset, uint64_t len, paddr_t* pa) {
+  canary_.Assert();
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(offset) && IS_PAGE_ALIGNED(len));
+
+  if (len == 0 || !InRange(offset, len, size_)) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+
+  *pa = base_ + offset;
+  return ZX_OK;
+}
+
 uint32_t VmObjectPhysical::GetMappingCachePolicy() const {
   Guard<Mutex> guard{&lock_};
 
@@ -12,6 +12,7 @@
 #include <zircon/types.h>
 
 #include <fbl/alloc_checker.h>
+#include <ktl/algorithm.h>
 #include <ktl/move.h>
 #include <vm/pmm.h>
 #include <vm/vm.h>
@@ -103,6 +104,22 @@ VmPageOrMarker* VmPageList::LookupOrAllocate(uint64_t offset) {
   return &p;
 }
 
+VmPageOrMarker* VmPageList::LookupOrAllocateRun(uint64_t offset, uint64_t end_offset,
+                                                size_t* count) {
+  DEBUG_ASSERT(IS_PAGE_ALIGNED(offset) && IS_PAGE_ALIGNED(end_offset));
+  DEBUG_ASSERT(offset < end_offset);
+
+  VmPageOrMarker* slot = LookupOrAllocate(offset);
+  if (!slot) {
+    return nullptr;
+  }
+  // The slots of a node are stored contiguously, so the run extends to the end of the node.
+  const size_t index = offset_to_node_index(offset, list_skew_);
+  *count = ktl::min<uint64_t>(VmPageListNode::kPageFanOut - index,
+                              (end_offset - offset) / PAGE_SIZE);
+  return slot;
+}
+
 VmPageOrMarker* VmPageList::Lookup(uint64_t offset) {
   uint64_t node_offset = offset_to_node_offset(offset, list_skew_);
   size_t index = offset_to_node_index(offset, list_skew_);
@@ -150,7 +167,7 @@ VmPageOrMarker VmPageList::RemovePage(uint64_t offset) {
 
   // free this page
   VmPageOrMarker page = ktl::move(pln->Lookup(index));
-  if (page.IsPage() && pln->IsEmpty()) {
+  if ((page.IsPage() || page.IsReference()) && pln->IsEmpty()) {
     // if it was the last page in the node, remove the node from the tree
     LTRACEF_LEVEL(2, "%p freeing the list node\n", this);
     list_.erase(*pln);
@@ -350,6 +367,8 @@ void VmPageSpliceList::FreeAllPages() {
     VmPageOrMarker page = Pop();
     if (page.IsPage()) {
       pmm_free_page(page.ReleasePage());
+    } else if (page.IsReference()) {
+      VmCompressedPage::Free(page.ReleaseReference());
     }
   }
 }
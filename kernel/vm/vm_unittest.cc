@@ -7,9 +7,11 @@
 #include <align.h>
 #include <assert.h>
 #include <err.h>
+#include <inttypes.h>
 #include <lib/instrumentation/asan.h>
 #include <lib/unittest/unittest.h>
 #include <lib/unittest/user_memory.h>
+#include <platform.h>
 #include <zircon/types.h>
 
 #include <arch/kernel_aspace.h>
@@ -19,6 +21,7 @@
 #include <fbl/auto_call.h>
 #include <fbl/vector.h>
 #include <kernel/semaphore.h>
+#include <kernel/thread.h>
 #include <ktl/algorithm.h>
 #include <ktl/iterator.h>
 #include <ktl/move.h>
@@ -32,6 +35,7 @@
 #include <vm/vm_aspace.h>
 #include <vm/vm_object.h>
 #include <vm/vm_object_paged.h>
+#include <vm/vm_page_list.h>
 #include <vm/vm_object_physical.h>
 
 #include "pmm_node.h"
@@ -639,6 +643,215 @@ static bool pmm_node_delayed_alloc_clear_late_test() {
   return pmm_node_delayed_alloc_clear_test_helper(false);
 }
 
+// Checks that single page allocations and frees through the per-CPU caches keep the free count and
+// the memory availability state consistent with the uncached behavior.
+static bool pmm_node_cpu_cache_test() {
+  BEGIN_TEST;
+  ManagedPmmNode node;
+  ASSERT_EQ(ZX_OK, node.node().EnableCpuCaches());
+  list_node list = LIST_INITIAL_VALUE(list);
+
+  uint64_t free_pages = ManagedPmmNode::kNumPages;
+  while (free_pages > 0) {
+    vm_page_t* page;
+    zx_status_t status = node.node().AllocPage(0, &page, nullptr);
+    ASSERT_EQ(ZX_OK, status);
+    list_add_tail(&list, &page->queue_node);
+    free_pages--;
+
+    EXPECT_EQ(free_pages, node.node().CountFreePages());
+    uint8_t expected =
+        free_pages > ManagedPmmNode::kDefaultWatermark - ManagedPmmNode::kDefaultDebounce;
+    EXPECT_EQ(expected, node.cur_level());
+  }
+
+  vm_page_t* page;
+  zx_status_t status = node.node().AllocPage(PMM_ALLOC_DELAY_OK, &page, nullptr);
+  EXPECT_EQ(ZX_ERR_NO_MEMORY, status);
+
+  while (!list_is_empty(&list)) {
+    node.node().FreePage(list_remove_head_type(&list, vm_page_t, queue_node));
+    free_pages++;
+
+    EXPECT_EQ(free_pages, node.node().CountFreePages());
+    // Leaving the OOM state is exact since the caches are bypassed while in it.
+    if (free_pages < ManagedPmmNode::kDefaultWatermark + ManagedPmmNode::kDefaultDebounce) {
+      EXPECT_EQ(0, node.cur_level());
+    } else {
+      EXPECT_EQ(1, node.cur_level());
+    }
+  }
+
+  // Pages held in the caches must still be available to multi-page allocations.
+  node.node().DrainCpuCaches();
+  EXPECT_EQ(ManagedPmmNode::kNumPages, node.node().CountFreePages());
+
+  END_TEST;
+}
+
+static bool page_is_zero(vm_page_t* page) {
+  auto base = static_cast<const uint64_t*>(paddr_to_physmap(page->paddr()));
+  for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+    if (base[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks that the zero pool fills in the background without changing the free count, and that
+// zeroed allocations are served from it.
+static bool pmm_node_zero_pool_test() {
+  BEGIN_TEST;
+  constexpr uint64_t kPoolPages = 16;
+  ManagedPmmNode node;
+  node.node().EnableZeroPool(kPoolPages);
+  // The node destructor needs every page back on the free list.
+  auto disable = fbl::MakeAutoCall([&node] { node.node().DisableZeroPool(); });
+
+  while (node.node().CountZeroedPages() < kPoolPages) {
+    Thread::Current::SleepRelative(ZX_MSEC(1));
+  }
+  EXPECT_EQ(ManagedPmmNode::kNumPages, node.node().CountFreePages());
+
+  list_node list = LIST_INITIAL_VALUE(list);
+  vm_page_t* page;
+  ASSERT_EQ(ZX_OK, node.node().AllocPage(PMM_ALLOC_FLAG_ZEROED, &page, nullptr));
+  list_add_tail(&list, &page->queue_node);
+  ASSERT_EQ(ZX_OK, node.node().AllocPages(4, PMM_ALLOC_FLAG_ZEROED, &list));
+  // The pool is only refilled once it drops below half of its target.
+  EXPECT_EQ(kPoolPages - 5, node.node().CountZeroedPages());
+  EXPECT_EQ(ManagedPmmNode::kNumPages - 5, node.node().CountFreePages());
+
+  list_for_every_entry (&list, page, vm_page_t, queue_node) {
+    EXPECT_TRUE(page->flags & VM_PAGE_FLAG_ZEROED);
+    EXPECT_TRUE(page_is_zero(page));
+    // Dirty the page to check that it is not put back in the pool when freed.
+    memset(paddr_to_physmap(page->paddr()), 0xff, PAGE_SIZE);
+  }
+
+  node.node().FreeList(&list);
+  EXPECT_EQ(ManagedPmmNode::kNumPages, node.node().CountFreePages());
+
+  // Allocating every page drains the pool and zeroes the rest, including the dirtied pages.
+  ASSERT_EQ(ZX_OK,
+            node.node().AllocPages(ManagedPmmNode::kNumPages, PMM_ALLOC_FLAG_ZEROED, &list));
+  EXPECT_EQ(0u, node.node().CountZeroedPages());
+  list_for_every_entry (&list, page, vm_page_t, queue_node) {
+    EXPECT_TRUE(page->flags & VM_PAGE_FLAG_ZEROED);
+    EXPECT_TRUE(page_is_zero(page));
+  }
+  node.node().FreeList(&list);
+
+  disable.call();
+  EXPECT_EQ(0u, node.node().CountZeroedPages());
+  EXPECT_EQ(ManagedPmmNode::kNumPages, node.node().CountFreePages());
+
+  END_TEST;
+}
+
+// Checks that pages taken from the zero pool by allocations that did not ask for zeroed pages are
+// not reported as zeroed.
+static bool pmm_node_zero_pool_unzeroed_alloc_test() {
+  BEGIN_TEST;
+  constexpr uint64_t kPoolPages = 16;
+  ManagedPmmNode node;
+  node.node().EnableZeroPool(kPoolPages);
+  auto disable = fbl::MakeAutoCall([&node] { node.node().DisableZeroPool(); });
+
+  while (node.node().CountZeroedPages() < kPoolPages) {
+    Thread::Current::SleepRelative(ZX_MSEC(1));
+  }
+
+  // Allocating every page takes the pool too.
+  list_node list = LIST_INITIAL_VALUE(list);
+  ASSERT_EQ(ZX_OK, node.node().AllocPages(ManagedPmmNode::kNumPages, 0, &list));
+  EXPECT_EQ(0u, node.node().CountZeroedPages());
+  vm_page_t* page;
+  list_for_every_entry (&list, page, vm_page_t, queue_node) {
+    EXPECT_FALSE(page->flags & VM_PAGE_FLAG_ZEROED);
+  }
+  node.node().FreeList(&list);
+
+  disable.call();
+  EXPECT_EQ(ManagedPmmNode::kNumPages, node.node().CountFreePages());
+
+  END_TEST;
+}
+
+struct PmmAllocThroughputArgs {
+  size_t iterations;
+  size_t batch;
+  zx_status_t status;
+};
+
+static int pmm_alloc_throughput_worker(void* arg) {
+  auto args = static_cast<PmmAllocThroughputArgs*>(arg);
+  vm_page_t* pages[16];
+  DEBUG_ASSERT(args->batch <= ktl::size(pages));
+
+  args->status = ZX_OK;
+  for (size_t i = 0; i < args->iterations; i++) {
+    for (size_t j = 0; j < args->batch; j++) {
+      zx_status_t status = pmm_alloc_page(0, &pages[j]);
+      if (status != ZX_OK) {
+        args->status = status;
+        for (size_t k = 0; k < j; k++) {
+          pmm_free_page(pages[k]);
+        }
+        return 0;
+      }
+    }
+    for (size_t j = 0; j < args->batch; j++) {
+      pmm_free_page(pages[j]);
+    }
+  }
+  return 0;
+}
+
+// Measures single page allocation throughput of the system pmm with an increasing number of
+// threads allocating and freeing concurrently.
+static bool pmm_alloc_throughput_test() {
+  BEGIN_TEST;
+
+  constexpr size_t kIterations = 4096;
+  constexpr size_t kBatch = 16;
+  const uint max_threads = arch_max_num_cpus();
+
+  fbl::AllocChecker ac;
+  fbl::Array<PmmAllocThroughputArgs> args(new (&ac) PmmAllocThroughputArgs[max_threads],
+                                          max_threads);
+  ASSERT_TRUE(ac.check());
+  fbl::Array<Thread*> threads(new (&ac) Thread*[max_threads], max_threads);
+  ASSERT_TRUE(ac.check());
+
+  for (uint num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    for (uint i = 0; i < num_threads; i++) {
+      args[i] = {kIterations, kBatch, ZX_ERR_INTERNAL};
+      threads[i] = Thread::Create("pmm alloc worker", pmm_alloc_throughput_worker, &args[i],
+                                  DEFAULT_PRIORITY);
+      ASSERT_NONNULL(threads[i]);
+    }
+
+    const zx_time_t start = current_time();
+    for (uint i = 0; i < num_threads; i++) {
+      threads[i]->Resume();
+    }
+    for (uint i = 0; i < num_threads; i++) {
+      threads[i]->Join(nullptr, ZX_TIME_INFINITE);
+      EXPECT_EQ(ZX_OK, args[i].status);
+    }
+    const uint64_t elapsed = ktl::max<zx_duration_t>(zx_time_sub_time(current_time(), start), 1);
+
+    const uint64_t pages = num_threads * kIterations * kBatch;
+    unittest_printf("%u threads: %" PRIu64 " page alloc/free pairs in %" PRIu64
+                    " ns (%" PRIu64 " per second)\n",
+                    num_threads, pages, elapsed, pages * ZX_SEC(1) / elapsed);
+  }
+
+  END_TEST;
+}
+
 static bool pmm_checker_test_with_fill_size(size_t fill_size) {
   BEGIN_TEST;
 
@@ -2060,6 +2273,179 @@ static bool vmo_eviction_test() {
   END_TEST;
 }
 
+static bool vmo_compression_test() {
+  BEGIN_TEST;
+  AutoVmScannerDisable scanner_disable;
+
+  fbl::RefPtr<VmObject> vmo;
+  zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, PAGE_SIZE, &vmo);
+  ASSERT_EQ(ZX_OK, status);
+  VmObjectPaged* paged = VmObjectPaged::AsVmObjectPaged(vmo);
+  ASSERT_NONNULL(paged);
+
+  fbl::AllocChecker ac;
+  fbl::Array<uint8_t> expected(new (&ac) uint8_t[PAGE_SIZE], PAGE_SIZE);
+  ASSERT_TRUE(ac.check());
+  fbl::Array<uint8_t> actual(new (&ac) uint8_t[PAGE_SIZE], PAGE_SIZE);
+  ASSERT_TRUE(ac.check());
+
+  // A repeating pattern should compress well.
+  for (size_t i = 0; i < PAGE_SIZE; i++) {
+    expected[i] = static_cast<uint8_t>(i % 37);
+  }
+  EXPECT_EQ(ZX_OK, vmo->Write(expected.data(), 0, PAGE_SIZE));
+  vm_page_t* page;
+  EXPECT_EQ(ZX_OK, vmo->GetPage(0, 0, nullptr, nullptr, &page, nullptr));
+
+  // Wrong offset, or wrong page, should not be compressed.
+  EXPECT_FALSE(paged->CompressPage(page, PAGE_SIZE));
+  EXPECT_FALSE(paged->CompressPage(vm_get_zero_page(), 0));
+
+  // Compression should drop the number of committed pages, and reading should transparently bring
+  // back the original contents.
+  EXPECT_EQ(1u, vmo->AttributedPages());
+  EXPECT_TRUE(paged->CompressPage(page, 0));
+  EXPECT_EQ(0u, vmo->AttributedPages());
+  pmm_free_page(page);
+  EXPECT_EQ(ZX_OK, vmo->Read(actual.data(), 0, PAGE_SIZE));
+  EXPECT_EQ(0, memcmp(expected.data(), actual.data(), PAGE_SIZE));
+  EXPECT_EQ(1u, vmo->AttributedPages());
+
+  // The decompressed page holds data, so it is not left for the zero page scanner.
+  EXPECT_EQ(ZX_OK, vmo->GetPage(0, 0, nullptr, nullptr, &page, nullptr));
+  EXPECT_TRUE(pmm_page_queues()->DebugPageIsUnswappable(page));
+
+  // Clones must see the original contents, as the parent is decompressed before sharing.
+  EXPECT_EQ(ZX_OK, vmo->GetPage(0, 0, nullptr, nullptr, &page, nullptr));
+  EXPECT_TRUE(paged->CompressPage(page, 0));
+  pmm_free_page(page);
+  fbl::RefPtr<VmObject> clone;
+  status =
+      vmo->CreateClone(Resizability::NonResizable, CloneType::Snapshot, 0, PAGE_SIZE, true, &clone);
+  ASSERT_EQ(ZX_OK, status);
+  memset(actual.data(), 0, PAGE_SIZE);
+  EXPECT_EQ(ZX_OK, clone->Read(actual.data(), 0, PAGE_SIZE));
+  EXPECT_EQ(0, memcmp(expected.data(), actual.data(), PAGE_SIZE));
+
+  // Pages in a VMO with children are not candidates.
+  EXPECT_EQ(ZX_OK, vmo->GetPage(0, 0, nullptr, nullptr, &page, nullptr));
+  EXPECT_FALSE(paged->CompressPage(page, 0));
+  clone.reset();
+
+  // Random data should be rejected as incompressible.
+  fbl::RefPtr<VmObject> vmo2;
+  status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, PAGE_SIZE, &vmo2);
+  ASSERT_EQ(ZX_OK, status);
+  fill_region(99, expected.data(), PAGE_SIZE);
+  EXPECT_EQ(ZX_OK, vmo2->Write(expected.data(), 0, PAGE_SIZE));
+  EXPECT_EQ(ZX_OK, vmo2->GetPage(0, 0, nullptr, nullptr, &page, nullptr));
+  EXPECT_FALSE(VmObjectPaged::AsVmObjectPaged(vmo2)->CompressPage(page, 0));
+
+  // Pinned pages should not be compressible.
+  EXPECT_EQ(ZX_OK, vmo->CommitRangePinned(0, PAGE_SIZE));
+  EXPECT_EQ(ZX_OK, vmo->GetPage(0, 0, nullptr, nullptr, &page, nullptr));
+  EXPECT_FALSE(paged->CompressPage(page, 0));
+  vmo->Unpin(0, PAGE_SIZE);
+
+  END_TEST;
+}
+
+// Faulting on one page of a mapping should also map the committed pages around it.
+static bool vmo_fault_around_test() {
+  BEGIN_TEST;
+
+  AutoVmScannerDisable scanner_disable;
+
+  constexpr size_t kFanOut = VmPageListNode::kPageFanOut;
+  fbl::RefPtr<VmObject> vmo;
+  zx_status_t status =
+      VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, 2 * kFanOut * PAGE_SIZE, &vmo);
+  ASSERT_EQ(ZX_OK, status);
+
+  // Commit the first half of the first window, and one page in the second window.
+  EXPECT_EQ(ZX_OK, vmo->CommitRange(0, kFanOut / 2 * PAGE_SIZE));
+  EXPECT_EQ(ZX_OK, vmo->CommitRange((kFanOut + 1) * PAGE_SIZE, PAGE_SIZE));
+
+  auto mem = testing::UserMemory::Create(vmo);
+  ASSERT_NONNULL(mem);
+  const auto& user_aspace = mem->aspace();
+
+  EXPECT_EQ(ZX_OK, user_aspace->SoftFault(mem->base() + PAGE_SIZE, 0u));
+
+  // Every committed page in the window of the fault should now be mapped, and nothing else.
+  for (size_t i = 0; i < 2 * kFanOut; i++) {
+    const bool expect_mapped = i < kFanOut / 2;
+    status = user_aspace->arch_aspace().Query(mem->base() + i * PAGE_SIZE, nullptr, nullptr);
+    EXPECT_EQ(expect_mapped ? ZX_OK : ZX_ERR_NOT_FOUND, status);
+  }
+
+  END_TEST;
+}
+
+// Tests that a committed large page vmo backed by a contiguous run is mapped with large pages in a
+// user aspace, and that changing one page of it leaves the rest of the pages where they were.
+static bool vmo_large_page_test() {
+  BEGIN_TEST;
+
+  AutoVmScannerDisable scanner_disable;
+
+  constexpr size_t kPages = LARGE_PAGE_SIZE / PAGE_SIZE;
+  fbl::RefPtr<VmObject> vmo;
+  zx_status_t status =
+      VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, VmObjectPaged::kLargePages, LARGE_PAGE_SIZE, &vmo);
+  ASSERT_EQ(ZX_OK, status);
+  ASSERT_EQ(ZX_OK, vmo->CommitRange(0, LARGE_PAGE_SIZE));
+
+  // Whether the commit got a contiguous run depends on how fragmented memory is.
+  paddr_t base = 0;
+  auto contiguous = [](void* ctx, size_t offset, size_t index, paddr_t pa) -> zx_status_t {
+    paddr_t* base = static_cast<paddr_t*>(ctx);
+    if (index == 0) {
+      *base = pa;
+      return IS_ALIGNED(pa, LARGE_PAGE_SIZE) ? ZX_OK : ZX_ERR_NOT_FOUND;
+    }
+    return pa == *base + index * PAGE_SIZE ? ZX_OK : ZX_ERR_NOT_FOUND;
+  };
+  if (vmo->Lookup(0, LARGE_PAGE_SIZE, contiguous, &base) != ZX_OK) {
+    unittest_printf("no contiguous run for large page, skipping\n");
+    END_TEST;
+  }
+
+  // Large pages are only used in user aspaces, where a dropped block can be faulted back in.
+  fbl::RefPtr<VmAspace> aspace = VmAspace::Create(0, "test aspace");
+  ASSERT_NONNULL(aspace, "VmAspace::Create pointer");
+  void* ptr;
+  status = aspace->MapObjectInternal(vmo, "test", 0, LARGE_PAGE_SIZE, &ptr, LARGE_PAGE_SIZE_SHIFT,
+                                     VmAspace::VMM_FLAG_COMMIT, kArchRwFlags);
+  ASSERT_EQ(ZX_OK, status, "mapping object");
+  const vaddr_t va = reinterpret_cast<vaddr_t>(ptr);
+  EXPECT_TRUE(IS_ALIGNED(va, LARGE_PAGE_SIZE));
+
+  for (size_t i = 0; i < kPages; i++) {
+    paddr_t pa;
+    EXPECT_EQ(ZX_OK, aspace->arch_aspace().Query(va + i * PAGE_SIZE, &pa, nullptr));
+    EXPECT_EQ(base + i * PAGE_SIZE, pa);
+  }
+
+  // Decommitting a page unmaps it. Depending on the arch the rest of the large page is either split
+  // off or unmapped too, but none of it may end up pointing anywhere else.
+  EXPECT_EQ(ZX_OK, vmo->DecommitRange(PAGE_SIZE, PAGE_SIZE));
+  for (size_t i = 0; i < kPages; i++) {
+    paddr_t pa;
+    status = aspace->arch_aspace().Query(va + i * PAGE_SIZE, &pa, nullptr);
+    if (i == 1) {
+      EXPECT_EQ(ZX_ERR_NOT_FOUND, status);
+    } else if (status == ZX_OK) {
+      EXPECT_EQ(base + i * PAGE_SIZE, pa);
+    } else {
+      EXPECT_EQ(ZX_ERR_NOT_FOUND, status);
+    }
+  }
+
+  EXPECT_EQ(ZX_OK, aspace->Destroy());
+  END_TEST;
+}
+
 // TODO(ZX-1431): The ARM code's error codes are always ZX_ERR_INTERNAL, so
 // special case that.
 #if ARCH_ARM64
@@ -3317,6 +3703,9 @@ VM_UNITTEST(vmo_clone_removes_write_test)
 VM_UNITTEST(vmo_zero_scan_test)
 VM_UNITTEST(vmo_move_pages_on_access_test)
 VM_UNITTEST(vmo_eviction_test)
+VM_UNITTEST(vmo_compression_test)
+VM_UNITTEST(vmo_fault_around_test)
+VM_UNITTEST(vmo_large_page_test)
 VM_UNITTEST(arch_noncontiguous_map)
 VM_UNITTEST(vm_kernel_region_test)
 VM_UNITTEST(region_list_get_alloc_spot_test)
@@ -3345,6 +3734,10 @@ VM_UNITTEST(pmm_node_delayed_alloc_swap_early_test)
 VM_UNITTEST(pmm_node_delayed_alloc_swap_late_test)
 VM_UNITTEST(pmm_node_delayed_alloc_clear_early_test)
 VM_UNITTEST(pmm_node_delayed_alloc_clear_late_test)
+VM_UNITTEST(pmm_node_cpu_cache_test)
+VM_UNITTEST(pmm_node_zero_pool_test)
+VM_UNITTEST(pmm_node_zero_pool_unzeroed_alloc_test)
+VM_UNITTEST(pmm_alloc_throughput_test)
 VM_UNITTEST(pmm_checker_test)
 VM_UNITTEST(pmm_checker_is_valid_fill_size_test)
 VM_UNITTEST(pmm_get_arena_info_test)
@@ -0,0 +1,54 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSROOT_ZIRCON_SYSCALLS_FIFO_H_
+#define SYSROOT_ZIRCON_SYSCALLS_FIFO_H_
+
+#include <stdint.h>
+#include <zircon/compiler.h>
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// Layout of the VMO returned by zx_fifo_get_vmo() for a fifo created with
+// ZX_FIFO_SHARED_RING.
+//
+// The first page holds one zx_fifo_ring_t per direction. Ring 0 carries
+// elements written by one endpoint and ring 1 elements written by the other;
+// an endpoint finds its own ring by comparing |writer_koid| with its koid.
+// Each ring's element storage is a page of its own, following the header
+// page, and holds |elem_count| elements of |elem_size| bytes. The pages stay
+// committed and pinned for the life of the fifo, so ZX_VMO_OP_DECOMMIT on the
+// VMO fails with ZX_ERR_BAD_STATE.
+//
+// |head| and |tail| are free-running element counters. Only the writer of a
+// ring stores to |head| and only the reader stores to |tail|; the ring holds
+// |head - tail| elements, and element |i| lives in slot |i & (elem_count - 1)|.
+// The kernel does not move data. zx_fifo_write() and zx_fifo_read() with a
+// |count| of zero act as a doorbell, recomputing ZX_FIFO_READABLE and
+// ZX_FIFO_WRITABLE on both endpoints from the current counters. A writer
+// needs to ring it only after filling a ring that was empty, and a reader
+// only after draining a ring that was full.
+typedef struct zx_fifo_ring {
+  zx_koid_t writer_koid;
+  uint32_t head;
+  uint8_t padding1[64 - sizeof(zx_koid_t) - sizeof(uint32_t)];
+  uint32_t tail;
+  uint8_t padding2[64 - sizeof(uint32_t)];
+} zx_fifo_ring_t;
+
+#define ZX_FIFO_RING_COUNT ((uint32_t)2u)
+
+// Byte offset in the VMO of the header of |ring|.
+#define ZX_FIFO_RING_HEADER_OFFSET(ring) ((uint64_t)(ring) * sizeof(zx_fifo_ring_t))
+
+// Byte offset in the VMO of the element storage of |ring|.
+#define ZX_FIFO_RING_DATA_OFFSET(ring) (((uint64_t)(ring) + 1u) * ZX_PAGE_SIZE)
+
+// Size of the VMO.
+#define ZX_FIFO_RING_VMO_SIZE ZX_FIFO_RING_DATA_OFFSET(ZX_FIFO_RING_COUNT)
+
+__END_CDECLS
+
+#endif  // SYSROOT_ZIRCON_SYSCALLS_FIFO_H_
@@ -176,6 +176,7 @@ typedef struct zx_wait_item {
 
 // VM Object creation options
 #define ZX_VMO_RESIZABLE                 ((uint32_t)1u << 1)
+#define ZX_VMO_LARGE_PAGES               ((uint32_t)1u << 2)
 
 // VM Object opcodes
 #define ZX_VMO_OP_COMMIT                 ((uint32_t)1u)
@@ -225,6 +226,7 @@ typedef uint32_t zx_vm_option_t;
 #define ZX_VM_REQUIRE_NON_RESIZABLE ((zx_vm_option_t)(1u << 11))
 #define ZX_VM_ALLOW_FAULTS          ((zx_vm_option_t)(1u << 12))
 #define ZX_VM_OFFSET_IS_UPPER_LIMIT ((zx_vm_option_t)(1u << 13))
+#define ZX_VM_SEQUENTIAL            ((zx_vm_option_t)(1u << 14))
 
 #define ZX_VM_ALIGN_BASE            24
 #define ZX_VM_ALIGN_1KB             ((zx_vm_option_t)(10u << ZX_VM_ALIGN_BASE))
@@ -304,15 +306,24 @@ typedef struct zx_iovec {
 
 // Channel options and limits.
 #define ZX_CHANNEL_READ_MAY_DISCARD         ((uint32_t)1u)
+// The bytes passed to zx_channel_write(), zx_channel_write_etc() or
+// zx_channel_call() are an array of zx_iovec_t, and the byte count is the
+// number of entries. The message is gathered from the buffers in order.
+#define ZX_CHANNEL_WRITE_USE_IOVEC          ((uint32_t)2u)
 
 // TODO(fxbug.dev/7802): This must be manually kept in sync with zx_common.fidl.
 // Eventually (some of) this file will be generated from //zircon/vdso.
 #define ZX_CHANNEL_MAX_MSG_BYTES            ((uint32_t)65536u)
 #define ZX_CHANNEL_MAX_MSG_HANDLES          ((uint32_t)64u)
+#define ZX_CHANNEL_MAX_MSG_IOVECS           ((uint32_t)64u)
 
 // Fifo limits.
 #define ZX_FIFO_MAX_SIZE_BYTES              ZX_PAGE_SIZE
 
+// This can be passed to zx_fifo_create(). The rings are then kept in a VMO
+// obtained with zx_fifo_get_vmo(); see <zircon/syscalls/fifo.h>.
+#define ZX_FIFO_SHARED_RING                 ((uint32_t)1u << 0)
+
 // Socket options and limits.
 // These options can be passed to zx_socket_shutdown().
 #define ZX_SOCKET_SHUTDOWN_WRITE            ((uint32_t)1u << 0)
@@ -23,6 +23,9 @@
 // The port wait key associated with the dispatcher's control messages.
 #define KEY_CONTROL (0u)
 
+// The most packets the loop will dequeue from its port in a single system call.
+#define PORT_BATCH_SIZE (16u)
+
 static zx_time_t async_loop_now(async_dispatcher_t* dispatcher);
 static zx_status_t async_loop_begin_wait(async_dispatcher_t* dispatcher, async_wait_t* wait);
 static zx_status_t async_loop_cancel_wait(async_dispatcher_t* dispatcher, async_wait_t* wait);
@@ -90,9 +93,19 @@ typedef struct async_loop {
   list_node_t irq_list;        // list of IRQs
   list_node_t paged_vmo_list;  // most recently added first
   bool timer_armed;            // true if timer has been set and has not fired yet
+
+  // Packets that were dequeued from the port together with an earlier one and
+  // are awaiting dispatch, oldest first.  Only one thread fills the buffer at a
+  // time, and only once it has been drained.
+  bool batching;  // true while a thread is dequeuing a batch of packets
+  size_t pending_head;
+  size_t pending_tail;
+  zx_port_packet_t pending[PORT_BATCH_SIZE - 1];
 } async_loop_t;
 
 static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline);
+static zx_status_t async_loop_dispatch_port_packet(async_loop_t* loop, zx_port_packet_t* packet);
+static bool async_loop_drop_pending_locked(async_loop_t* loop, uint64_t key, uint32_t type);
 static zx_status_t async_loop_dispatch_wait(async_loop_t* loop, async_wait_t* wait,
                                             zx_status_t status, const zx_packet_signal_t* signal);
 static zx_status_t async_loop_dispatch_irq(async_loop_t* loop, async_irq_t* irq, zx_status_t status,
@@ -208,6 +221,10 @@ void async_loop_shutdown(async_loop_t* loop) {
   async_loop_wake_threads(loop);
   async_loop_join_threads(loop);
 
+  // Packets still staged for dispatch are discarded along with those in the
+  // port.  Any waits they would have completed are canceled below.
+  loop->pending_head = loop->pending_tail = 0u;
+
   list_node_t* node;
   while ((node = list_remove_head(&loop->wait_list))) {
     async_wait_t* wait = node_to_wait(node);
@@ -271,51 +288,90 @@ static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline) {
   if (state != ASYNC_LOOP_RUNNABLE)
     return ZX_ERR_CANCELED;
 
-  zx_port_packet_t packet;
-  zx_status_t status = zx_port_wait(loop->port, deadline, &packet);
+  // Drain any packets left over from an earlier batch before going back to
+  // the port.
+  zx_port_packet_t packets[PORT_BATCH_SIZE];
+  mtx_lock(&loop->lock);
+  if (loop->pending_head != loop->pending_tail) {
+    packets[0] = loop->pending[loop->pending_head++];
+    if (loop->pending_head == loop->pending_tail)
+      loop->pending_head = loop->pending_tail = 0u;
+    mtx_unlock(&loop->lock);
+    return async_loop_dispatch_port_packet(loop, &packets[0]);
+  }
+
+  // Batching is only worthwhile when a single thread is servicing the loop;
+  // otherwise the packets are better spread between the threads.
+  bool batch = !loop->batching &&
+               atomic_load_explicit(&loop->active_threads, memory_order_acquire) == 1u;
+  if (batch)
+    loop->batching = true;
+  mtx_unlock(&loop->lock);
+
+  zx_status_t status;
+  size_t count = 1u;
+  if (batch) {
+    status = zx_port_wait_many(loop->port, deadline, packets, PORT_BATCH_SIZE, &count);
+
+    // Stage everything but the first packet so that later calls, and
+    // cancelations made by the handlers in the meantime, can see them.
+    mtx_lock(&loop->lock);
+    if (status == ZX_OK) {
+      for (size_t i = 1u; i < count; i++)
+        loop->pending[loop->pending_tail++] = packets[i];
+    }
+    loop->batching = false;
+    mtx_unlock(&loop->lock);
+  } else {
+    status = zx_port_wait(loop->port, deadline, &packets[0]);
+  }
   if (status != ZX_OK)
     return status;
 
-  if (packet.key == KEY_CONTROL) {
+  return async_loop_dispatch_port_packet(loop, &packets[0]);
+}
+
+static zx_status_t async_loop_dispatch_port_packet(async_loop_t* loop, zx_port_packet_t* packet) {
+  if (packet->key == KEY_CONTROL) {
     // Handle wake-up packets.
-    if (packet.type == ZX_PKT_TYPE_USER)
+    if (packet->type == ZX_PKT_TYPE_USER)
       return ZX_OK;
 
     // Handle task timer expirations.
-    if (packet.type == ZX_PKT_TYPE_SIGNAL_ONE && packet.signal.observed & ZX_TIMER_SIGNALED) {
+    if (packet->type == ZX_PKT_TYPE_SIGNAL_ONE && packet->signal.observed & ZX_TIMER_SIGNALED) {
       return async_loop_dispatch_tasks(loop);
     }
   } else {
     // Handle wait completion packets.
-    if (packet.type == ZX_PKT_TYPE_SIGNAL_ONE) {
-      async_wait_t* wait = (void*)(uintptr_t)packet.key;
+    if (packet->type == ZX_PKT_TYPE_SIGNAL_ONE) {
+      async_wait_t* wait = (void*)(uintptr_t)packet->key;
       mtx_lock(&loop->lock);
       list_delete(wait_to_node(wait));
       mtx_unlock(&loop->lock);
-      return async_loop_dispatch_wait(loop, wait, packet.status, &packet.signal);
+      return async_loop_dispatch_wait(loop, wait, packet->status, &packet->signal);
     }
 
     // Handle queued user packets.
-    if (packet.type == ZX_PKT_TYPE_USER) {
-      async_receiver_t* receiver = (void*)(uintptr_t)packet.key;
-      return async_loop_dispatch_packet(loop, receiver, packet.status, &packet.user);
+    if (packet->type == ZX_PKT_TYPE_USER) {
+      async_receiver_t* receiver = (void*)(uintptr_t)packet->key;
+      return async_loop_dispatch_packet(loop, receiver, packet->status, &packet->user);
     }
 
     // Handle guest bell trap packets.
-    if (packet.type == ZX_PKT_TYPE_GUEST_BELL) {
-      async_guest_bell_trap_t* trap = (void*)(uintptr_t)packet.key;
-      return async_loop_dispatch_guest_bell_trap(loop, trap, packet.status, &packet.guest_bell);
+    if (packet->type == ZX_PKT_TYPE_GUEST_BELL) {
+      async_guest_bell_trap_t* trap = (void*)(uintptr_t)packet->key;
+      return async_loop_dispatch_guest_bell_trap(loop, trap, packet->status, &packet->guest_bell);
     }
 
     // Handle interrupt packets.
-    if (packet.type == ZX_PKT_TYPE_INTERRUPT) {
-      async_irq_t* irq = (void*)(uintptr_t)packet.key;
-      return async_loop_dispatch_irq(loop, irq, packet.status, &packet.interrupt);
+    if (packet->type == ZX_PKT_TYPE_INTERRUPT) {
+      async_irq_t* irq = (void*)(uintptr_t)packet->key;
+      return async_loop_dispatch_irq(loop, irq, packet->status, &packet->interrupt);
     }
     // Handle pager packets.
-    if (packet.type == ZX_PKT_TYPE_PAGE_REQUEST) {
-      async_paged_vmo_t* paged_vmo = (void*)(uintptr_t)packet.key;
-      return async_loop_dispatch_paged_vmo(loop, paged_vmo, packet.status, &packet.page_request);
+    if (packet->type == ZX_PKT_TYPE_PAGE_REQUEST) {
+      async_paged_vmo_t* paged_vmo = (void*)(uintptr_t)packet->key;
+      return async_loop_dispatch_paged_vmo(loop, paged_vmo, packet->status, &packet->page_request);
     }
   }
 
@@ -323,6 +379,22 @@ static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline) {
   return ZX_ERR_INTERNAL;
 }
 
+// Removes any staged packets of the given |key| and |type| so that they will
+// not be dispatched.  Returns true if any were found.
+static bool async_loop_drop_pending_locked(async_loop_t* loop, uint64_t key, uint32_t type) {
+  size_t tail = loop->pending_head;
+  for (size_t i = loop->pending_head; i < loop->pending_tail; i++) {
+    if (loop->pending[i].key == key && loop->pending[i].type == type)
+      continue;
+    loop->pending[tail++] = loop->pending[i];
+  }
+  bool dropped = tail != loop->pending_tail;
+  loop->pending_tail = tail;
+  if (loop->pending_head == loop->pending_tail)
+    loop->pending_head = loop->pending_tail = 0u;
+  return dropped;
+}
+
 async_dispatcher_t* async_loop_get_dispatcher(async_loop_t* loop) {
   // Note: The loop's implementation inherits from async_t so we can upcast to it.
   return (async_dispatcher_t*)loop;
@@ -536,8 +608,12 @@ static zx_status_t async_loop_cancel_wait(async_dispatcher_t* async, async_wait_
 
   // Next, cancel the wait.  This may be racing with another thread that
   // has read the wait's packet but not yet dispatched it.  So if we fail
-  // to cancel then we assume we lost the race.
+  // to cancel then we assume we lost the race, unless the packet is merely
+  // staged in a batch, in which case it can still be withdrawn.
   zx_status_t status = zx_port_cancel(loop->port, wait->object, (uintptr_t)wait);
+  if (status == ZX_ERR_NOT_FOUND &&
+      async_loop_drop_pending_locked(loop, (uintptr_t)wait, ZX_PKT_TYPE_SIGNAL_ONE))
+    status = ZX_OK;
   if (status == ZX_OK) {
     list_delete(node);
   } else {
@@ -721,6 +797,8 @@ static void async_loop_restart_timer_locked(async_loop_t* loop) {
       status = zx_port_cancel(loop->port, loop->timer, KEY_CONTROL);
       ZX_ASSERT_MSG(status == ZX_OK || status == ZX_ERR_NOT_FOUND, "zx_port_cancel: status=%d",
                     status);
+      if (status == ZX_ERR_NOT_FOUND)
+        async_loop_drop_pending_locked(loop, KEY_CONTROL, ZX_PKT_TYPE_SIGNAL_ONE);
       loop->timer_armed = false;
     }
 
@@ -784,6 +862,9 @@ static zx_status_t async_loop_unbind_irq(async_dispatcher_t* dispatcher, async_i
       zx_interrupt_bind(irq->object, loop->port, (uintptr_t)irq, ZX_INTERRUPT_UNBIND);
   if (status == ZX_OK) {
     list_delete(irq_to_node(irq));
+    // Unbinding removes the interrupt's packets from the port, so do the same
+    // for any that have already been dequeued into a batch.
+    async_loop_drop_pending_locked(loop, (uintptr_t)irq, ZX_PKT_TYPE_INTERRUPT);
   } else {
     ZX_ASSERT_MSG(status == ZX_ERR_ACCESS_DENIED, "zx_object_wait_async: status=%d", status);
   }
@@ -73,6 +73,22 @@ class TestWait : public async_wait_t {
   zx_packet_signal_t last_signal_storage_;
 };
 
+// A wait whose handler cancels another wait.
+class CancelingWait : public TestWait {
+ public:
+  CancelingWait(zx_handle_t object, zx_signals_t trigger) : TestWait(object, trigger) {}
+
+  TestWait* victim = nullptr;
+  zx_status_t cancel_result = ZX_ERR_INTERNAL;
+
+ protected:
+  void Handle(async_dispatcher_t* dispatcher, zx_status_t status,
+              const zx_packet_signal_t* signal) override {
+    TestWait::Handle(dispatcher, status, signal);
+    cancel_result = victim->Cancel(dispatcher);
+  }
+};
+
 class TestWaitIrq : public async_irq_t {
  public:
   TestWaitIrq(zx_handle_t irq) : async_irq_t{{ASYNC_STATE_INIT}, &TestWaitIrq::CallHandler, irq} {}
@@ -514,6 +530,30 @@ TEST(Loop, Wait) {
   loop.Shutdown();
 }
 
+TEST(Loop, WaitCanceledByEarlierHandler) {
+  async::Loop loop(&kAsyncLoopConfigNoAttachToCurrentThread);
+  zx::event event;
+  EXPECT_EQ(ZX_OK, zx::event::create(0u, &event), "create event");
+
+  // Both waits complete at once, so their packets are dequeued together.
+  // Whichever handler runs first cancels the other wait, which must then
+  // never run even though its packet has already left the port.
+  CancelingWait wait1(event.get(), ZX_USER_SIGNAL_1);
+  CancelingWait wait2(event.get(), ZX_USER_SIGNAL_1);
+  wait1.victim = &wait2;
+  wait2.victim = &wait1;
+  EXPECT_EQ(ZX_OK, wait1.Begin(loop.dispatcher()), "wait 1");
+  EXPECT_EQ(ZX_OK, wait2.Begin(loop.dispatcher()), "wait 2");
+
+  EXPECT_EQ(ZX_OK, event.signal(0u, ZX_USER_SIGNAL_1), "signal 1");
+  EXPECT_EQ(ZX_OK, loop.RunUntilIdle(), "run loop");
+  EXPECT_EQ(1u, wait1.run_count + wait2.run_count, "run count");
+  CancelingWait& ran = wait1.run_count ? wait1 : wait2;
+  EXPECT_EQ(ZX_OK, ran.cancel_result, "cancel");
+
+  loop.Shutdown();
+}
+
 TEST(Loop, Irq) {
   async_loop_config_t config = kAsyncLoopConfigNoAttachToCurrentThread;
   config.irq_support = true;
@@ -6,6 +6,7 @@
 
 #include <zircon/status.h>
 
+#include <algorithm>
 #include <utility>
 
 #include <digest/digest.h>
@@ -32,14 +33,49 @@ void BlobCache::Reset() {
 }
 
 void BlobCache::ResetLocked() {
+  // The replacement lists only hold nodes which are also in closed_hash_.
+  recent_.clear();
+  frequent_.clear();
+  recent_ghosts_.clear();
+  frequent_ghosts_.clear();
+  recent_bytes_ = 0;
+  frequent_bytes_ = 0;
+  recent_ghost_bytes_ = 0;
+  frequent_ghost_bytes_ = 0;
+  recent_target_bytes_ = 0;
+
   // All nodes in closed_hash_ have been leaked. If we're attempting to reset the
   // cache, these nodes must be explicitly deleted.
   CacheNode* node = nullptr;
   while ((node = closed_hash_.pop_front()) != nullptr) {
+    node->cache_list_ = CacheList::kNone;
+    node->cache_list_bytes_ = 0;
     delete node;
   }
 }
 
+void BlobCache::SetMemoryBudget(uint64_t bytes) {
+  fbl::AutoLock lock(&hash_lock_);
+  memory_budget_ = bytes;
+  ShrinkLocked();
+}
+
+void BlobCache::SetMemoryPressure(MemoryPressure level) {
+  fbl::AutoLock lock(&hash_lock_);
+  memory_pressure_ = level;
+  ShrinkLocked();
+}
+
+void BlobCache::SetMetrics(CacheMetrics* metrics) {
+  fbl::AutoLock lock(&hash_lock_);
+  metrics_ = metrics;
+}
+
+uint64_t BlobCache::ResidentBytes() {
+  fbl::AutoLock lock(&hash_lock_);
+  return recent_bytes_ + frequent_bytes_;
+}
+
 void BlobCache::ForAllOpenNodes(NextNodeCallback callback) {
   fbl::RefPtr<CacheNode> old_vnode = nullptr;
   fbl::RefPtr<CacheNode> vnode = nullptr;
@@ -194,6 +230,11 @@ zx_status_t BlobCache::EvictUnsafe(CacheNode* vnode, bool from_recycle) {
 }
 
 void BlobCache::Downgrade(CacheNode* raw_vnode) {
+  // Measuring a node may take syscalls, so do it before taking the lock, and only for the policy
+  // which needs it. Nothing else can reach the node while its reference count is zero.
+  const uint64_t bytes =
+      cache_policy_ == CachePolicy::EvictLeastRecentlyUsed ? raw_vnode->GetMemoryUsage() : 0;
+
   fbl::AutoLock lock(&hash_lock_);
   // We must resurrect the vnode while holding the lock to prevent it from being
   // concurrently accessed in Lookup, and gaining a strong reference before
@@ -222,6 +263,9 @@ void BlobCache::Downgrade(CacheNode* raw_vnode) {
       break;
     case CachePolicy::NeverEvict:
       break;
+    case CachePolicy::EvictLeastRecentlyUsed:
+      OnCloseLocked(vnode.get(), bytes);
+      break;
     default:
       ZX_ASSERT_MSG(false, "Unexpected cache policy");
   }
@@ -237,10 +281,147 @@ fbl::RefPtr<CacheNode> BlobCache::UpgradeLocked(const uint8_t* key) {
   if (raw_vnode == nullptr) {
     return nullptr;
   }
+  if (metrics_ != nullptr) {
+    if (raw_vnode->IsResident()) {
+      metrics_->IncrementHit();
+    } else {
+      metrics_->IncrementMiss();
+    }
+  }
+  OnReopenLocked(raw_vnode);
   open_hash_.insert(raw_vnode);
   // To have existed in the closed_hash_, this RefPtr must have been leaked.
   // See the complement of this adoption in Downgrade.
   return fbl::ImportFromRawPtr(raw_vnode);
 }
 
+BlobCache::CacheNodeList& BlobCache::ListLocked(CacheList list) {
+  switch (list) {
+    case CacheList::kRecent:
+      return recent_;
+    case CacheList::kFrequent:
+      return frequent_;
+    case CacheList::kRecentGhost:
+      return recent_ghosts_;
+    case CacheList::kFrequentGhost:
+      return frequent_ghosts_;
+    default:
+      ZX_PANIC("Unexpected cache list");
+  }
+}
+
+uint64_t& BlobCache::ListBytesLocked(CacheList list) {
+  switch (list) {
+    case CacheList::kRecent:
+      return recent_bytes_;
+    case CacheList::kFrequent:
+      return frequent_bytes_;
+    case CacheList::kRecentGhost:
+      return recent_ghost_bytes_;
+    case CacheList::kFrequentGhost:
+      return frequent_ghost_bytes_;
+    default:
+      ZX_PANIC("Unexpected cache list");
+  }
+}
+
+void BlobCache::PushListLocked(CacheNode* node, CacheList list, uint64_t bytes) {
+  ZX_DEBUG_ASSERT(node->cache_list_ == CacheList::kNone);
+  node->cache_list_ = list;
+  node->cache_list_bytes_ = bytes;
+  ListLocked(list).push_back(node);
+  ListBytesLocked(list) += bytes;
+}
+
+void BlobCache::RemoveFromListLocked(CacheNode* node) {
+  if (node->cache_list_ == CacheList::kNone) {
+    return;
+  }
+  ListLocked(node->cache_list_).erase(*node);
+  ListBytesLocked(node->cache_list_) -= node->cache_list_bytes_;
+  node->cache_list_ = CacheList::kNone;
+  node->cache_list_bytes_ = 0;
+}
+
+void BlobCache::OnReopenLocked(CacheNode* node) {
+  const uint64_t bytes = node->cache_list_bytes_;
+  switch (node->cache_list_) {
+    case CacheList::kNone:
+      // Either this is the first time the node has been cached, or it has been forgotten.
+      node->cache_reused_ = false;
+      return;
+    case CacheList::kRecentGhost: {
+      // The node would still be resident if the recent list were larger.
+      const uint64_t scale = std::max<uint64_t>(frequent_ghost_bytes_ / recent_ghost_bytes_, 1);
+      recent_target_bytes_ = std::min(recent_target_bytes_ + scale * bytes, memory_budget_);
+      break;
+    }
+    case CacheList::kFrequentGhost: {
+      // The node would still be resident if the frequent list were larger.
+      const uint64_t scale = std::max<uint64_t>(recent_ghost_bytes_ / frequent_ghost_bytes_, 1);
+      const uint64_t delta = scale * bytes;
+      recent_target_bytes_ = recent_target_bytes_ > delta ? recent_target_bytes_ - delta : 0;
+      break;
+    }
+    default:
+      break;
+  }
+  RemoveFromListLocked(node);
+  node->cache_reused_ = true;
+}
+
+void BlobCache::OnCloseLocked(CacheNode* node, uint64_t bytes) {
+  const bool reused = node->cache_reused_;
+  node->cache_reused_ = false;
+  if (bytes == 0) {
+    // There is nothing to be gained by tracking a node which holds no memory.
+    return;
+  }
+  PushListLocked(node, reused ? CacheList::kFrequent : CacheList::kRecent, bytes);
+  ShrinkLocked();
+}
+
+void BlobCache::ShrinkLocked() {
+  const uint64_t budget = EffectiveBudgetLocked();
+  recent_target_bytes_ = std::min(recent_target_bytes_, memory_budget_);
+
+  while (recent_bytes_ + frequent_bytes_ > budget) {
+    // Prefer to evict from the recent list while it is over its target size, so that nodes which
+    // are only used once make way for those which are used repeatedly.
+    const bool evict_recent =
+        !recent_.is_empty() && (recent_bytes_ > recent_target_bytes_ || frequent_.is_empty());
+    const CacheList from = evict_recent ? CacheList::kRecent : CacheList::kFrequent;
+    CacheNode* victim = &ListLocked(from).front();
+    const uint64_t bytes = victim->cache_list_bytes_;
+    RemoveFromListLocked(victim);
+    victim->ActivateLowMemory();
+    if (metrics_ != nullptr) {
+      metrics_->IncrementEviction(bytes);
+    }
+    PushListLocked(victim, evict_recent ? CacheList::kRecentGhost : CacheList::kFrequentGhost,
+                   bytes);
+  }
+
+  // The ghost lists only need to remember as much history as the resident lists could hold.
+  while (recent_ghost_bytes_ + frequent_ghost_bytes_ > budget) {
+    const bool trim_recent = !recent_ghosts_.is_empty() &&
+                             (recent_bytes_ + recent_ghost_bytes_ > budget ||
+                              frequent_ghosts_.is_empty());
+    RemoveFromListLocked(trim_recent ? &recent_ghosts_.front() : &frequent_ghosts_.front());
+  }
+}
+
+uint64_t BlobCache::EffectiveBudgetLocked() const {
+  switch (memory_pressure_) {
+    case MemoryPressure::kNormal:
+      return memory_budget_;
+    case MemoryPressure::kWarning:
+      return memory_budget_ / 2;
+    case MemoryPressure::kCritical:
+      return 0;
+    default:
+      ZX_PANIC("Unexpected memory pressure level");
+  }
+}
+
 }  // namespace blobfs
@@ -13,12 +13,14 @@
 #include <digest/digest.h>
 #include <fbl/condition_variable.h>
 #include <fbl/function.h>
+#include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/mutex.h>
 #include <fbl/ref_ptr.h>
 #include <fs/trace.h>
 #include <fs/vnode.h>
 
+#include "cache-metrics.h"
 #include "cache-node.h"
 #include "metrics.h"
 
@@ -26,6 +28,17 @@ namespace blobfs {
 
 using digest::Digest;
 
+// Levels of system memory pressure which the BlobCache responds to by shrinking the memory used
+// by closed nodes.
+enum class MemoryPressure {
+  // Closed nodes may use the full memory budget.
+  kNormal,
+  // Closed nodes may use at most half of the memory budget.
+  kWarning,
+  // Closed nodes are placed into a low-memory state as soon as they are closed.
+  kCritical,
+};
+
 // BlobCache contains a collection of weak pointers to vnodes.
 //
 // This cache also helps manage the lifecycle of these vnodes, controlling what is cached
@@ -36,6 +49,13 @@ using digest::Digest;
 // The "closed set" contains references to Vnodes which are not used, but which exist
 // on-disk. These Vnodes may be stored in a "low-memory" state until they are requested.
 //
+// Under |CachePolicy::EvictLeastRecentlyUsed|, closed nodes which still hold memory are kept on
+// one of two lists, following the Adaptive Replacement Cache algorithm: "recent" nodes, which
+// have been closed once since being loaded, and "frequent" nodes, which were reopened while still
+// in memory. Nodes evicted from either list are remembered on a corresponding "ghost" list, and
+// reopening a ghost shifts the target balance between the two lists towards the one it came from.
+// Budgets and list sizes are measured in bytes, as reported by |CacheNode::GetMemoryUsage()|.
+//
 // This class is thread-safe.
 class BlobCache {
  public:
@@ -51,6 +71,21 @@ class BlobCache {
   // Refer to the declaration of |CachePolicy| for more information.
   void SetCachePolicy(CachePolicy policy) { cache_policy_ = policy; }
 
+  // Sets the memory budget for closed nodes under |CachePolicy::EvictLeastRecentlyUsed|,
+  // evicting nodes as necessary to fit within it.
+  void SetMemoryBudget(uint64_t bytes);
+
+  // Adjusts the memory used by closed nodes in response to system memory pressure, evicting
+  // nodes as necessary. Only affects |CachePolicy::EvictLeastRecentlyUsed|.
+  void SetMemoryPressure(MemoryPressure level);
+
+  // Sets the object which receives hit, miss and eviction counts for closed nodes. |metrics| may
+  // be null, and must otherwise outlive the cache or be unset before it is destroyed.
+  void SetMetrics(CacheMetrics* metrics);
+
+  // Returns the number of bytes currently held by closed nodes on the replacement lists.
+  uint64_t ResidentBytes();
+
   // Iterates over all non-evicted cached nodes with strong references, invoking |callback| on
   // each one.
   //
@@ -123,6 +158,34 @@ class BlobCache {
   // Resets the cache by deleting all members |closed_hash_|.
   void ResetLocked() __TA_REQUIRES(hash_lock_);
 
+  using CacheList = CacheNode::CacheList;
+  using CacheNodeList = fbl::DoublyLinkedListCustomTraits<CacheNode*, CacheNode::CacheListTraits>;
+
+  // Returns the list and byte count corresponding to |list|, which must not be |kNone|.
+  CacheNodeList& ListLocked(CacheList list) __TA_REQUIRES(hash_lock_);
+  uint64_t& ListBytesLocked(CacheList list) __TA_REQUIRES(hash_lock_);
+
+  // Places |node| at the most-recently-used end of |list|, accounting |bytes| to it.
+  void PushListLocked(CacheNode* node, CacheList list, uint64_t bytes) __TA_REQUIRES(hash_lock_);
+
+  // Removes |node| from whichever replacement list it is on, if any.
+  void RemoveFromListLocked(CacheNode* node) __TA_REQUIRES(hash_lock_);
+
+  // Records that a closed node is being reopened, adapting the recent/frequent balance if it was
+  // found on a ghost list.
+  void OnReopenLocked(CacheNode* node) __TA_REQUIRES(hash_lock_);
+
+  // Places a newly closed |node|, holding |bytes| of memory, onto the appropriate resident list, and
+  // evicts nodes until the resident lists fit within the effective memory budget.
+  void OnCloseLocked(CacheNode* node, uint64_t bytes) __TA_REQUIRES(hash_lock_);
+
+  // Evicts resident nodes until they fit within the effective memory budget, and trims the ghost
+  // lists to the same size.
+  void ShrinkLocked() __TA_REQUIRES(hash_lock_);
+
+  // Returns the memory budget after accounting for memory pressure.
+  uint64_t EffectiveBudgetLocked() const __TA_REQUIRES(hash_lock_);
+
   // We need to define this structure to allow the CacheNodes to be indexable by a key
   // which is larger than a primitive type: the keys are 'digest::kSha256Length'
   // bytes long.
@@ -143,6 +206,22 @@ class BlobCache {
   CachePolicy cache_policy_ = CachePolicy::EvictImmediately;
 
   fbl::Mutex hash_lock_ = {};
+  // Replacement lists for closed nodes under |CachePolicy::EvictLeastRecentlyUsed|, ordered from
+  // least to most recently used. Every node on these lists is also in |closed_hash_|.
+  CacheNodeList recent_ __TA_GUARDED(hash_lock_);
+  CacheNodeList frequent_ __TA_GUARDED(hash_lock_);
+  CacheNodeList recent_ghosts_ __TA_GUARDED(hash_lock_);
+  CacheNodeList frequent_ghosts_ __TA_GUARDED(hash_lock_);
+  uint64_t recent_bytes_ __TA_GUARDED(hash_lock_) = 0;
+  uint64_t frequent_bytes_ __TA_GUARDED(hash_lock_) = 0;
+  uint64_t recent_ghost_bytes_ __TA_GUARDED(hash_lock_) = 0;
+  uint64_t frequent_ghost_bytes_ __TA_GUARDED(hash_lock_) = 0;
+  // The adaptive target size, in bytes, of |recent_|.
+  uint64_t recent_target_bytes_ __TA_GUARDED(hash_lock_) = 0;
+  uint64_t memory_budget_ __TA_GUARDED(hash_lock_) = kDefaultCacheMemoryBudget;
+  MemoryPressure memory_pressure_ __TA_GUARDED(hash_lock_) = MemoryPressure::kNormal;
+  CacheMetrics* metrics_ __TA_GUARDED(hash_lock_) = nullptr;
+
   // All 'in use' blobs.
   WAVLTreeByMerkle open_hash_ __TA_GUARDED(hash_lock_){};
   // All 'closed' blobs.
@@ -25,7 +25,9 @@
 #include "compression/decompressor.h"
 #include "compression/seekable-decompressor.h"
 #include "compression/zstd-seekable-blob-collection.h"
+#include "iterator/allocated-extent-iterator.h"
 #include "iterator/block-iterator.h"
+#include "iterator/extent-index.h"
 
 namespace blobfs {
 
@@ -172,6 +174,17 @@ zx_status_t BlobLoader::LoadBlobPaged(uint32_t node_index,
     return status;
   }
 
+  // Index the extents now, while nothing else can see the blob, so that the pager threads servicing
+  // its page requests only ever read the index.
+  std::unique_ptr<ExtentIndex> extent_index;
+  {
+    AllocatedExtentIterator extents(node_finder_, node_index);
+    if ((status = ExtentIndex::Create(&extents, &extent_index)) != ZX_OK) {
+      FS_TRACE_ERROR("blobfs: Failed to index extents: %s\n", zx_status_get_string(status));
+      return status;
+    }
+  }
+
   UserPagerInfo userpager_info;
   userpager_info.identifier = node_index;
   userpager_info.data_start_bytes = ComputeNumMerkleTreeBlocks(*inode) * kBlobfsBlockSize;
@@ -179,6 +192,7 @@ zx_status_t BlobLoader::LoadBlobPaged(uint32_t node_index,
   userpager_info.verifier = std::move(verifier);
   userpager_info.decompressor = std::move(decompressor);
   userpager_info.zstd_seekable_blob_collection = zstd_seekable_blob_collection;
+  userpager_info.extent_index = std::move(extent_index);
   auto page_watcher = std::make_unique<PageWatcher>(pager_, std::move(userpager_info));
 
   fbl::StringBuffer<ZX_MAX_NAME_LEN> data_vmo_name;
@@ -8,6 +8,7 @@
 #include <ctype.h>
 #include <fuchsia/device/c/fidl.h>
 #include <fuchsia/io/llcpp/fidl.h>
+#include <lib/fzl/owned-vmo-mapper.h>
 #include <lib/sync/completion.h>
 #include <stdlib.h>
 #include <string.h>
@@ -61,6 +62,20 @@ bool SupportsPaging(const Inode& inode) {
   return false;
 }
 
+// Returns the number of bytes committed to the VMO behind |mapping|. Falls back to the size of the
+// mapping if the VMO cannot be queried.
+uint64_t CommittedBytes(const fzl::OwnedVmoMapper& mapping) {
+  const zx::vmo& vmo = mapping.vmo();
+  if (!vmo.is_valid()) {
+    return 0;
+  }
+  zx_info_vmo_t info;
+  if (vmo.get_info(ZX_INFO_VMO, &info, sizeof(info), nullptr, nullptr) != ZX_OK) {
+    return mapping.size();
+  }
+  return info.committed_bytes;
+}
+
 }  // namespace
 
 zx_status_t Blob::Verify() const {
@@ -768,6 +783,16 @@ void Blob::ActivateLowMemory() {
   merkle_mapping_.Reset();
 }
 
+uint64_t Blob::GetMemoryUsage() const {
+  // Paged blobs only have the pages which were read committed, so the mapping sizes would overstate
+  // what |ActivateLowMemory()| releases.
+  return CommittedBytes(data_mapping_) + CommittedBytes(merkle_mapping_);
+}
+
+bool Blob::IsResident() const {
+  return data_mapping_.vmo().is_valid() || merkle_mapping_.vmo().is_valid();
+}
+
 Blob::~Blob() { ActivateLowMemory(); }
 
 fs::VnodeProtocolSet Blob::GetProtocols() const { return fs::VnodeProtocol::kFile; }
@@ -160,6 +160,8 @@ class Blob final : public CacheNode, fbl::Recyclable<Blob> {
   BlobCache& Cache() final;
   bool ShouldCache() const final;
   void ActivateLowMemory() final;
+  uint64_t GetMemoryUsage() const final;
+  bool IsResident() const final;
 
   ////////////////
   // Other methods.
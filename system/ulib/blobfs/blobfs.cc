@@ -158,12 +158,16 @@ zx_status_t Blobfs::Create(async_dispatcher_t* dispatcher, std::unique_ptr<Block
   fs->block_info_ = std::move(block_info);
 
   if (options->pager) {
-    status = fs->InitPager();
+    status = fs->InitPager(options->pager_threads, &fs->metrics_.pager_metrics());
     if (status != ZX_OK) {
       FS_TRACE_ERROR("blobfs: Could not initialize user pager\n");
       return status;
     }
     fs->paging_enabled_ = true;
+    fs->read_ahead_enabled_ = options->pager_read_ahead;
+    if (!fs->read_ahead_enabled_) {
+      fs->SetMaxReadAhead(0);
+    }
     FS_TRACE_INFO("blobfs: Initialized user pager\n");
   }
 
@@ -237,6 +241,8 @@ zx_status_t Blobfs::Create(async_dispatcher_t* dispatcher, std::unique_ptr<Block
   }
 
   fs->Cache().SetCachePolicy(options->cache_policy);
+  fs->Cache().SetMemoryBudget(options->cache_memory_budget);
+  fs->Cache().SetMetrics(&fs->metrics_.cache_metrics());
   RawBitmap block_map;
   // Keep the block_map aligned to a block multiple
   if ((status = block_map.Reset(BlockMapBlocks(fs->info_) * kBlobfsBlockBits)) < 0) {
@@ -327,7 +333,11 @@ std::unique_ptr<BlockDevice> Blobfs::Destroy(std::unique_ptr<Blobfs> blobfs) {
   return blobfs->Reset();
 }
 
-Blobfs::~Blobfs() { Reset(); }
+Blobfs::~Blobfs() {
+  Reset();
+  // |metrics_| is destroyed before |blob_cache_|.
+  Cache().SetMetrics(nullptr);
+}
 
 zx_status_t Blobfs::LoadAndVerifyBlob(uint32_t node_index) {
   return Blob::LoadAndVerifyBlob(this, node_index);
@@ -752,7 +762,9 @@ std::unique_ptr<BlockDevice> Blobfs::Reset() {
   sync_txn.Transact();
 
   BlockDetachVmo(std::move(info_vmoid_));
-  BlockDetachVmo(std::move(transfer_vmoid_));
+  for (auto& vmoid : transfer_vmoids_) {
+    BlockDetachVmo(std::move(vmoid));
+  }
 
   return std::move(block_device_);
 }
@@ -842,22 +854,58 @@ zx_status_t Blobfs::OpenRootNode(fbl::RefPtr<fs::Vnode>* out) {
 
 Journal* Blobfs::journal() { return journal_.get(); }
 
-zx_status_t Blobfs::AttachTransferVmo(const zx::vmo& transfer_vmo) {
-  return BlockAttachVmo(transfer_vmo, &transfer_vmoid_);
+void Blobfs::SetMemoryPressure(MemoryPressure level) {
+  Cache().SetMemoryPressure(level);
+  if (!read_ahead_enabled_) {
+    return;
+  }
+  switch (level) {
+    case MemoryPressure::kNormal:
+      SetMaxReadAhead(kDefaultMaxReadAhead);
+      break;
+    case MemoryPressure::kWarning:
+      SetMaxReadAhead(kDefaultMaxReadAhead / 4);
+      break;
+    case MemoryPressure::kCritical:
+      SetMaxReadAhead(0);
+      break;
+  }
+}
+
+zx_status_t Blobfs::AttachTransferVmo(uint32_t index, const zx::vmo& transfer_vmo) {
+  if (transfer_vmoids_.size() <= index) {
+    transfer_vmoids_.resize(index + 1);
+  }
+  return BlockAttachVmo(transfer_vmo, &transfer_vmoids_[index]);
 }
 
-zx_status_t Blobfs::PopulateTransferVmo(uint64_t offset, uint64_t length,
+zx_status_t Blobfs::PopulateTransferVmo(uint32_t index, uint64_t offset, uint64_t length,
                                         const UserPagerInfo& info) {
   fs::Ticker ticker(metrics_.Collecting());
   fs::ReadTxn txn(this);
-  BlockIterator block_iter = BlockIteratorByNodeIndex(info.identifier);
 
   auto start_block = static_cast<uint32_t>((offset + info.data_start_bytes) / kBlobfsBlockSize);
   auto block_count =
       static_cast<uint32_t>(fbl::round_up(length, kBlobfsBlockSize) / kBlobfsBlockSize);
 
+  // With an index of the blob's extents, jump straight to the extent holding the start block
+  // instead of walking the extent chain.
+  zx_status_t status;
+  std::unique_ptr<ExtentIterator> extents;
+  if (info.extent_index != nullptr) {
+    status = info.extent_index->IteratorAtBlock(start_block, &extents);
+    if (status != ZX_OK) {
+      FS_TRACE_ERROR("blobfs: Failed to find extent for block %u: %s\n", start_block,
+                     zx_status_get_string(status));
+      return status;
+    }
+  } else {
+    extents = std::make_unique<AllocatedExtentIterator>(GetAllocator(), info.identifier);
+  }
+  BlockIterator block_iter(std::move(extents));
+
   // Navigate to the start block.
-  zx_status_t status = IterateToBlock(&block_iter, start_block);
+  status = IterateToBlock(&block_iter, start_block);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: Failed to navigate to start block %u: %s\n", start_block,
                    zx_status_get_string(status));
@@ -868,7 +916,7 @@ zx_status_t Blobfs::PopulateTransferVmo(uint64_t offset, uint64_t length,
   const uint64_t data_start = DataStartBlock(Info());
   status = StreamBlocks(&block_iter, block_count,
                         [&](uint64_t vmo_offset, uint64_t dev_offset, uint32_t length) {
-                          txn.Enqueue(transfer_vmoid_.get(), vmo_offset - start_block,
+                          txn.Enqueue(transfer_vmoids_[index].get(), vmo_offset - start_block,
                                       dev_offset + data_start, length);
                           return ZX_OK;
                         });
@@ -21,6 +21,7 @@
 
 #include <memory>
 #include <shared_mutex>
+#include <vector>
 
 #include <bitmap/raw-bitmap.h>
 #include <blobfs/common.h>
@@ -158,6 +159,10 @@ class Blobfs : public TransactionManager, public UserPager, public BlockIterator
 
   BlobCache& Cache() { return blob_cache_; }
 
+  // Responds to system memory pressure by shrinking the memory used by closed nodes and the pager
+  // read-ahead window.
+  void SetMemoryPressure(MemoryPressure level);
+
   zx_status_t Readdir(fs::vdircookie_t* cookie, void* dirents, size_t len, size_t* out_actual);
 
   BlockDevice* Device() const { return block_device_.get(); }
@@ -209,10 +214,10 @@ class Blobfs : public TransactionManager, public UserPager, public BlockIterator
   ////////////////
   // UserPager interface.
   //
-  // Allows populating (and verifying) the pager transfer buffer with a blob's blocks
+  // Allows populating (and verifying) the pager transfer buffers with a blob's blocks
   // from the block device.
-  [[nodiscard]] zx_status_t AttachTransferVmo(const zx::vmo& transfer_vmo) final;
-  [[nodiscard]] zx_status_t PopulateTransferVmo(uint64_t offset, uint64_t length,
+  [[nodiscard]] zx_status_t AttachTransferVmo(uint32_t index, const zx::vmo& transfer_vmo) final;
+  [[nodiscard]] zx_status_t PopulateTransferVmo(uint32_t index, uint64_t offset, uint64_t length,
                                                 const UserPagerInfo& info) final;
   [[nodiscard]] zx_status_t VerifyTransferVmo(uint64_t offset, uint64_t length,
                                               uint64_t buffer_length, const zx::vmo& transfer_vmo,
@@ -306,8 +311,10 @@ class Blobfs : public TransactionManager, public UserPager, public BlockIterator
 
   BlobfsMetrics metrics_ = {};
 
-  storage::Vmoid transfer_vmoid_;
+  // One per pager thread, indexed by the transfer buffer index.
+  std::vector<storage::Vmoid> transfer_vmoids_;
   bool paging_enabled_ = false;
+  bool read_ahead_enabled_ = false;
 
   BlobLoader loader_;
   std::shared_mutex fsck_at_end_of_transaction_mutex_;
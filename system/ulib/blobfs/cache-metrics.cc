@@ -0,0 +1,35 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cache-metrics.h"
+
+namespace blobfs {
+
+void CacheMetrics::IncrementHit() {
+  std::scoped_lock guard(mutex_);
+  ++hits_;
+}
+
+void CacheMetrics::IncrementMiss() {
+  std::scoped_lock guard(mutex_);
+  ++misses_;
+}
+
+void CacheMetrics::IncrementEviction(uint64_t bytes) {
+  std::scoped_lock guard(mutex_);
+  ++evictions_;
+  evicted_bytes_ += bytes;
+}
+
+CacheMetrics::Snapshot CacheMetrics::Get() {
+  std::scoped_lock guard(mutex_);
+  return Snapshot{
+      .hits = hits_,
+      .misses = misses_,
+      .evictions = evictions_,
+      .evicted_bytes = evicted_bytes_,
+  };
+}
+
+}  // namespace blobfs
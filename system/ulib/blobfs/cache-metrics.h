@@ -0,0 +1,56 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_BLOBFS_CACHE_METRICS_H_
+#define ZIRCON_SYSTEM_ULIB_BLOBFS_CACHE_METRICS_H_
+
+#include <stdint.h>
+#include <zircon/compiler.h>
+
+#include <mutex>
+
+namespace blobfs {
+
+// The |CacheMetrics| class tracks blobfs metrics related to the cache of closed blobs.
+//
+// This class is thread-safe. It is updated by the |BlobCache|, which may be used from any thread
+// that opens or closes blobs.
+class CacheMetrics {
+ public:
+  CacheMetrics() = default;
+  CacheMetrics(const CacheMetrics&) = delete;
+  CacheMetrics& operator=(const CacheMetrics&) = delete;
+
+  // Records a closed blob being reopened while its contents were still in memory.
+  void IncrementHit();
+
+  // Records a closed blob being reopened after its contents were released from memory.
+  void IncrementMiss();
+
+  // Records a closed blob having its contents released from memory to keep the cache within its
+  // memory budget.
+  void IncrementEviction(uint64_t bytes);
+
+  struct Snapshot {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t evicted_bytes;
+  };
+
+  // Returns a snapshot of the metrics.
+  Snapshot Get();
+
+ private:
+  uint64_t hits_ __TA_GUARDED(mutex_) = 0;
+  uint64_t misses_ __TA_GUARDED(mutex_) = 0;
+  uint64_t evictions_ __TA_GUARDED(mutex_) = 0;
+  uint64_t evicted_bytes_ __TA_GUARDED(mutex_) = 0;
+
+  std::mutex mutex_;
+};
+
+}  // namespace blobfs
+
+#endif  // ZIRCON_SYSTEM_ULIB_BLOBFS_CACHE_METRICS_H_
@@ -11,6 +11,7 @@
 
 #include <digest/digest.h>
 #include <fbl/function.h>
+#include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/mutex.h>
 #include <fbl/ref_ptr.h>
@@ -68,12 +69,55 @@ class CacheNode : public fs::Vnode,
   // The implementation of this method must not attempt to acquire a reference to |this|.
   virtual void ActivateLowMemory() = 0;
 
+  // Returns the number of bytes of memory which would be released by |ActivateLowMemory()|.
+  // This is used to bound the size of the "closed cache" for policies which do so.
+  //
+  // The implementation of this method must not invoke any other CacheNode methods.
+  // The implementation of this method must not attempt to acquire a reference to |this|.
+  virtual uint64_t GetMemoryUsage() const = 0;
+
+  // Returns whether the node holds any memory which |ActivateLowMemory()| would release. Unlike
+  // |GetMemoryUsage()|, this must be cheap, since the cache calls it with its lock held.
+  //
+  // The implementation of this method must not invoke any other CacheNode methods.
+  // The implementation of this method must not attempt to acquire a reference to |this|.
+  virtual bool IsResident() const = 0;
+
   // Returns the node's digest.
   const uint8_t* GetKey() const { return &digest_[0]; }
   digest::Digest GetKeyAsDigest() const { return digest::Digest(digest_); }
 
  private:
+  friend class BlobCache;
+
+  // Identifies which of the BlobCache's replacement lists the node is on, if any.
+  // Only meaningful while the node is in the "closed set", and guarded by the cache's lock.
+  enum class CacheList {
+    kNone,
+    // Resident in memory; closed once since it was last (re)loaded.
+    kRecent,
+    // Resident in memory; reopened while resident at least once.
+    kFrequent,
+    // Evicted from |kRecent| or |kFrequent|. Only the history of the node is kept.
+    kRecentGhost,
+    kFrequentGhost,
+  };
+
+  struct CacheListTraits {
+    static fbl::DoublyLinkedListNodeState<CacheNode*>& node_state(CacheNode& node) {
+      return node.cache_list_node_state_;
+    }
+  };
+
   uint8_t digest_[digest::kSha256Length] = {};
+
+  fbl::DoublyLinkedListNodeState<CacheNode*> cache_list_node_state_;
+  CacheList cache_list_ = CacheList::kNone;
+  // The memory usage of the node when it was placed on its current list.
+  uint64_t cache_list_bytes_ = 0;
+  // Set when the node is reopened from a replacement list, so that it is treated as frequently
+  // used when next closed.
+  bool cache_reused_ = false;
 };
 
 }  // namespace blobfs
@@ -14,6 +14,7 @@
 #include <memory>
 #include <new>
 #include <optional>
+#include <thread>
 #include <utility>
 
 #include <blobfs/compression-settings.h>
@@ -44,6 +45,11 @@ constexpr uint32_t kExtentCount = 5;
 namespace blobfs {
 namespace {
 
+// Blobs at least this large have their Merkle trees built on every core. Image builds already
+// hash several blobs at once, but without this a single large blob would leave the other cores
+// idle while it finishes.
+constexpr size_t kParallelMerkleThreshold = 32 * 1024 * 1024;
+
 // TODO(markdittmer): Abstract choice of host compressor, decompressor and metadata flag to support
 // choosing from multiple strategies. This has already been done in non-host code but host tools do
 // not use |BlobCompressor| the same way.
@@ -80,8 +86,12 @@ zx_status_t buffer_create_merkle(const FileMapping& mapping, MerkleInfo* out_inf
   zx_status_t status;
   std::unique_ptr<uint8_t[]> merkle_tree;
   size_t merkle_size;
+  size_t num_threads = 1;
+  if (mapping.length() >= kParallelMerkleThreshold) {
+    num_threads = std::thread::hardware_concurrency();
+  }
   if ((status = MerkleTreeCreator::Create(mapping.data(), mapping.length(), &merkle_tree,
-                                          &merkle_size, &out_info->digest)) != ZX_OK) {
+                                          &merkle_size, &out_info->digest, num_threads)) != ZX_OK) {
     return status;
   }
   out_info->merkle.reset(merkle_tree.release(), merkle_size);
@@ -5,6 +5,8 @@
 #ifndef BLOBFS_CACHE_POLICY_H_
 #define BLOBFS_CACHE_POLICY_H_
 
+#include <stdint.h>
+
 namespace blobfs {
 
 // CachePolicy describes the techniques used to cache blobs in memory, avoiding re-reading and
@@ -21,8 +23,19 @@ enum class CachePolicy {
   //
   // This option costs a significant amount of memory, but it results in high performance.
   NeverEvict,
+
+  // Nodes remain in memory after being closed, up to a memory budget for all closed nodes. When
+  // the budget is exceeded, |ActivateLowMemory()| is invoked on the nodes least likely to be
+  // reopened. Recently and frequently used nodes are balanced adaptively, in the style of ARC, so
+  // that a one-time scan over many blobs does not displace the blobs which are reopened often.
+  //
+  // This option bounds the memory cost of caching, and the budget shrinks under memory pressure.
+  EvictLeastRecentlyUsed,
 };
 
+// The default memory budget for closed nodes under |CachePolicy::EvictLeastRecentlyUsed|.
+constexpr uint64_t kDefaultCacheMemoryBudget = 64ull * 1024 * 1024;
+
 }  // namespace blobfs
 
 #endif  // BLOBFS_CACHE_POLICY_H_
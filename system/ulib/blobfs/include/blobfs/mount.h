@@ -7,6 +7,7 @@
 
 #include <lib/async-loop/default.h>
 #include <lib/zx/channel.h>
+#include <lib/zx/event.h>
 #include <lib/zx/resource.h>
 
 #include <blobfs/cache-policy.h>
@@ -18,6 +19,9 @@ namespace blobfs {
 
 using block_client::BlockDevice;
 
+// The default number of threads servicing page requests when the pager is enabled.
+constexpr uint32_t kDefaultPagerThreadCount = 2;
+
 // TODO(54521): This is a temporary measure. The diagnostics directory can
 // eventually be added to the outgoing dir passed via PA_DIRECTORY_REQUEST.
 #define FS_HANDLE_DIAGNOSTICS_DIR PA_HND(PA_USER0, 2)
@@ -51,10 +55,25 @@ struct MountOptions {
   bool metrics = false;
   bool journal = false;
   bool pager = false;
+  // Only used when |pager| is set. Must be between 1 and |kMaxPagerThreads|.
+  uint32_t pager_threads = kDefaultPagerThreadCount;
+  // Only used when |pager| is set. Extends sequential page requests with a read-ahead window
+  // that grows while the access pattern stays sequential.
+  bool pager_read_ahead = true;
   CachePolicy cache_policy = CachePolicy::EvictImmediately;
+  // Only used by |CachePolicy::EvictLeastRecentlyUsed|.
+  uint64_t cache_memory_budget = kDefaultCacheMemoryBudget;
   CompressionSettings compression_settings{};
 };
 
+// The kernel events signaled on entering each level of system memory pressure, as returned by
+// zx_system_get_event().
+struct MemoryPressureEvents {
+  zx::event normal;
+  zx::event warning;
+  zx::event critical;
+};
+
 // Begins serving requests to the filesystem by parsing the on-disk format using |device|. If
 // |ServeLayout| is |kDataRootOnly|, |root| serves the root of the filesystem. If it's
 // |kExportDirectory|, |root| serves an outgoing directory.
@@ -67,9 +86,13 @@ struct MountOptions {
 // |diagnostics_dir| is the server end of a diagnostics directory made for BlobFS.
 // The inspect tree is served in this directory. This directory will be visible to Archivist.
 //
+// If |memory_pressure| holds valid events, blobfs shrinks its blob cache and pager read-ahead while
+// memory pressure is elevated. Otherwise it runs as if memory pressure were always normal.
+//
 // This function blocks until the filesystem terminates.
 zx_status_t Mount(std::unique_ptr<BlockDevice> device, MountOptions* options, zx::channel root,
-                  ServeLayout layout, zx::resource vmex_resource, zx::channel diagnostics_dir);
+                  ServeLayout layout, zx::resource vmex_resource, zx::channel diagnostics_dir,
+                  MemoryPressureEvents memory_pressure = {});
 
 }  // namespace blobfs
 
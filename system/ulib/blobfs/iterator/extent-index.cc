@@ -0,0 +1,83 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extent-index.h"
+
+#include <stdint.h>
+#include <zircon/types.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <blobfs/format.h>
+
+namespace blobfs {
+namespace {
+
+// Iterates over the extents of an |ExtentIndex| from a given position.
+class IndexedExtentIterator : public ExtentIterator {
+ public:
+  IndexedExtentIterator(const std::vector<Extent>& extents, size_t extent_index,
+                        uint64_t block_index)
+      : extents_(extents), extent_index_(extent_index), block_index_(block_index) {}
+
+  bool Done() const final { return extent_index_ == extents_.size(); }
+
+  zx_status_t Next(const Extent** out) final {
+    ZX_DEBUG_ASSERT(!Done());
+    *out = &extents_[extent_index_];
+    block_index_ += extents_[extent_index_].Length();
+    extent_index_++;
+    return ZX_OK;
+  }
+
+  uint64_t BlockIndex() const final { return block_index_; }
+
+ private:
+  const std::vector<Extent>& extents_;
+  size_t extent_index_;
+  uint64_t block_index_;
+};
+
+}  // namespace
+
+zx_status_t ExtentIndex::Create(ExtentIterator* iterator, std::unique_ptr<ExtentIndex>* out) {
+  std::unique_ptr<ExtentIndex> index(new ExtentIndex());
+  while (!iterator->Done()) {
+    const Extent* extent;
+    zx_status_t status = iterator->Next(&extent);
+    if (status != ZX_OK) {
+      return status;
+    }
+    index->extents_.push_back(*extent);
+    index->block_offsets_.push_back(index->block_count_);
+    index->block_count_ += extent->Length();
+  }
+  *out = std::move(index);
+  return ZX_OK;
+}
+
+zx_status_t ExtentIndex::Lookup(uint64_t block, size_t* out_extent) const {
+  if (block >= block_count_) {
+    return ZX_ERR_OUT_OF_RANGE;
+  }
+  // The extent holding |block| is the last one beginning at or before it. Empty extents share
+  // their offset with the next extent, and are skipped by taking the last match.
+  auto next = std::upper_bound(block_offsets_.begin(), block_offsets_.end(), block);
+  *out_extent = static_cast<size_t>(next - block_offsets_.begin()) - 1;
+  return ZX_OK;
+}
+
+zx_status_t ExtentIndex::IteratorAtBlock(uint64_t block,
+                                         std::unique_ptr<ExtentIterator>* out) const {
+  size_t extent;
+  zx_status_t status = Lookup(block, &extent);
+  if (status != ZX_OK) {
+    return status;
+  }
+  *out = std::make_unique<IndexedExtentIterator>(extents_, extent, block_offsets_[extent]);
+  return ZX_OK;
+}
+
+}  // namespace blobfs
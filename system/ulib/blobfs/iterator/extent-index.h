@@ -0,0 +1,63 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_BLOBFS_ITERATOR_EXTENT_INDEX_H_
+#define ZIRCON_SYSTEM_ULIB_BLOBFS_ITERATOR_EXTENT_INDEX_H_
+
+#include <stdint.h>
+#include <zircon/types.h>
+
+#include <memory>
+#include <vector>
+
+#include <blobfs/format.h>
+
+#include "extent-iterator.h"
+
+namespace blobfs {
+
+// An in-memory copy of a node's extents, sorted by the node block at which each one begins.
+//
+// Finding the extent which holds an arbitrary block of a node otherwise requires walking the
+// node's chain of extent containers from the start, which is costly for large fragmented blobs
+// read at high offsets. The index finds it with a binary search instead.
+//
+// The index is a copy, so it is only valid while the node's extents are unchanged. Blobs are
+// immutable once written.
+class ExtentIndex {
+ public:
+  ExtentIndex(const ExtentIndex&) = delete;
+  ExtentIndex& operator=(const ExtentIndex&) = delete;
+
+  // Consumes |iterator| to the end, indexing every extent it returns.
+  static zx_status_t Create(ExtentIterator* iterator, std::unique_ptr<ExtentIndex>* out);
+
+  size_t ExtentCount() const { return extents_.size(); }
+
+  // Returns the number of blocks in all the indexed extents.
+  uint64_t BlockCount() const { return block_count_; }
+
+  // Returns the position of the extent which holds node block |block| in |out_extent|, or
+  // ZX_ERR_OUT_OF_RANGE if |block| is not below |BlockCount()|.
+  zx_status_t Lookup(uint64_t block, size_t* out_extent) const;
+
+  // Returns an iterator over the indexed extents, beginning with the one which holds |block|. The
+  // iterator's |BlockIndex()| starts at the first block of that extent, so a |BlockIterator|
+  // wrapping it reaches |block| with a single call to |IterateToBlock|.
+  //
+  // The iterator must not outlive the index.
+  zx_status_t IteratorAtBlock(uint64_t block, std::unique_ptr<ExtentIterator>* out) const;
+
+ private:
+  ExtentIndex() = default;
+
+  std::vector<Extent> extents_;
+  // |block_offsets_[i]| is the node block at which |extents_[i]| begins.
+  std::vector<uint64_t> block_offsets_;
+  uint64_t block_count_ = 0;
+};
+
+}  // namespace blobfs
+
+#endif  // ZIRCON_SYSTEM_ULIB_BLOBFS_ITERATOR_EXTENT_INDEX_H_
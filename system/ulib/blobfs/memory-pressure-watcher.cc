@@ -0,0 +1,86 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "memory-pressure-watcher.h"
+
+#include <zircon/status.h>
+
+#include <utility>
+
+#include <fs/trace.h>
+
+namespace blobfs {
+namespace {
+
+constexpr MemoryPressure kLevels[] = {MemoryPressure::kNormal, MemoryPressure::kWarning,
+                                      MemoryPressure::kCritical};
+
+size_t LevelIndex(MemoryPressure level) { return static_cast<size_t>(level); }
+
+}  // namespace
+
+MemoryPressureWatcher::MemoryPressureWatcher(async_dispatcher_t* dispatcher,
+                                             MemoryPressureEvents events, Callback callback)
+    : dispatcher_(dispatcher), callback_(std::move(callback)) {
+  events_[LevelIndex(MemoryPressure::kNormal)] = std::move(events.normal);
+  events_[LevelIndex(MemoryPressure::kWarning)] = std::move(events.warning);
+  events_[LevelIndex(MemoryPressure::kCritical)] = std::move(events.critical);
+  for (MemoryPressure level : kLevels) {
+    async::Wait& wait = waits_[LevelIndex(level)];
+    wait.set_object(events_[LevelIndex(level)].get());
+    wait.set_trigger(ZX_EVENT_SIGNALED);
+    wait.set_handler([this, level](async_dispatcher_t*, async::Wait*, zx_status_t status,
+                                   const zx_packet_signal_t*) { OnSignaled(level, status); });
+  }
+}
+
+zx_status_t MemoryPressureWatcher::Create(async_dispatcher_t* dispatcher,
+                                          MemoryPressureEvents events, Callback callback,
+                                          std::unique_ptr<MemoryPressureWatcher>* out) {
+  if (!events.normal.is_valid() || !events.warning.is_valid() || !events.critical.is_valid()) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+  std::unique_ptr<MemoryPressureWatcher> watcher(
+      new MemoryPressureWatcher(dispatcher, std::move(events), std::move(callback)));
+
+  // Wait for every level until the first one is reported.
+  for (async::Wait& wait : watcher->waits_) {
+    zx_status_t status = wait.Begin(dispatcher);
+    if (status != ZX_OK) {
+      return status;
+    }
+  }
+  *out = std::move(watcher);
+  return ZX_OK;
+}
+
+zx_status_t MemoryPressureWatcher::WaitForChange(MemoryPressure current) {
+  for (MemoryPressure level : kLevels) {
+    async::Wait& wait = waits_[LevelIndex(level)];
+    if (level == current) {
+      wait.Cancel();
+    } else if (!wait.is_pending()) {
+      zx_status_t status = wait.Begin(dispatcher_);
+      if (status != ZX_OK) {
+        return status;
+      }
+    }
+  }
+  return ZX_OK;
+}
+
+void MemoryPressureWatcher::OnSignaled(MemoryPressure level, zx_status_t status) {
+  if (status != ZX_OK) {
+    // The dispatcher is shutting down.
+    return;
+  }
+  callback_(level);
+  status = WaitForChange(level);
+  if (status != ZX_OK) {
+    FS_TRACE_ERROR("blobfs: Failed to wait for memory pressure changes: %s\n",
+                   zx_status_get_string(status));
+  }
+}
+
+}  // namespace blobfs
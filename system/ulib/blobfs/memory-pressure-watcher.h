@@ -0,0 +1,60 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_BLOBFS_MEMORY_PRESSURE_WATCHER_H_
+#define ZIRCON_SYSTEM_ULIB_BLOBFS_MEMORY_PRESSURE_WATCHER_H_
+
+#include <lib/async/cpp/wait.h>
+#include <lib/async/dispatcher.h>
+#include <lib/fit/function.h>
+#include <lib/zx/event.h>
+
+#include <array>
+#include <memory>
+
+#include <blobfs/mount.h>
+
+#include "blob-cache.h"
+
+namespace blobfs {
+
+// Reports changes in system memory pressure to a callback, by waiting for the kernel events
+// signaled on entering each level.
+//
+// The kernel keeps the event of the current level signaled, so the watcher only waits on the
+// events of the other levels. All callbacks run on |dispatcher|, and the watcher must be destroyed
+// on it too.
+class MemoryPressureWatcher {
+ public:
+  using Callback = fit::function<void(MemoryPressure level)>;
+
+  MemoryPressureWatcher(const MemoryPressureWatcher&) = delete;
+  MemoryPressureWatcher& operator=(const MemoryPressureWatcher&) = delete;
+
+  // Starts watching |events|, which must all be valid. |callback| is invoked with the current
+  // level as soon as it is known, and then on every change.
+  static zx_status_t Create(async_dispatcher_t* dispatcher, MemoryPressureEvents events,
+                            Callback callback, std::unique_ptr<MemoryPressureWatcher>* out);
+
+ private:
+  MemoryPressureWatcher(async_dispatcher_t* dispatcher, MemoryPressureEvents events,
+                        Callback callback);
+
+  // Waits for every level other than |current|.
+  zx_status_t WaitForChange(MemoryPressure current);
+
+  void OnSignaled(MemoryPressure level, zx_status_t status);
+
+  static constexpr size_t kLevels = 3;
+
+  async_dispatcher_t* dispatcher_;
+  // Indexed by MemoryPressure.
+  std::array<zx::event, kLevels> events_;
+  Callback callback_;
+  std::array<async::Wait, kLevels> waits_;
+};
+
+}  // namespace blobfs
+
+#endif  // ZIRCON_SYSTEM_ULIB_BLOBFS_MEMORY_PRESSURE_WATCHER_H_
@@ -82,6 +82,52 @@ void BlobfsMetrics::Dump() {
                   TicksToMs(zx::ticks(read_snapshot.read_time)),
                   TicksToMs(zx::ticks(verify_snapshot.verification_time)));
   }
+
+  auto cache_snapshot = cache_metrics_.Get();
+  FS_TRACE_INFO("Cache Info:\n");
+  FS_TRACE_INFO("  Reopened %zu closed blobs from memory, %zu after eviction\n",
+                cache_snapshot.hits, cache_snapshot.misses);
+  FS_TRACE_INFO("  Evicted %zu closed blobs (%zu MB)\n", cache_snapshot.evictions,
+                cache_snapshot.evicted_bytes / mb);
+
+  auto pager_snapshot = pager_metrics_.Get();
+  FS_TRACE_INFO("Pager Info:\n");
+  FS_TRACE_INFO("  Serviced %zu page requests (%zu MB), %zu failed, in %zu ms\n",
+                pager_snapshot.requests, pager_snapshot.requested_bytes / mb,
+                pager_snapshot.failed_requests, pager_snapshot.total_latency.to_msecs());
+  FS_TRACE_INFO("  Read ahead of %zu page requests (%zu MB)\n", pager_snapshot.read_ahead_requests,
+                pager_snapshot.read_ahead_bytes / mb);
+}
+
+fit::promise<inspect::Inspector> BlobfsMetrics::InspectCache() {
+  auto snapshot = cache_metrics_.Get();
+  inspect::Inspector inspector;
+  inspect::Node& root = inspector.GetRoot();
+  root.CreateUint("hits", snapshot.hits, &inspector);
+  root.CreateUint("misses", snapshot.misses, &inspector);
+  root.CreateUint("evictions", snapshot.evictions, &inspector);
+  root.CreateUint("evicted_bytes", snapshot.evicted_bytes, &inspector);
+  return fit::make_ok_promise(std::move(inspector));
+}
+
+fit::promise<inspect::Inspector> BlobfsMetrics::InspectPager() {
+  auto snapshot = pager_metrics_.Get();
+  inspect::Inspector inspector;
+  inspect::Node& root = inspector.GetRoot();
+  root.CreateUint("requests", snapshot.requests, &inspector);
+  root.CreateUint("failed_requests", snapshot.failed_requests, &inspector);
+  root.CreateUint("requested_bytes", snapshot.requested_bytes, &inspector);
+  root.CreateUint("read_ahead_requests", snapshot.read_ahead_requests, &inspector);
+  root.CreateUint("read_ahead_bytes", snapshot.read_ahead_bytes, &inspector);
+  root.CreateUint("total_latency_us", snapshot.total_latency.to_usecs(), &inspector);
+  // Slot i counts requests that took [2^(i-1), 2^i) microseconds; see |PagerMetrics|.
+  auto histogram =
+      root.CreateUintArray("latency_us_log2_histogram", snapshot.latency_histogram.size());
+  for (size_t i = 0; i < snapshot.latency_histogram.size(); i++) {
+    histogram.Set(i, snapshot.latency_histogram[i]);
+  }
+  inspector.emplace(std::move(histogram));
+  return fit::make_ok_promise(std::move(inspector));
 }
 
 void BlobfsMetrics::ScheduleMetricFlush() {
@@ -21,6 +21,8 @@
 #include <fs/ticker.h>
 #include <fs/vnode.h>
 
+#include "cache-metrics.h"
+#include "pager-metrics.h"
 #include "read-metrics.h"
 #include "verification-metrics.h"
 
@@ -29,7 +31,8 @@ namespace blobfs {
 // Alias for the LatencyEvent used in blobfs.
 using LatencyEvent = fs_metrics::CompositeLatencyEvent;
 
-// This class is not thread-safe except for the read_metrics() and verification_metrics() accessors.
+// This class is not thread-safe except for the read_metrics(), verification_metrics(),
+// cache_metrics() and pager_metrics() accessors.
 class BlobfsMetrics {
  public:
   ~BlobfsMetrics();
@@ -75,6 +78,14 @@ class BlobfsMetrics {
   ReadMetrics& read_metrics() { return read_metrics_; }
   VerificationMetrics& verification_metrics() { return verification_metrics_; }
 
+  // Accessor for the closed blob cache metrics, which are updated by the |BlobCache|. The metrics
+  // object returned is thread-safe.
+  CacheMetrics& cache_metrics() { return cache_metrics_; }
+
+  // Accessor for the page request metrics, which are updated by the user pager threads. The metrics
+  // object returned is thread-safe.
+  PagerMetrics& pager_metrics() { return pager_metrics_; }
+
   // Accessor for BlobFS Inspector. This Inspector serves the BlobFS inspect tree.
   inspect::Inspector* inspector() { return &inspector_; }
 
@@ -85,6 +96,12 @@ class BlobfsMetrics {
   // Flushes the metrics to the cobalt client and schedules itself to flush again.
   void ScheduleMetricFlush();
 
+  // Returns a snapshot of |cache_metrics_| for the inspect tree.
+  fit::promise<inspect::Inspector> InspectCache();
+
+  // Returns a snapshot of |pager_metrics_| for the inspect tree.
+  fit::promise<inspect::Inspector> InspectPager();
+
   // ALLOCATION STATS
 
   // Created with external-facing "Create".
@@ -114,6 +131,12 @@ class BlobfsMetrics {
   // VERIFICATION STATS
   VerificationMetrics verification_metrics_;
 
+  // CACHE STATS
+  CacheMetrics cache_metrics_;
+
+  // PAGER STATS
+  PagerMetrics pager_metrics_;
+
   // FVM STATS
   // TODO(smklein)
 
@@ -122,6 +145,10 @@ class BlobfsMetrics {
       inspect::InspectSettings{.maximum_size = 2 * fs_metrics::Histograms::Size()});
   inspect::Node& root_ = inspector_.GetRoot();
   fs_metrics::Histograms histograms_ = fs_metrics::Histograms(&root_);
+  // Exposes |cache_metrics_| under "cache", sampled whenever the inspect tree is read.
+  inspect::LazyNode cache_node_ = root_.CreateLazyNode("cache", [this] { return InspectCache(); });
+  // Exposes |pager_metrics_| under "pager", sampled whenever the inspect tree is read.
+  inspect::LazyNode pager_node_ = root_.CreateLazyNode("pager", [this] { return InspectPager(); });
 
   // local_storage project ID as defined in cobalt-analytics projects.yaml.
   static constexpr uint32_t kCobaltProjectId = 3676913920;
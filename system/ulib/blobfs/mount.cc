@@ -16,7 +16,8 @@
 namespace blobfs {
 
 zx_status_t Mount(std::unique_ptr<BlockDevice> device, MountOptions* options, zx::channel root,
-                  ServeLayout layout, zx::resource vmex_resource, zx::channel diagnostics_dir) {
+                  ServeLayout layout, zx::resource vmex_resource, zx::channel diagnostics_dir,
+                  MemoryPressureEvents memory_pressure) {
   async::Loop loop(&kAsyncLoopConfigNoAttachToCurrentThread);
   trace::TraceProviderWithFdio provider(loop.dispatcher());
 
@@ -27,6 +28,8 @@ zx_status_t Mount(std::unique_ptr<BlockDevice> device, MountOptions* options, zx
     return status;
   }
 
+  runner->WatchMemoryPressure(std::move(memory_pressure));
+
   status = runner->ServeRoot(std::move(root), layout);
   if (status != ZX_OK) {
     return status;
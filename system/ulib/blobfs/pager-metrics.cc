@@ -0,0 +1,56 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "pager-metrics.h"
+
+#include <algorithm>
+
+namespace blobfs {
+
+namespace {
+
+size_t LatencyBucket(zx::duration latency) {
+  const uint64_t us = std::max<int64_t>(latency.to_usecs(), 0);
+  // The bucket is the number of significant bits in |us|.
+  size_t bucket = 0;
+  for (uint64_t v = us; v != 0; v >>= 1) {
+    bucket++;
+  }
+  return std::min(bucket, PagerMetrics::kLatencyBuckets - 1);
+}
+
+}  // namespace
+
+void PagerMetrics::RecordPageRequest(uint64_t length, zx::duration latency, bool succeeded) {
+  const size_t bucket = LatencyBucket(latency);
+  std::scoped_lock guard(mutex_);
+  ++requests_;
+  if (!succeeded) {
+    ++failed_requests_;
+  }
+  requested_bytes_ += length;
+  total_latency_ += latency;
+  ++latency_histogram_[bucket];
+}
+
+void PagerMetrics::RecordReadAhead(uint64_t length) {
+  std::scoped_lock guard(mutex_);
+  ++read_ahead_requests_;
+  read_ahead_bytes_ += length;
+}
+
+PagerMetrics::Snapshot PagerMetrics::Get() {
+  std::scoped_lock guard(mutex_);
+  return Snapshot{
+      .requests = requests_,
+      .failed_requests = failed_requests_,
+      .requested_bytes = requested_bytes_,
+      .read_ahead_requests = read_ahead_requests_,
+      .read_ahead_bytes = read_ahead_bytes_,
+      .total_latency = total_latency_,
+      .latency_histogram = latency_histogram_,
+  };
+}
+
+}  // namespace blobfs
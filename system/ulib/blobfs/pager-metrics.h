@@ -0,0 +1,65 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_BLOBFS_PAGER_METRICS_H_
+#define ZIRCON_SYSTEM_ULIB_BLOBFS_PAGER_METRICS_H_
+
+#include <lib/zx/time.h>
+#include <stdint.h>
+#include <zircon/compiler.h>
+
+#include <array>
+#include <mutex>
+
+namespace blobfs {
+
+// The |PagerMetrics| class tracks how long the user pager takes to service page requests, and how
+// much it reads ahead of them.
+//
+// This class is thread-safe. It is updated concurrently by every pager thread.
+class PagerMetrics {
+ public:
+  // Page request latencies are bucketed by powers of two microseconds: bucket 0 holds requests
+  // that took less than 1us, bucket i > 0 those that took [2^(i-1), 2^i) us, and the last bucket
+  // everything slower.
+  static constexpr size_t kLatencyBuckets = 24;
+
+  PagerMetrics() = default;
+  PagerMetrics(const PagerMetrics&) = delete;
+  PagerMetrics& operator=(const PagerMetrics&) = delete;
+
+  // Records a page request for |length| bytes that took |latency| to service, successfully or not.
+  void RecordPageRequest(uint64_t length, zx::duration latency, bool succeeded);
+
+  // Records |length| bytes requested past the end of a page request by read-ahead.
+  void RecordReadAhead(uint64_t length);
+
+  struct Snapshot {
+    uint64_t requests;
+    uint64_t failed_requests;
+    uint64_t requested_bytes;
+    uint64_t read_ahead_requests;
+    uint64_t read_ahead_bytes;
+    zx::duration total_latency;
+    std::array<uint64_t, kLatencyBuckets> latency_histogram;
+  };
+
+  // Returns a snapshot of the metrics.
+  Snapshot Get();
+
+ private:
+  uint64_t requests_ __TA_GUARDED(mutex_) = 0;
+  uint64_t failed_requests_ __TA_GUARDED(mutex_) = 0;
+  uint64_t requested_bytes_ __TA_GUARDED(mutex_) = 0;
+  uint64_t read_ahead_requests_ __TA_GUARDED(mutex_) = 0;
+  uint64_t read_ahead_bytes_ __TA_GUARDED(mutex_) = 0;
+  zx::duration total_latency_ __TA_GUARDED(mutex_) = {};
+  std::array<uint64_t, kLatencyBuckets> latency_histogram_ __TA_GUARDED(mutex_) = {};
+
+  std::mutex mutex_;
+};
+
+}  // namespace blobfs
+
+#endif  // ZIRCON_SYSTEM_ULIB_BLOBFS_PAGER_METRICS_H_
@@ -33,7 +33,10 @@ zx_status_t PageWatcher::CreatePagedVmo(size_t vmo_size, zx::vmo* vmo_out) {
     fbl::AutoLock guard(&vmo_attached_mutex_);
     vmo_attached_to_pager_ = true;
   }
-  vmo_ = zx::unowned_vmo(vmo);
+  {
+    fbl::AutoLock transfer_guard(&transfer_mutex_);
+    vmo_ = zx::unowned_vmo(vmo);
+  }
   *vmo_out = std::move(vmo);
   return ZX_OK;
 }
@@ -50,7 +53,7 @@ void PageWatcher::DetachPagedVmoSync() {
   }
 }
 
-// Called from the singleton userpager thread.
+// Called from a pager thread.
 void PageWatcher::HandlePageRequest(async_dispatcher_t* dispatcher, async::PagedVmoBase* paged_vmo,
                                     zx_status_t status, const zx_packet_page_request_t* request) {
   TRACE_DURATION("blobfs", "PageWatcher::HandlePageRequest", "command", request->command, "offset",
@@ -84,11 +87,13 @@ void PageWatcher::HandlePageRequest(async_dispatcher_t* dispatcher, async::Paged
   }
 }
 
-// Called from the singleton userpager thread.
+// Called from a pager thread.
 void PageWatcher::PopulateAndVerifyPagesInRange(uint64_t offset, uint64_t length) {
   TRACE_DURATION("blobfs", "PageWatcher::PopulateAndVerifyPagesInRange", "offset", offset, "length",
                  length);
 
+  // Page requests on the same blob are serviced one at a time; see |transfer_mutex_|.
+  fbl::AutoLock transfer_guard(&transfer_mutex_);
   if (!vmo_->is_valid()) {
     FS_TRACE_ERROR("blobfs: pager VMO is not valid.\n");
     // Return without calling op_range(ZX_PAGER_OP_FAIL), since that requires a valid pager VMO
@@ -103,7 +108,8 @@ void PageWatcher::PopulateAndVerifyPagesInRange(uint64_t offset, uint64_t length
     FS_TRACE_ERROR("blobfs: Pager failed page request because blob is corrupt, error: %s\n",
                    zx_status_get_string(static_cast<zx_status_t>(pager_error_status)));
   } else {
-    pager_error_status = user_pager_->TransferPagesToVmo(offset, length, *vmo_, userpager_info_);
+    pager_error_status =
+        user_pager_->TransferPagesToVmo(offset, length, *vmo_, userpager_info_, &read_ahead_);
     if (pager_error_status != PagerErrorStatus::kOK) {
       FS_TRACE_ERROR("blobfs: Pager failed to transfer pages to the blob, error: %s\n",
                      zx_status_get_string(static_cast<zx_status_t>(pager_error_status)));
@@ -136,11 +142,15 @@ void PageWatcher::PopulateAndVerifyPagesInRange(uint64_t offset, uint64_t length
   }
 }
 
-// Called from the singleton userpager thread.
+// Called from a pager thread.
 void PageWatcher::SignalPagerDetach() {
   TRACE_DURATION("blobfs", "PageWatcher::SignalPagerDetach");
-  // Reset the mapping so that future read requests on this VMO will be ignored.
-  vmo_ = zx::unowned_vmo(ZX_HANDLE_INVALID);
+  {
+    // Reset the mapping so that future read requests on this VMO will be ignored. Waits for a page
+    // request in flight on another pager thread to finish with the VMO first.
+    fbl::AutoLock transfer_guard(&transfer_mutex_);
+    vmo_ = zx::unowned_vmo(ZX_HANDLE_INVALID);
+  }
 
   // Complete the paged vmo detach. Any in-flight read requests that arrive after this will be
   // ignored.
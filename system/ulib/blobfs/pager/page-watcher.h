@@ -92,8 +92,13 @@ class PageWatcher {
   // Pointer to the user pager. Required to create the paged VMO and populate its pages.
   UserPager* const user_pager_;
 
+  // Serializes page requests on this blob, which may be delivered to any of the pager threads.
+  // The verifier and decompressor in |userpager_info_| keep per-blob state and are not
+  // thread-safe. Acquired before |vmo_attached_mutex_| when both are held.
+  fbl::Mutex transfer_mutex_;
+
   // Unowned VMO corresponding to the paged VMO. Used by |page_request_handler_| to populate pages.
-  zx::unowned_vmo vmo_;
+  zx::unowned_vmo vmo_ __TA_GUARDED(transfer_mutex_);
 
   // Various bits of information passed on to the user pager, not used directly by the page watcher.
   // Set at time of creation.
@@ -101,7 +106,10 @@ class PageWatcher {
 
   // Indicates whether the data is corrupt. Once a corruption is discovered on any portion of the
   // blob, all further page requests on the entire blob must fail.
-  bool is_corrupt_ = false;
+  bool is_corrupt_ __TA_GUARDED(transfer_mutex_) = false;
+
+  // Access pattern on the blob, used by |user_pager_| to size read-ahead.
+  ReadAheadState read_ahead_ __TA_GUARDED(transfer_mutex_);
 };
 
 }  // namespace blobfs
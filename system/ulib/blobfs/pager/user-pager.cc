@@ -6,6 +6,7 @@
 
 #include <lib/fzl/owned-vmo-mapper.h>
 #include <lib/fzl/vmo-mapper.h>
+#include <lib/zx/clock.h>
 #include <limits.h>
 #include <zircon/status.h>
 
@@ -14,59 +15,99 @@
 
 #include <blobfs/format.h>
 #include <fbl/auto_call.h>
+#include <fbl/auto_lock.h>
 #include <fs/trace.h>
 
 #include "compression/zstd-seekable.h"
 
 namespace blobfs {
 
-zx_status_t UserPager::InitPager() {
-  TRACE_DURATION("blobfs", "UserPager::InitPager");
+zx_status_t UserPager::InitPager(uint32_t thread_count, PagerMetrics* metrics) {
+  TRACE_DURATION("blobfs", "UserPager::InitPager", "thread_count", thread_count);
 
   // Make sure blocks are page-aligned.
   static_assert(kBlobfsBlockSize % PAGE_SIZE == 0);
   // Make sure the pager transfer buffer is block-aligned.
   static_assert(kTransferBufferSize % kBlobfsBlockSize == 0);
 
-  // Set up the pager transfer buffer.
-  zx_status_t status = zx::vmo::create(kTransferBufferSize, 0, &transfer_buffer_);
-  if (status != ZX_OK) {
-    FS_TRACE_ERROR("blobfs: Cannot create pager transfer buffer: %s\n",
-                   zx_status_get_string(status));
-    return status;
+  if (thread_count == 0 || thread_count > kMaxPagerThreads) {
+    FS_TRACE_ERROR("blobfs: Invalid pager thread count %u\n", thread_count);
+    return ZX_ERR_INVALID_ARGS;
   }
-  status = AttachTransferVmo(transfer_buffer_);
-  if (status != ZX_OK) {
-    FS_TRACE_ERROR("blobfs: Failed to attach pager transfer vmo: %s\n",
-                   zx_status_get_string(status));
-    return status;
+  metrics_ = metrics;
+
+  for (uint32_t i = 0; i < thread_count; i++) {
+    auto buffers = std::make_unique<TransferBuffers>();
+    buffers->index = i;
+
+    // Set up the pager transfer buffer.
+    zx_status_t status = zx::vmo::create(kTransferBufferSize, 0, &buffers->transfer_buffer);
+    if (status != ZX_OK) {
+      FS_TRACE_ERROR("blobfs: Cannot create pager transfer buffer: %s\n",
+                     zx_status_get_string(status));
+      return status;
+    }
+    status = AttachTransferVmo(i, buffers->transfer_buffer);
+    if (status != ZX_OK) {
+      FS_TRACE_ERROR("blobfs: Failed to attach pager transfer vmo: %s\n",
+                     zx_status_get_string(status));
+      return status;
+    }
+
+    // Set up the decompress buffer.
+    status = zx::vmo::create(kDecompressionBufferSize, 0, &buffers->decompression_buffer);
+    if (status != ZX_OK) {
+      FS_TRACE_ERROR("blobfs: Cannot create pager decompress buffer: %s\n",
+                     zx_status_get_string(status));
+      return status;
+    }
+
+    transfer_buffers_.push_back(std::move(buffers));
   }
-
-  // Set up the decompress buffer.
-  status = zx::vmo::create(kDecompressionBufferSize, 0, &decompression_buffer_);
-  if (status != ZX_OK) {
-    FS_TRACE_ERROR("blobfs: Cannot create pager decompress buffer: %s\n",
-                   zx_status_get_string(status));
-    return status;
+  {
+    fbl::AutoLock guard(&buffers_mutex_);
+    for (const auto& buffers : transfer_buffers_) {
+      idle_buffers_.push_back(buffers.get());
+    }
   }
 
   // Create the pager.
-  status = zx::pager::create(0, &pager_);
+  zx_status_t status = zx::pager::create(0, &pager_);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: Cannot initialize pager\n");
     return status;
   }
 
-  // Start the pager thread.
-  status = pager_loop_.StartThread("blobfs-pager-thread");
-  if (status != ZX_OK) {
-    FS_TRACE_ERROR("blobfs: Could not start pager thread\n");
-    return status;
+  // Start the pager threads.
+  for (uint32_t i = 0; i < thread_count; i++) {
+    status = pager_loop_.StartThread("blobfs-pager-thread");
+    if (status != ZX_OK) {
+      FS_TRACE_ERROR("blobfs: Could not start pager thread\n");
+      return status;
+    }
   }
 
   return ZX_OK;
 }
 
+UserPager::TransferBuffers* UserPager::AcquireTransferBuffers() {
+  fbl::AutoLock guard(&buffers_mutex_);
+  while (idle_buffers_.empty()) {
+    buffers_available_.Wait(&buffers_mutex_);
+  }
+  TransferBuffers* buffers = idle_buffers_.back();
+  idle_buffers_.pop_back();
+  return buffers;
+}
+
+void UserPager::ReleaseTransferBuffers(TransferBuffers* buffers) {
+  {
+    fbl::AutoLock guard(&buffers_mutex_);
+    idle_buffers_.push_back(buffers);
+  }
+  buffers_available_.Signal();
+}
+
 UserPager::ReadRange UserPager::GetBlockAlignedReadRange(const UserPagerInfo& info, uint64_t offset,
                                                          uint64_t length) {
   ZX_DEBUG_ASSERT(offset < info.data_length_bytes);
@@ -109,8 +150,29 @@ UserPager::ReadRange UserPager::GetBlockAlignedExtendedRange(const UserPagerInfo
   return GetBlockAlignedReadRange(info, read_ahead_offset, read_ahead_length);
 }
 
+uint64_t UserPager::ExtendForReadAhead(uint64_t offset, uint64_t length, const UserPagerInfo& info,
+                                       ReadAheadState* state) {
+  const uint64_t max_read_ahead = max_read_ahead_.load(std::memory_order_relaxed);
+  // ZSTD Seekable reads go through a compressed-space buffer that only holds a single frame.
+  if (max_read_ahead == 0 || info.zstd_seekable_blob_collection != nullptr ||
+      offset >= info.data_length_bytes) {
+    state->window = 0;
+    return length;
+  }
+
+  // The kernel only sends requests for pages which are not present, so a sequential reader faults
+  // exactly at the end of the range supplied for its previous request.
+  if (state->supplied_end != 0 && offset == state->supplied_end) {
+    state->window = std::min(std::max(state->window * 2, kMinReadAheadWindow), max_read_ahead);
+  } else {
+    state->window = 0;
+  }
+  return std::max(length, std::min(length + state->window, info.data_length_bytes - offset));
+}
+
 PagerErrorStatus UserPager::TransferPagesToVmo(uint64_t offset, uint64_t length, const zx::vmo& vmo,
-                                               const UserPagerInfo& info) {
+                                               const UserPagerInfo& info,
+                                               ReadAheadState* read_ahead) {
   size_t end;
   if (add_overflow(offset, length, &end)) {
     FS_TRACE_ERROR("blobfs: pager transfer range would overflow (off=%lu, len=%lu)\n", offset,
@@ -118,19 +180,45 @@ PagerErrorStatus UserPager::TransferPagesToVmo(uint64_t offset, uint64_t length,
     return PagerErrorStatus::kErrBadState;
   }
 
+  uint64_t transfer_length = length;
+  if (read_ahead != nullptr) {
+    transfer_length = ExtendForReadAhead(offset, length, info, read_ahead);
+  }
+
+  const zx::time start = zx::clock::get_monotonic();
+  TransferBuffers* buffers = AcquireTransferBuffers();
+  uint64_t supplied_end = 0;
+  PagerErrorStatus result;
   if (info.decompressor != nullptr) {
-    return TransferChunkedPagesToVmo(offset, length, vmo, info);
+    result = TransferChunkedPagesToVmo(offset, transfer_length, vmo, info, buffers, &supplied_end);
   } else if (info.zstd_seekable_blob_collection != nullptr) {
-    return TransferZSTDSeekablePagesToVmo(offset, length, vmo, info);
+    result =
+        TransferZSTDSeekablePagesToVmo(offset, transfer_length, vmo, info, buffers, &supplied_end);
   } else {
-    return TransferUncompressedPagesToVmo(offset, length, vmo, info);
+    result =
+        TransferUncompressedPagesToVmo(offset, transfer_length, vmo, info, buffers, &supplied_end);
   }
+  ReleaseTransferBuffers(buffers);
+
+  if (read_ahead != nullptr) {
+    read_ahead->supplied_end = result == PagerErrorStatus::kOK ? supplied_end : 0;
+  }
+  if (metrics_ != nullptr) {
+    metrics_->RecordPageRequest(length, zx::clock::get_monotonic() - start,
+                                result == PagerErrorStatus::kOK);
+    if (transfer_length > length) {
+      metrics_->RecordReadAhead(transfer_length - length);
+    }
+  }
+  return result;
 }
 
 PagerErrorStatus UserPager::TransferUncompressedPagesToVmo(uint64_t requested_offset,
                                                            uint64_t requested_length,
                                                            const zx::vmo& vmo,
-                                                           const UserPagerInfo& info) {
+                                                           const UserPagerInfo& info,
+                                                           TransferBuffers* buffers,
+                                                           uint64_t* supplied_end) {
   ZX_DEBUG_ASSERT(!info.decompressor);
 
   const auto [offset, length] =
@@ -139,15 +227,15 @@ PagerErrorStatus UserPager::TransferUncompressedPagesToVmo(uint64_t requested_of
   TRACE_DURATION("blobfs", "UserPager::TransferUncompressedPagesToVmo", "offset", offset, "length",
                  length);
 
-  auto decommit = fbl::MakeAutoCall([this, length = length]() {
-    // Decommit pages in the transfer buffer that might have been populated. All blobs share the
-    // same transfer buffer - this prevents data leaks between different blobs.
-    transfer_buffer_.op_range(ZX_VMO_OP_DECOMMIT, 0, fbl::round_up(length, kBlobfsBlockSize),
-                              nullptr, 0);
+  auto decommit = fbl::MakeAutoCall([buffers, length = length]() {
+    // Decommit pages in the transfer buffer that might have been populated. Buffers are reused
+    // across blobs - this prevents data leaks between different blobs.
+    buffers->transfer_buffer.op_range(ZX_VMO_OP_DECOMMIT, 0,
+                                      fbl::round_up(length, kBlobfsBlockSize), nullptr, 0);
   });
 
   // Read from storage into the transfer buffer.
-  zx_status_t status = PopulateTransferVmo(offset, length, info);
+  zx_status_t status = PopulateTransferVmo(buffers->index, offset, length, info);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferUncompressed: Failed to populate transfer vmo: %s\n",
                    zx_status_get_string(status));
@@ -156,7 +244,7 @@ PagerErrorStatus UserPager::TransferUncompressedPagesToVmo(uint64_t requested_of
 
   // Verify the pages read in.
   const uint64_t rounded_length = fbl::round_up<uint64_t, uint64_t>(length, PAGE_SIZE);
-  status = VerifyTransferVmo(offset, length, rounded_length, transfer_buffer_, info);
+  status = VerifyTransferVmo(offset, length, rounded_length, buffers->transfer_buffer, info);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferUncompressed: Failed to verify transfer vmo: %s\n",
                    zx_status_get_string(status));
@@ -165,19 +253,22 @@ PagerErrorStatus UserPager::TransferUncompressedPagesToVmo(uint64_t requested_of
 
   ZX_DEBUG_ASSERT(offset % PAGE_SIZE == 0);
   // Move the pages from the transfer buffer to the destination VMO.
-  status = pager_.supply_pages(vmo, offset, rounded_length, transfer_buffer_, 0);
+  status = pager_.supply_pages(vmo, offset, rounded_length, buffers->transfer_buffer, 0);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferUncompressed: Failed to supply pages to paged VMO: %s\n",
                    zx_status_get_string(status));
     return ToPagerErrorStatus(status);
   }
 
+  *supplied_end = offset + rounded_length;
   return PagerErrorStatus::kOK;
 }
 
 PagerErrorStatus UserPager::TransferChunkedPagesToVmo(uint64_t requested_offset,
                                                       uint64_t requested_length, const zx::vmo& vmo,
-                                                      const UserPagerInfo& info) {
+                                                      const UserPagerInfo& info,
+                                                      TransferBuffers* buffers,
+                                                      uint64_t* supplied_end) {
   ZX_DEBUG_ASSERT(info.decompressor);
 
   const auto [offset, length] = GetBlockAlignedReadRange(info, requested_offset, requested_length);
@@ -202,23 +293,23 @@ PagerErrorStatus UserPager::TransferChunkedPagesToVmo(uint64_t requested_offset,
   // Read from storage into the transfer buffer.
   size_t read_offset = fbl::round_down(mapping.compressed_offset, kBlobfsBlockSize);
   size_t read_len = (mapping.compressed_length + offset_of_compressed_data);
-  zx_status_t status = PopulateTransferVmo(read_offset, read_len, info);
+  zx_status_t status = PopulateTransferVmo(buffers->index, read_offset, read_len, info);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferChunked: Failed to populate transfer vmo: %s\n",
                    zx_status_get_string(status));
     return ToPagerErrorStatus(status);
   }
 
-  auto decommit_compressed = fbl::MakeAutoCall([this, length = read_len]() {
-    // Decommit pages in the transfer buffer that might have been populated. All blobs share the
-    // same transfer buffer - this prevents data leaks between different blobs.
-    transfer_buffer_.op_range(ZX_VMO_OP_DECOMMIT, 0, fbl::round_up(length, kBlobfsBlockSize),
-                              nullptr, 0);
+  auto decommit_compressed = fbl::MakeAutoCall([buffers, length = read_len]() {
+    // Decommit pages in the transfer buffer that might have been populated. Buffers are reused
+    // across blobs - this prevents data leaks between different blobs.
+    buffers->transfer_buffer.op_range(ZX_VMO_OP_DECOMMIT, 0,
+                                      fbl::round_up(length, kBlobfsBlockSize), nullptr, 0);
   });
 
   // Map the transfer VMO in order to pass the decompressor a pointer to the data.
   fzl::VmoMapper compressed_mapper;
-  status = compressed_mapper.Map(transfer_buffer_, 0, read_len, ZX_VM_PERM_READ);
+  status = compressed_mapper.Map(buffers->transfer_buffer, 0, read_len, ZX_VM_PERM_READ);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferChunked: Failed to map transfer buffer: %s\n",
                    zx_status_get_string(status));
@@ -226,16 +317,18 @@ PagerErrorStatus UserPager::TransferChunkedPagesToVmo(uint64_t requested_offset,
   }
   auto unmap_compression = fbl::MakeAutoCall([&]() { compressed_mapper.Unmap(); });
 
-  auto decommit_decompressed = fbl::MakeAutoCall([this, length = mapping.decompressed_length]() {
-    // Decommit pages in the decompression buffer that might have been populated. All blobs share
-    // the same transfer buffer - this prevents data leaks between different blobs.
-    decompression_buffer_.op_range(ZX_VMO_OP_DECOMMIT, 0, fbl::round_up(length, kBlobfsBlockSize),
-                                   nullptr, 0);
+  auto decommit_decompressed = fbl::MakeAutoCall([buffers,
+                                                   length = mapping.decompressed_length]() {
+    // Decommit pages in the decompression buffer that might have been populated. Buffers are
+    // reused across blobs - this prevents data leaks between different blobs.
+    buffers->decompression_buffer.op_range(ZX_VMO_OP_DECOMMIT, 0,
+                                           fbl::round_up(length, kBlobfsBlockSize), nullptr, 0);
   });
 
   // Map the decompression VMO.
   fzl::VmoMapper decompressed_mapper;
-  if ((status = decompressed_mapper.Map(decompression_buffer_, 0, mapping.decompressed_length,
+  if ((status = decompressed_mapper.Map(buffers->decompression_buffer, 0,
+                                        mapping.decompressed_length,
                                         ZX_VM_PERM_READ | ZX_VM_PERM_WRITE)) != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferChunked: Failed to map decompress buffer: %s\n",
                    zx_status_get_string(status));
@@ -269,19 +362,22 @@ PagerErrorStatus UserPager::TransferChunkedPagesToVmo(uint64_t requested_offset,
 
   // Move the pages from the decompression buffer to the destination VMO.
   status = pager_.supply_pages(vmo, mapping.decompressed_offset, rounded_length,
-                               decompression_buffer_, 0);
+                               buffers->decompression_buffer, 0);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferChunked: Failed to supply pages to paged VMO: %s\n",
                    zx_status_get_string(status));
     return ToPagerErrorStatus(status);
   }
+  *supplied_end = mapping.decompressed_offset + rounded_length;
   return PagerErrorStatus::kOK;
 }
 
 PagerErrorStatus UserPager::TransferZSTDSeekablePagesToVmo(uint64_t requested_offset,
                                                            uint64_t requested_length,
                                                            const zx::vmo& vmo,
-                                                           const UserPagerInfo& info) {
+                                                           const UserPagerInfo& info,
+                                                           TransferBuffers* buffers,
+                                                           uint64_t* supplied_end) {
   // This code path assumes a ZSTD Seekable blob.
   ZX_DEBUG_ASSERT(info.zstd_seekable_blob_collection);
 
@@ -300,16 +396,17 @@ PagerErrorStatus UserPager::TransferZSTDSeekablePagesToVmo(uint64_t requested_of
   ZX_ASSERT(info.verifier->Align(&aligned_offset, &aligned_length) == ZX_OK &&
             offset == aligned_offset && read_length == aligned_length);
 
-  auto decommit = fbl::MakeAutoCall([this, length = page_aligned_length]() {
-    // Decommit pages in the compression buffer that might have been populated. All blobs share the
-    // same transfer buffer - this prevents data leaks between different blobs.
-    decompression_buffer_.op_range(ZX_VMO_OP_DECOMMIT, 0, length, nullptr, 0);
+  auto decommit = fbl::MakeAutoCall([buffers, length = page_aligned_length]() {
+    // Decommit pages in the compression buffer that might have been populated. Buffers are reused
+    // across blobs - this prevents data leaks between different blobs.
+    buffers->decompression_buffer.op_range(ZX_VMO_OP_DECOMMIT, 0, length, nullptr, 0);
   });
 
   // Map the decompression VMO in order to pass it to |ZSTDSeekableBlobCollection::Read|.
   fzl::VmoMapper decompression_mapping;
-  zx_status_t status = decompression_mapping.Map(decompression_buffer_, 0, page_aligned_length,
-                                                 ZX_VM_PERM_READ | ZX_VM_PERM_WRITE);
+  zx_status_t status =
+      decompression_mapping.Map(buffers->decompression_buffer, 0, page_aligned_length,
+                                ZX_VM_PERM_READ | ZX_VM_PERM_WRITE);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferSeekable: Failed to map transfer buffer: %s\n",
                    zx_status_get_string(status));
@@ -317,8 +414,12 @@ PagerErrorStatus UserPager::TransferZSTDSeekablePagesToVmo(uint64_t requested_of
   }
   auto unmap = fbl::MakeAutoCall([&]() { decompression_mapping.Unmap(); });
 
-  status = info.zstd_seekable_blob_collection->Read(
-      info.identifier, static_cast<uint8_t*>(decompression_mapping.start()), offset, read_length);
+  {
+    fbl::AutoLock guard(&zstd_seekable_mutex_);
+    status = info.zstd_seekable_blob_collection->Read(
+        info.identifier, static_cast<uint8_t*>(decompression_mapping.start()), offset,
+        read_length);
+  }
   if (status != ZX_OK) {
     FS_TRACE_ERROR(
         "blobfs: TransferSeekable: Failed to read from ZSTD Seekable archive to service page "
@@ -341,13 +442,14 @@ PagerErrorStatus UserPager::TransferZSTDSeekablePagesToVmo(uint64_t requested_of
   decompression_mapping.Unmap();
 
   // Move the pages from the decompression buffer to the destination VMO.
-  status = pager_.supply_pages(vmo, offset, page_aligned_length, decompression_buffer_, 0);
+  status = pager_.supply_pages(vmo, offset, page_aligned_length, buffers->decompression_buffer, 0);
   if (status != ZX_OK) {
     FS_TRACE_ERROR("blobfs: TransferSeekable: Failed to supply pages to paged VMO: %s\n",
                    zx_status_get_string(status));
     return ToPagerErrorStatus(status);
   }
 
+  *supplied_end = offset + page_aligned_length;
   return PagerErrorStatus::kOK;
 }
 
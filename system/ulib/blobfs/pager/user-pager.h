@@ -14,11 +14,20 @@
 #include <lib/async/dispatcher.h>
 #include <lib/zx/pager.h>
 
+#include <zircon/compiler.h>
+
+#include <atomic>
 #include <memory>
+#include <vector>
+
+#include <fbl/condition_variable.h>
+#include <fbl/mutex.h>
 
 #include "../blob-verifier.h"
 #include "../compression/seekable-decompressor.h"
 #include "../compression/zstd-seekable-blob-collection.h"
+#include "../iterator/extent-index.h"
+#include "../pager-metrics.h"
 
 namespace blobfs {
 
@@ -48,30 +57,48 @@ struct UserPagerInfo {
   // TODO(51072): Decompression strategies should have common abstractions to, among other things,
   // avoid the need for both |decompressor| and |zstd_seekable_blob_collection|. This change is
   // somewhat complicated by the fact that ZSTD Seekable decompression manages its own
-  // compressed-space buffer rather than reusing |transfer_buffer_| as chunked decompression does.
+  // compressed-space buffer rather than reusing the transfer buffer as chunked decompression does.
   ZSTDSeekableBlobCollection* zstd_seekable_blob_collection = nullptr;
+  // An optional index of the blob's extents, so that page requests at high offsets do not walk the
+  // extent chain. Built when the blob is loaded and never changed afterwards, so page requests
+  // serviced concurrently by different pager threads can share it. If unset, the extent chain is
+  // walked from the start.
+  std::unique_ptr<const ExtentIndex> extent_index;
 };
 
-// The size of a transfer buffer for reading from storage.
-//
-// The decision to use a single global transfer buffer is arbitrary; a pool of them could also be
-// available in the future for more fine-grained access. Moreover, the blobfs pager uses a single
-// thread at the moment, so a global buffer should be sufficient.
+// The size of a transfer buffer for reading from storage. Each pager thread has its own.
 //
 // 256 MB; but the size is arbitrary, since pages will become decommitted as they are moved to
-// destination VMOS.
+// destination VMOS. Only the pages in use are committed, so the size does not multiply the memory
+// cost of additional pager threads.
 constexpr uint64_t kTransferBufferSize = 256 * (1 << 20);
 
-// The size of a transfer buffer for reading from storage.
-//
-// The decision to use a single global transfer buffer is arbitrary; a pool of them could also be
-// available in the future for more fine-grained access. Moreover, the blobfs pager uses a single
-// thread at the moment, so a global buffer should be sufficient.
+// The size of a decompression buffer. Each pager thread has its own.
 //
 // 256 MB; but the size is arbitrary, since pages will become decommitted as they are moved to
 // destination VMOS.
 constexpr uint64_t kDecompressionBufferSize = 256 * (1 << 20);
 
+// The largest number of pager threads a |UserPager| can be created with.
+constexpr uint32_t kMaxPagerThreads = 16;
+
+// Bounds on the read-ahead window for sequential access. While the page requests on a blob stay
+// sequential, the window doubles from |kMinReadAheadWindow| up to the limit set with
+// |UserPager::SetMaxReadAhead|, which defaults to |kDefaultMaxReadAhead|.
+constexpr uint64_t kMinReadAheadWindow = 64 * (1 << 10);
+constexpr uint64_t kDefaultMaxReadAhead = 2 * (1 << 20);
+
+// Tracks the page requests on one blob to detect sequential access. Not thread-safe; the owner
+// must serialize the requests on the blob.
+struct ReadAheadState {
+  // End of the range supplied by the previous page request, or zero if it failed.
+  uint64_t supplied_end = 0;
+
+  // Bytes to supply past the end of the next page request, if it continues where the previous one
+  // ended.
+  uint64_t window = 0;
+};
+
 // Wrapper enum for error codes supported by the zx_pager_op_range(ZX_PAGER_OP_FAIL) syscall, used
 // to communicate userpager errors to the kernel, so that the error can be propagated to the
 // originator of the page request (if required), and the waiting thread can be unblocked. We use
@@ -108,9 +135,14 @@ constexpr PagerErrorStatus ToPagerErrorStatus(zx_status_t status) {
   }
 }
 
-// Abstract class that encapsulates a user pager, its associated thread and transfer buffer. The
-// child class will need to define the interface required to populate the transfer buffer with
+// Abstract class that encapsulates a user pager, its associated threads and their transfer buffers.
+// The child class will need to define the interface required to populate a transfer buffer with
 // blocks read from storage.
+//
+// Page requests are serviced by a pool of threads sharing one async loop. Each thread uses a
+// separate set of transfer and decompression buffers, so requests on different blobs proceed in
+// parallel. Requests on the same blob are serialized by its |PageWatcher|, since a blob's verifier
+// and decompressor are not thread-safe.
 class UserPager {
  public:
   UserPager() = default;
@@ -123,10 +155,16 @@ class UserPager {
   async_dispatcher_t* Dispatcher() const { return pager_loop_.dispatcher(); }
 
   // Invoked by the |PageWatcher| on a read request. Reads in the requested byte range
-  // [|offset|, |offset| + |length|) for the inode associated with |info->identifier| into the
-  // |transfer_buffer_|, and then moves those pages to the destination |vmo|. If |verifier_info| is
+  // [|offset|, |offset| + |length|) for the inode associated with |info->identifier| into an idle
+  // transfer buffer, and then moves those pages to the destination |vmo|. If |verifier_info| is
   // not null, uses it to verify the pages prior to transferring them to the destination vmo.
   //
+  // May be called concurrently from several threads, but not for the same |info|.
+  //
+  // If |read_ahead| is not null, it tracks the access pattern on the blob: a request that begins
+  // where the previous one ended is extended by a read-ahead window which grows while the
+  // requests stay sequential.
+  //
   // If an error is encountered, the error code is returned as a |PagerErrorStatus|. This error code
   // is communicated to the kernel with the zx_pager_op_range(ZX_PAGER_OP_FAIL) syscall.
   // |PagerErrorStatus| wraps the supported error codes for ZX_PAGER_OP_FAIL.
@@ -136,11 +174,17 @@ class UserPager {
   // the page request, e.g. failure while decompressing, or while transferring pages from the
   // transfer buffer etc.
   [[nodiscard]] PagerErrorStatus TransferPagesToVmo(uint64_t offset, uint64_t length,
-                                                    const zx::vmo& vmo, const UserPagerInfo& info);
+                                                    const zx::vmo& vmo, const UserPagerInfo& info,
+                                                    ReadAheadState* read_ahead = nullptr);
+
+  // Limits the read-ahead window to |bytes|. Zero disables read-ahead past the fixed cluster size
+  // used for uncompressed blobs. May be called while page requests are being serviced.
+  void SetMaxReadAhead(uint64_t bytes) { max_read_ahead_.store(bytes, std::memory_order_relaxed); }
 
  protected:
-  // Sets up the transfer buffer, creates the pager and starts the pager thread.
-  [[nodiscard]] zx_status_t InitPager();
+  // Sets up |thread_count| sets of transfer buffers, creates the pager and starts |thread_count|
+  // pager threads. If |metrics| is not null, the latency of every page request is recorded in it.
+  [[nodiscard]] zx_status_t InitPager(uint32_t thread_count = 1, PagerMetrics* metrics = nullptr);
 
   // Protected for unit test access.
   zx::pager pager_;
@@ -174,19 +218,54 @@ class UserPager {
   ReadRange GetBlockAlignedExtendedRange(const UserPagerInfo& info, uint64_t offset,
                                          uint64_t length);
 
+  // Scratch buffers for servicing one page request.
+  struct TransferBuffers {
+    // Identifies |transfer_buffer| to |AttachTransferVmo| and |PopulateTransferVmo|.
+    uint32_t index = 0;
+
+    // Scratch buffer for pager transfers.
+    // NOTE: Per the constraints imposed by |zx_pager_supply_pages|, this needs to be unmapped
+    // before calling |zx_pager_supply_pages|. Map this only when an explicit address is required,
+    // e.g. for verification, and unmap it immediately after.
+    zx::vmo transfer_buffer;
+
+    // Scratch buffer for decompression.
+    // NOTE: Per the constraints imposed by |zx_pager_supply_pages|, this needs to be unmapped
+    // before calling |zx_pager_supply_pages|.
+    zx::vmo decompression_buffer;
+  };
+
+  // Returns the number of bytes to transfer for a request of |length| bytes at |offset|, and
+  // updates |state| for this request.
+  uint64_t ExtendForReadAhead(uint64_t offset, uint64_t length, const UserPagerInfo& info,
+                              ReadAheadState* state);
+
+  // Takes an idle set of buffers, waiting for one if every set is in use. There are as many sets as
+  // pager threads, so the pager threads themselves never wait.
+  TransferBuffers* AcquireTransferBuffers();
+  void ReleaseTransferBuffers(TransferBuffers* buffers);
+
+  // Each of these sets |supplied_end| to the end of the range supplied to |vmo| on success.
   PagerErrorStatus TransferChunkedPagesToVmo(uint64_t offset, uint64_t length, const zx::vmo& vmo,
-                                             const UserPagerInfo& info);
+                                             const UserPagerInfo& info, TransferBuffers* buffers,
+                                             uint64_t* supplied_end);
   PagerErrorStatus TransferZSTDSeekablePagesToVmo(uint64_t offset, uint64_t length,
-                                                  const zx::vmo& vmo, const UserPagerInfo& info);
+                                                  const zx::vmo& vmo, const UserPagerInfo& info,
+                                                  TransferBuffers* buffers, uint64_t* supplied_end);
   PagerErrorStatus TransferUncompressedPagesToVmo(uint64_t offset, uint64_t length,
-                                                  const zx::vmo& vmo, const UserPagerInfo& info);
-  // Attaches the transfer buffer to the underlying block device, so that blocks can be read into it
-  // from storage.
-  [[nodiscard]] virtual zx_status_t AttachTransferVmo(const zx::vmo& transfer_vmo) = 0;
-
-  // Reads data for the inode corresponding to |info.identifier| into the transfer buffer for the
-  // byte range specified by [|offset|, |offset| + |length|).
-  [[nodiscard]] virtual zx_status_t PopulateTransferVmo(uint64_t offset, uint64_t length,
+                                                  const zx::vmo& vmo, const UserPagerInfo& info,
+                                                  TransferBuffers* buffers, uint64_t* supplied_end);
+  // Attaches the transfer buffer identified by |index| to the underlying block device, so that
+  // blocks can be read into it from storage. Called once for each index below the thread count
+  // passed to |InitPager|, before any pager thread starts.
+  [[nodiscard]] virtual zx_status_t AttachTransferVmo(uint32_t index,
+                                                      const zx::vmo& transfer_vmo) = 0;
+
+  // Reads data for the inode corresponding to |info.identifier| into the transfer buffer identified
+  // by |index| for the byte range specified by [|offset|, |offset| + |length|). May be called
+  // concurrently for different |index| values.
+  [[nodiscard]] virtual zx_status_t PopulateTransferVmo(uint32_t index, uint64_t offset,
+                                                        uint64_t length,
                                                         const UserPagerInfo& info) = 0;
 
   // Verifies the data read in to |transfer_vmo| (i.e. the transfer buffer) via
@@ -199,18 +278,23 @@ class UserPager {
                                                       const zx::vmo& transfer_vmo,
                                                       const UserPagerInfo& info) = 0;
 
-  // Scratch buffer for pager transfers.
-  // NOTE: Per the constraints imposed by |zx_pager_supply_pages|, this needs to be unmapped before
-  // calling |zx_pager_supply_pages|. Map this only when an explicit address is required, e.g. for
-  // verification, and unmap it immediately after.
-  zx::vmo transfer_buffer_;
+  // One set of buffers per pager thread.
+  std::vector<std::unique_ptr<TransferBuffers>> transfer_buffers_;
+
+  fbl::Mutex buffers_mutex_;
+  fbl::ConditionVariable buffers_available_;
+  // The sets in |transfer_buffers_| not currently servicing a request.
+  std::vector<TransferBuffers*> idle_buffers_ __TA_GUARDED(buffers_mutex_);
+
+  // Serializes reads through the ZSTD Seekable blob collection, which has a single transfer buffer
+  // shared by all blobs.
+  fbl::Mutex zstd_seekable_mutex_;
+
+  PagerMetrics* metrics_ = nullptr;
 
-  // Scratch buffer for decompression.
-  // NOTE: Per the constraints imposed by |zx_pager_supply_pages|, this needs to be unmapped before
-  // calling |zx_pager_supply_pages|.
-  zx::vmo decompression_buffer_;
+  std::atomic<uint64_t> max_read_ahead_ = kDefaultMaxReadAhead;
 
-  // Async loop for pager requests.
+  // Async loop for pager requests, run by every pager thread.
   async::Loop pager_loop_ = async::Loop(&kAsyncLoopConfigNoAttachToCurrentThread);
 };
 
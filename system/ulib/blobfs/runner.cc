@@ -73,6 +73,7 @@ void Runner::Shutdown(fs::Vfs::ShutdownCallback cb) {
       // Manually destroy the filesystem. The promise of Shutdown is that no
       // connections are active, and destroying the Runner object
       // should terminate all background workers.
+      memory_pressure_watcher_ = nullptr;
       blobfs_ = nullptr;
 
       // Tell the mounting thread that the filesystem has terminated.
@@ -117,6 +118,20 @@ zx_status_t Runner::ServeRoot(zx::channel root, ServeLayout layout) {
   return ZX_OK;
 }
 
+void Runner::WatchMemoryPressure(MemoryPressureEvents events) {
+  if (!events.normal.is_valid() || !events.warning.is_valid() || !events.critical.is_valid()) {
+    FS_TRACE_WARN("blobfs: memory pressure events not provided; caches will not shrink\n");
+    return;
+  }
+  zx_status_t status = MemoryPressureWatcher::Create(
+      loop_->dispatcher(), std::move(events),
+      [fs = blobfs_.get()](MemoryPressure level) { fs->SetMemoryPressure(level); },
+      &memory_pressure_watcher_);
+  if (status != ZX_OK) {
+    FS_TRACE_ERROR("blobfs: failed to watch memory pressure: %s\n", zx_status_get_string(status));
+  }
+}
+
 bool Runner::IsReadonly() {
 #ifdef __Fuchsia__
   fbl::AutoLock lock(&vfs_lock_);
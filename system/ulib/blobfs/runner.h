@@ -17,6 +17,7 @@
 #include <fs/vnode.h>
 
 #include "blobfs.h"
+#include "memory-pressure-watcher.h"
 
 namespace blobfs {
 
@@ -48,6 +49,10 @@ class Runner : public fs::ManagedVfs {
   // of an IPC connection.
   zx_status_t ServeRoot(zx::channel root, ServeLayout layout);
 
+  // Forwards changes in system memory pressure signaled on |events| to the filesystem. Does
+  // nothing if the events are not valid.
+  void WatchMemoryPressure(MemoryPressureEvents events);
+
  private:
   Runner(async::Loop* loop, std::unique_ptr<Blobfs> fs);
 
@@ -56,6 +61,7 @@ class Runner : public fs::ManagedVfs {
 
   async::Loop* loop_;
   std::unique_ptr<Blobfs> blobfs_;
+  std::unique_ptr<MemoryPressureWatcher> memory_pressure_watcher_;
   fbl::RefPtr<QueryService> query_svc_;
 };
 
@@ -0,0 +1,307 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/fzl/vmo-mapper.h>
+#include <lib/zx/vmo.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <blobfs/compression-settings.h>
+#include <digest/digest.h>
+#include <digest/merkle-tree.h>
+#include <fbl/algorithm.h>
+#include <fbl/auto_call.h>
+#include <fbl/string_printf.h>
+#include <perftest/perftest.h>
+
+#include "blob-verifier.h"
+#include "compression/blob-compressor.h"
+#include "compression/chunked.h"
+#include "iterator/block-iterator.h"
+#include "iterator/extent-index.h"
+#include "metrics.h"
+#include "pager/page-watcher.h"
+#include "pager/user-pager.h"
+
+namespace blobfs {
+namespace {
+
+// Blob sizes to measure. Both are page multiples so that every read is a whole page.
+constexpr size_t kBlobSizes[] = {1024 * 1024, 16 * 1024 * 1024};
+
+// Reads are issued a page at a time, like the faults on a memory-mapped blob.
+constexpr size_t kReadSize = ZX_PAGE_SIZE;
+
+enum class ReadOrder { kSequential, kRandom };
+
+// A blob as it is stored, shared by every run of a test.
+struct StoredBlob {
+  CompressionAlgorithm algorithm;
+  size_t data_size = 0;
+  std::vector<uint8_t> raw_data;
+  uint8_t root[digest::kSha256Length];
+  std::unique_ptr<uint8_t[]> merkle_tree;
+  size_t merkle_tree_size = 0;
+};
+
+std::unique_ptr<StoredBlob> MakeBlob(CompressionAlgorithm algorithm, size_t data_size) {
+  auto blob = std::make_unique<StoredBlob>();
+  blob->algorithm = algorithm;
+  blob->data_size = data_size;
+
+  // Draw the bytes from a small alphabet so that the chunked compressor has something to do.
+  std::vector<uint8_t> data(data_size);
+  std::default_random_engine random_engine(data_size);
+  std::uniform_int_distribution<int> distribution(0, 15);
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>('a' + distribution(random_engine));
+  }
+
+  digest::Digest root;
+  if (digest::MerkleTreeCreator::Create(data.data(), data_size, &blob->merkle_tree,
+                                        &blob->merkle_tree_size, &root) != ZX_OK) {
+    return nullptr;
+  }
+  memcpy(blob->root, root.get(), sizeof(blob->root));
+
+  if (algorithm == CompressionAlgorithm::UNCOMPRESSED) {
+    blob->raw_data = std::move(data);
+    return blob;
+  }
+  CompressionSettings settings{
+      .compression_algorithm = algorithm,
+  };
+  std::optional<BlobCompressor> compressor = BlobCompressor::Create(settings, data_size);
+  if (!compressor || compressor->Update(data.data(), data_size) != ZX_OK ||
+      compressor->End() != ZX_OK) {
+    return nullptr;
+  }
+  const uint8_t* compressed = static_cast<const uint8_t*>(compressor->Data());
+  blob->raw_data.assign(compressed, compressed + compressor->Size());
+  return blob;
+}
+
+// Serves a single blob from memory, so that the tests measure the cost of servicing page requests
+// rather than that of the block device.
+class InMemoryPager : public UserPager {
+ public:
+  explicit InMemoryPager(const StoredBlob* blob) : blob_(blob) {}
+
+  zx_status_t Init() { return InitPager(); }
+
+ private:
+  zx_status_t AttachTransferVmo(uint32_t /*index*/, const zx::vmo& transfer_vmo) override {
+    transfer_vmo_ = zx::unowned_vmo(transfer_vmo);
+    return ZX_OK;
+  }
+
+  zx_status_t PopulateTransferVmo(uint32_t /*index*/, uint64_t offset, uint64_t length,
+                                  const UserPagerInfo& /*info*/) override {
+    length = std::min(length, blob_->raw_data.size() - offset);
+    return transfer_vmo_->write(blob_->raw_data.data() + offset, 0, length);
+  }
+
+  zx_status_t VerifyTransferVmo(uint64_t offset, uint64_t length, uint64_t buffer_size,
+                                const zx::vmo& transfer_vmo, const UserPagerInfo& info) override {
+    fzl::VmoMapper mapping;
+    zx_status_t status = mapping.Map(transfer_vmo, 0, buffer_size, ZX_VM_PERM_READ);
+    if (status != ZX_OK) {
+      return status;
+    }
+    auto unmap = fbl::MakeAutoCall([&]() { mapping.Unmap(); });
+    return info.verifier->VerifyPartial(mapping.start(), length, offset, buffer_size);
+  }
+
+  const StoredBlob* blob_;
+  zx::unowned_vmo transfer_vmo_;
+};
+
+// Measures reading a blob that has no pages in memory, a page at a time in |order|. Each run
+// attaches a new paged VMO so that every read starts cold.
+bool ColdReadTest(perftest::RepeatState* state, CompressionAlgorithm algorithm, size_t blob_size,
+                  ReadOrder order, bool read_ahead) {
+  state->SetBytesProcessedPerRun(blob_size);
+  state->DeclareStep("create");
+  state->DeclareStep("read");
+  state->DeclareStep("detach");
+
+  std::unique_ptr<StoredBlob> blob = MakeBlob(algorithm, blob_size);
+  if (!blob) {
+    return false;
+  }
+  InMemoryPager pager(blob.get());
+  if (pager.Init() != ZX_OK) {
+    return false;
+  }
+  pager.SetMaxReadAhead(read_ahead ? kDefaultMaxReadAhead : 0);
+  BlobfsMetrics metrics;
+
+  std::vector<uint64_t> offsets(blob_size / kReadSize);
+  std::iota(offsets.begin(), offsets.end(), 0);
+  for (uint64_t& offset : offsets) {
+    offset *= kReadSize;
+  }
+  if (order == ReadOrder::kRandom) {
+    std::shuffle(offsets.begin(), offsets.end(), std::default_random_engine(blob_size));
+  }
+
+  uint8_t buf[kReadSize];
+  while (state->KeepRunning()) {
+    std::unique_ptr<BlobVerifier> verifier;
+    if (BlobVerifier::Create(digest::Digest(blob->root), &metrics, blob->merkle_tree.get(),
+                             blob->merkle_tree_size, blob->data_size, &verifier) != ZX_OK) {
+      return false;
+    }
+    std::unique_ptr<SeekableDecompressor> decompressor;
+    if (algorithm == CompressionAlgorithm::CHUNKED &&
+        SeekableChunkedDecompressor::CreateDecompressor(
+            blob->raw_data.data(), blob->raw_data.size(), blob->raw_data.size(),
+            &decompressor) != ZX_OK) {
+      return false;
+    }
+    UserPagerInfo info = {
+        .identifier = 0,
+        .data_length_bytes = blob->data_size,
+        .verifier = std::move(verifier),
+        .decompressor = std::move(decompressor),
+    };
+    PageWatcher watcher(&pager, std::move(info));
+    zx::vmo vmo;
+    if (watcher.CreatePagedVmo(blob_size, &vmo) != ZX_OK) {
+      return false;
+    }
+    state->NextStep();
+
+    for (uint64_t offset : offsets) {
+      if (vmo.read(buf, offset, kReadSize) != ZX_OK) {
+        return false;
+      }
+    }
+    state->NextStep();
+
+    watcher.DetachPagedVmoSync();
+  }
+  return true;
+}
+
+// Extent counts to measure lookups over. The larger approaches a blob whose every block is its
+// own extent.
+constexpr size_t kExtentCounts[] = {64, 4096};
+
+// Iterates over an in-memory list of extents, as the allocator would over a node's extent chain.
+class VectorExtentIterator : public ExtentIterator {
+ public:
+  explicit VectorExtentIterator(const std::vector<Extent>* extents) : extents_(extents) {}
+
+  bool Done() const final { return extent_index_ == extents_->size(); }
+
+  zx_status_t Next(const Extent** out) final {
+    *out = &(*extents_)[extent_index_];
+    block_index_ += (*extents_)[extent_index_].Length();
+    extent_index_++;
+    return ZX_OK;
+  }
+
+  uint64_t BlockIndex() const final { return block_index_; }
+
+ private:
+  const std::vector<Extent>* extents_;
+  size_t extent_index_ = 0;
+  uint64_t block_index_ = 0;
+};
+
+// Measures finding the device block behind random node blocks of a blob with |extent_count|
+// single-block extents, either by walking the extents from the start or through an
+// |ExtentIndex|.
+bool ExtentLookupTest(perftest::RepeatState* state, size_t extent_count, bool indexed) {
+  std::vector<Extent> extents;
+  for (size_t i = 0; i < extent_count; i++) {
+    extents.emplace_back(2 * i, 1);
+  }
+  std::unique_ptr<ExtentIndex> index;
+  VectorExtentIterator all_extents(&extents);
+  if (ExtentIndex::Create(&all_extents, &index) != ZX_OK) {
+    return false;
+  }
+
+  std::vector<uint32_t> blocks(extent_count);
+  std::iota(blocks.begin(), blocks.end(), 0);
+  std::shuffle(blocks.begin(), blocks.end(), std::default_random_engine(extent_count));
+
+  size_t next = 0;
+  while (state->KeepRunning()) {
+    uint32_t block = blocks[next];
+    next = (next + 1) % blocks.size();
+    std::unique_ptr<ExtentIterator> iter;
+    if (indexed) {
+      if (index->IteratorAtBlock(block, &iter) != ZX_OK) {
+        return false;
+      }
+    } else {
+      iter = std::make_unique<VectorExtentIterator>(&extents);
+    }
+    BlockIterator block_iter(std::move(iter));
+    uint32_t length;
+    uint64_t start;
+    if (IterateToBlock(&block_iter, block) != ZX_OK ||
+        block_iter.Next(1, &length, &start) != ZX_OK || start != 2 * block) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RegisterTests() {
+  const struct {
+    CompressionAlgorithm algorithm;
+    const char* name;
+  } kAlgorithms[] = {
+      {CompressionAlgorithm::UNCOMPRESSED, "Uncompressed"},
+      {CompressionAlgorithm::CHUNKED, "Chunked"},
+  };
+  const struct {
+    ReadOrder order;
+    const char* name;
+  } kOrders[] = {
+      {ReadOrder::kSequential, "Sequential"},
+      {ReadOrder::kRandom, "Random"},
+  };
+
+  for (const auto& algorithm : kAlgorithms) {
+    for (size_t blob_size : kBlobSizes) {
+      for (const auto& order : kOrders) {
+        for (bool read_ahead : {false, true}) {
+          fbl::String name = fbl::StringPrintf(
+              "BlobfsPager/ColdRead/%s/%s/%zuKiB/ReadAhead%s", algorithm.name, order.name,
+              blob_size / 1024, read_ahead ? "On" : "Off");
+          perftest::RegisterTest(name.c_str(), ColdReadTest, algorithm.algorithm, blob_size,
+                                 order.order, read_ahead);
+        }
+      }
+    }
+  }
+
+  for (size_t extent_count : kExtentCounts) {
+    for (bool indexed : {false, true}) {
+      fbl::String name = fbl::StringPrintf("BlobfsPager/ExtentLookup/%s/%zuExtents",
+                                           indexed ? "Indexed" : "Linear", extent_count);
+      perftest::RegisterTest(name.c_str(), ExtentLookupTest, extent_count, indexed);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace blobfs
+
+int main(int argc, char** argv) {
+  blobfs::RegisterTests();
+  return perftest::PerfTestMain(argc, argv, "fuchsia.blobfs");
+}
@@ -14,6 +14,9 @@
 namespace blobfs {
 namespace {
 
+// The memory held by a TestNode in a high-memory state.
+constexpr uint64_t kNodeMemory = 8192;
+
 // A mock Node, comparable to Blob.
 //
 // "ShouldCache" mimics the internal Vnode state machine.
@@ -31,6 +34,10 @@ class TestNode : public CacheNode, fbl::Recyclable<TestNode> {
 
   void ActivateLowMemory() final { using_memory_ = false; }
 
+  uint64_t GetMemoryUsage() const final { return using_memory_ ? kNodeMemory : 0; }
+
+  bool IsResident() const final { return using_memory_; }
+
   bool UsingMemory() { return using_memory_; }
 
   void SetCache(bool should_cache) { should_cache_ = should_cache; }
@@ -322,5 +329,95 @@ TEST(BlobCacheTest, CachePolicyNeverEvict) {
   ASSERT_TRUE(node->UsingMemory());
 }
 
+// Adds a high-memory node for each digest in [first, first + count), and closes it.
+void AddClosedNodesHelper(BlobCache* cache, size_t first, size_t count) {
+  for (size_t i = first; i < first + count; i++) {
+    fbl::RefPtr<TestNode> node = fbl::AdoptRef(new TestNode(GenerateDigest(i), cache));
+    node->SetHighMemory();
+    ASSERT_OK(cache->Add(node));
+  }
+}
+
+// Reopens the node for |digest| and reports whether it was still in a high-memory state.
+bool ReopenUsingMemory(BlobCache* cache, const Digest& digest) {
+  fbl::RefPtr<CacheNode> cache_node;
+  ZX_ASSERT(cache->Lookup(digest, &cache_node) == ZX_OK);
+  return fbl::RefPtr<TestNode>::Downcast(std::move(cache_node))->UsingMemory();
+}
+
+TEST(BlobCacheTest, CachePolicyEvictLeastRecentlyUsed) {
+  BlobCache cache;
+  CacheMetrics metrics;
+  cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+  cache.SetMemoryBudget(2 * kNodeMemory);
+  cache.SetMetrics(&metrics);
+
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 0, 3));
+  ASSERT_EQ(cache.ResidentBytes(), 2 * kNodeMemory);
+
+  // The oldest node is the one evicted.
+  ASSERT_FALSE(ReopenUsingMemory(&cache, GenerateDigest(0)));
+  ASSERT_TRUE(ReopenUsingMemory(&cache, GenerateDigest(1)));
+  ASSERT_TRUE(ReopenUsingMemory(&cache, GenerateDigest(2)));
+
+  CacheMetrics::Snapshot snapshot = metrics.Get();
+  ASSERT_EQ(snapshot.hits, 2u);
+  ASSERT_EQ(snapshot.misses, 1u);
+  ASSERT_EQ(snapshot.evictions, 1u);
+  ASSERT_EQ(snapshot.evicted_bytes, kNodeMemory);
+}
+
+TEST(BlobCacheTest, CachePolicyEvictLeastRecentlyUsedResistsScans) {
+  BlobCache cache;
+  cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+  cache.SetMemoryBudget(2 * kNodeMemory);
+
+  // Reopening a node while it is still resident marks it as frequently used.
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 0, 1));
+  ASSERT_TRUE(ReopenUsingMemory(&cache, GenerateDigest(0)));
+
+  // A scan over many nodes which are each used once should not displace it.
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 1, 8));
+  ASSERT_EQ(cache.ResidentBytes(), 2 * kNodeMemory);
+  ASSERT_TRUE(ReopenUsingMemory(&cache, GenerateDigest(0)));
+  ASSERT_TRUE(ReopenUsingMemory(&cache, GenerateDigest(8)));
+  ASSERT_FALSE(ReopenUsingMemory(&cache, GenerateDigest(7)));
+}
+
+TEST(BlobCacheTest, CachePolicyEvictLeastRecentlyUsedMemoryPressure) {
+  BlobCache cache;
+  cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+  cache.SetMemoryBudget(4 * kNodeMemory);
+
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 0, 4));
+  ASSERT_EQ(cache.ResidentBytes(), 4 * kNodeMemory);
+
+  cache.SetMemoryPressure(MemoryPressure::kWarning);
+  ASSERT_EQ(cache.ResidentBytes(), 2 * kNodeMemory);
+
+  cache.SetMemoryPressure(MemoryPressure::kCritical);
+  ASSERT_EQ(cache.ResidentBytes(), 0u);
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 4, 1));
+  ASSERT_EQ(cache.ResidentBytes(), 0u);
+
+  // Once pressure is relieved, closed nodes are kept in memory again.
+  cache.SetMemoryPressure(MemoryPressure::kNormal);
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 5, 1));
+  ASSERT_EQ(cache.ResidentBytes(), kNodeMemory);
+  ASSERT_TRUE(ReopenUsingMemory(&cache, GenerateDigest(5)));
+  ASSERT_FALSE(ReopenUsingMemory(&cache, GenerateDigest(0)));
+}
+
+TEST(BlobCacheTest, ResetWithResidentNodes) {
+  BlobCache cache;
+  cache.SetCachePolicy(CachePolicy::EvictLeastRecentlyUsed);
+  cache.SetMemoryBudget(2 * kNodeMemory);
+
+  ASSERT_NO_FAILURES(AddClosedNodesHelper(&cache, 0, 4));
+  cache.Reset();
+  ASSERT_EQ(cache.ResidentBytes(), 0u);
+  ASSERT_EQ(ZX_ERR_NOT_FOUND, cache.Lookup(GenerateDigest(0), nullptr));
+}
+
 }  // namespace
 }  // namespace blobfs
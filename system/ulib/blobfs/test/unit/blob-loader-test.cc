@@ -70,12 +70,13 @@ class FakeUserPager : public UserPager {
  private:
   void AbortMainThread() { zx_pager_detach_vmo(pager_.get(), handle_to_close_on_failure_); }
 
-  zx_status_t AttachTransferVmo(const zx::vmo& transfer_vmo) override {
+  // Only one pager thread is started, so there is a single transfer buffer.
+  zx_status_t AttachTransferVmo(uint32_t /*index*/, const zx::vmo& transfer_vmo) override {
     vmo_ = zx::unowned_vmo(transfer_vmo);
     return ZX_OK;
   }
 
-  zx_status_t PopulateTransferVmo(uint64_t offset, uint64_t length,
+  zx_status_t PopulateTransferVmo(uint32_t /*index*/, uint64_t offset, uint64_t length,
                                   const UserPagerInfo& info) override {
     if (offset + length > data_.size()) {
       AbortMainThread();
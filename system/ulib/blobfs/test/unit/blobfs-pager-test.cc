@@ -14,6 +14,7 @@
 #include <memory>
 #include <random>
 #include <thread>
+#include <vector>
 
 #include <blobfs/compression-settings.h>
 #include <blobfs/format.h>
@@ -27,6 +28,7 @@
 #include "blob-verifier.h"
 #include "compression/blob-compressor.h"
 #include "compression/chunked.h"
+#include "pager-metrics.h"
 #include "pager/page-watcher.h"
 #include "pager/user-pager.h"
 
@@ -192,7 +194,9 @@ class MockBlobFactory {
 // mock blobs can be verified.
 class MockPager : public UserPager {
  public:
-  MockPager() : factory_(this) { ASSERT_OK(InitPager()); }
+  explicit MockPager(uint32_t thread_count = 1) : factory_(this) {
+    ASSERT_OK(InitPager(thread_count, &metrics_));
+  }
 
   void SetFailureMode(PagerErrorStatus mode) {
     switch (mode) {
@@ -206,7 +210,8 @@ class MockPager : public UserPager {
         mapping_.Unmap();
         break;
       case PagerErrorStatus::kErrBadState:
-        mapping_.Map(*vmo_, 0, ZX_PAGE_SIZE, ZX_VM_PERM_READ);
+        // Failure modes are only exercised with a single pager thread.
+        mapping_.Map(*vmos_[0], 0, ZX_PAGE_SIZE, ZX_VM_PERM_READ);
         factory_.SetDataCorruption(false);
         break;
       default:
@@ -225,14 +230,20 @@ class MockPager : public UserPager {
     do_partial_transfer_ = do_partial_transfer;
   }
 
+  PagerMetrics& metrics() { return metrics_; }
+
  private:
-  zx_status_t AttachTransferVmo(const zx::vmo& transfer_vmo) override {
-    vmo_ = zx::unowned_vmo(transfer_vmo);
+  zx_status_t AttachTransferVmo(uint32_t index, const zx::vmo& transfer_vmo) override {
+    if (vmos_.size() <= index) {
+      vmos_.resize(index + 1);
+    }
+    vmos_[index] = zx::unowned_vmo(transfer_vmo);
     return ZX_OK;
   }
 
-  zx_status_t PopulateTransferVmo(uint64_t offset, uint64_t length,
+  zx_status_t PopulateTransferVmo(uint32_t index, uint64_t offset, uint64_t length,
                                   const UserPagerInfo& info) override {
+    const zx::unowned_vmo& vmo = vmos_[index];
     if (failure_mode_ == PagerErrorStatus::kErrIO) {
       return ZX_ERR_IO_REFUSED;
     }
@@ -244,10 +255,10 @@ class MockPager : public UserPager {
     // Fill the transfer buffer with the blob's data, to service page requests.
     if (do_partial_transfer_) {
       // Zero the entire range, and then explicitly fill the first half.
-      EXPECT_OK(vmo_->op_range(ZX_VMO_OP_ZERO, offset, length, nullptr, 0));
-      EXPECT_OK(vmo_->write(blob.raw_data() + offset, 0, length / 2));
+      EXPECT_OK(vmo->op_range(ZX_VMO_OP_ZERO, offset, length, nullptr, 0));
+      EXPECT_OK(vmo->write(blob.raw_data() + offset, 0, length / 2));
     } else {
-      EXPECT_OK(vmo_->write(blob.raw_data() + offset, 0, length));
+      EXPECT_OK(vmo->write(blob.raw_data() + offset, 0, length));
     }
     return ZX_OK;
   }
@@ -269,7 +280,8 @@ class MockPager : public UserPager {
 
   std::map<char, std::unique_ptr<MockBlob>> blob_registry_;
   MockBlobFactory factory_;
-  zx::unowned_vmo vmo_;
+  PagerMetrics metrics_;
+  std::vector<zx::unowned_vmo> vmos_;
   bool do_partial_transfer_ = false;
   fzl::VmoMapper mapping_;
   PagerErrorStatus failure_mode_ = PagerErrorStatus::kOK;
@@ -277,7 +289,7 @@ class MockPager : public UserPager {
 
 class BlobfsPagerTest : public zxtest::Test {
  public:
-  void SetUp() override { pager_ = std::make_unique<MockPager>(); }
+  void SetUp() override { pager_ = std::make_unique<MockPager>(PagerThreadCount()); }
 
   MockBlob* CreateBlob(char identifier = 'z',
                        CompressionAlgorithm algorithm = CompressionAlgorithm::UNCOMPRESSED,
@@ -291,10 +303,19 @@ class BlobfsPagerTest : public zxtest::Test {
 
   void SetFailureMode(PagerErrorStatus mode) { pager_->SetFailureMode(mode); }
 
+ protected:
+  virtual uint32_t PagerThreadCount() const { return 1; }
+
  private:
   std::unique_ptr<MockPager> pager_;
 };
 
+// Services page requests on several pager threads.
+class BlobfsMultithreadedPagerTest : public BlobfsPagerTest {
+ protected:
+  uint32_t PagerThreadCount() const override { return 4; }
+};
+
 class RandomBlobReader {
  public:
   using Seed = std::default_random_engine::result_type;
@@ -418,6 +439,120 @@ TEST_F(BlobfsPagerTest, ReadRandomMultipleBlobsMultithreaded) {
   }
 }
 
+TEST_F(BlobfsMultithreadedPagerTest, ReadRandomMultipleBlobsMultithreaded) {
+  constexpr int kNumBlobs = 4;
+  MockBlob* blobs[kNumBlobs] = {CreateBlob('w'), CreateBlob('x', CompressionAlgorithm::CHUNKED),
+                                CreateBlob('y'), CreateBlob('z', CompressionAlgorithm::CHUNKED)};
+  std::array<std::thread, kNumBlobs * 2> threads;
+
+  // Two threads read each blob, so page requests on distinct blobs and on the same blob race
+  // across the pager threads.
+  for (int i = 0; i < kNumBlobs * 2; i++) {
+    threads[i] = std::thread(RandomBlobReader(zxtest::Runner::GetInstance()->random_seed() + i),
+                             blobs[i % kNumBlobs]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST_F(BlobfsMultithreadedPagerTest, CommitRange_ZstdChunked) {
+  MockBlob* blob = CreateBlob('x', CompressionAlgorithm::CHUNKED);
+  blob->CommitRange(0, kDefaultPagedVmoSize);
+}
+
+TEST_F(BlobfsPagerTest, MetricsRecordPageRequests) {
+  MockBlob* blob = CreateBlob();
+  blob->CommitRange(0, kDefaultPagedVmoSize);
+
+  PagerMetrics::Snapshot snapshot = pager().metrics().Get();
+  EXPECT_GT(snapshot.requests, 0);
+  EXPECT_EQ(snapshot.failed_requests, 0);
+  EXPECT_GE(snapshot.requested_bytes, kDefaultPagedVmoSize);
+  uint64_t histogram_total = 0;
+  for (uint64_t count : snapshot.latency_histogram) {
+    histogram_total += count;
+  }
+  EXPECT_EQ(histogram_total, snapshot.requests);
+}
+
+// Reads |blob| a page at a time from the start, the way a sequential reader of a mapped blob would
+// fault it in, and returns the number of page requests serviced.
+uint64_t ReadPagesSequentially(MockPager& pager, MockBlob* blob) {
+  const uint64_t requests_before = pager.metrics().Get().requests;
+  for (uint64_t offset = 0; offset < kDefaultBlobSize; offset += ZX_PAGE_SIZE) {
+    blob->Read(offset, ZX_PAGE_SIZE);
+  }
+  return pager.metrics().Get().requests - requests_before;
+}
+
+TEST_F(BlobfsPagerTest, ReadAheadReducesSequentialPageRequests) {
+  pager().SetMaxReadAhead(0);
+  const uint64_t requests_without_read_ahead = ReadPagesSequentially(pager(), CreateBlob('x'));
+  EXPECT_EQ(pager().metrics().Get().read_ahead_bytes, 0);
+
+  pager().SetMaxReadAhead(kDefaultMaxReadAhead);
+  const uint64_t requests_with_read_ahead = ReadPagesSequentially(pager(), CreateBlob('y'));
+  EXPECT_GT(pager().metrics().Get().read_ahead_bytes, 0);
+  EXPECT_LT(requests_with_read_ahead, requests_without_read_ahead);
+}
+
+// Large enough that the read-ahead window reaches its limit well before the end of the blob.
+constexpr size_t kReadAheadBlobSize = 16 * (1 << 20);
+
+// Reads |blob| a page at a time from |*offset| until |count| page requests have been serviced,
+// and returns the read-ahead window each of them was extended by. |*offset| is left after the
+// range supplied for the last request.
+std::vector<uint64_t> ReadAheadWindows(MockPager& pager, MockBlob* blob, uint64_t* offset,
+                                       size_t count) {
+  std::vector<uint64_t> windows;
+  while (windows.size() < count && *offset < kReadAheadBlobSize) {
+    const PagerMetrics::Snapshot before = pager.metrics().Get();
+    blob->Read(*offset, ZX_PAGE_SIZE);
+    const PagerMetrics::Snapshot after = pager.metrics().Get();
+    if (after.requests != before.requests) {
+      windows.push_back(after.read_ahead_bytes - before.read_ahead_bytes);
+    }
+    *offset += ZX_PAGE_SIZE;
+  }
+  return windows;
+}
+
+void CheckReadAheadWindowGrowsAndShrinks(MockPager& pager, MockBlob* blob) {
+  constexpr uint64_t kKiB = 1 << 10;
+  uint64_t offset = 0;
+
+  // Nothing precedes the first request. After it, the window doubles up to the limit.
+  const std::vector<uint64_t> growing = {0,         64 * kKiB,   128 * kKiB,  256 * kKiB,
+                                         512 * kKiB, 1024 * kKiB, 2048 * kKiB, 2048 * kKiB};
+  EXPECT_EQ(growing, ReadAheadWindows(pager, blob, &offset, growing.size()));
+
+  // Memory pressure lowers the limit, which the next sequential request is held to at once.
+  pager.SetMaxReadAhead(kDefaultMaxReadAhead / 4);
+  const std::vector<uint64_t> limited = {512 * kKiB, 512 * kKiB};
+  EXPECT_EQ(limited, ReadAheadWindows(pager, blob, &offset, limited.size()));
+
+  // Disabling read-ahead drops the window altogether.
+  pager.SetMaxReadAhead(0);
+  const std::vector<uint64_t> disabled = {0};
+  EXPECT_EQ(disabled, ReadAheadWindows(pager, blob, &offset, disabled.size()));
+
+  // Raising the limit again restarts the window from the minimum.
+  pager.SetMaxReadAhead(kDefaultMaxReadAhead);
+  const std::vector<uint64_t> restarted = {64 * kKiB, 128 * kKiB};
+  EXPECT_EQ(restarted, ReadAheadWindows(pager, blob, &offset, restarted.size()));
+}
+
+TEST_F(BlobfsPagerTest, ReadAheadWindowGrowsAndShrinks) {
+  CheckReadAheadWindowGrowsAndShrinks(
+      pager(), CreateBlob('x', CompressionAlgorithm::UNCOMPRESSED, kReadAheadBlobSize));
+}
+
+TEST_F(BlobfsPagerTest, ReadAheadWindowGrowsAndShrinks_ZstdChunked) {
+  CheckReadAheadWindowGrowsAndShrinks(
+      pager(), CreateBlob('x', CompressionAlgorithm::CHUNKED, kReadAheadBlobSize));
+}
+
 TEST_F(BlobfsPagerTest, CommitRange_ExactLength) {
   MockBlob* blob = CreateBlob();
   // Attempt to commit the entire blob. The zx_vmo_op_range(ZX_VMO_OP_COMMIT) call will return
@@ -0,0 +1,164 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "iterator/extent-index.h"
+
+#include <memory>
+
+#include <zxtest/zxtest.h>
+
+#include "iterator/allocated-extent-iterator.h"
+#include "iterator/block-iterator.h"
+#include "iterator/node-populator.h"
+#include "utils.h"
+
+namespace blobfs {
+namespace {
+
+// Allocates a blob with |allocated_blocks| blocks, spread over |allocated_nodes| nodes. When
+// |fragmented|, every block is an extent of its own.
+void TestSetup(size_t allocated_blocks, size_t allocated_nodes, bool fragmented,
+               MockSpaceManager* space_manager, std::unique_ptr<Allocator>* out_allocator,
+               fbl::Vector<Extent>* out_extents, uint32_t* out_node_index) {
+  size_t block_count = 3 * allocated_blocks;
+  ASSERT_NO_FAILURES(
+      InitializeAllocator(block_count, allocated_nodes, space_manager, out_allocator));
+  if (fragmented) {
+    ASSERT_NO_FAILURES(ForceFragmentation(out_allocator->get(), block_count));
+  }
+
+  fbl::Vector<ReservedNode> nodes;
+  fbl::Vector<ReservedExtent> extents;
+  ASSERT_OK((*out_allocator)->ReserveNodes(allocated_nodes, &nodes));
+  ASSERT_OK((*out_allocator)->ReserveBlocks(allocated_blocks, &extents));
+  if (fragmented) {
+    ASSERT_EQ(allocated_blocks, extents.size());
+  }
+  CopyExtents(extents, out_extents);
+  *out_node_index = nodes[0].index();
+
+  auto on_node = [&](const ReservedNode& node) {};
+  auto on_extent = [&](ReservedExtent& extent) {
+    return NodePopulator::IterationCommand::Continue;
+  };
+  NodePopulator populator(out_allocator->get(), std::move(extents), std::move(nodes));
+  ASSERT_OK(populator.Walk(on_node, on_extent));
+}
+
+TEST(ExtentIndexTest, Null) {
+  MockSpaceManager space_manager;
+  std::unique_ptr<Allocator> allocator;
+  fbl::Vector<Extent> allocated_extents;
+  uint32_t node_index;
+  ASSERT_NO_FAILURES(TestSetup(0, 1, /* fragmented=*/true, &space_manager, &allocator,
+                               &allocated_extents, &node_index));
+
+  AllocatedExtentIterator iter(allocator.get(), node_index);
+  std::unique_ptr<ExtentIndex> index;
+  ASSERT_OK(ExtentIndex::Create(&iter, &index));
+  EXPECT_EQ(0, index->ExtentCount());
+  EXPECT_EQ(0, index->BlockCount());
+
+  size_t extent;
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, index->Lookup(0, &extent));
+  std::unique_ptr<ExtentIterator> extents;
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, index->IteratorAtBlock(0, &extents));
+}
+
+// Every block of a fragmented multi-node blob is found in the extent holding it.
+TEST(ExtentIndexTest, LookupMultiNodeFragmented) {
+  MockSpaceManager space_manager;
+  std::unique_ptr<Allocator> allocator;
+  fbl::Vector<Extent> allocated_extents;
+  uint32_t node_index;
+  constexpr size_t kAllocatedExtents = kInlineMaxExtents + kContainerMaxExtents + 1;
+  ASSERT_NO_FAILURES(TestSetup(kAllocatedExtents, 3, /* fragmented=*/true, &space_manager,
+                               &allocator, &allocated_extents, &node_index));
+
+  AllocatedExtentIterator iter(allocator.get(), node_index);
+  std::unique_ptr<ExtentIndex> index;
+  ASSERT_OK(ExtentIndex::Create(&iter, &index));
+  ASSERT_EQ(allocated_extents.size(), index->ExtentCount());
+  ASSERT_EQ(kAllocatedExtents, index->BlockCount());
+
+  for (uint64_t block = 0; block < index->BlockCount(); block++) {
+    size_t extent;
+    ASSERT_OK(index->Lookup(block, &extent));
+    EXPECT_EQ(block, extent);
+  }
+  size_t extent;
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, index->Lookup(index->BlockCount(), &extent));
+}
+
+// A block iterator started from the index reaches every block at the same device offset as one
+// which walks the extent chain from the start.
+TEST(ExtentIndexTest, IteratorAtBlockMatchesLinearWalk) {
+  MockSpaceManager space_manager;
+  std::unique_ptr<Allocator> allocator;
+  fbl::Vector<Extent> allocated_extents;
+  uint32_t node_index;
+  constexpr size_t kAllocatedBlocks = kInlineMaxExtents + 2 * kContainerMaxExtents;
+  ASSERT_NO_FAILURES(TestSetup(kAllocatedBlocks, 4, /* fragmented=*/true, &space_manager,
+                               &allocator, &allocated_extents, &node_index));
+
+  AllocatedExtentIterator iter(allocator.get(), node_index);
+  std::unique_ptr<ExtentIndex> index;
+  ASSERT_OK(ExtentIndex::Create(&iter, &index));
+
+  for (uint32_t block = 0; block < kAllocatedBlocks; block += 7) {
+    BlockIterator linear(std::make_unique<AllocatedExtentIterator>(allocator.get(), node_index));
+    ASSERT_OK(IterateToBlock(&linear, block));
+
+    std::unique_ptr<ExtentIterator> extents;
+    ASSERT_OK(index->IteratorAtBlock(block, &extents));
+    BlockIterator indexed(std::move(extents));
+    ASSERT_OK(IterateToBlock(&indexed, block));
+    ASSERT_EQ(block, indexed.BlockIndex());
+
+    // Stream the remaining blocks from both and compare.
+    while (!linear.Done()) {
+      ASSERT_FALSE(indexed.Done());
+      uint32_t linear_length, indexed_length;
+      uint64_t linear_start, indexed_start;
+      ASSERT_OK(linear.Next(2, &linear_length, &linear_start));
+      ASSERT_OK(indexed.Next(2, &indexed_length, &indexed_start));
+      ASSERT_EQ(linear_length, indexed_length);
+      ASSERT_EQ(linear_start, indexed_start);
+    }
+    ASSERT_TRUE(indexed.Done());
+  }
+}
+
+// Lookups into an unfragmented blob land within its extents, which span many blocks.
+TEST(ExtentIndexTest, LookupUnfragmented) {
+  MockSpaceManager space_manager;
+  std::unique_ptr<Allocator> allocator;
+  fbl::Vector<Extent> allocated_extents;
+  uint32_t node_index;
+  constexpr size_t kAllocatedBlocks = 100;
+  ASSERT_NO_FAILURES(TestSetup(kAllocatedBlocks, 1, /* fragmented=*/false, &space_manager,
+                               &allocator, &allocated_extents, &node_index));
+
+  AllocatedExtentIterator iter(allocator.get(), node_index);
+  std::unique_ptr<ExtentIndex> index;
+  ASSERT_OK(ExtentIndex::Create(&iter, &index));
+  ASSERT_EQ(allocated_extents.size(), index->ExtentCount());
+  ASSERT_EQ(kAllocatedBlocks, index->BlockCount());
+
+  std::unique_ptr<ExtentIterator> extents;
+  ASSERT_OK(index->IteratorAtBlock(kAllocatedBlocks - 1, &extents));
+  BlockIterator block_iter(std::move(extents));
+  ASSERT_OK(IterateToBlock(&block_iter, kAllocatedBlocks - 1));
+  uint32_t length;
+  uint64_t start;
+  ASSERT_OK(block_iter.Next(1, &length, &start));
+  EXPECT_EQ(1, length);
+  EXPECT_EQ(allocated_extents[allocated_extents.size() - 1].Start() +
+                allocated_extents[allocated_extents.size() - 1].Length() - 1,
+            start);
+  EXPECT_TRUE(block_iter.Done());
+}
+
+}  // namespace
+}  // namespace blobfs
@@ -0,0 +1,99 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "memory-pressure-watcher.h"
+
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/zx/event.h>
+
+#include <vector>
+
+#include <zxtest/zxtest.h>
+
+namespace blobfs {
+namespace {
+
+class MemoryPressureWatcherTest : public zxtest::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK(zx::event::create(0, &normal_));
+    ASSERT_OK(zx::event::create(0, &warning_));
+    ASSERT_OK(zx::event::create(0, &critical_));
+  }
+
+  MemoryPressureEvents Events() {
+    MemoryPressureEvents events;
+    EXPECT_OK(normal_.duplicate(ZX_RIGHT_SAME_RIGHTS, &events.normal));
+    EXPECT_OK(warning_.duplicate(ZX_RIGHT_SAME_RIGHTS, &events.warning));
+    EXPECT_OK(critical_.duplicate(ZX_RIGHT_SAME_RIGHTS, &events.critical));
+    return events;
+  }
+
+  // Signals the event of |level| and clears the others, as the kernel does.
+  void EnterLevel(MemoryPressure level) {
+    ASSERT_OK(normal_.signal(ZX_EVENT_SIGNALED,
+                             level == MemoryPressure::kNormal ? ZX_EVENT_SIGNALED : 0));
+    ASSERT_OK(warning_.signal(ZX_EVENT_SIGNALED,
+                              level == MemoryPressure::kWarning ? ZX_EVENT_SIGNALED : 0));
+    ASSERT_OK(critical_.signal(ZX_EVENT_SIGNALED,
+                               level == MemoryPressure::kCritical ? ZX_EVENT_SIGNALED : 0));
+  }
+
+ protected:
+  async::Loop loop_{&kAsyncLoopConfigNoAttachToCurrentThread};
+  zx::event normal_;
+  zx::event warning_;
+  zx::event critical_;
+};
+
+TEST_F(MemoryPressureWatcherTest, ReportsEachChangeOnce) {
+  std::vector<MemoryPressure> levels;
+  std::unique_ptr<MemoryPressureWatcher> watcher;
+  ASSERT_NO_FAILURES(EnterLevel(MemoryPressure::kNormal));
+  ASSERT_OK(MemoryPressureWatcher::Create(
+      loop_.dispatcher(), Events(),
+      [&levels](MemoryPressure level) { levels.push_back(level); }, &watcher));
+
+  // The initial level is reported, and not again while it stays signaled.
+  ASSERT_OK(loop_.RunUntilIdle());
+  ASSERT_OK(loop_.RunUntilIdle());
+  EXPECT_EQ(std::vector<MemoryPressure>{MemoryPressure::kNormal}, levels);
+
+  ASSERT_NO_FAILURES(EnterLevel(MemoryPressure::kCritical));
+  ASSERT_OK(loop_.RunUntilIdle());
+  ASSERT_NO_FAILURES(EnterLevel(MemoryPressure::kWarning));
+  ASSERT_OK(loop_.RunUntilIdle());
+  ASSERT_NO_FAILURES(EnterLevel(MemoryPressure::kNormal));
+  ASSERT_OK(loop_.RunUntilIdle());
+
+  const std::vector<MemoryPressure> expected = {MemoryPressure::kNormal, MemoryPressure::kCritical,
+                                                MemoryPressure::kWarning, MemoryPressure::kNormal};
+  EXPECT_EQ(expected, levels);
+}
+
+TEST_F(MemoryPressureWatcherTest, NothingReportedAfterDestruction) {
+  int calls = 0;
+  std::unique_ptr<MemoryPressureWatcher> watcher;
+  ASSERT_OK(MemoryPressureWatcher::Create(
+      loop_.dispatcher(), Events(), [&calls](MemoryPressure) { calls++; }, &watcher));
+  watcher.reset();
+
+  ASSERT_NO_FAILURES(EnterLevel(MemoryPressure::kWarning));
+  ASSERT_OK(loop_.RunUntilIdle());
+  EXPECT_EQ(0, calls);
+}
+
+TEST_F(MemoryPressureWatcherTest, InvalidEventsAreRejected) {
+  std::unique_ptr<MemoryPressureWatcher> watcher;
+  MemoryPressureEvents events = Events();
+  events.warning.reset();
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS,
+            MemoryPressureWatcher::Create(loop_.dispatcher(), std::move(events),
+                                          [](MemoryPressure) {}, &watcher));
+  EXPECT_NULL(watcher.get());
+}
+
+}  // namespace
+}  // namespace blobfs
@@ -7,11 +7,20 @@
 #include <zircon/types.h>
 
 #include <algorithm>
+#include <thread>
+#include <vector>
 
 #include <digest/digest.h>
 #include <digest/hash-list.h>
 
 namespace digest {
+namespace {
+
+// Below this many nodes for each thread, starting the thread costs more than it saves.
+constexpr size_t kMinNodesPerThread = 64;
+
+}  // namespace
+
 namespace internal {
 
 // HashListBase<T>
@@ -64,9 +73,26 @@ zx_status_t HashListBase::ProcessData(const uint8_t *buf, size_t buf_len, size_t
   data_off_ = data_off;
   list_off_ = GetListOffset(data_off);
   while (buf_len != 0) {
-    if (node_digest_.IsAligned(data_off_) &&
-        (rc = node_digest_.Reset(data_off_, data_len_)) != ZX_OK) {
-      return rc;
+    if (node_digest_.IsAligned(data_off_)) {
+      // Complete nodes are independent of each other, so hash as many together as possible.
+      size_t nodes = std::min(buf_len, data_len_ - data_off_) / GetNodeSize();
+      if (nodes > 1) {
+        nodes = std::min(nodes, NodeDigest::kMaxParallelNodes);
+        uint8_t digests[NodeDigest::kMaxParallelNodes][kSha256Length];
+        node_digest_.HashNodes(buf, data_off_, nodes, digests);
+        for (size_t i = 0; i < nodes; ++i) {
+          HandleOne(Digest(digests[i]));
+          list_off_ += GetDigestSize();
+        }
+        size_t chunk = nodes * GetNodeSize();
+        buf += chunk;
+        buf_len -= chunk;
+        data_off_ += chunk;
+        continue;
+      }
+      if ((rc = node_digest_.Reset(data_off_, data_len_)) != ZX_OK) {
+        return rc;
+      }
     }
     size_t chunk = node_digest_.Append(buf, buf_len);
     buf += chunk;
@@ -115,6 +141,51 @@ zx_status_t HashListCreator::Append(const void *buf, size_t buf_len) {
   return this->ProcessData(static_cast<const uint8_t *>(buf), buf_len, this->data_off());
 }
 
+zx_status_t HashListCreator::AppendParallel(const void *buf, size_t buf_len, size_t num_threads) {
+  if (data_off() != 0 || buf_len != data_len()) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+  const size_t num_nodes = GetListLength() / GetDigestSize();
+  num_threads = std::min(num_threads, num_nodes / kMinNodesPerThread);
+  if (num_threads <= 1) {
+    return Append(buf, buf_len);
+  }
+
+  // Each worker hashes a contiguous range of nodes with its own hash list over the shared |list()|,
+  // so the digests land where a single |Append| would have put them. The final range is hashed on
+  // this thread, which leaves this list's offsets as they would be after that |Append|.
+  const uint8_t *data = static_cast<const uint8_t *>(buf);
+  const size_t range_len = ((num_nodes + num_threads - 1) / num_threads) * GetNodeSize();
+  std::vector<zx_status_t> results(num_threads, ZX_OK);
+  std::vector<std::thread> workers;
+  size_t data_off = 0;
+  for (; buf_len - data_off > range_len; data_off += range_len) {
+    zx_status_t *result = &results[workers.size()];
+    workers.emplace_back([this, data, data_off, range_len, result]() {
+      HashListCreator worker;
+      worker.SetNodeId(GetNodeId());
+      zx_status_t rc;
+      if ((rc = worker.SetNodeSize(GetNodeSize())) != ZX_OK ||
+          (rc = worker.SetDataLength(data_len())) != ZX_OK ||
+          (rc = worker.SetList(list(), list_len())) != ZX_OK) {
+        *result = rc;
+        return;
+      }
+      *result = worker.ProcessData(data + data_off, range_len, data_off);
+    });
+  }
+  results[workers.size()] = ProcessData(data + data_off, buf_len - data_off, data_off);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  for (zx_status_t rc : results) {
+    if (rc != ZX_OK) {
+      return rc;
+    }
+  }
+  return ZX_OK;
+}
+
 void HashListCreator::HandleOne(const Digest &digest) {
   digest.CopyTo(list() + list_off(), GetDigestSize());
 }
@@ -118,6 +118,10 @@ class HashListCreator : public internal::HashList<uint8_t> {
   // Reads |buf_len| bytes of data from |buf| and appends digests to the hash |list|.
   zx_status_t Append(const void *buf, size_t buf_len);
 
+  // Equivalent to a single |Append| of all |data_len()| bytes of data from |buf| to an empty list,
+  // but splits the nodes into contiguous ranges that are hashed on up to |num_threads| threads.
+  zx_status_t AppendParallel(const void *buf, size_t buf_len, size_t num_threads);
+
  protected:
   // Writes a single calculated digest to the appropriate position in the list.
   void HandleOne(const Digest &digest) override;
@@ -80,12 +80,19 @@ class MerkleTreeCreator
     : public internal::MerkleTree<uint8_t, void *, MerkleTreeCreator, HashListCreator> {
  public:
   // Convenience method to create and return a Merkle tree for the given |data| via |out_tree| and
-  // |out_root|.
+  // |out_root|. If |num_threads| is greater than one, the nodes of each level of the tree are
+  // hashed on up to that many threads before moving on to the next level. The resulting tree is
+  // the same regardless.
   static zx_status_t Create(const void *data, size_t data_len, std::unique_ptr<uint8_t[]> *out_tree,
-                            size_t *out_tree_len, Digest *out_root);
+                            size_t *out_tree_len, Digest *out_root, size_t num_threads = 1);
 
   // Reads |buf_len| bytes of data from |buf| and appends digests to the hash |list|.
   zx_status_t Append(const void *buf, size_t buf_len);
+
+ private:
+  // Builds the whole tree from all of the data in |buf|, one level at a time. See
+  // |HashListCreator::AppendParallel|.
+  zx_status_t AppendParallel(const void *buf, size_t buf_len, size_t num_threads);
 };
 
 // |digest::MerkleTreeVerifier| verifies data against a Merkle tree.
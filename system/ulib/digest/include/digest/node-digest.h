@@ -68,6 +68,16 @@ class NodeDigest {
   // the number of bytes hashed.
   size_t Append(const void* buf, size_t buf_len);
 
+  // The most nodes |HashNodes| will hash in one call.
+  static constexpr size_t kMaxParallelNodes = 8;
+
+  // Computes the digests of |count| consecutive complete nodes from |buf|, the first of which is at
+  // the node-aligned |data_off|, and writes them to |out|. The result is the same as calling
+  // |Reset| and |Append| for each node in turn, but the nodes are hashed in parallel where the CPU
+  // allows. Does not modify the working digest. |count| must be at most |kMaxParallelNodes|.
+  void HashNodes(const uint8_t* buf, size_t data_off, size_t count,
+                 uint8_t (*out)[kSha256Length]) const;
+
  private:
   // The underlying digest used to hash the data.
   Digest digest_;
@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <zircon/errors.h>
 #include <zircon/types.h>
 
@@ -82,7 +83,7 @@ template zx_status_t internal::MerkleTree<uint8_t, void *, MerkleTreeCreator,
 // static
 zx_status_t MerkleTreeCreator::Create(const void *data, size_t data_len,
                                       std::unique_ptr<uint8_t[]> *out_tree, size_t *out_tree_len,
-                                      Digest *out_root) {
+                                      Digest *out_root, size_t num_threads) {
   if (out_tree == nullptr || out_tree_len == nullptr || out_root == nullptr) {
     return ZX_ERR_INVALID_ARGS;
   }
@@ -101,8 +102,15 @@ zx_status_t MerkleTreeCreator::Create(const void *data, size_t data_len,
       return ZX_ERR_NO_MEMORY;
     }
   }
-  if ((rc = creator.SetTree(tree.get(), tree_len, root, sizeof(root))) != ZX_OK ||
-      (rc = creator.Append(data, data_len)) != ZX_OK) {
+  if ((rc = creator.SetTree(tree.get(), tree_len, root, sizeof(root))) != ZX_OK) {
+    return rc;
+  }
+  if (num_threads > 1) {
+    rc = creator.AppendParallel(data, data_len, num_threads);
+  } else {
+    rc = creator.Append(data, data_len);
+  }
+  if (rc != ZX_OK) {
     return rc;
   }
   *out_tree = std::move(tree);
@@ -138,6 +146,18 @@ zx_status_t MerkleTreeCreator::Append(const void *buf, size_t buf_len) {
   return next_->Append(list, list_len);
 }
 
+zx_status_t MerkleTreeCreator::AppendParallel(const void *buf, size_t buf_len,
+                                              size_t num_threads) {
+  zx_status_t rc = hash_list_.AppendParallel(buf, buf_len, num_threads);
+  if (rc != ZX_OK || next_.get() == nullptr) {
+    return rc;
+  }
+  // This level is complete, so pad it out to a whole node and hash it as the next level's data.
+  auto list = hash_list_.list();
+  memset(list + hash_list_.list_off(), 0, hash_list_.list_len() - hash_list_.list_off());
+  return next_->AppendParallel(list, hash_list_.list_len(), num_threads);
+}
+
 // MerkleTreeVerifier
 
 // Forward declarations for templates
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <zircon/assert.h>
 #include <zircon/types.h>
 
@@ -12,6 +13,8 @@
 #include <digest/node-digest.h>
 #include <fbl/algorithm.h>
 
+#include "sha256-multi.h"
+
 namespace digest {
 
 zx_status_t NodeDigest::SetNodeSize(size_t node_size) {
@@ -59,4 +62,26 @@ size_t NodeDigest::Append(const void* buf, size_t buf_len) {
   return len;
 }
 
+static_assert(NodeDigest::kMaxParallelNodes <= internal::kSha256MaxLanes);
+
+void NodeDigest::HashNodes(const uint8_t* buf, size_t data_off, size_t count,
+                           uint8_t (*out)[kSha256Length]) const {
+  ZX_DEBUG_ASSERT(IsAligned(data_off));
+  ZX_DEBUG_ASSERT(count <= kMaxParallelNodes);
+  // Each node is prefixed with the same locality and length |Reset| would hash.
+  constexpr size_t kPrefixLen = sizeof(uint64_t) + sizeof(uint32_t);
+  uint8_t prefixes[kMaxParallelNodes][kPrefixLen];
+  const uint8_t* prefix_ptrs[kMaxParallelNodes];
+  const uint8_t* data_ptrs[kMaxParallelNodes];
+  const uint32_t length = static_cast<uint32_t>(node_size_);
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t locality = id_ ^ (data_off + i * node_size_);
+    memcpy(&prefixes[i][0], &locality, sizeof(locality));
+    memcpy(&prefixes[i][sizeof(locality)], &length, sizeof(length));
+    prefix_ptrs[i] = prefixes[i];
+    data_ptrs[i] = buf + i * node_size_;
+  }
+  internal::Sha256Multi(prefix_ptrs, kPrefixLen, data_ptrs, node_size_, count, out);
+}
+
 }  // namespace digest
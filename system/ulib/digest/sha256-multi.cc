@@ -0,0 +1,518 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+
+#include "sha256-multi.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zircon/assert.h>
+
+#include <algorithm>
+
+#include <digest/digest.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#if defined(__Fuchsia__)
+#include <zircon/features.h>
+#include <zircon/syscalls.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace digest {
+namespace internal {
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+alignas(16) constexpr uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t kInitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// Presents a message made up of a prefix and data as the sequence of padded 64-byte blocks which
+// SHA-256 consumes.
+class PaddedMessage {
+ public:
+  PaddedMessage() = default;
+  PaddedMessage(const uint8_t* prefix, size_t prefix_len, const uint8_t* data, size_t data_len)
+      : prefix_(prefix), prefix_len_(prefix_len), data_(data), data_len_(data_len) {}
+
+  // The number of blocks after padding, which is the same for all messages of a given length.
+  static size_t NumBlocks(size_t len) {
+    return (len + 1 + sizeof(uint64_t) + kBlockSize - 1) / kBlockSize;
+  }
+
+  // Returns the |index|th block. Blocks which lie entirely within the data are returned in place;
+  // the rest are assembled in |scratch|.
+  const uint8_t* Block(size_t index, uint8_t* scratch) const {
+    const size_t len = prefix_len_ + data_len_;
+    const size_t start = index * kBlockSize;
+    if (start >= prefix_len_ && start + kBlockSize <= len) {
+      return data_ + (start - prefix_len_);
+    }
+    memset(scratch, 0, kBlockSize);
+    if (start < prefix_len_) {
+      memcpy(scratch, prefix_ + start, std::min(prefix_len_ - start, kBlockSize));
+    }
+    const size_t data_start = std::max(start, prefix_len_);
+    const size_t data_end = std::min(start + kBlockSize, len);
+    if (data_start < data_end) {
+      memcpy(scratch + (data_start - start), data_ + (data_start - prefix_len_),
+             data_end - data_start);
+    }
+    if (len >= start && len < start + kBlockSize) {
+      scratch[len - start] = 0x80;
+    }
+    if (index == NumBlocks(len) - 1) {
+      const uint64_t bits = static_cast<uint64_t>(len) * 8;
+      for (size_t i = 0; i < sizeof(bits); ++i) {
+        scratch[kBlockSize - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+      }
+    }
+    return scratch;
+  }
+
+ private:
+  const uint8_t* prefix_ = nullptr;
+  size_t prefix_len_ = 0;
+  const uint8_t* data_ = nullptr;
+  size_t data_len_ = 0;
+};
+
+void StoreDigest(const uint32_t state[8], uint8_t* out) {
+  for (size_t i = 0; i < 8; ++i) {
+    out[4 * i + 0] = static_cast<uint8_t>(state[i] >> 24);
+    out[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+    out[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+    out[4 * i + 3] = static_cast<uint8_t>(state[i]);
+  }
+}
+
+// Hashes a single message with the general purpose implementation.
+void HashOne(const uint8_t* prefix, size_t prefix_len, const uint8_t* data, size_t data_len,
+             uint8_t* out) {
+  Digest digest;
+  digest.Init();
+  digest.Update(prefix, prefix_len);
+  digest.Update(data, data_len);
+  digest.Final();
+  digest.CopyTo(out, kSha256Length);
+}
+
+#if defined(__x86_64__)
+
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1"), always_inline))
+
+// Performs four rounds on |abef| and |cdgh| using the message words |w| and round constants |k|.
+SHA_NI_TARGET inline void ShaNiRounds(__m128i* abef, __m128i* cdgh, __m128i w, const uint32_t* k) {
+  __m128i wk = _mm_add_epi32(w, _mm_load_si128(reinterpret_cast<const __m128i*>(k)));
+  *cdgh = _mm_sha256rnds2_epu32(*cdgh, *abef, wk);
+  wk = _mm_shuffle_epi32(wk, 0x0e);
+  *abef = _mm_sha256rnds2_epu32(*abef, *cdgh, wk);
+}
+
+// Replaces the oldest message words |w0| with the words four groups later, given the following
+// three groups of words.
+SHA_NI_TARGET inline void ShaNiSchedule(__m128i* w0, __m128i w1, __m128i w2, __m128i w3) {
+  const __m128i next = _mm_add_epi32(_mm_sha256msg1_epu32(*w0, w1), _mm_alignr_epi8(w3, w2, 4));
+  *w0 = _mm_sha256msg2_epu32(next, w3);
+}
+
+struct ShaNiLane {
+  __m128i abef;
+  __m128i cdgh;
+  __m128i w[4];
+};
+
+// Hashes two messages of |len| bytes with interleaved SHA-NI instruction streams, so that the
+// latency of each round instruction is hidden behind the other lane's work.
+__attribute__((target("sha,sse4.1"))) void HashPairShaNi(const PaddedMessage (&msgs)[2], size_t len,
+                                                         uint8_t (*out)[kSha256Length]) {
+  const __m128i kByteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  ShaNiLane x;
+  ShaNiLane y;
+  {
+    const __m128i tmp = _mm_shuffle_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kInitialState[0])), 0xb1);
+    const __m128i efgh = _mm_shuffle_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kInitialState[4])), 0x1b);
+    x.abef = y.abef = _mm_alignr_epi8(tmp, efgh, 8);
+    x.cdgh = y.cdgh = _mm_blend_epi16(efgh, tmp, 0xf0);
+  }
+
+  uint8_t scratch[2][kBlockSize];
+  const size_t num_blocks = PaddedMessage::NumBlocks(len);
+  for (size_t n = 0; n < num_blocks; ++n) {
+    const uint8_t* block_x = msgs[0].Block(n, scratch[0]);
+    const uint8_t* block_y = msgs[1].Block(n, scratch[1]);
+    for (size_t i = 0; i < 4; ++i) {
+      x.w[i] = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(block_x + 16 * i)), kByteSwap);
+      y.w[i] = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(block_y + 16 * i)), kByteSwap);
+    }
+    const __m128i abef_x = x.abef;
+    const __m128i cdgh_x = x.cdgh;
+    const __m128i abef_y = y.abef;
+    const __m128i cdgh_y = y.cdgh;
+
+    // Each group of four rounds computes the message words needed four groups later in place of
+    // the ones it consumed; the last four groups need no more words.
+    for (size_t g = 0; g < 16; g += 4) {
+      const bool schedule = g < 12;
+      ShaNiRounds(&x.abef, &x.cdgh, x.w[0], &kRoundConstants[4 * g]);
+      ShaNiRounds(&y.abef, &y.cdgh, y.w[0], &kRoundConstants[4 * g]);
+      if (schedule) {
+        ShaNiSchedule(&x.w[0], x.w[1], x.w[2], x.w[3]);
+        ShaNiSchedule(&y.w[0], y.w[1], y.w[2], y.w[3]);
+      }
+      ShaNiRounds(&x.abef, &x.cdgh, x.w[1], &kRoundConstants[4 * g + 4]);
+      ShaNiRounds(&y.abef, &y.cdgh, y.w[1], &kRoundConstants[4 * g + 4]);
+      if (schedule) {
+        ShaNiSchedule(&x.w[1], x.w[2], x.w[3], x.w[0]);
+        ShaNiSchedule(&y.w[1], y.w[2], y.w[3], y.w[0]);
+      }
+      ShaNiRounds(&x.abef, &x.cdgh, x.w[2], &kRoundConstants[4 * g + 8]);
+      ShaNiRounds(&y.abef, &y.cdgh, y.w[2], &kRoundConstants[4 * g + 8]);
+      if (schedule) {
+        ShaNiSchedule(&x.w[2], x.w[3], x.w[0], x.w[1]);
+        ShaNiSchedule(&y.w[2], y.w[3], y.w[0], y.w[1]);
+      }
+      ShaNiRounds(&x.abef, &x.cdgh, x.w[3], &kRoundConstants[4 * g + 12]);
+      ShaNiRounds(&y.abef, &y.cdgh, y.w[3], &kRoundConstants[4 * g + 12]);
+      if (schedule) {
+        ShaNiSchedule(&x.w[3], x.w[0], x.w[1], x.w[2]);
+        ShaNiSchedule(&y.w[3], y.w[0], y.w[1], y.w[2]);
+      }
+    }
+    x.abef = _mm_add_epi32(x.abef, abef_x);
+    x.cdgh = _mm_add_epi32(x.cdgh, cdgh_x);
+    y.abef = _mm_add_epi32(y.abef, abef_y);
+    y.cdgh = _mm_add_epi32(y.cdgh, cdgh_y);
+  }
+
+  const ShaNiLane* lanes[2] = {&x, &y};
+  for (size_t l = 0; l < 2; ++l) {
+    uint32_t state[8];
+    const __m128i feba = _mm_shuffle_epi32(lanes[l]->abef, 0x1b);
+    const __m128i dchg = _mm_shuffle_epi32(lanes[l]->cdgh, 0xb1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(dchg, feba, 8));
+    StoreDigest(state, out[l]);
+  }
+}
+
+#undef SHA_NI_TARGET
+
+#define AVX2_TARGET __attribute__((target("avx2"), always_inline))
+
+template <int n>
+AVX2_TARGET inline __m256i Avx2Rotr(__m256i x) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// Transposes the 8x8 matrix of 32-bit words in |rows|.
+AVX2_TARGET inline void Avx2Transpose(__m256i (&rows)[8]) {
+  const __m256i t0 = _mm256_unpacklo_epi32(rows[0], rows[1]);
+  const __m256i t1 = _mm256_unpackhi_epi32(rows[0], rows[1]);
+  const __m256i t2 = _mm256_unpacklo_epi32(rows[2], rows[3]);
+  const __m256i t3 = _mm256_unpackhi_epi32(rows[2], rows[3]);
+  const __m256i t4 = _mm256_unpacklo_epi32(rows[4], rows[5]);
+  const __m256i t5 = _mm256_unpackhi_epi32(rows[4], rows[5]);
+  const __m256i t6 = _mm256_unpacklo_epi32(rows[6], rows[7]);
+  const __m256i t7 = _mm256_unpackhi_epi32(rows[6], rows[7]);
+  const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+  const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+  const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+  const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+  const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+  const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+  const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+  const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+  rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+// Performs one round in every lane. Rather than shifting the working variables, callers rotate
+// the arguments from one round to the next.
+AVX2_TARGET inline void Avx2Round(__m256i a, __m256i b, __m256i c, __m256i* d, __m256i e,
+                                  __m256i f, __m256i g, __m256i* h, __m256i w, uint32_t k) {
+  const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Avx2Rotr<6>(e), Avx2Rotr<11>(e)),
+                                      Avx2Rotr<25>(e));
+  const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+  const __m256i t1 =
+      _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(*h, s1), _mm256_add_epi32(ch, w)),
+                       _mm256_set1_epi32(static_cast<int>(k)));
+  const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Avx2Rotr<2>(a), Avx2Rotr<13>(a)),
+                                      Avx2Rotr<22>(a));
+  const __m256i maj =
+      _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+  *d = _mm256_add_epi32(*d, t1);
+  *h = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));
+}
+
+// Hashes eight messages of |len| bytes, one per 32-bit lane of the AVX2 registers.
+__attribute__((target("avx2"))) void HashOctetAvx2(const PaddedMessage (&msgs)[8], size_t len,
+                                                   uint8_t (*out)[kSha256Length]) {
+  __m256i state[8];
+  for (size_t i = 0; i < 8; ++i) {
+    state[i] = _mm256_set1_epi32(static_cast<int>(kInitialState[i]));
+  }
+  const __m256i kByteSwap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+  uint8_t scratch[8][kBlockSize];
+  const size_t num_blocks = PaddedMessage::NumBlocks(len);
+  for (size_t n = 0; n < num_blocks; ++n) {
+    // Load and transpose the blocks so that each vector holds the same message word from every
+    // lane, then expand the message schedule for all lanes at once.
+    __m256i w[64];
+    __m256i rows[2][8];
+    for (size_t l = 0; l < 8; ++l) {
+      const uint8_t* block = msgs[l].Block(n, scratch[l]);
+      for (size_t half = 0; half < 2; ++half) {
+        rows[half][l] = _mm256_shuffle_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * half)), kByteSwap);
+      }
+    }
+    for (size_t half = 0; half < 2; ++half) {
+      Avx2Transpose(rows[half]);
+      for (size_t i = 0; i < 8; ++i) {
+        w[8 * half + i] = rows[half][i];
+      }
+    }
+    for (size_t t = 16; t < 64; ++t) {
+      const __m256i s0 =
+          _mm256_xor_si256(_mm256_xor_si256(Avx2Rotr<7>(w[t - 15]), Avx2Rotr<18>(w[t - 15])),
+                           _mm256_srli_epi32(w[t - 15], 3));
+      const __m256i s1 =
+          _mm256_xor_si256(_mm256_xor_si256(Avx2Rotr<17>(w[t - 2]), Avx2Rotr<19>(w[t - 2])),
+                           _mm256_srli_epi32(w[t - 2], 10));
+      w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+    }
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+    for (size_t t = 0; t < 64; t += 8) {
+      Avx2Round(a, b, c, &d, e, f, g, &h, w[t + 0], kRoundConstants[t + 0]);
+      Avx2Round(h, a, b, &c, d, e, f, &g, w[t + 1], kRoundConstants[t + 1]);
+      Avx2Round(g, h, a, &b, c, d, e, &f, w[t + 2], kRoundConstants[t + 2]);
+      Avx2Round(f, g, h, &a, b, c, d, &e, w[t + 3], kRoundConstants[t + 3]);
+      Avx2Round(e, f, g, &h, a, b, c, &d, w[t + 4], kRoundConstants[t + 4]);
+      Avx2Round(d, e, f, &g, h, a, b, &c, w[t + 5], kRoundConstants[t + 5]);
+      Avx2Round(c, d, e, &f, g, h, a, &b, w[t + 6], kRoundConstants[t + 6]);
+      Avx2Round(b, c, d, &e, f, g, h, &a, w[t + 7], kRoundConstants[t + 7]);
+    }
+    state[0] = _mm256_add_epi32(state[0], a);
+    state[1] = _mm256_add_epi32(state[1], b);
+    state[2] = _mm256_add_epi32(state[2], c);
+    state[3] = _mm256_add_epi32(state[3], d);
+    state[4] = _mm256_add_epi32(state[4], e);
+    state[5] = _mm256_add_epi32(state[5], f);
+    state[6] = _mm256_add_epi32(state[6], g);
+    state[7] = _mm256_add_epi32(state[7], h);
+  }
+
+  // Transposing the state yields each lane's digest words.
+  Avx2Transpose(state);
+  for (size_t l = 0; l < 8; ++l) {
+    uint32_t lane[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lane), state[l]);
+    StoreDigest(lane, out[l]);
+  }
+}
+
+#undef AVX2_TARGET
+
+#elif defined(__aarch64__)
+
+// Hashes two messages of |len| bytes with interleaved ARMv8 SHA2 instruction streams.
+__attribute__((target("crypto"))) void HashPairArmSha2(const PaddedMessage (&msgs)[2], size_t len,
+                                                       uint8_t (*out)[kSha256Length]) {
+  uint32x4_t abcd[2];
+  uint32x4_t efgh[2];
+  for (size_t l = 0; l < 2; ++l) {
+    abcd[l] = vld1q_u32(&kInitialState[0]);
+    efgh[l] = vld1q_u32(&kInitialState[4]);
+  }
+
+  uint8_t scratch[2][kBlockSize];
+  const size_t num_blocks = PaddedMessage::NumBlocks(len);
+  for (size_t n = 0; n < num_blocks; ++n) {
+    uint32x4_t words[2][4];
+    uint32x4_t abcd_save[2];
+    uint32x4_t efgh_save[2];
+    for (size_t l = 0; l < 2; ++l) {
+      const uint8_t* block = msgs[l].Block(n, scratch[l]);
+      for (size_t i = 0; i < 4; ++i) {
+        words[l][i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + 16 * i)));
+      }
+      abcd_save[l] = abcd[l];
+      efgh_save[l] = efgh[l];
+    }
+    // Each iteration performs four rounds, and computes the message words needed four iterations
+    // later in place of the ones just consumed.
+    for (size_t g = 0; g < 16; ++g) {
+      const uint32x4_t k = vld1q_u32(&kRoundConstants[4 * g]);
+      for (size_t l = 0; l < 2; ++l) {
+        const uint32x4_t wk = vaddq_u32(words[l][g & 3], k);
+        const uint32x4_t prev = abcd[l];
+        abcd[l] = vsha256hq_u32(abcd[l], efgh[l], wk);
+        efgh[l] = vsha256h2q_u32(efgh[l], prev, wk);
+        if (g < 12) {
+          words[l][g & 3] =
+              vsha256su1q_u32(vsha256su0q_u32(words[l][g & 3], words[l][(g + 1) & 3]),
+                              words[l][(g + 2) & 3], words[l][(g + 3) & 3]);
+        }
+      }
+    }
+    for (size_t l = 0; l < 2; ++l) {
+      abcd[l] = vaddq_u32(abcd[l], abcd_save[l]);
+      efgh[l] = vaddq_u32(efgh[l], efgh_save[l]);
+    }
+  }
+
+  for (size_t l = 0; l < 2; ++l) {
+    uint32_t state[8];
+    vst1q_u32(&state[0], abcd[l]);
+    vst1q_u32(&state[4], efgh[l]);
+    StoreDigest(state, out[l]);
+  }
+}
+
+#endif
+
+enum class Implementation {
+  // One message at a time, through |Digest|.
+  kGeneric,
+  kShaNi,
+  kAvx2,
+  kArmSha2,
+};
+
+Implementation DetectImplementation() {
+#if defined(__x86_64__)
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return Implementation::kGeneric;
+  }
+  const bool has_sse41 = ecx & bit_SSE4_1;
+  bool has_ymm_state = false;
+  if (ecx & bit_OSXSAVE) {
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    has_ymm_state = (xcr0_lo & 0x6) == 0x6;
+  }
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return Implementation::kGeneric;
+  }
+  if ((ebx & bit_SHA) && has_sse41) {
+    return Implementation::kShaNi;
+  }
+  if ((ebx & bit_AVX2) && has_ymm_state) {
+    return Implementation::kAvx2;
+  }
+#elif defined(__aarch64__)
+#if defined(__Fuchsia__)
+  uint32_t features = 0;
+  if (zx_system_get_features(ZX_FEATURE_KIND_CPU, &features) == ZX_OK &&
+      (features & ZX_ARM64_FEATURE_ISA_SHA2)) {
+    return Implementation::kArmSha2;
+  }
+#elif defined(__linux__)
+  // HWCAP_SHA2 from <asm/hwcap.h>.
+  if (getauxval(AT_HWCAP) & (1 << 6)) {
+    return Implementation::kArmSha2;
+  }
+#elif defined(__APPLE__)
+  return Implementation::kArmSha2;
+#endif
+#endif
+  return Implementation::kGeneric;
+}
+
+Implementation GetImplementation() {
+  static const Implementation implementation = DetectImplementation();
+  return implementation;
+}
+
+}  // namespace
+
+void Sha256Multi(const uint8_t* const* prefixes, size_t prefix_len, const uint8_t* const* data,
+                 size_t data_len, size_t count, uint8_t (*out)[kSha256Length]) {
+  ZX_DEBUG_ASSERT(count <= kSha256MaxLanes);
+  const size_t len = prefix_len + data_len;
+  size_t i = 0;
+  switch (GetImplementation()) {
+#if defined(__x86_64__)
+    case Implementation::kShaNi:
+      for (; i + 2 <= count; i += 2) {
+        const PaddedMessage msgs[2] = {
+            PaddedMessage(prefixes[i], prefix_len, data[i], data_len),
+            PaddedMessage(prefixes[i + 1], prefix_len, data[i + 1], data_len),
+        };
+        HashPairShaNi(msgs, len, &out[i]);
+      }
+      break;
+    case Implementation::kAvx2: {
+      // Idle lanes repeat the first message, so only use the vector unit when enough lanes are
+      // busy to beat hashing the messages one at a time.
+      constexpr size_t kMinBusyLanes = 5;
+      if (count < kMinBusyLanes) {
+        break;
+      }
+      PaddedMessage msgs[8];
+      for (size_t l = 0; l < 8; ++l) {
+        const size_t m = l < count ? l : 0;
+        msgs[l] = PaddedMessage(prefixes[m], prefix_len, data[m], data_len);
+      }
+      uint8_t digests[8][kSha256Length];
+      HashOctetAvx2(msgs, len, digests);
+      memcpy(out, digests, count * kSha256Length);
+      i = count;
+      break;
+    }
+#elif defined(__aarch64__)
+    case Implementation::kArmSha2:
+      for (; i + 2 <= count; i += 2) {
+        const PaddedMessage msgs[2] = {
+            PaddedMessage(prefixes[i], prefix_len, data[i], data_len),
+            PaddedMessage(prefixes[i + 1], prefix_len, data[i + 1], data_len),
+        };
+        HashPairArmSha2(msgs, len, &out[i]);
+      }
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; i < count; ++i) {
+    HashOne(prefixes[i], prefix_len, data[i], data_len, out[i]);
+  }
+}
+
+}  // namespace internal
+}  // namespace digest
@@ -0,0 +1,32 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_DIGEST_SHA256_MULTI_H_
+#define ZIRCON_SYSTEM_ULIB_DIGEST_SHA256_MULTI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <digest/digest.h>
+
+namespace digest {
+namespace internal {
+
+// The largest number of messages |Sha256Multi| will hash together. Callers batching work for it
+// should offer this many messages at a time where possible.
+constexpr size_t kSha256MaxLanes = 8;
+
+// Computes the SHA-256 digests of |count| independent messages of equal length, where |count| is
+// at most |kSha256MaxLanes|. Message |i| is the |prefix_len| bytes at |prefixes[i]| followed by the
+// |data_len| bytes at |data[i]|, and its digest is written to |out[i]|.
+//
+// Where the CPU supports it, the messages are hashed in parallel: 8 lanes with AVX2, or 2 lanes
+// interleaved with the SHA extensions on x86-64 and arm64, which hides the latency of the round
+// instructions. Otherwise each message is hashed in turn with |Digest|.
+void Sha256Multi(const uint8_t* const* prefixes, size_t prefix_len, const uint8_t* const* data,
+                 size_t data_len, size_t count, uint8_t (*out)[kSha256Length]);
+
+}  // namespace internal
+}  // namespace digest
+
+#endif  // ZIRCON_SYSTEM_ULIB_DIGEST_SHA256_MULTI_H_
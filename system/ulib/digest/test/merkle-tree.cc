@@ -214,5 +214,40 @@ TEST(MerkleTree, Verify) {
   }
 }
 
+TEST(MerkleTree, CreateParallel) {
+  srand(zxtest::Runner::GetInstance()->random_seed());
+  // The largest length is enough to be split across threads at the leaves, with a partial node at
+  // the end and more than one node in the level above. Smaller trees are built on the calling
+  // thread.
+  const size_t kDataLens[] = {0, 1, kNodeSize, (kNodeSize * 8) + 1,
+                              (kNodeSize * kDigestsPerNode * 3) + (kNodeSize / 2) + 1};
+  const size_t max_len = kDataLens[(sizeof(kDataLens) / sizeof(kDataLens[0])) - 1];
+  fbl::AllocChecker ac;
+  std::unique_ptr<uint8_t[]> data(new (&ac) uint8_t[max_len]);
+  ASSERT_TRUE(ac.check());
+  for (size_t i = 0; i < max_len; ++i) {
+    data[i] = static_cast<uint8_t>(rand());
+  }
+  for (size_t data_len : kDataLens) {
+    std::unique_ptr<uint8_t[]> expected_tree;
+    size_t expected_tree_len;
+    Digest expected_root;
+    ASSERT_OK(MerkleTreeCreator::Create(data.get(), data_len, &expected_tree, &expected_tree_len,
+                                        &expected_root));
+    for (size_t num_threads : {2, 3, 8, 64}) {
+      std::unique_ptr<uint8_t[]> tree;
+      size_t tree_len;
+      Digest root;
+      ASSERT_OK(MerkleTreeCreator::Create(data.get(), data_len, &tree, &tree_len, &root,
+                                          num_threads));
+      ASSERT_EQ(tree_len, expected_tree_len);
+      if (tree_len > 0) {
+        EXPECT_BYTES_EQ(tree.get(), expected_tree.get(), tree_len);
+      }
+      EXPECT_BYTES_EQ(root.get(), expected_root.get(), kSha256Length);
+    }
+  }
+}
+
 }  // namespace testing
 }  // namespace digest
@@ -6,6 +6,8 @@
 #include <zircon/assert.h>
 #include <zircon/status.h>
 
+#include <memory>
+
 #include <digest/digest.h>
 #include <digest/merkle-tree.h>
 #include <digest/node-digest.h>
@@ -125,5 +127,29 @@ TEST(NodeDigest, ResetAndAppend) {
   }
 }
 
+TEST(NodeDigest, HashNodes) {
+  srand(zxtest::Runner::GetInstance()->random_seed());
+  NodeDigest node_digest;
+  node_digest.set_id(3);
+  const size_t node_size = node_digest.node_size();
+  const size_t data_len = node_size * NodeDigest::kMaxParallelNodes;
+  std::unique_ptr<uint8_t[]> data(new uint8_t[data_len]);
+  for (size_t i = 0; i < data_len; ++i) {
+    data[i] = static_cast<uint8_t>(rand());
+  }
+  uint8_t digests[NodeDigest::kMaxParallelNodes][kSha256Length];
+  for (size_t count = 1; count <= NodeDigest::kMaxParallelNodes; ++count) {
+    // Any batch of nodes should match hashing the same nodes one at a time.
+    const size_t data_off = node_size * (NodeDigest::kMaxParallelNodes - count);
+    node_digest.HashNodes(&data[data_off], data_off, count, digests);
+    for (size_t i = 0; i < count; ++i) {
+      const size_t node_off = data_off + (i * node_size);
+      ASSERT_OK(node_digest.Reset(node_off, data_len));
+      EXPECT_EQ(node_digest.Append(&data[node_off], node_size), node_size);
+      EXPECT_BYTES_EQ(digests[i], node_digest.get().get(), kSha256Length);
+    }
+  }
+}
+
 }  // namespace testing
 }  // namespace digest
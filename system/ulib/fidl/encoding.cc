@@ -57,7 +57,13 @@ struct EnvelopeCheckpoint {
   uint32_t num_handles;
 };
 
-enum class Mode { EncodeOnly, LinearizeAndEncode };
+// In LinearizeAndEncodeIovec mode, large strings and vectors of primitives are not copied into the
+// output buffer. Instead the message is described by a list of iovecs which alternates between
+// runs of the output buffer and such objects in their original location.
+enum class Mode { EncodeOnly, LinearizeAndEncode, LinearizeAndEncodeIovec };
+
+// Objects smaller than this are cheaper to copy than to describe with an iovec of their own.
+constexpr uint32_t kIovecMinGatherSize = 512;
 
 template <Mode mode>
 class FidlEncoder final
@@ -92,8 +98,17 @@ class FidlEncoder final
 
   static constexpr bool kContinueAfterConstraintViolation = true;
 
+  static constexpr bool kLinearize =
+      mode == Mode::LinearizeAndEncode || mode == Mode::LinearizeAndEncodeIovec;
+
+  // Only used in LinearizeAndEncodeIovec mode. |max_iovecs| must be at least one.
+  void set_iovecs(zx_iovec_t* iovecs, uint32_t max_iovecs) {
+    iovecs_ = iovecs;
+    max_iovecs_ = max_iovecs;
+  }
+
   Status VisitAbsentPointerInNonNullableCollection(ObjectPointerPointer object_ptr_ptr) {
-    if (mode == Mode::LinearizeAndEncode) {
+    if (kLinearize) {
       // Empty LLCPP vectors and strings typically have null data portions, which differs
       // from the wire format representation (0 length out-of-line object for empty vector
       // or string).
@@ -114,7 +129,8 @@ class FidlEncoder final
     // and may be set to 1 if the object is heap allocated. However, the original pointer has this
     // bit cleared. For vectors and strings, any value is accepted.
     auto object_ptr =
-        pointee_type == PointeeType::kVector || pointee_type == PointeeType::kString
+        pointee_type == PointeeType::kVector || pointee_type == PointeeType::kVectorOfPrimitives ||
+                pointee_type == PointeeType::kString
             ? *object_ptr_ptr
             : reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(*object_ptr_ptr) &
                                       ~fidl::internal::kNonArrayTrackingPtrOwnershipMask);
@@ -129,10 +145,22 @@ class FidlEncoder final
       return Status::kConstraintViolationError;
     }
 
-    if (mode == Mode::LinearizeAndEncode) {
+    // The wire format of a gathered object is the object itself, so it can be sent from where it
+    // is. The walker still visits a vector's elements, but only to validate them.
+    uint8_t* dest = &bytes_[next_out_of_line_];
+    if (mode == Mode::LinearizeAndEncodeIovec && inline_size >= kIovecMinGatherSize &&
+        (pointee_type == PointeeType::kVectorOfPrimitives ||
+         pointee_type == PointeeType::kString) &&
+        // Leave room for the output buffer before and after the object.
+        num_iovecs_ + 3 <= max_iovecs_) {
+      FlushIovec(next_out_of_line_);
+      iovecs_[num_iovecs_++] = zx_iovec_t{.buffer = object_ptr, .capacity = inline_size};
+      staged_start_ = next_out_of_line_ + inline_size;
+      dest = static_cast<uint8_t*>(object_ptr);
+    } else if (kLinearize) {
       // Copy the pointee to the desired location in secondary storage
-      memcpy(&bytes_[next_out_of_line_], object_ptr, inline_size);
-    } else if (unlikely(object_ptr != &bytes_[next_out_of_line_])) {
+      memcpy(dest, object_ptr, inline_size);
+    } else if (unlikely(object_ptr != dest)) {
       SetError("noncontiguous out of line storage during encode");
       return Status::kMemoryError;
     }
@@ -145,8 +173,7 @@ class FidlEncoder final
     // TODO(fxb/52215): For strings, it would most likely be more efficient
     // to validate and copy at the same time.
     if (unlikely(pointee_type == PointeeType::kString)) {
-      auto status =
-          fidl_validate_string(reinterpret_cast<char*>(&bytes_[next_out_of_line_]), inline_size);
+      auto status = fidl_validate_string(reinterpret_cast<char*>(dest), inline_size);
       if (status != ZX_OK) {
         SetError("encoder encountered invalid UTF8 string");
         return Status::kConstraintViolationError;
@@ -154,7 +181,7 @@ class FidlEncoder final
     }
 
     // Instruct the walker to traverse the pointee afterwards.
-    *out_position = Position{.source_object = object_ptr, .dest = bytes_ + next_out_of_line_};
+    *out_position = Position{.source_object = object_ptr, .dest = dest};
 
     next_out_of_line_ = new_offset;
 
@@ -189,7 +216,7 @@ class FidlEncoder final
     }
 
     *dest_handle = FIDL_HANDLE_PRESENT;
-    if (mode == Mode::LinearizeAndEncode) {
+    if (kLinearize) {
       *handle_position.GetFromSource<zx_handle_t>() = ZX_HANDLE_INVALID;
     }
     handle_idx_++;
@@ -197,7 +224,7 @@ class FidlEncoder final
   }
 
   Status VisitVectorOrStringCount(CountPointer ptr) {
-    if (mode == Mode::LinearizeAndEncode) {
+    if (kLinearize) {
       // Clear the MSB that is used for storing ownership information for vectors and strings.
       // While this operation could be considered part of encoding, it is LLCPP specific so it
       // is done during linearization.
@@ -222,7 +249,7 @@ class FidlEncoder final
   Status LeaveEnvelope(EnvelopePointer envelope, EnvelopeCheckpoint prev_checkpoint) {
     uint32_t num_bytes = next_out_of_line_ - prev_checkpoint.num_bytes;
     uint32_t num_handles = handle_idx_ - prev_checkpoint.num_handles;
-    if (mode == Mode::LinearizeAndEncode) {
+    if (kLinearize) {
       // Write the num_bytes/num_handles.
       envelope->num_bytes = num_bytes;
       envelope->num_handles = num_handles;
@@ -249,6 +276,12 @@ class FidlEncoder final
   uint32_t num_out_handles() const { return handle_idx_; }
   uint32_t num_out_bytes() const { return next_out_of_line_; }
 
+  // Completes the iovec list with the remainder of the output buffer, and returns its length.
+  uint32_t FinishIovecs() {
+    FlushIovec(next_out_of_line_);
+    return num_iovecs_;
+  }
+
  private:
   void SetError(const char* error) {
     if (status_ == ZX_OK) {
@@ -259,6 +292,16 @@ class FidlEncoder final
     }
   }
 
+  // Adds an iovec for the part of the output buffer from the end of the last gathered object up to
+  // |end|, if it is not empty.
+  void FlushIovec(uint32_t end) {
+    if (end > staged_start_) {
+      iovecs_[num_iovecs_++] =
+          zx_iovec_t{.buffer = &bytes_[staged_start_], .capacity = end - staged_start_};
+    }
+    staged_start_ = end;
+  }
+
   void ThrowAwayHandle(HandlePointer handle) {
 #ifdef __Fuchsia__
     zx_handle_close(*handle);
@@ -286,12 +329,20 @@ class FidlEncoder final
   // Encoder state
   zx_status_t status_ = ZX_OK;
   uint32_t handle_idx_ = 0;
+
+  // Iovec state, for LinearizeAndEncodeIovec mode.
+  zx_iovec_t* iovecs_ = nullptr;
+  uint32_t max_iovecs_ = 0;
+  uint32_t num_iovecs_ = 0;
+  uint32_t staged_start_ = 0;
 };
 
-template <typename HandleType>
+template <Mode mode, typename HandleType>
 zx_status_t fidl_linearize_and_encode_impl(const fidl_type_t* type, void* value, uint8_t* out_bytes,
-                                           uint32_t num_bytes, HandleType* out_handles,
+                                           uint32_t num_bytes, zx_iovec_t* out_iovecs,
+                                           uint32_t num_iovecs, HandleType* out_handles,
                                            uint32_t num_handles, uint32_t* out_num_actual_bytes,
+                                           uint32_t* out_num_actual_iovecs,
                                            uint32_t* out_num_actual_handles,
                                            const char** out_error_msg,
                                            void (*close_handles)(const HandleType*, uint32_t)) {
@@ -319,6 +370,10 @@ zx_status_t fidl_linearize_and_encode_impl(const fidl_type_t* type, void* value,
     set_error("num_bytes must be aligned to FIDL_ALIGNMENT");
     return ZX_ERR_INVALID_ARGS;
   }
+  if (mode == Mode::LinearizeAndEncodeIovec && unlikely(out_iovecs == nullptr || num_iovecs == 0)) {
+    set_error("Cannot encode to an empty iovec array");
+    return ZX_ERR_INVALID_ARGS;
+  }
 
   zx_status_t status;
   uint32_t next_out_of_line;
@@ -339,8 +394,11 @@ zx_status_t fidl_linearize_and_encode_impl(const fidl_type_t* type, void* value,
   // Zero the padding gaps
   memset(out_bytes + primary_size, 0, next_out_of_line - primary_size);
 
-  FidlEncoder<Mode::LinearizeAndEncode> encoder(out_bytes, num_bytes, out_handles, num_handles,
-                                                next_out_of_line, out_error_msg);
+  FidlEncoder<mode> encoder(out_bytes, num_bytes, out_handles, num_handles, next_out_of_line,
+                            out_error_msg);
+  if (mode == Mode::LinearizeAndEncodeIovec) {
+    encoder.set_iovecs(out_iovecs, num_iovecs);
+  }
   fidl::Walk(encoder, type, Position{.source_object = value, .dest = out_bytes});
 
   auto drop_all_handles = [&]() {
@@ -361,6 +419,14 @@ zx_status_t fidl_linearize_and_encode_impl(const fidl_type_t* type, void* value,
       drop_all_handles();
       return ZX_ERR_INVALID_ARGS;
     }
+    if (mode == Mode::LinearizeAndEncodeIovec) {
+      if (unlikely(out_num_actual_iovecs == nullptr)) {
+        set_error("Cannot encode with null out_actual_iovecs");
+        drop_all_handles();
+        return ZX_ERR_INVALID_ARGS;
+      }
+      *out_num_actual_iovecs = encoder.FinishIovecs();
+    }
     *out_num_actual_bytes = encoder.num_out_bytes();
     *out_num_actual_handles = encoder.num_out_handles();
   } else {
@@ -500,18 +566,31 @@ zx_status_t fidl_linearize_and_encode(const fidl_type_t* type, void* value, uint
                                       uint32_t num_handles, uint32_t* out_num_actual_bytes,
                                       uint32_t* out_num_actual_handles,
                                       const char** out_error_msg) {
-  return fidl_linearize_and_encode_impl(type, value, out_bytes, num_bytes, out_handles, num_handles,
-                                        out_num_actual_bytes, out_num_actual_handles, out_error_msg,
-                                        close_handles_op);
+  return fidl_linearize_and_encode_impl<Mode::LinearizeAndEncode>(
+      type, value, out_bytes, num_bytes, nullptr, 0, out_handles, num_handles, out_num_actual_bytes,
+      nullptr, out_num_actual_handles, out_error_msg, close_handles_op);
 }
 zx_status_t fidl_linearize_and_encode_etc(const fidl_type_t* type, void* value, uint8_t* out_bytes,
                                           uint32_t num_bytes, zx_handle_disposition_t* out_handles,
                                           uint32_t num_handles, uint32_t* out_num_actual_bytes,
                                           uint32_t* out_num_actual_handles,
                                           const char** out_error_msg) {
-  return fidl_linearize_and_encode_impl(type, value, out_bytes, num_bytes, out_handles, num_handles,
-                                        out_num_actual_bytes, out_num_actual_handles, out_error_msg,
-                                        close_handle_dispositions_op);
+  return fidl_linearize_and_encode_impl<Mode::LinearizeAndEncode>(
+      type, value, out_bytes, num_bytes, nullptr, 0, out_handles, num_handles, out_num_actual_bytes,
+      nullptr, out_num_actual_handles, out_error_msg, close_handle_dispositions_op);
+}
+zx_status_t fidl_linearize_and_encode_iovec(const fidl_type_t* type, void* value,
+                                            uint8_t* out_bytes, uint32_t num_bytes,
+                                            zx_iovec_t* out_iovecs, uint32_t num_iovecs,
+                                            zx_handle_t* out_handles, uint32_t num_handles,
+                                            uint32_t* out_num_actual_bytes,
+                                            uint32_t* out_num_actual_iovecs,
+                                            uint32_t* out_num_actual_handles,
+                                            const char** out_error_msg) {
+  return fidl_linearize_and_encode_impl<Mode::LinearizeAndEncodeIovec>(
+      type, value, out_bytes, num_bytes, out_iovecs, num_iovecs, out_handles, num_handles,
+      out_num_actual_bytes, out_num_actual_iovecs, out_num_actual_handles, out_error_msg,
+      close_handles_op);
 }
 zx_status_t fidl_linearize_and_encode_msg(const fidl_type_t* type, void* value, fidl_msg_t* msg,
                                           uint32_t* out_num_actual_bytes,
@@ -56,6 +56,22 @@ zx_status_t fidl_linearize_and_encode_etc(const fidl_type_t* type, void* value,
                                           uint32_t num_handles, uint32_t* out_num_actual_bytes,
                                           uint32_t* out_num_actual_handles,
                                           const char** out_error_msg);
+// fidl_linearize_and_encode_iovec is like fidl_linearize_and_encode, except that strings and vectors
+// of primitives that are large enough to be worth it are not copied into |out_bytes|. The encoded
+// message is instead the concatenation of the |out_num_actual_iovecs| buffers described by
+// |out_iovecs|, which refer both to |out_bytes| and to such objects where they are in |value|. It
+// can be written with zx_channel_write and ZX_CHANNEL_WRITE_USE_IOVEC, which copies those objects
+// once instead of twice. |value| must outlive the use of |out_iovecs|, and must not be modified
+// until then. |*out_num_actual_bytes| is the total size of the message, and |out_bytes| must be
+// large enough to hold all of it, gathered objects included.
+zx_status_t fidl_linearize_and_encode_iovec(const fidl_type_t* type, void* value,
+                                            uint8_t* out_bytes, uint32_t num_bytes,
+                                            zx_iovec_t* out_iovecs, uint32_t num_iovecs,
+                                            zx_handle_t* out_handles, uint32_t num_handles,
+                                            uint32_t* out_num_actual_bytes,
+                                            uint32_t* out_num_actual_iovecs,
+                                            uint32_t* out_num_actual_handles,
+                                            const char** out_error_msg);
 zx_status_t fidl_linearize_and_encode_msg(const fidl_type_t* type, void* value, fidl_msg_t* msg,
                                           uint32_t* out_num_actual_bytes,
                                           uint32_t* out_num_actual_handles,
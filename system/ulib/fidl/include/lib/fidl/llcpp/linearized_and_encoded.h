@@ -7,6 +7,12 @@
 
 #include <lib/fidl/llcpp/coding.h>
 #include <lib/fidl/llcpp/message_storage.h>
+#include <zircon/types.h>
+
+#ifdef __Fuchsia__
+#include <lib/zx/channel.h>
+#include <zircon/syscalls.h>
+#endif
 
 namespace fidl {
 namespace internal {
@@ -71,6 +77,66 @@ template <typename FidlType>
 using LinearizedAndEncoded =
     LinearizedAndEncodedImpl<FidlType, AlreadyLinearized<!FidlType::HasPointer>>;
 
+// LinearizedAndEncodedIovec linearizes and encodes the input object as a list of iovecs, leaving
+// large strings and vectors of primitives where they are rather than copying them into the
+// linearization buffer. |obj| must outlive this object, and must not be modified while it exists.
+// Intended for messages with bulk payloads, which are then copied once, by the kernel.
+template <typename FidlType>
+class LinearizedAndEncodedIovec final {
+ public:
+  static constexpr uint32_t kResolvedMaxHandles =
+      FidlType::MaxNumHandles > ZX_CHANNEL_MAX_MSG_HANDLES ? ZX_CHANNEL_MAX_MSG_HANDLES
+                                                           : FidlType::MaxNumHandles;
+
+  explicit LinearizedAndEncodedIovec(FidlType* obj) {
+    status_ = fidl_linearize_and_encode_iovec(
+        FidlType::Type, obj, buf_.buffer().data(), buf_.buffer().capacity(), iovecs_,
+        ZX_CHANNEL_MAX_MSG_IOVECS, handles_, kResolvedMaxHandles, &num_bytes_, &num_iovecs_,
+        &num_handles_, &error_);
+  }
+  ~LinearizedAndEncodedIovec() {
+#ifdef __Fuchsia__
+    if (num_handles_ > 0) {
+      zx_handle_close_many(handles_, num_handles_);
+    }
+#endif
+  }
+  LinearizedAndEncodedIovec(LinearizedAndEncodedIovec&&) = delete;
+  LinearizedAndEncodedIovec(const LinearizedAndEncodedIovec&) = delete;
+  LinearizedAndEncodedIovec& operator=(LinearizedAndEncodedIovec&&) = delete;
+  LinearizedAndEncodedIovec& operator=(const LinearizedAndEncodedIovec&) = delete;
+
+  zx_status_t status() const { return status_; }
+  const char* error() const { return error_; }
+
+  const zx_iovec_t* iovecs() const { return iovecs_; }
+  uint32_t num_iovecs() const { return num_iovecs_; }
+  // Total size of the message described by the iovecs.
+  uint32_t num_bytes() const { return num_bytes_; }
+
+#ifdef __Fuchsia__
+  // Writes the message to |chan|. The handles are consumed whether or not this succeeds.
+  zx_status_t Write(const zx::unowned_channel& chan) {
+    if (status_ != ZX_OK) {
+      return status_;
+    }
+    uint32_t num_handles = num_handles_;
+    num_handles_ = 0;
+    return chan->write(ZX_CHANNEL_WRITE_USE_IOVEC, iovecs_, num_iovecs_, handles_, num_handles);
+  }
+#endif
+
+ private:
+  LinearizeBuffer<FidlType> buf_;
+  zx_iovec_t iovecs_[ZX_CHANNEL_MAX_MSG_IOVECS];
+  zx_handle_t handles_[kResolvedMaxHandles > 0 ? kResolvedMaxHandles : 1];
+  uint32_t num_bytes_ = 0;
+  uint32_t num_iovecs_ = 0;
+  uint32_t num_handles_ = 0;
+  zx_status_t status_ = ZX_OK;
+  const char* error_ = nullptr;
+};
+
 }  // namespace internal
 }  // namespace fidl
 
@@ -99,7 +99,9 @@ class Visitor {
     kMemoryError                // overflow/out-of-bounds etc. Non-recoverable.
   };
 
-  enum class PointeeType { kVector, kString, kOther };
+  // |kVectorOfPrimitives| is a vector whose elements hold no pointers, handles or padding, such as
+  // a vector of integers, so that its wire format is exactly its in-memory layout.
+  enum class PointeeType { kVector, kVectorOfPrimitives, kString, kOther };
 
   // Compile-time interface checking. Code is invisible to the subclass.
  private:
@@ -630,9 +630,15 @@ Result Walker<VisitorImpl>::WalkVector(const FidlCodedVector* coded_vector,
   }
   OutOfLineDepth array_depth = INCREASE_DEPTH(depth);
   FIDL_DEPTH_GUARD(array_depth);
+  const fidl_type_t* elem_type = coded_vector->element;
+  const bool primitive_elements =
+      elem_type == nullptr || elem_type->type_tag() == kFidlTypePrimitive ||
+      elem_type->type_tag() == kFidlTypeEnum || elem_type->type_tag() == kFidlTypeBits;
   Position array_position;
-  status = visitor_->VisitPointer(position, VisitorImpl::PointeeType::kVector, &vector_ptr->data,
-                                  size, &array_position);
+  status = visitor_->VisitPointer(position,
+                                  primitive_elements ? VisitorImpl::PointeeType::kVectorOfPrimitives
+                                                     : VisitorImpl::PointeeType::kVector,
+                                  &vector_ptr->data, size, &array_position);
   FIDL_STATUS_GUARD(status);
 
   uint32_t stride = coded_vector->element_size;
@@ -0,0 +1,177 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_FZL_SHARED_FIFO_RING_H_
+#define LIB_FZL_SHARED_FIFO_RING_H_
+
+#include <lib/fzl/vmo-mapper.h>
+#include <lib/zx/fifo.h>
+#include <lib/zx/time.h>
+#include <lib/zx/vmo.h>
+#include <zircon/syscalls/fifo.h>
+#include <zircon/types.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include <fbl/macros.h>
+
+namespace fzl {
+
+// One endpoint of a fifo created with ZX_FIFO_SHARED_RING, carrying elements of type |T|.
+//
+// Elements move through the mapped rings without syscalls; the kernel is only asked to update the
+// signals when a ring stops being empty or full, or when this endpoint is about to block. See
+// <zircon/syscalls/fifo.h> for the protocol. The kernel keeps the ring pages pinned, so a holder
+// of the ring VMO cannot decommit them from under the endpoints.
+//
+// Each endpoint must be used by a single thread at a time.
+template <typename T>
+class SharedFifoRing {
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+ public:
+  SharedFifoRing() = default;
+  DISALLOW_COPY_ASSIGN_AND_MOVE(SharedFifoRing);
+
+  // Maps the rings of |fifo|, which was created with ZX_FIFO_SHARED_RING, |elem_count| elements
+  // and an element size of sizeof(T).
+  zx_status_t Init(zx::fifo fifo, uint32_t elem_count) {
+    if (elem_count == 0 || (elem_count & (elem_count - 1)) != 0 ||
+        elem_count * sizeof(T) > ZX_PAGE_SIZE) {
+      return ZX_ERR_INVALID_ARGS;
+    }
+    fifo_ = std::move(fifo);
+    elem_count_ = elem_count;
+
+    zx::vmo vmo;
+    zx_status_t status = fifo_.get_vmo(0u, &vmo);
+    if (status != ZX_OK) {
+      return status;
+    }
+    status = mapper_.Map(vmo, 0, ZX_FIFO_RING_VMO_SIZE, ZX_VM_PERM_READ | ZX_VM_PERM_WRITE);
+    if (status != ZX_OK) {
+      return status;
+    }
+
+    zx_info_handle_basic_t info;
+    status = fifo_.get_info(ZX_INFO_HANDLE_BASIC, &info, sizeof(info), nullptr, nullptr);
+    if (status != ZX_OK) {
+      return status;
+    }
+    const auto addr = reinterpret_cast<uintptr_t>(mapper_.start());
+    for (uint32_t i = 0; i < ZX_FIFO_RING_COUNT; i++) {
+      auto* ring = reinterpret_cast<zx_fifo_ring_t*>(addr + ZX_FIFO_RING_HEADER_OFFSET(i));
+      auto* data = reinterpret_cast<T*>(addr + ZX_FIFO_RING_DATA_OFFSET(i));
+      if (ring->writer_koid == info.koid) {
+        tx_ = ring;
+        tx_data_ = data;
+      } else {
+        rx_ = ring;
+        rx_data_ = data;
+      }
+    }
+    return (tx_ && rx_) ? ZX_OK : ZX_ERR_BAD_STATE;
+  }
+
+  const zx::fifo& fifo() const { return fifo_; }
+
+  // Queues up to |count| elements and returns how many were queued.
+  size_t Write(const T* elements, size_t count) {
+    const uint32_t head = tx_->head;
+    const uint32_t tail = __atomic_load_n(&tx_->tail, __ATOMIC_ACQUIRE);
+    const size_t n = std::min<size_t>(count, elem_count_ - (head - tail));
+    for (uint32_t i = 0; i < n; i++) {
+      tx_data_[(head + i) & (elem_count_ - 1)] = elements[i];
+    }
+    __atomic_store_n(&tx_->head, head + static_cast<uint32_t>(n), __ATOMIC_RELEASE);
+
+    // If the reader had drained everything before this store it may be about to sleep.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (n != 0 && __atomic_load_n(&tx_->tail, __ATOMIC_ACQUIRE) == head) {
+      Doorbell();
+    }
+    return n;
+  }
+
+  // Dequeues up to |count| elements and returns how many were dequeued.
+  size_t Read(T* elements, size_t count) {
+    const uint32_t tail = rx_->tail;
+    const uint32_t head = __atomic_load_n(&rx_->head, __ATOMIC_ACQUIRE);
+    const size_t n = std::min<size_t>(count, head - tail);
+    for (uint32_t i = 0; i < n; i++) {
+      elements[i] = rx_data_[(tail + i) & (elem_count_ - 1)];
+    }
+    __atomic_store_n(&rx_->tail, tail + static_cast<uint32_t>(n), __ATOMIC_RELEASE);
+
+    // If the writer had filled the ring before this store it may be about to sleep.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (n != 0 && __atomic_load_n(&rx_->head, __ATOMIC_ACQUIRE) - tail == elem_count_) {
+      Doorbell();
+    }
+    return n;
+  }
+
+  // Waits until there is an element to read. Returns ZX_ERR_PEER_CLOSED if the peer went away
+  // first.
+  zx_status_t WaitReadable() {
+    return Wait(ZX_FIFO_READABLE,
+                [this] { return __atomic_load_n(&rx_->head, __ATOMIC_ACQUIRE) != rx_->tail; });
+  }
+
+  // Waits until there is room to write an element. Returns ZX_ERR_PEER_CLOSED if the peer went
+  // away first.
+  zx_status_t WaitWritable() {
+    return Wait(ZX_FIFO_WRITABLE, [this] {
+      return tx_->head - __atomic_load_n(&tx_->tail, __ATOMIC_ACQUIRE) < elem_count_;
+    });
+  }
+
+ private:
+  static constexpr uint32_t kMinSpin = 16;
+  static constexpr uint32_t kMaxSpin = 16384;
+
+  void Doorbell() { fifo_.read(sizeof(T), nullptr, 0, nullptr); }
+
+  // Polls for |ready| for a while before blocking on |signal|. The polling window grows each
+  // time the peer answers within it and shrinks each time it has to block.
+  template <typename Ready>
+  zx_status_t Wait(zx_signals_t signal, Ready ready) {
+    for (uint32_t i = 0; i < spin_limit_; i++) {
+      if (ready()) {
+        spin_limit_ = std::min(spin_limit_ * 2, kMaxSpin);
+        return ZX_OK;
+      }
+    }
+    spin_limit_ = std::max(spin_limit_ / 2, kMinSpin);
+
+    // Let the kernel see the counters before sleeping, then look again in case the peer made
+    // progress before the signals were updated.
+    Doorbell();
+    if (ready()) {
+      return ZX_OK;
+    }
+    zx_signals_t pending;
+    zx_status_t status =
+        fifo_.wait_one(signal | ZX_FIFO_PEER_CLOSED, zx::time::infinite(), &pending);
+    if (status != ZX_OK) {
+      return status;
+    }
+    return (pending & signal) ? ZX_OK : ZX_ERR_PEER_CLOSED;
+  }
+
+  zx::fifo fifo_;
+  uint32_t elem_count_ = 0;
+  VmoMapper mapper_;
+  zx_fifo_ring_t* tx_ = nullptr;
+  zx_fifo_ring_t* rx_ = nullptr;
+  T* tx_data_ = nullptr;
+  T* rx_data_ = nullptr;
+  uint32_t spin_limit_ = kMinSpin;
+};
+
+}  // namespace fzl
+
+#endif  // LIB_FZL_SHARED_FIFO_RING_H_
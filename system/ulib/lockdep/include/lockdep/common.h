@@ -30,6 +30,14 @@ namespace lockdep {
 #define LOCK_DEP_ENABLE_VALIDATION 0
 #endif
 
+// Configures whether per-lock class statistics are collected. Defaults to
+// disabled. When enabled every guarded acquisition records its wait time, hold
+// time, and whether it was contended in the lock class of the lock. This may be
+// enabled independently of validation.
+#ifndef LOCK_DEP_ENABLE_STATISTICS
+#define LOCK_DEP_ENABLE_STATISTICS 0
+#endif
+
 // Id type used to identify each lock class.
 using LockClassId = uintptr_t;
 
@@ -80,6 +88,25 @@ template <typename EnabledType, typename DisabledType>
 using IfLockValidationEnabled =
     typename std::conditional<kLockValidationEnabled, EnabledType, DisabledType>::type;
 
+// Whether or not lock statistics are globally enabled.
+constexpr bool kLockStatisticsEnabled = static_cast<bool>(LOCK_DEP_ENABLE_STATISTICS);
+
+// Utility template alias to simplify selecting different types based whether
+// lock statistics are enabled or disabled.
+template <typename EnabledType, typename DisabledType>
+using IfLockStatisticsEnabled =
+    typename std::conditional<kLockStatisticsEnabled, EnabledType, DisabledType>::type;
+
+// Whether or not lock classes are instantiated. Both validation and statistics
+// need per-lock class state.
+constexpr bool kLockClassesEnabled = kLockValidationEnabled || kLockStatisticsEnabled;
+
+// Utility template alias to simplify selecting different types based whether
+// lock classes are instantiated.
+template <typename EnabledType, typename DisabledType>
+using IfLockClassesEnabled =
+    typename std::conditional<kLockClassesEnabled, EnabledType, DisabledType>::type;
+
 // Result type that represents whether a lock attempt was successful, or if not
 // which check failed.
 enum class LockResult : uint8_t {
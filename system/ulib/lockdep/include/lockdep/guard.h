@@ -77,6 +77,69 @@ template <typename LockType, typename Option>
 using EnableIfNotShared =
     std::enable_if_t<!IsSharedLockPolicy<LockPolicy<LockType, Option>>::value>;
 
+// Detect whether `LockPolicy<LockType, Option>::IsLocked(const LockType&)` is a
+// valid expression. Policies implement this to let lock statistics tell
+// contended acquisitions from uncontended ones.
+template <typename LockType, typename Option, typename = void>
+struct PolicyHasIsLocked : std::false_type {};
+template <typename LockType, typename Option>
+struct PolicyHasIsLocked<LockType, Option,
+                         std::void_t<decltype(LockPolicy<LockType, Option>::IsLocked(
+                             std::declval<const LockType&>()))>> : std::true_type {};
+
+// Records wait and hold times of a guarded acquisition in the statistics of
+// the lock class. Used when lock statistics are enabled.
+template <typename LockType, typename Option>
+class StatisticsRecorder {
+ public:
+  explicit StatisticsRecorder(LockClassId id) : id_{id} {}
+
+  // Samples whether the lock is already held and starts the wait timer.
+  void BeforeAcquire(const LockType& lock) {
+    if constexpr (PolicyHasIsLocked<LockType, Option>::value) {
+      contended_ = LockPolicy<LockType, Option>::IsLocked(lock);
+    }
+    timestamp_ = SystemGetLockStatisticsTimestamp();
+  }
+
+  // Records the wait time and starts the hold timer.
+  void AfterAcquire() {
+    const uint64_t now = SystemGetLockStatisticsTimestamp();
+    const uint64_t wait = now - timestamp_;
+    LockClassState::GetStatistics(id_).RecordAcquire(wait, contended_);
+    if (contended_) {
+      SystemLockContended(LockClassState::Get(id_), wait);
+    }
+    timestamp_ = now;
+  }
+
+  // Records the hold time.
+  void AfterRelease() {
+    LockClassState::GetStatistics(id_).RecordRelease(SystemGetLockStatisticsTimestamp() -
+                                                     timestamp_);
+  }
+
+ private:
+  LockClassId id_;
+  uint64_t timestamp_{0};
+  bool contended_{false};
+};
+
+// Recorder type used when lock statistics are disabled.
+template <typename LockType, typename Option>
+struct DummyStatisticsRecorder {
+  explicit DummyStatisticsRecorder(LockClassId) {}
+  void BeforeAcquire(const LockType&) {}
+  void AfterAcquire() {}
+  void AfterRelease() {}
+};
+
+// Alias of the configured statistics recorder.
+template <typename LockType, typename Option>
+using ConditionalStatisticsRecorder =
+    IfLockStatisticsEnabled<StatisticsRecorder<LockType, Option>,
+                            DummyStatisticsRecorder<LockType, Option>>;
+
 }  // namespace internal
 
 // Assert that the given lock is exclusively held by the current thread.
@@ -130,7 +193,10 @@ class __TA_SCOPED_CAPABILITY
             typename = internal::EnableIfNotNestable<Lockable, LockType>>
   __WARN_UNUSED_CONSTRUCTOR Guard(Lockable* lock, Args&&... state_args) __TA_ACQUIRE(lock)
       __TA_ACQUIRE(lock->capability())
-      : validator_{lock->id()}, lock_{&lock->lock()}, state_{std::forward<Args>(state_args)...} {
+      : validator_{lock->id()},
+        statistics_{lock->id()},
+        lock_{&lock->lock()},
+        state_{std::forward<Args>(state_args)...} {
     ValidateAndAcquire();
   }
 
@@ -150,6 +216,7 @@ class __TA_SCOPED_CAPABILITY
   void Release(Args&&... args) __TA_RELEASE() {
     if (lock_ != nullptr) {
       LockPolicy<LockType, Option>::Release(lock_, &state_, std::forward<Args>(args)...);
+      statistics_.AfterRelease();
       validator_.ValidateRelease();
       lock_ = nullptr;
     }
@@ -186,6 +253,7 @@ class __TA_SCOPED_CAPABILITY
   //
   __WARN_UNUSED_CONSTRUCTOR Guard(AdoptLockTag, Guard&& other) __TA_ACQUIRE(other.lock_)
       : validator_{std::move(other.validator_)},
+        statistics_{std::move(other.statistics_)},
         lock_{other.lock_},
         state_{std::move(other.state_)} {
     other.lock_ = nullptr;
@@ -212,6 +280,7 @@ class __TA_SCOPED_CAPABILITY
 
     LockPolicy<LockType, Option>::Release(lock_, &state_,
                                           std::forward<ReleaseArgs>(release_args)...);
+    statistics_.AfterRelease();
     validator_.ValidateRelease();
 
     std::forward<Op>(op)();
@@ -231,9 +300,12 @@ class __TA_SCOPED_CAPABILITY
   // body.
   void ValidateAndAcquire() __TA_NO_THREAD_SAFETY_ANALYSIS {
     validator_.ValidateAcquire();
+    statistics_.BeforeAcquire(*lock_);
     if (!LockPolicy<LockType, Option>::Acquire(lock_, &state_)) {
       lock_ = nullptr;
       validator_.ValidateRelease();
+    } else {
+      statistics_.AfterAcquire();
     }
   }
 
@@ -244,6 +316,7 @@ class __TA_SCOPED_CAPABILITY
                                   Args&&... state_args) __TA_ACQUIRE(lock)
       __TA_ACQUIRE(lock->capability())
       : validator_{lock->id(), order},
+        statistics_{lock->id()},
         lock_{&lock->lock()},
         state_{std::forward<Args>(state_args)...} {
     ValidateAndAcquire();
@@ -274,6 +347,9 @@ class __TA_SCOPED_CAPABILITY
   // The validator to use when acquiring and releasing the lock.
   Validator validator_;
 
+  // Records lock class statistics when acquiring and releasing the lock.
+  internal::ConditionalStatisticsRecorder<LockType, Option> statistics_;
+
   // Pointer to the acquired lock.
   LockType* lock_;
 
@@ -303,7 +379,10 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
             typename = internal::EnableIfNotNestable<Lockable, LockType>>
   __WARN_UNUSED_CONSTRUCTOR Guard(Lockable* lock, Args&&... state_args) __TA_ACQUIRE_SHARED(lock)
       __TA_ACQUIRE_SHARED(lock->capability())
-      : validator_{lock->id()}, lock_{&lock->lock()}, state_{std::forward<Args>(state_args)...} {
+      : validator_{lock->id()},
+        statistics_{lock->id()},
+        lock_{&lock->lock()},
+        state_{std::forward<Args>(state_args)...} {
     ValidateAndAcquire();
   }
 
@@ -323,6 +402,7 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
   void Release(Args&&... args) __TA_RELEASE() {
     if (lock_ != nullptr) {
       LockPolicy<LockType, Option>::Release(lock_, &state_, std::forward<Args>(args)...);
+      statistics_.AfterRelease();
       validator_.ValidateRelease();
       lock_ = nullptr;
     }
@@ -357,6 +437,7 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
   //
   __WARN_UNUSED_CONSTRUCTOR Guard(AdoptLockTag, Guard&& other) __TA_ACQUIRE_SHARED(other.lock_)
       : validator_{std::move(other.validator_)},
+        statistics_{std::move(other.statistics_)},
         lock_{other.lock_},
         state_{std::move(other.state_)} {
     other.lock_ = nullptr;
@@ -383,6 +464,7 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
 
     LockPolicy<LockType, Option>::Release(lock_, &state_,
                                           std::forward<ReleaseArgs>(release_args)...);
+    statistics_.AfterRelease();
     validator_.ValidateRelease();
 
     std::forward<Op>(op)();
@@ -402,9 +484,12 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
   // body.
   void ValidateAndAcquire() __TA_NO_THREAD_SAFETY_ANALYSIS {
     validator_.ValidateAcquire();
+    statistics_.BeforeAcquire(*lock_);
     if (!LockPolicy<LockType, Option>::Acquire(lock_, &state_)) {
       lock_ = nullptr;
       validator_.ValidateRelease();
+    } else {
+      statistics_.AfterAcquire();
     }
   }
 
@@ -415,6 +500,7 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
                                   Args&&... state_args) __TA_ACQUIRE_SHARED(lock)
       __TA_ACQUIRE_SHARED(lock->capability())
       : validator_{lock->id(), order},
+        statistics_{lock->id()},
         lock_{&lock->lock()},
         state_{std::forward<Args>(state_args)...} {
     ValidateAndAcquire();
@@ -445,6 +531,9 @@ class __TA_SCOPED_CAPABILITY Guard<LockType, Option, internal::EnableIfShared<Lo
   // The validator to use when acquiring and releasing the lock.
   Validator validator_;
 
+  // Records lock class statistics when acquiring and releasing the lock.
+  internal::ConditionalStatisticsRecorder<LockType, Option> statistics_;
+
   // Pointer to the acquired lock.
   LockType* lock_;
 
@@ -43,7 +43,8 @@ struct LockTraits<T, std::void_t<LookupLockTraits<T>>> {
 // represents an independent, unique lock class. This type maintains a global
 // dependency set that tracks which other lock classes have been observed
 // being held prior to acquisitions of this lock class. This type is only used
-// when lock validation is enabled, otherwise DummyLockClass takes its place.
+// when lock validation or statistics are enabled, otherwise DummyLockClass
+// takes its place.
 template <typename Class, typename LockType, size_t Index, LockFlags Flags>
 class LockClass {
  public:
@@ -85,17 +86,18 @@ LockClassState LockClass<Class, LockType, Index, Flags>::lock_class_state_ = {
 template <typename Class, typename LockType, size_t Index, LockFlags Flags>
 LockDependencySet LockClass<Class, LockType, Index, Flags>::dependency_set_;
 
-// Dummy type used in place of LockClass when validation is disabled. This type
-// does not create static dependency tracking structures that LockClass does.
+// Dummy type used in place of LockClass when validation and statistics are
+// disabled. This type does not create static dependency tracking structures
+// that LockClass does.
 struct DummyLockClass {
   static LockClassId Id() { return kInvalidLockClassId; }
 };
 
 // Alias that selects LockClass<Class, LockType, Index, Flags> when validation
-// is enabled or DummyLockClass when validation is disabled.
+// or statistics are enabled or DummyLockClass when both are disabled.
 template <typename Class, typename LockType, size_t Index, LockFlags Flags>
 using ConditionalLockClass =
-    IfLockValidationEnabled<LockClass<Class, LockType, Index, Flags>, DummyLockClass>;
+    IfLockClassesEnabled<LockClass<Class, LockType, Index, Flags>, DummyLockClass>;
 
 // Base lock wrapper type that provides the essential interface required by
 // Guard<LockType, Option> to perform locking and validation. This type wraps
@@ -197,23 +199,24 @@ class __TA_CAPABILITY("mutex") Lock {
   template <size_t, typename, typename>
   friend class GuardMultiple;
 
-  // Value type that stores the LockClassId for this lock when validation is
-  // enabled.
+  // Value type that stores the LockClassId for this lock when validation or
+  // statistics are enabled.
   struct Value {
     LockClassId value_;
     LockClassId value() const { return value_; }
   };
 
-  // Dummy type that stores nothing when validation is disabled.
+  // Dummy type that stores nothing when validation and statistics are
+  // disabled.
   struct Dummy {
     Dummy(LockClassId) {}
     LockClassId value() const { return kInvalidLockClassId; }
   };
 
-  // Selects between Value or Dummy based on whether validation is enabled.
-  using IdValue = IfLockValidationEnabled<Value, Dummy>;
+  // Selects between Value or Dummy based on whether lock classes are enabled.
+  using IdValue = IfLockClassesEnabled<Value, Dummy>;
 
-  // Stores the lock class id of this lock when validation is enabled.
+  // Stores the lock class id of this lock when lock classes are enabled.
   IdValue id_;
 
   // The underlying lock managed by this dependency tracking wrapper.
@@ -262,9 +265,9 @@ class __TA_CAPABILITY("mutex") Lock<GlobalReference<LockType, Reference>> {
     LockClassId value() const { return kInvalidLockClassId; }
   };
 
-  using IdValue = IfLockValidationEnabled<Value, Dummy>;
+  using IdValue = IfLockClassesEnabled<Value, Dummy>;
 
-  // Stores the lock class id of this lock when validation is enabled.
+  // Stores the lock class id of this lock when lock classes are enabled.
   IdValue id_;
 };
 
@@ -16,6 +16,7 @@
 #include <fbl/algorithm.h>
 #include <lockdep/common.h>
 #include <lockdep/lock_dependency_set.h>
+#include <lockdep/lock_statistics.h>
 #include <lockdep/lock_traits.h>
 
 namespace lockdep {
@@ -123,6 +124,16 @@ class LockClassState {
   // Returns the dependency set for this lock class.
   const LockDependencySet& dependency_set() const { return *dependency_set_; }
 
+  // Alias of the configured statistics type.
+  using Statistics = IfLockStatisticsEnabled<LockClassStatistics, DummyLockClassStatistics>;
+
+  // Returns the acquisition statistics for this lock class.
+  Statistics& statistics() { return statistics_; }
+  const Statistics& statistics() const { return statistics_; }
+
+  // Returns the acquisition statistics for the given lock class id.
+  static Statistics& GetStatistics(LockClassId id) { return Get(id)->statistics_; }
+
   LockClassState* connected_set() { return LoopDetector::FindSet(&loop_node_)->ToState(); }
 
   // Runs a loop detection pass on the set of lock classes to find possible
@@ -140,6 +151,7 @@ class LockClassState {
   void Reset() {
     dependency_set_->clear();
     loop_node_.Reset();
+    statistics_.Reset();
   }
 
  private:
@@ -153,6 +165,9 @@ class LockClassState {
   // Flags specifying which which rules to apply during lock validation.
   const LockFlags flags_;
 
+  // Acquisition statistics, empty unless statistics are enabled.
+  Statistics statistics_;
+
   // Linked list pointer to the next state instance. This list is constructed
   // by a global initializer and never modified again. The list is used by the
   // loop detector and runtime lock inspection commands to access the complete
@@ -0,0 +1,99 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOCKDEP_LOCK_STATISTICS_H_
+#define LOCKDEP_LOCK_STATISTICS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace lockdep {
+
+// Per-lock class acquisition statistics. Every guarded acquisition of a lock in
+// the class updates the counters with relaxed atomic operations, so readers see
+// a consistent value for each counter but not necessarily across counters.
+// Durations are in the units returned by SystemGetLockStatisticsTimestamp().
+class LockClassStatistics {
+ public:
+  // A point-in-time copy of the counters.
+  struct Snapshot {
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t wait_total;
+    uint64_t wait_max;
+    uint64_t hold_total;
+    uint64_t hold_max;
+  };
+
+  constexpr LockClassStatistics() = default;
+
+  LockClassStatistics(const LockClassStatistics&) = delete;
+  LockClassStatistics& operator=(const LockClassStatistics&) = delete;
+
+  // Records a successful acquisition that waited |wait| time units. The
+  // acquisition is contended when the lock was observed held beforehand.
+  void RecordAcquire(uint64_t wait, bool contended) {
+    acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    if (contended) {
+      contended_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wait_total_.fetch_add(wait, std::memory_order_relaxed);
+    UpdateMax(&wait_max_, wait);
+  }
+
+  // Records a release after holding the lock for |hold| time units.
+  void RecordRelease(uint64_t hold) {
+    hold_total_.fetch_add(hold, std::memory_order_relaxed);
+    UpdateMax(&hold_max_, hold);
+  }
+
+  Snapshot Read() const {
+    return {acquisitions_.load(std::memory_order_relaxed),
+            contended_.load(std::memory_order_relaxed),
+            wait_total_.load(std::memory_order_relaxed),
+            wait_max_.load(std::memory_order_relaxed),
+            hold_total_.load(std::memory_order_relaxed),
+            hold_max_.load(std::memory_order_relaxed)};
+  }
+
+  // Clears the counters. Acquisitions racing with the reset may be partially
+  // recorded.
+  void Reset() {
+    acquisitions_.store(0, std::memory_order_relaxed);
+    contended_.store(0, std::memory_order_relaxed);
+    wait_total_.store(0, std::memory_order_relaxed);
+    wait_max_.store(0, std::memory_order_relaxed);
+    hold_total_.store(0, std::memory_order_relaxed);
+    hold_max_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static void UpdateMax(std::atomic<uint64_t>* max, uint64_t value) {
+    uint64_t current = max->load(std::memory_order_relaxed);
+    while (value > current &&
+           !max->compare_exchange_weak(current, value, std::memory_order_relaxed,
+                                       std::memory_order_relaxed)) {
+    }
+  }
+
+  std::atomic<uint64_t> acquisitions_{0};
+  std::atomic<uint64_t> contended_{0};
+  std::atomic<uint64_t> wait_total_{0};
+  std::atomic<uint64_t> wait_max_{0};
+  std::atomic<uint64_t> hold_total_{0};
+  std::atomic<uint64_t> hold_max_{0};
+};
+
+// Empty stand-in for LockClassStatistics when statistics are disabled.
+struct DummyLockClassStatistics {
+  constexpr DummyLockClassStatistics() = default;
+  void RecordAcquire(uint64_t, bool) {}
+  void RecordRelease(uint64_t) {}
+  void Reset() {}
+};
+
+}  // namespace lockdep
+
+#endif  // LOCKDEP_LOCK_STATISTICS_H_
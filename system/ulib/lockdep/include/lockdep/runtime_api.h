@@ -48,4 +48,13 @@ extern void SystemInitThreadLockState(ThreadLockState* state);
 // given time interval.
 extern void SystemTriggerLoopDetection();
 
+// System-defined hook that returns a monotonic timestamp used to measure lock
+// wait and hold times. Only required when lock statistics are enabled.
+extern uint64_t SystemGetLockStatisticsTimestamp();
+
+// System-defined hook invoked after a contended acquisition of a lock in the
+// given class that waited |wait| timestamp units. Only required when lock
+// statistics are enabled.
+extern void SystemLockContended(LockClassState* lock_class_state, uint64_t wait);
+
 }  // namespace lockdep
@@ -9,6 +9,7 @@
 //
 
 #include <zircon/compiler.h>
+#include <zircon/syscalls.h>
 
 #include <lockdep/lockdep.h>
 
@@ -25,4 +26,10 @@ __WEAK ThreadLockState* SystemGetThreadLockState() {
 
 __WEAK void SystemInitThreadLockState(ThreadLockState* state) {}
 
+// Default implementation of the runtime functions supporting lock statistics.
+
+__WEAK uint64_t SystemGetLockStatisticsTimestamp() { return zx_clock_get_monotonic(); }
+
+__WEAK void SystemLockContended(LockClassState* lock_class_state, uint64_t wait) {}
+
 }  // namespace lockdep
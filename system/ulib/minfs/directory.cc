@@ -152,6 +152,7 @@ zx_status_t Directory::UnlinkChild(Transaction* transaction, fbl::RefPtr<VnodeMi
   size_t off_prev = offs->off_prev;
   size_t off = offs->off;
   size_t off_next = off + MinfsReclen(de, off);
+  bool coalesced_next = false;
   zx_status_t status;
 
   // Read the direntries we're considering merging with.
@@ -170,6 +171,7 @@ zx_status_t Directory::UnlinkChild(Transaction* transaction, fbl::RefPtr<VnodeMi
       return status;
     }
     if (de_next.ino == 0) {
+      coalesced_next = true;
       coalesced_size += MinfsReclen(&de_next, off_next);
       // If the next entry *was* last, then 'de' is now last.
       de->reclen |= (de_next.reclen & kMinfsReclenLast);
@@ -201,8 +203,18 @@ zx_status_t Directory::UnlinkChild(Transaction* transaction, fbl::RefPtr<VnodeMi
       static_cast<uint32_t>(coalesced_size & kMinfsReclenMask) | (de->reclen & kMinfsReclenLast);
   // Erase dirent (replace with 'empty' dirent)
   if ((status = WriteExactInternal(transaction, de, kMinfsDirentSize, off)) != ZX_OK) {
+    index_.reset();
     return status;
   }
+  if (index_) {
+    if (coalesced_next) {
+      index_->Erase(off_next);
+    }
+    if (off != offs->off) {
+      index_->Erase(offs->off);
+    }
+    index_->Update(off, static_cast<uint32_t>(MinfsReclen(de, off)), fbl::StringPiece());
+  }
 
   if (de->reclen & kMinfsReclenLast) {
     // Truncating the directory merely removed unused space; if it fails,
@@ -357,6 +369,22 @@ zx_status_t Directory::DirentCallbackFindSpace(fbl::RefPtr<Directory> vndir, Dir
   }
 }
 
+zx_status_t Directory::DirentCallbackIndex(fbl::RefPtr<Directory> vndir, Dirent* de,
+                                           DirArgs* args) {
+  uint32_t reclen = static_cast<uint32_t>(MinfsReclen(de, args->offs.off));
+  if (de->ino == 0) {
+    vndir->index_->Update(args->offs.off, reclen, fbl::StringPiece());
+  } else {
+    uint32_t size = static_cast<uint32_t>(DirentSize(de->namelen));
+    if (size > reclen) {
+      FS_TRACE_ERROR("bad reclen (smaller than dirent) %u < %u\n", reclen, size);
+      return ZX_ERR_IO;
+    }
+    vndir->index_->Update(args->offs.off, reclen, fbl::StringPiece(de->name, de->namelen));
+  }
+  return NextDirent(de, &args->offs);
+}
+
 zx_status_t Directory::AppendDirent(DirArgs* args) {
   DirentBuffer dirent_buffer;
   Dirent* de = &dirent_buffer.dirent;
@@ -370,6 +398,9 @@ zx_status_t Directory::AppendDirent(DirArgs* args) {
     return status;
   }
 
+  // Any failure past this point may leave the directory half-modified.
+  auto drop_index = fbl::MakeAutoCall([this]() { index_.reset(); });
+
   uint32_t reclen = static_cast<uint32_t>(MinfsReclen(de, args->offs.off));
   if (de->ino == 0) {
     // empty entry, do we fit?
@@ -394,10 +425,14 @@ zx_status_t Directory::AppendDirent(DirArgs* args) {
                                      args->offs.off)) != ZX_OK) {
       return status;
     }
+    if (index_) {
+      index_->Update(args->offs.off, size, fbl::StringPiece(de->name, de->namelen));
+    }
 
     args->offs.off += size;
     // Overwrite dirent data to reflect the new dirent.
     de->reclen = extra | (was_last_record ? kMinfsReclenLast : 0);
+    reclen = extra;
   }
 
   de->ino = args->ino;
@@ -408,6 +443,10 @@ zx_status_t Directory::AppendDirent(DirArgs* args) {
                                    args->offs.off)) != ZX_OK) {
     return status;
   }
+  if (index_) {
+    index_->Update(args->offs.off, reclen, args->name);
+  }
+  drop_index.cancel();
 
   if (args->type == kMinfsTypeDir) {
     // Child directory has '..' which will point to parent directory
@@ -434,34 +473,44 @@ zx_status_t Directory::AppendDirent(DirArgs* args) {
 //          Since 'func' may create / remove surrounding dirents, it is responsible for
 //          updating the offset information to access the next dirent.
 zx_status_t Directory::ForEachDirent(DirArgs* args, const DirentCallback func) {
-  DirentBuffer dirent_buffer;
-  Dirent* de = &dirent_buffer.dirent;
-
   args->offs.off = 0;
   args->offs.off_prev = 0;
   while (args->offs.off + kMinfsDirentSize < kMinfsMaxDirectorySize) {
     FS_TRACE_DEBUG("Reading dirent at offset %zd\n", args->offs.off);
-    size_t r;
-    zx_status_t status =
-        ReadInternal(args->transaction, de, kMinfsMaxDirentSize, args->offs.off, &r);
-    if (status != ZX_OK) {
-      return status;
-    } else if ((status = ValidateDirent(de, r, args->offs.off)) != ZX_OK) {
-      return status;
+    zx_status_t status = VisitDirent(args, func);
+    switch (status) {
+      case kDirIteratorNext:
+        break;
+      case kDirIteratorDone:
+        return ZX_OK;
+      default:
+        // All errors. The callback should not be returning any other non-error (positive) values.
+        ZX_DEBUG_ASSERT(status < 0);
+        return status;
     }
+  }
+
+  return ZX_ERR_NOT_FOUND;
+}
+
+zx_status_t Directory::FindDirent(DirArgs* args, const DirentCallback func) {
+  BuildIndexIfNeeded(args->transaction);
+  if (!index_) {
+    return ForEachDirent(args, func);
+  }
 
-    switch ((status = func(fbl::RefPtr<Directory>(this), de, args))) {
+  // Visit the candidates in directory order, as |ForEachDirent| would find them.
+  for (size_t off : index_->Find(args->name)) {
+    args->offs.off = off;
+    args->offs.off_prev = index_->PreviousOffset(off);
+    zx_status_t status = VisitDirent(args, func);
+    switch (status) {
       case kDirIteratorNext:
+        // A different name with the same hash.
         break;
-      case kDirIteratorSaveSync:
-        inode_.seq_num++;
-        InodeSync(args->transaction, kMxFsSyncMtime);
-        args->transaction->PinVnode(fbl::RefPtr(this));
-        return ZX_OK;
       case kDirIteratorDone:
         return ZX_OK;
       default:
-        // All errors. The callback should not be returning any other non-error (positive) values.
         ZX_DEBUG_ASSERT(status < 0);
         return status;
     }
@@ -470,6 +519,59 @@ zx_status_t Directory::ForEachDirent(DirArgs* args, const DirentCallback func) {
   return ZX_ERR_NOT_FOUND;
 }
 
+zx_status_t Directory::FindSpace(DirArgs* args) {
+  BuildIndexIfNeeded(args->transaction);
+  if (!index_) {
+    return ForEachDirent(args, DirentCallbackFindSpace);
+  }
+
+  size_t off;
+  if (!index_->FindSpace(args->reclen, &off)) {
+    return ZX_ERR_NOT_FOUND;
+  }
+  args->offs.off = off;
+  args->offs.off_prev = index_->PreviousOffset(off);
+  return ZX_OK;
+}
+
+zx_status_t Directory::VisitDirent(DirArgs* args, const DirentCallback func) {
+  DirentBuffer dirent_buffer;
+  Dirent* de = &dirent_buffer.dirent;
+
+  size_t r;
+  zx_status_t status =
+      ReadInternal(args->transaction, de, kMinfsMaxDirentSize, args->offs.off, &r);
+  if (status != ZX_OK) {
+    return status;
+  } else if ((status = ValidateDirent(de, r, args->offs.off)) != ZX_OK) {
+    return status;
+  }
+
+  status = func(fbl::RefPtr<Directory>(this), de, args);
+  if (status == kDirIteratorSaveSync) {
+    inode_.seq_num++;
+    InodeSync(args->transaction, kMxFsSyncMtime);
+    args->transaction->PinVnode(fbl::RefPtr(this));
+    return kDirIteratorDone;
+  }
+  return status;
+}
+
+void Directory::BuildIndexIfNeeded(Transaction* transaction) {
+  if (index_ || GetSize() < kMinfsDirectoryIndexMinSize) {
+    return;
+  }
+
+  DirArgs args;
+  args.transaction = transaction;
+  index_ = std::make_unique<DirectoryIndex>();
+  // The scan only ends with ZX_ERR_NOT_FOUND once it has passed the last record.
+  if (ForEachDirent(&args, DirentCallbackIndex) != ZX_ERR_NOT_FOUND) {
+    FS_TRACE_WARN("minfs: Failed to index directory #%u\n", GetIno());
+    index_.reset();
+  }
+}
+
 fs::VnodeProtocolSet Directory::GetProtocols() const { return fs::VnodeProtocol::kDirectory; }
 
 zx_status_t Directory::Read(void* data, size_t len, size_t off, size_t* out_actual) {
@@ -500,7 +602,7 @@ zx_status_t Directory::LookupInternal(fbl::RefPtr<fs::Vnode>* out, fbl::StringPi
   auto get_metrics = fbl::MakeAutoCall(
       [&ticker, &success, this]() { fs_->UpdateLookupMetrics(success, ticker.End()); });
 
-  if (zx_status_t status = ForEachDirent(&args, DirentCallbackFind); status != ZX_OK) {
+  if (zx_status_t status = FindDirent(&args, DirentCallbackFind); status != ZX_OK) {
     return status;
   }
   fbl::RefPtr<VnodeMinfs> vn;
@@ -617,7 +719,7 @@ zx_status_t Directory::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece name
 
   // Ensure file does not exist.
   zx_status_t status;
-  if ((status = ForEachDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
+  if ((status = FindDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
     return ZX_ERR_ALREADY_EXISTS;
   }
 
@@ -628,7 +730,7 @@ zx_status_t Directory::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece name
   // before updating any other metadata.
   args.type = type;
   args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(name.length())));
-  status = ForEachDirent(&args, DirentCallbackFindSpace);
+  status = FindSpace(&args);
   if (status == ZX_ERR_NOT_FOUND) {
     return ZX_ERR_NO_SPACE;
   } else if (status != ZX_OK) {
@@ -708,7 +810,7 @@ zx_status_t Directory::Unlink(fbl::StringPiece name, bool must_be_dir) {
   args.type = must_be_dir ? kMinfsTypeDir : 0;
   args.transaction = transaction.get();
 
-  status = ForEachDirent(&args, DirentCallbackUnlink);
+  status = FindDirent(&args, DirentCallbackUnlink);
   if (status != ZX_OK) {
     return status;
   }
@@ -768,7 +870,7 @@ zx_status_t Directory::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece o
   // Acquire the 'oldname' node (it must exist).
   DirArgs args;
   args.name = oldname;
-  if ((status = ForEachDirent(&args, DirentCallbackFind)) < 0) {
+  if ((status = FindDirent(&args, DirentCallbackFind)) < 0) {
     return status;
   }
   if ((status = fs_->VnodeGet(&oldvn, args.ino)) < 0) {
@@ -797,7 +899,7 @@ zx_status_t Directory::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece o
   args.type = oldvn->IsDirectory() ? kMinfsTypeDir : kMinfsTypeFile;
   args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(newname.length())));
 
-  status = newdir->ForEachDirent(&args, DirentCallbackFindSpace);
+  status = newdir->FindSpace(&args);
   if (status == ZX_ERR_NOT_FOUND) {
     return ZX_ERR_NO_SPACE;
   }
@@ -824,7 +926,7 @@ zx_status_t Directory::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece o
   args.transaction = transaction.get();
   args.name = newname;
   args.ino = oldvn->GetIno();
-  status = newdir->ForEachDirent(&args, DirentCallbackAttemptRename);
+  status = newdir->FindDirent(&args, DirentCallbackAttemptRename);
   if (status == ZX_ERR_NOT_FOUND) {
     // If 'newname' does not exist, create it.
     args.offs = append_offs;
@@ -845,7 +947,7 @@ zx_status_t Directory::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece o
     auto vn = fbl::RefPtr<Directory>::Downcast(vn_fs);
     args.name = "..";
     args.ino = newdir->GetIno();
-    if ((status = vn->ForEachDirent(&args, DirentCallbackUpdateInode)) < 0) {
+    if ((status = vn->FindDirent(&args, DirentCallbackUpdateInode)) < 0) {
       return status;
     }
   }
@@ -856,7 +958,7 @@ zx_status_t Directory::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece o
 
   // finally, remove oldname from its original position
   args.name = oldname;
-  if ((status = ForEachDirent(&args, DirentCallbackForceUnlink)) != ZX_OK) {
+  if ((status = FindDirent(&args, DirentCallbackForceUnlink)) != ZX_OK) {
     return status;
   }
   transaction->PinVnode(oldvn);
@@ -884,7 +986,7 @@ zx_status_t Directory::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targe
   DirArgs args;
   args.name = name;
   zx_status_t status;
-  if ((status = ForEachDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
+  if ((status = FindDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
     return (status == ZX_OK) ? ZX_ERR_ALREADY_EXISTS : status;
   }
 
@@ -892,7 +994,7 @@ zx_status_t Directory::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targe
   // before updating any other metadata.
   args.type = kMinfsTypeFile;  // We can't hard link directories
   args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(name.length())));
-  status = ForEachDirent(&args, DirentCallbackFindSpace);
+  status = FindSpace(&args);
   if (status == ZX_ERR_NOT_FOUND) {
     return ZX_ERR_NO_SPACE;
   } else if (status != ZX_OK) {
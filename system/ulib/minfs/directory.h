@@ -5,6 +5,8 @@
 #ifndef ZIRCON_SYSTEM_ULIB_MINFS_DIRECTORY_H_
 #define ZIRCON_SYSTEM_ULIB_MINFS_DIRECTORY_H_
 
+#include <memory>
+
 #include <fbl/algorithm.h>
 #include <fbl/ref_ptr.h>
 #include <fs/trace.h>
@@ -15,6 +17,7 @@
 #include <minfs/transaction_limits.h>
 #include <minfs/writeback.h>
 
+#include "directory_index.h"
 #include "vnode.h"
 
 namespace minfs {
@@ -89,6 +92,23 @@ class Directory final : public VnodeMinfs, public fbl::Recyclable<Directory> {
   // Enumerates directories.
   zx_status_t ForEachDirent(DirArgs* args, const DirentCallback func);
 
+  // Like |ForEachDirent|, but only visits the entries which may be named |args->name|. Uses the
+  // index when the directory has one, so |func| must skip entries with other names, as the
+  // callbacks below do.
+  zx_status_t FindDirent(DirArgs* args, const DirentCallback func);
+
+  // Finds a record with room for a dirent of |args->reclen| bytes, as |ForEachDirent| with
+  // |DirentCallbackFindSpace| would, and leaves its offset in |args->offs|.
+  zx_status_t FindSpace(DirArgs* args);
+
+  // Reads the dirent at |args->offs.off| and passes it to |func|. Syncs the inode if |func|
+  // modified the directory, returning |kDirIteratorDone| in place of |kDirIteratorSaveSync|.
+  zx_status_t VisitDirent(DirArgs* args, const DirentCallback func);
+
+  // Builds |index_| by reading every dirent, if the directory is large enough to benefit and is
+  // not already indexed. Leaves the directory unindexed if it cannot be read.
+  void BuildIndexIfNeeded(Transaction* transaction);
+
   // Directory callback functions.
   //
   // The following functions are passable to |ForEachDirent|, which reads the parent directory,
@@ -100,6 +120,7 @@ class Directory final : public VnodeMinfs, public fbl::Recyclable<Directory> {
   static zx_status_t DirentCallbackAttemptRename(fbl::RefPtr<Directory>, Dirent*, DirArgs*);
   static zx_status_t DirentCallbackUpdateInode(fbl::RefPtr<Directory>, Dirent*, DirArgs*);
   static zx_status_t DirentCallbackFindSpace(fbl::RefPtr<Directory>, Dirent*, DirArgs*);
+  static zx_status_t DirentCallbackIndex(fbl::RefPtr<Directory>, Dirent*, DirArgs*);
 
   // Appends a new directory at the specified offset within |args|. This requires a prior call to
   // DirentCallbackFindSpace to find an offset where there is space for the direntry. It takes
@@ -108,6 +129,10 @@ class Directory final : public VnodeMinfs, public fbl::Recyclable<Directory> {
 
   zx_status_t UnlinkChild(Transaction* transaction, fbl::RefPtr<VnodeMinfs> child, Dirent* de,
                           DirectoryOffset* offs);
+
+  // Index of the directory's records, built on first use once the directory is large. Every change
+  // to the dirents updates it; a change which fails part way discards it instead.
+  std::unique_ptr<DirectoryIndex> index_;
 };
 
 }  // namespace minfs
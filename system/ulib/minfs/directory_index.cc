@@ -0,0 +1,84 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "directory_index.h"
+
+#include <zircon/assert.h>
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+namespace minfs {
+
+size_t DirectoryIndex::HashName(fbl::StringPiece name) {
+  return std::hash<std::string_view>()(name);
+}
+
+void DirectoryIndex::Update(size_t off, uint32_t reclen, fbl::StringPiece name) {
+  Erase(off);
+
+  Record record;
+  record.reclen = reclen;
+  if (!name.empty()) {
+    record.size = DirentSize(static_cast<uint8_t>(name.length()));
+    record.name_hash = HashName(name);
+    names_.emplace(record.name_hash, off);
+  }
+  ZX_DEBUG_ASSERT(record.size <= record.reclen);
+  records_.emplace(off, record);
+
+  uint32_t unused = record.reclen - record.size;
+  if (unused >= DirentSize(1)) {
+    space_.emplace(off, unused);
+  }
+}
+
+void DirectoryIndex::Erase(size_t off) {
+  auto record = records_.find(off);
+  if (record == records_.end()) {
+    return;
+  }
+  if (record->second.size != 0) {
+    auto range = names_.equal_range(record->second.name_hash);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+      if (entry->second == off) {
+        names_.erase(entry);
+        break;
+      }
+    }
+  }
+  space_.erase(off);
+  records_.erase(record);
+}
+
+std::vector<size_t> DirectoryIndex::Find(fbl::StringPiece name) const {
+  std::vector<size_t> offsets;
+  auto range = names_.equal_range(HashName(name));
+  for (auto entry = range.first; entry != range.second; ++entry) {
+    offsets.push_back(entry->second);
+  }
+  std::sort(offsets.begin(), offsets.end());
+  return offsets;
+}
+
+size_t DirectoryIndex::PreviousOffset(size_t off) const {
+  auto record = records_.find(off);
+  if (record == records_.end() || record == records_.begin()) {
+    return off;
+  }
+  return std::prev(record)->first;
+}
+
+bool DirectoryIndex::FindSpace(uint32_t reclen, size_t* out_off) const {
+  for (const auto& [off, unused] : space_) {
+    if (unused >= reclen) {
+      *out_off = off;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace minfs
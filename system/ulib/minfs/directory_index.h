@@ -0,0 +1,84 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_MINFS_DIRECTORY_INDEX_H_
+#define ZIRCON_SYSTEM_ULIB_MINFS_DIRECTORY_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <fbl/string_piece.h>
+#include <minfs/format.h>
+
+namespace minfs {
+
+// Directories smaller than this are cheap enough to scan that they are never indexed.
+constexpr size_t kMinfsDirectoryIndexMinSize = kMinfsBlockSize;
+
+// An in-memory index of the records in a directory.
+//
+// Without an index, finding an entry by name or finding room for a new entry reads the directory
+// one dirent at a time from the start. The index holds the offset and size of every record, and
+// the offsets of the entries grouped by a hash of their names, so that both can be answered
+// without reading the dirents.
+//
+// The index is derived entirely from the dirents, which remain the only on-disk state, and must be
+// updated with every change made to them. It does not own the names, so a name match only
+// identifies a candidate; the caller must compare the name stored in the dirent.
+class DirectoryIndex {
+ public:
+  DirectoryIndex() = default;
+  DirectoryIndex(const DirectoryIndex&) = delete;
+  DirectoryIndex& operator=(const DirectoryIndex&) = delete;
+
+  // Records that the record at |off| is |reclen| bytes long and holds an entry named |name|, or
+  // is free if |name| is empty. Replaces any existing record at |off|. For the last record in the
+  // directory, |reclen| is the length given by |MinfsReclen|.
+  void Update(size_t off, uint32_t reclen, fbl::StringPiece name);
+
+  // Forgets the record at |off|, which has been coalesced into a neighbouring record.
+  void Erase(size_t off);
+
+  // Returns the offsets of the entries which may be named |name|, in directory order.
+  std::vector<size_t> Find(fbl::StringPiece name) const;
+
+  // Returns the offset of the record before the one at |off|, or |off| for the first record. This
+  // matches the |DirectoryOffset| seen when walking the directory from the start.
+  size_t PreviousOffset(size_t off) const;
+
+  // Returns the offset of the first record with room for a dirent of |reclen| bytes, either as a
+  // free record or as unused space after an entry, or false if there is none.
+  bool FindSpace(uint32_t reclen, size_t* out_off) const;
+
+  size_t RecordCount() const { return records_.size(); }
+  size_t EntryCount() const { return names_.size(); }
+
+ private:
+  struct Record {
+    uint32_t reclen = 0;
+    // The size of the entry held in the record, or zero if the record is free.
+    uint32_t size = 0;
+    size_t name_hash = 0;
+  };
+
+  static size_t HashName(fbl::StringPiece name);
+
+  // Every record in the directory, keyed by offset.
+  std::map<size_t, Record> records_;
+
+  // The records with at least enough unused space for the smallest dirent, keyed by offset and
+  // holding the unused space.
+  std::map<size_t, uint32_t> space_;
+
+  // The offsets of the entries, keyed by |HashName|.
+  std::unordered_multimap<size_t, size_t> names_;
+};
+
+}  // namespace minfs
+
+#endif  // ZIRCON_SYSTEM_ULIB_MINFS_DIRECTORY_INDEX_H_
@@ -0,0 +1,176 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extent_map.h"
+
+#include <string.h>
+#include <zircon/assert.h>
+
+#include <limits>
+
+namespace minfs {
+
+namespace {
+
+// The extents overlay the block pointers, which start at |dnum| and run to the end of the inode.
+constexpr size_t kExtentsOffset = offsetof(Inode, dnum);
+constexpr size_t kExtentsSize = sizeof(InodeExtent) * kMinfsInodeExtents;
+static_assert(kExtentsOffset + kExtentsSize == sizeof(Inode));
+
+// Returns true if |second| carries on from where |first| ends, so the two can be one extent.
+bool CanMerge(const InodeExtent& first, const InodeExtent& second) {
+  if (first.start == 0 || second.start == 0) {
+    return first.start == second.start;
+  }
+  return first.start + first.length == second.start;
+}
+
+}  // namespace
+
+size_t ExtentMap::Load(Extents* extents) const {
+  memcpy(extents->data(), reinterpret_cast<const uint8_t*>(&inode_) + kExtentsOffset,
+         kExtentsSize);
+  size_t count = 0;
+  while (count < kMinfsInodeExtents && (*extents)[count].length != 0) {
+    ++count;
+  }
+  return count;
+}
+
+zx_status_t ExtentMap::Store(Extents* extents, size_t count) {
+  size_t merged = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const InodeExtent& extent = (*extents)[i];
+    if (extent.length == 0) {
+      continue;
+    }
+    if (merged > 0 && CanMerge((*extents)[merged - 1], extent)) {
+      (*extents)[merged - 1].length += extent.length;
+    } else {
+      (*extents)[merged++] = extent;
+    }
+  }
+  while (merged > 0 && (*extents)[merged - 1].start == 0) {
+    --merged;
+  }
+  if (merged > kMinfsInodeExtents) {
+    return ZX_ERR_NO_SPACE;
+  }
+  for (size_t i = merged; i < kMinfsInodeExtents; ++i) {
+    (*extents)[i] = {};
+  }
+  memcpy(reinterpret_cast<uint8_t*>(&inode_) + kExtentsOffset, extents->data(), kExtentsSize);
+  return ZX_OK;
+}
+
+size_t ExtentMap::ExtentCount() const {
+  Extents extents;
+  return Load(&extents);
+}
+
+uint64_t ExtentMap::BlockCount() const {
+  Extents extents;
+  size_t count = Load(&extents);
+  uint64_t blocks = 0;
+  for (size_t i = 0; i < count; ++i) {
+    blocks += extents[i].length;
+  }
+  return blocks;
+}
+
+bool ExtentMap::IsValid() const {
+  Extents extents;
+  size_t count = Load(&extents);
+  if (count > 0 && extents[count - 1].start == 0) {
+    return false;
+  }
+  for (size_t i = count; i < kMinfsInodeExtents; ++i) {
+    if (extents[i].start != 0 || extents[i].length != 0) {
+      return false;
+    }
+  }
+  return BlockCount() <= kMinfsMaxFileBlock;
+}
+
+std::pair<blk_t, uint64_t> ExtentMap::Lookup(uint64_t file_block) const {
+  Extents extents;
+  size_t count = Load(&extents);
+  uint64_t extent_start = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const InodeExtent& extent = extents[i];
+    if (file_block < extent_start + extent.length) {
+      uint64_t offset = file_block - extent_start;
+      blk_t block = extent.start == 0 ? 0 : static_cast<blk_t>(extent.start + offset);
+      return std::make_pair(block, extent.length - offset);
+    }
+    extent_start += extent.length;
+  }
+  return std::make_pair(0, std::numeric_limits<uint64_t>::max());
+}
+
+zx_status_t ExtentMap::Set(uint64_t file_block, blk_t block) {
+  Extents extents;
+  size_t count = Load(&extents);
+
+  // Find the extent holding |file_block|.
+  uint64_t extent_start = 0;
+  size_t index = 0;
+  while (index < count && file_block >= extent_start + extents[index].length) {
+    extent_start += extents[index].length;
+    ++index;
+  }
+
+  if (index == count) {
+    // Past the last extent: a sparse extent fills any gap, followed by the new block.
+    if (block == 0) {
+      return ZX_OK;
+    }
+    ZX_DEBUG_ASSERT(file_block - extent_start <= std::numeric_limits<blk_t>::max());
+    if (file_block > extent_start) {
+      extents[count++] = {0, static_cast<blk_t>(file_block - extent_start)};
+    }
+    extents[count++] = {block, 1};
+    return Store(&extents, count);
+  }
+
+  const InodeExtent extent = extents[index];
+  const blk_t offset = static_cast<blk_t>(file_block - extent_start);
+  if ((extent.start == 0 ? 0 : extent.start + offset) == block) {
+    return ZX_OK;
+  }
+
+  // Split the extent into what comes before the block, the block and what comes after it. Empty
+  // pieces are dropped by Store.
+  InodeExtent pieces[3] = {
+      {extent.start, offset},
+      {block, 1},
+      {extent.start == 0 ? 0 : extent.start + offset + 1, extent.length - offset - 1},
+  };
+  for (size_t i = count; i > index + 1; --i) {
+    extents[i + 1] = extents[i - 1];
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    extents[index + i] = pieces[i];
+  }
+  return Store(&extents, count + 2);
+}
+
+void ExtentMap::Truncate(uint64_t file_block) {
+  Extents extents;
+  size_t count = Load(&extents);
+  uint64_t extent_start = 0;
+  size_t index = 0;
+  while (index < count && file_block >= extent_start + extents[index].length) {
+    extent_start += extents[index].length;
+    ++index;
+  }
+  if (index == count) {
+    return;
+  }
+  extents[index].length = static_cast<blk_t>(file_block - extent_start);
+  zx_status_t status = Store(&extents, index + 1);
+  ZX_DEBUG_ASSERT(status == ZX_OK);
+}
+
+}  // namespace minfs
@@ -0,0 +1,81 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSTEM_ULIB_MINFS_EXTENT_MAP_H_
+#define ZIRCON_SYSTEM_ULIB_MINFS_EXTENT_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zircon/types.h>
+
+#include <array>
+#include <utility>
+
+#include <minfs/format.h>
+
+namespace minfs {
+
+// Maps file blocks to device blocks through the extents held in an extent-mapped inode. See
+// |InodeExtent| for the format.
+//
+// The extents are read from and written back to the inode on every call, so an ExtentMap never
+// holds state of its own and any number of them may refer to the same inode.
+class ExtentMap {
+ public:
+  explicit ExtentMap(Inode* inode) : inode_(*inode) {}
+
+  // Returns the number of extents in use.
+  size_t ExtentCount() const;
+
+  // Returns the number of file blocks covered by the extents. No block at or past this one is
+  // mapped.
+  uint64_t BlockCount() const;
+
+  // Returns true if the extents are laid out as |InodeExtent| describes and cover no more than
+  // kMinfsMaxFileBlock blocks.
+  bool IsValid() const;
+
+  // Returns the device block holding |file_block|, or zero if it is sparse, and the number of
+  // blocks from |file_block| onwards which are mapped contiguously with it (or are all sparse). The
+  // count is unbounded past the last extent, and is otherwise never larger than what is left of
+  // the extent holding |file_block|.
+  std::pair<blk_t, uint64_t> Lookup(uint64_t file_block) const;
+
+  // Maps |file_block| to the device block |block|, or unmaps it if |block| is zero, merging and
+  // splitting extents as required. Returns ZX_ERR_NO_SPACE, and leaves the extents unchanged, if
+  // the result would need more than kMinfsInodeExtents extents.
+  //
+  // Mapping one block at a time adds at most two extents for the first block of a run of file
+  // blocks, and at most one for each block after it.
+  [[nodiscard]] zx_status_t Set(uint64_t file_block, blk_t block);
+
+  // Unmaps every block from |file_block| onwards. This never needs more extents than are already in
+  // use. The device blocks are not freed.
+  void Truncate(uint64_t file_block);
+
+  // Returns the maximum number of extents which mapping |block_count| contiguous file blocks one at
+  // a time may add.
+  static constexpr size_t MaxNewExtents(uint64_t block_count) {
+    return block_count == 0 ? 0 : static_cast<size_t>(block_count) + 1;
+  }
+
+ private:
+  // Leaves room to split an extent in three before the result is checked against the inode.
+  static constexpr size_t kMaxWorkingExtents = kMinfsInodeExtents + 2;
+  using Extents = std::array<InodeExtent, kMaxWorkingExtents>;
+
+  // Copies the extents out of the inode, returning the number in use.
+  size_t Load(Extents* extents) const;
+
+  // Merges neighbouring extents which can be merged, and drops trailing sparse extents, before
+  // copying the first |count| extents back to the inode. Returns ZX_ERR_NO_SPACE, and leaves the
+  // inode unchanged, if more extents remain than the inode can hold.
+  zx_status_t Store(Extents* extents, size_t count);
+
+  Inode& inode_;
+};
+
+}  // namespace minfs
+
+#endif  // ZIRCON_SYSTEM_ULIB_MINFS_EXTENT_MAP_H_
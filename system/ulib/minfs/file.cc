@@ -34,6 +34,7 @@
 #include <fbl/auto_lock.h>
 #endif
 
+#include "extent_map.h"
 #include "minfs_private.h"
 #include "unowned_vmo_buffer.h"
 #include "vnode.h"
@@ -96,16 +97,21 @@ void File::AllocateAndCommitData(std::unique_ptr<Transaction> transaction) {
     // Since we reserved enough space ahead of time, this should not fail.
     ZX_ASSERT(BlocksSwap(transaction.get(), bno_start, bno_count, &allocated_blocks[0]) == ZX_OK);
 
-    // Enqueue each data block one at a time, as they may not be contiguous on disk.
+    // Enqueue the data blocks in runs which are contiguous on disk.
     UnownedVmoBuffer buffer(zx::unowned_vmo(vmo_.get()));
-    for (blk_t i = 0; i < bno_count; i++) {
+    for (blk_t i = 0; i < bno_count;) {
+      blk_t run = 1;
+      while (i + run < bno_count && allocated_blocks[i + run] == allocated_blocks[i] + run) {
+        run++;
+      }
       storage::Operation operation = {
           .type = storage::OperationType::kWrite,
           .vmo_offset = bno_start + i,
           .dev_offset = allocated_blocks[i] + fs_->Info().dat_block,
-          .length = 1,
+          .length = run,
       };
       transaction->EnqueueData(operation, &buffer);
+      i += run;
     }
 
     // Since we are updating the file in "chunks", only update the on-disk inode size
@@ -173,6 +179,90 @@ zx_status_t File::BlocksSwap(Transaction* transaction, blk_t start, blk_t count,
 
 #endif
 
+blk_t File::MaxExtentMappedBlocks() const {
+  return kMinfsDirect + kMinfsDirectPerIndirect * fs_->Limits().GetMaximumMetaDataBlocks();
+}
+
+zx_status_t File::EnsureExtentCapacity(size_t offset, size_t length) {
+  if (!IsExtentMapped() || length == 0) {
+    return ZX_OK;
+  }
+  const uint64_t first_block = offset / kMinfsBlockSize;
+  const uint64_t end_block = fbl::round_up(offset + length, kMinfsBlockSize) / kMinfsBlockSize;
+  ExtentMap extents(&inode_);
+  if (end_block <= MaxExtentMappedBlocks() &&
+      extents.ExtentCount() + ExtentMap::MaxNewExtents(end_block - first_block) <=
+          kMinfsInodeExtents) {
+    return ZX_OK;
+  }
+  return ConvertToBlockPointers();
+}
+
+zx_status_t File::ConvertToBlockPointers() {
+  TRACE_DURATION("minfs", "File::ConvertToBlockPointers", "ino", GetIno());
+  Inode extent_inode = inode_;
+  ExtentMap extents(&extent_inode);
+  const uint64_t block_count = extents.BlockCount();
+  ZX_DEBUG_ASSERT(block_count <= MaxExtentMappedBlocks());
+
+  // One indirect block is needed for every kMinfsDirectPerIndirect blocks past the direct blocks.
+  // Sparse ranges may need fewer, in which case the rest of the reservation goes unused.
+  blk_t indirect_blocks = 0;
+  if (block_count > kMinfsDirect) {
+    indirect_blocks = static_cast<blk_t>(
+        fbl::round_up(block_count - kMinfsDirect, kMinfsDirectPerIndirect) /
+        kMinfsDirectPerIndirect);
+  }
+  std::unique_ptr<Transaction> transaction;
+  zx_status_t status = fs_->BeginTransaction(0, indirect_blocks, &transaction);
+  if (status != ZX_OK) {
+    return status;
+  }
+
+  // If anything fails, go back to the extents and drop any block pointers already cached.
+  auto restore = fbl::MakeAutoCall([this, &extent_inode]() {
+    inode_ = extent_inode;
+    if (indirect_file_) {
+      indirect_file_->Shrink(0);
+    }
+  });
+
+  inode_.flags &= ~kMinfsInodeFlagExtents;
+  memset(inode_.dnum, 0, sizeof(inode_.dnum));
+  memset(inode_.inum, 0, sizeof(inode_.inum));
+  memset(inode_.dinum, 0, sizeof(inode_.dinum));
+
+  VnodeMapper mapper(this);
+  VnodeIterator iterator;
+  if ((status = iterator.Init(&mapper, transaction.get(), 0)) != ZX_OK) {
+    return status;
+  }
+  while (iterator.file_block() < block_count) {
+    auto [block, count] = extents.Lookup(iterator.file_block());
+    if (block == 0) {
+      if ((status = iterator.Advance(count)) != ZX_OK) {
+        return status;
+      }
+      continue;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+      if ((status = iterator.SetBlk(static_cast<blk_t>(block + i))) != ZX_OK ||
+          (status = iterator.Advance()) != ZX_OK) {
+        return status;
+      }
+    }
+  }
+  if ((status = iterator.Flush()) != ZX_OK) {
+    return status;
+  }
+  restore.cancel();
+
+  InodeSync(transaction.get(), kMxFsSyncDefault);
+  transaction->PinVnode(fbl::RefPtr(this));
+  fs_->CommitTransaction(std::move(transaction));
+  return ZX_OK;
+}
+
 blk_t File::GetBlockCount() const {
 #ifdef __Fuchsia__
   return inode_.block_count + allocation_state_.GetNewPending();
@@ -270,9 +360,16 @@ zx_status_t File::Write(const void* data, size_t len, size_t offset, size_t* out
   auto get_metrics = fbl::MakeAutoCall(
       [&ticker, &out_actual, this]() { fs_->UpdateWriteMetrics(*out_actual, ticker.End()); });
 
+  // An extent-mapped file which may not be able to map the blocks written must first switch to
+  // block pointers.
+  zx_status_t status = EnsureExtentCapacity(offset, len);
+  if (status != ZX_OK) {
+    return status;
+  }
+
   blk_t reserve_blocks;
   // Calculate maximum number of blocks to reserve for this write operation.
-  zx_status_t status = GetRequiredBlockCount(offset, len, &reserve_blocks);
+  status = GetRequiredBlockCount(offset, len, &reserve_blocks);
   if (status != ZX_OK) {
     return status;
   }
@@ -315,10 +412,18 @@ zx_status_t File::Truncate(size_t len) {
   auto get_metrics =
       fbl::MakeAutoCall([&ticker, this] { fs_->UpdateTruncateMetrics(ticker.End()); });
 
+  zx_status_t status;
+  // Zeroing the tail of a partial last block rewrites it, which an extent-mapped file may not be
+  // able to map.
+  if (len < GetSize() && len % kMinfsBlockSize != 0) {
+    if ((status = EnsureExtentCapacity(len, 1)) != ZX_OK) {
+      return status;
+    }
+  }
+
   std::unique_ptr<Transaction> transaction;
   // Due to file copy-on-write, up to 1 new (data) block may be required.
   size_t reserve_blocks = 1;
-  zx_status_t status;
 
   if ((status = fs_->BeginTransaction(0, reserve_blocks, &transaction)) != ZX_OK) {
     return status;
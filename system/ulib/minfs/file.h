@@ -59,6 +59,18 @@ class File final : public VnodeMinfs, public fbl::Recyclable<File> {
   zx_status_t Append(const void* data, size_t len, size_t* out_end, size_t* out_actual) final;
   zx_status_t Truncate(size_t len) final;
 
+  // Returns the number of blocks an extent-mapped file may span. A larger file could not be
+  // converted to block pointers within one transaction.
+  blk_t MaxExtentMappedBlocks() const;
+
+  // Converts an extent-mapped file to block pointers if writing |length| bytes at |offset| could
+  // need more extents than the inode holds, or would take the file past MaxExtentMappedBlocks.
+  zx_status_t EnsureExtentCapacity(size_t offset, size_t length);
+
+  // Rewrites the mapping of an extent-mapped file as block pointers, and commits it in a
+  // transaction of its own.
+  zx_status_t ConvertToBlockPointers();
+
 #ifdef __Fuchsia__
   // Allocate all data blocks pending in |allocation_state_|.
   void AllocateAndCommitData(std::unique_ptr<Transaction> transaction);
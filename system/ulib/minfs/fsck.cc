@@ -11,6 +11,8 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <string>
+#include <unordered_set>
 #include <utility>
 
 #include <fs/journal/format.h>
@@ -22,6 +24,7 @@
 #include <storage/buffer/array_buffer.h>
 #endif
 
+#include "extent_map.h"
 #include "lib/fit/string_view.h"
 #include "minfs_private.h"
 
@@ -165,6 +168,19 @@ zx_status_t MinfsChecker::GetInodeNthBno(Inode* inode, blk_t n, blk_t* next_n, b
   // The default value for the "next n". It's easier to set it here anyway,
   // since we proceed to modify n in the code below.
   *next_n = n + 1;
+  if (inode->flags & kMinfsInodeFlagExtents) {
+    ExtentMap extents(inode);
+    if (n >= extents.BlockCount()) {
+      return ZX_ERR_OUT_OF_RANGE;
+    }
+    auto [block, count] = extents.Lookup(n);
+    *bno_out = block;
+    if (block == 0) {
+      // Skip over the rest of a sparse extent.
+      *next_n = static_cast<blk_t>(n + count);
+    }
+    return ZX_OK;
+  }
   if (n < kMinfsDirect) {
     *bno_out = inode->dnum[n];
     return ZX_OK;
@@ -248,6 +264,8 @@ zx_status_t MinfsChecker::CheckDirectory(Inode* inode, ino_t ino, ino_t parent,
   bool dot = false;
   bool dotdot = false;
   uint32_t dirent_count = 0;
+  // Names seen so far. Lookups stop at the first entry with a name, so a second one is never found.
+  std::unordered_set<std::string> names;
 
   zx_status_t status;
   fbl::RefPtr<VnodeMinfs> vn;
@@ -329,6 +347,11 @@ zx_status_t MinfsChecker::CheckDirectory(Inode* inode, ino_t ino, ino_t parent,
       if (flags & CD_DUMP) {
         FS_TRACE_DEBUG("ino#%u: de[%u]: ino=%u type=%u '%.*s' %s\n", ino, eno, de->ino, de->type,
                        de->namelen, de->name, is_last ? "[last]" : "");
+        if (!names.emplace(de->name, de->namelen).second) {
+          FS_TRACE_ERROR("check: ino#%u: de[%u]: duplicate entry '%.*s'\n", ino, eno, de->namelen,
+                         de->name);
+          conforming_ = false;
+        }
       }
 
       if (flags & CD_RECURSE) {
@@ -406,49 +429,63 @@ zx_status_t MinfsChecker::CheckFile(Inode* inode, ino_t ino) {
 
   uint32_t block_count = 0;
 
-  // count and sanity-check indirect blocks
-  for (unsigned n = 0; n < kMinfsIndirect; n++) {
-    if (inode->inum[n]) {
-      BlockInfo block_info = {ino, LogicalBlockIndirect(n), BlockType::IndirectBlock};
-      auto msg = CheckDataBlock(inode->inum[n], block_info);
-      if (msg) {
-        FS_TRACE_WARN("check: ino#%u: indirect block %u(@%u): %s\n", ino, n, inode->inum[n],
-                      msg.value().c_str());
-        conforming_ = false;
+  if (inode->flags & kMinfsInodeFlagExtents) {
+    // Extent-mapped files have no indirect blocks.
+    if (fs_->Info().version_major != kMinfsExtentsMajorVersion) {
+      FS_TRACE_WARN("check: ino#%u: extent-mapped inode on a filesystem without extents\n", ino);
+      conforming_ = false;
+      return ZX_OK;
+    }
+    if (!ExtentMap(inode).IsValid()) {
+      FS_TRACE_WARN("check: ino#%u: malformed extents\n", ino);
+      conforming_ = false;
+      return ZX_OK;
+    }
+  } else {
+    // count and sanity-check indirect blocks
+    for (unsigned n = 0; n < kMinfsIndirect; n++) {
+      if (inode->inum[n]) {
+        BlockInfo block_info = {ino, LogicalBlockIndirect(n), BlockType::IndirectBlock};
+        auto msg = CheckDataBlock(inode->inum[n], block_info);
+        if (msg) {
+          FS_TRACE_WARN("check: ino#%u: indirect block %u(@%u): %s\n", ino, n, inode->inum[n],
+                        msg.value().c_str());
+          conforming_ = false;
+        }
+        block_count++;
       }
-      block_count++;
     }
-  }
 
-  // count and sanity-check doubly indirect blocks
-  for (unsigned n = 0; n < kMinfsDoublyIndirect; n++) {
-    if (inode->dinum[n]) {
-      BlockInfo block_info = {ino, LogicalBlockDoublyIndirect(n), BlockType::DoubleIndirectBlock};
-      auto msg = CheckDataBlock(inode->dinum[n], block_info);
-      if (msg) {
-        FS_TRACE_WARN("check: ino#%u: doubly indirect block %u(@%u): %s\n", ino, n, inode->dinum[n],
-                      msg.value().c_str());
-        conforming_ = false;
-      }
-      block_count++;
+    // count and sanity-check doubly indirect blocks
+    for (unsigned n = 0; n < kMinfsDoublyIndirect; n++) {
+      if (inode->dinum[n]) {
+        BlockInfo block_info = {ino, LogicalBlockDoublyIndirect(n), BlockType::DoubleIndirectBlock};
+        auto msg = CheckDataBlock(inode->dinum[n], block_info);
+        if (msg) {
+          FS_TRACE_WARN("check: ino#%u: doubly indirect block %u(@%u): %s\n", ino, n, inode->dinum[n],
+                        msg.value().c_str());
+          conforming_ = false;
+        }
+        block_count++;
 
-      char data[kMinfsBlockSize];
-      zx_status_t status;
-      if ((status = fs_->ReadDat(inode->dinum[n], data)) != ZX_OK) {
-        return status;
-      }
-      uint32_t* entry = reinterpret_cast<uint32_t*>(data);
-
-      for (unsigned m = 0; m < kMinfsDirectPerIndirect; m++) {
-        if (entry[m]) {
-          BlockInfo block_info = {ino, LogicalBlockDoublyIndirect(n, m), BlockType::IndirectBlock};
-          msg = CheckDataBlock(entry[m], block_info);
-          if (msg) {
-            FS_TRACE_WARN("check: ino#%u: indirect block (in dind) %u(@%u): %s\n", ino, m, entry[m],
-                          msg.value().c_str());
-            conforming_ = false;
+        char data[kMinfsBlockSize];
+        zx_status_t status;
+        if ((status = fs_->ReadDat(inode->dinum[n], data)) != ZX_OK) {
+          return status;
+        }
+        uint32_t* entry = reinterpret_cast<uint32_t*>(data);
+
+        for (unsigned m = 0; m < kMinfsDirectPerIndirect; m++) {
+          if (entry[m]) {
+            BlockInfo block_info = {ino, LogicalBlockDoublyIndirect(n, m), BlockType::IndirectBlock};
+            msg = CheckDataBlock(entry[m], block_info);
+            if (msg) {
+              FS_TRACE_WARN("check: ino#%u: indirect block (in dind) %u(@%u): %s\n", ino, m, entry[m],
+                            msg.value().c_str());
+              conforming_ = false;
+            }
+            block_count++;
           }
-          block_count++;
         }
       }
     }
@@ -10,6 +10,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <zircon/types.h>
 
@@ -33,8 +34,13 @@ typedef uint32_t ino_t;
 constexpr uint64_t kMinfsMagic0         = (0x002153466e694d21ULL);
 constexpr uint64_t kMinfsMagic1         = (0x385000d3d3d3d304ULL);
 constexpr uint32_t kMinfsMajorVersion   = 0x00000009;
+// Filesystems which may hold extent-mapped inodes (see kMinfsInodeFlagExtents) carry this major
+// version instead, so that drivers which predate them refuse to mount them. A filesystem is only
+// moved to it when first mounted with extent-mapped files enabled.
+constexpr uint32_t kMinfsExtentsMajorVersion = 0x0000000a;
 constexpr uint32_t kMinfsMinorVersion   = 0x00000000;
-constexpr uint32_t kMinfsRevision       = 0x00000001;
+// Revision 2 adds extent-mapped inodes (see kMinfsInodeFlagExtents).
+constexpr uint32_t kMinfsRevision       = 0x00000002;
 
 constexpr ino_t    kMinfsRootIno        = 1;
 constexpr uint32_t kMinfsFlagClean      = 0x00000001;  // Currently unused,
@@ -51,6 +57,9 @@ constexpr uint32_t kMinfsDoublyIndirect = 1;
 constexpr uint32_t kMinfsDirectPerIndirect  = (kMinfsBlockSize / sizeof(blk_t));
 constexpr uint32_t kMinfsDirectPerDindirect = kMinfsDirectPerIndirect * kMinfsDirectPerIndirect;
 
+// Inode flags.
+constexpr uint32_t kMinfsInodeFlagExtents = 0x00000001;  // Blocks are mapped by InodeExtent.
+
 // It is not possible to have a block at or past this one due to the limitations of the inode and
 // indirect blocks.
 // TODO(ZX-1523): Remove this artificial cap when MinFS can safely deal with files larger than 4GB.
@@ -166,7 +175,8 @@ struct Inode {
   uint32_t dirent_count;  // for directories
   ino_t last_inode;       // index to the previous unlinked inode
   ino_t next_inode;       // index to the next unlinked inode
-  uint32_t rsvd[3];
+  uint32_t flags;         // kMinfsInodeFlag*
+  uint32_t rsvd[2];
   blk_t dnum[kMinfsDirect];           // direct blocks
   blk_t inum[kMinfsIndirect];         // indirect blocks
   blk_t dinum[kMinfsDoublyIndirect];  // doubly indirect blocks
@@ -174,6 +184,27 @@ struct Inode {
 
 static_assert(sizeof(Inode) == kMinfsInodeSize, "minfs inode size is wrong");
 
+// A run of |length| file blocks stored in the device blocks starting at |start|, or a sparse run if
+// |start| is zero.
+//
+// When an inode has kMinfsInodeFlagExtents set, its dnum, inum and dinum fields instead hold an
+// array of kMinfsInodeExtents extents. The extents map the file from block zero onwards, each
+// starting where the previous one ends. Unused slots, which all follow the used ones, have a length
+// of zero, and the last used extent is never sparse. No indirect blocks are used, so such a file
+// holds exactly the blocks named by its extents.
+struct InodeExtent {
+  blk_t start;
+  blk_t length;
+};
+
+constexpr uint32_t kMinfsInodeExtents =
+    (kMinfsDirect + kMinfsIndirect + kMinfsDoublyIndirect) * sizeof(blk_t) / sizeof(InodeExtent);
+
+static_assert(offsetof(Inode, inum) == offsetof(Inode, dnum) + sizeof(Inode::dnum) &&
+                  offsetof(Inode, dinum) == offsetof(Inode, inum) + sizeof(Inode::inum) &&
+                  offsetof(Inode, dinum) + sizeof(Inode::dinum) == sizeof(Inode),
+              "minfs inode extents must fill the block pointers");
+
 struct Dirent {
   ino_t ino;        // Inode number.
   uint32_t reclen;  // Low 28 bits: Length of record. High 4 bits: Flags
@@ -81,6 +81,10 @@ struct MountOptions {
   bool use_journal = true;
   // For testing only: if true, run fsck after every transaction.
   bool fsck_after_every_transaction = false;
+  // If true, new files map their blocks with extents held in the inode rather than with block
+  // pointers. Files of either kind can always be read. An extent-mapped file reverts to block
+  // pointers if it becomes too fragmented or too large for its extents.
+  bool extent_mapped_files = false;
 
   // Number of slices to preallocate for data when the filesystem is created.
   uint32_t fvm_data_slices = 1;
@@ -63,7 +63,8 @@ std::unique_ptr<disk_inspector::DiskStruct> GetInodeStruct(uint64_t index) {
   ADD_FIELD(object, Inode, dirent_count);
   ADD_FIELD(object, Inode, last_inode);
   ADD_FIELD(object, Inode, next_inode);
-  ADD_ARRAY_FIELD(object, Inode, rsvd, 3);
+  ADD_FIELD(object, Inode, flags);
+  ADD_ARRAY_FIELD(object, Inode, rsvd, 2);
   ADD_ARRAY_FIELD(object, Inode, dnum, kMinfsDirect);
   ADD_ARRAY_FIELD(object, Inode, inum, kMinfsIndirect);
   ADD_ARRAY_FIELD(object, Inode, dinum, kMinfsDoublyIndirect);
@@ -61,18 +61,22 @@ std::unique_ptr<disk_inspector::DiskObject> InodeObject::GetElementAt(uint32_t i
       return CreateUint32DiskObj("next_inode", &(inode_.next_inode));
     }
     case 11: {
-      // uint32_t Array rsvd
-      return CreateUint32ArrayDiskObj("reserved", inode_.rsvd, 3);
+      // uint32_t flags
+      return CreateUint32DiskObj("flags", &(inode_.flags));
     }
     case 12: {
+      // uint32_t Array rsvd
+      return CreateUint32ArrayDiskObj("reserved", inode_.rsvd, 2);
+    }
+    case 13: {
       // blk_t/uint32_t Array dnum
       return CreateUint32ArrayDiskObj("direct blocks", inode_.dnum, kMinfsDirect);
     }
-    case 13: {
+    case 14: {
       // blk_t/uint32_t Array inum
       return CreateUint32ArrayDiskObj("indirect blocks", inode_.inum, kMinfsIndirect);
     }
-    case 14: {
+    case 15: {
       // blk_t/uint32_t Array dinum
       return CreateUint32ArrayDiskObj("double indirect blocks", inode_.dinum, kMinfsDoublyIndirect);
     }
@@ -397,9 +397,10 @@ zx_status_t CheckSuperblock(const Superblock* info, uint32_t max_blocks) {
                    kMinfsMagic0);
     return ZX_ERR_WRONG_TYPE;
   }
-  if (info->version_major != kMinfsMajorVersion) {
-    FS_TRACE_ERROR("minfs: FS major version: %08x. Driver major version: %08x\n",
-                   info->version_major, kMinfsMajorVersion);
+  if (info->version_major != kMinfsMajorVersion &&
+      info->version_major != kMinfsExtentsMajorVersion) {
+    FS_TRACE_ERROR("minfs: FS major version: %08x. Driver major versions: %08x, %08x\n",
+                   info->version_major, kMinfsMajorVersion, kMinfsExtentsMajorVersion);
     return ZX_ERR_NOT_SUPPORTED;
   }
   if (info->version_minor != kMinfsMinorVersion) {
@@ -796,6 +797,10 @@ zx_status_t Minfs::UpdateCleanBitAndOldestRevision(bool is_clean) {
   if (kMinfsRevision < Info().oldest_revision) {
     sb_->MutableInfo()->oldest_revision = kMinfsRevision;
   }
+  // Mark the filesystem as holding extent-mapped inodes before any can be created.
+  if (mount_options_.extent_mapped_files) {
+    sb_->MutableInfo()->version_major = kMinfsExtentsMajorVersion;
+  }
   UpdateFlags(transaction.get(), kMinfsFlagClean, is_clean);
   CommitTransaction(std::move(transaction));
   // Mount/unmount marks filesystem as dirty/clean. When we called UpdateFlags
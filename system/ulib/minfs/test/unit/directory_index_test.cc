@@ -0,0 +1,206 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "directory_index.h"
+
+#include <lib/sync/completion.h>
+#include <stdio.h>
+
+#include <block-client/cpp/fake-device.h>
+#include <fbl/string_printf.h>
+#include <minfs/format.h>
+#include <minfs/fsck.h>
+#include <zxtest/zxtest.h>
+
+#include "directory.h"
+#include "minfs_private.h"
+
+namespace minfs {
+namespace {
+
+using block_client::FakeBlockDevice;
+
+TEST(DirectoryIndexTest, FindEntries) {
+  DirectoryIndex index;
+  index.Update(0, DirentSize(1), ".");
+  index.Update(DirentSize(1), DirentSize(2), "..");
+  index.Update(DirentSize(1) + DirentSize(2), 100, "foo");
+  EXPECT_EQ(3, index.RecordCount());
+  EXPECT_EQ(3, index.EntryCount());
+
+  std::vector<size_t> offsets = index.Find("foo");
+  ASSERT_EQ(1, offsets.size());
+  EXPECT_EQ(DirentSize(1) + DirentSize(2), offsets[0]);
+  EXPECT_TRUE(index.Find("bar").empty());
+
+  EXPECT_EQ(0, index.PreviousOffset(0));
+  EXPECT_EQ(DirentSize(1), index.PreviousOffset(DirentSize(1) + DirentSize(2)));
+}
+
+TEST(DirectoryIndexTest, UpdateReplacesName) {
+  DirectoryIndex index;
+  index.Update(0, 64, "foo");
+  index.Update(0, 64, "bar");
+  EXPECT_TRUE(index.Find("foo").empty());
+  ASSERT_EQ(1, index.Find("bar").size());
+
+  // Freeing the record forgets the name but keeps the record.
+  index.Update(0, 64, fbl::StringPiece());
+  EXPECT_TRUE(index.Find("bar").empty());
+  EXPECT_EQ(1, index.RecordCount());
+  EXPECT_EQ(0, index.EntryCount());
+
+  index.Erase(0);
+  EXPECT_EQ(0, index.RecordCount());
+}
+
+TEST(DirectoryIndexTest, DuplicateNamesFoundInDirectoryOrder) {
+  DirectoryIndex index;
+  index.Update(200, 100, "foo");
+  index.Update(0, 100, "foo");
+  index.Update(100, 100, "bar");
+
+  std::vector<size_t> offsets = index.Find("foo");
+  ASSERT_EQ(2, offsets.size());
+  EXPECT_EQ(0, offsets[0]);
+  EXPECT_EQ(200, offsets[1]);
+}
+
+TEST(DirectoryIndexTest, FindSpaceIsFirstFit) {
+  DirectoryIndex index;
+  // A full entry, an entry with a little unused space, a free record and the open-ended last
+  // record.
+  index.Update(0, DirentSize(3), "foo");
+  index.Update(DirentSize(3), DirentSize(3) + DirentSize(1), "bar");
+  index.Update(2 * DirentSize(3) + DirentSize(1), DirentSize(8), fbl::StringPiece());
+  size_t last = 2 * DirentSize(3) + DirentSize(1) + DirentSize(8);
+  index.Update(last, kMinfsMaxDirectorySize - static_cast<uint32_t>(last), "baz");
+
+  size_t off;
+  ASSERT_TRUE(index.FindSpace(DirentSize(1), &off));
+  EXPECT_EQ(DirentSize(3), off);
+  ASSERT_TRUE(index.FindSpace(DirentSize(8), &off));
+  EXPECT_EQ(2 * DirentSize(3) + DirentSize(1), off);
+  ASSERT_TRUE(index.FindSpace(DirentSize(kMinfsMaxNameSize), &off));
+  EXPECT_EQ(last, off);
+
+  index.Update(last, DirentSize(3), "baz");
+  EXPECT_FALSE(index.FindSpace(DirentSize(kMinfsMaxNameSize), &off));
+}
+
+// Exercises the index through a directory large enough to be indexed.
+class LargeDirectoryTest : public zxtest::Test {
+ public:
+  static constexpr uint64_t kBlockCount = 1 << 15;
+  static constexpr int kEntryCount = 1000;
+
+  void SetUp() override {
+    auto device = std::make_unique<FakeBlockDevice>(kBlockCount, kMinfsBlockSize);
+    std::unique_ptr<Bcache> bcache;
+    ASSERT_OK(Bcache::Create(std::move(device), kBlockCount, &bcache));
+    ASSERT_OK(Mkfs(bcache.get()));
+    ASSERT_OK(Minfs::Create(std::move(bcache), MountOptions(), &fs_));
+
+    fbl::RefPtr<VnodeMinfs> root;
+    ASSERT_OK(fs_->VnodeGet(&root, kMinfsRootIno));
+    root_ = fbl::RefPtr<Directory>::Downcast(std::move(root));
+    for (int i = 0; i < kEntryCount; i++) {
+      ASSERT_NO_FAILURES(CreateEntry(Name(i)));
+    }
+    ASSERT_GE(root_->GetInode()->size, kMinfsDirectoryIndexMinSize);
+  }
+
+  void TearDown() override {
+    root_.reset();
+    sync_completion_t completion;
+    fs_->Sync([&completion](zx_status_t status) { sync_completion_signal(&completion); });
+    ASSERT_OK(sync_completion_wait(&completion, zx::duration::infinite().get()));
+    std::unique_ptr<Bcache> bcache = Minfs::Destroy(std::move(fs_));
+    ASSERT_OK(Fsck(std::move(bcache), FsckOptions()));
+  }
+
+  static fbl::String Name(int i) { return fbl::StringPrintf("entry-%d", i); }
+
+  void CreateEntry(const fbl::String& name) {
+    fbl::RefPtr<fs::Vnode> child;
+    ASSERT_OK(root_->Create(&child, name, 0));
+    ASSERT_OK(child->Close());
+  }
+
+  bool Exists(const fbl::String& name) {
+    fbl::RefPtr<fs::Vnode> child;
+    return root_->Lookup(&child, name) == ZX_OK;
+  }
+
+ protected:
+  std::unique_ptr<Minfs> fs_;
+  fbl::RefPtr<Directory> root_;
+};
+
+TEST_F(LargeDirectoryTest, LookupAfterCreate) {
+  for (int i = 0; i < kEntryCount; i++) {
+    EXPECT_TRUE(Exists(Name(i)), "%s", Name(i).c_str());
+  }
+  EXPECT_FALSE(Exists("missing"));
+
+  fbl::RefPtr<fs::Vnode> child;
+  EXPECT_EQ(ZX_ERR_ALREADY_EXISTS, root_->Create(&child, Name(0), 0));
+}
+
+TEST_F(LargeDirectoryTest, UnlinkAndReuseSpace) {
+  uint64_t size = root_->GetInode()->size;
+  for (int i = 0; i < kEntryCount; i += 2) {
+    ASSERT_OK(root_->Unlink(Name(i), false));
+  }
+  for (int i = 0; i < kEntryCount; i++) {
+    EXPECT_EQ(i % 2 != 0, Exists(Name(i)), "%s", Name(i).c_str());
+  }
+
+  // New entries no longer than the ones removed fit in the space they left.
+  for (int i = 0; i < kEntryCount; i += 2) {
+    ASSERT_NO_FAILURES(CreateEntry(fbl::StringPrintf("new-%d", i)));
+  }
+  EXPECT_EQ(size, root_->GetInode()->size);
+  for (int i = 0; i < kEntryCount; i += 2) {
+    EXPECT_TRUE(Exists(fbl::StringPrintf("new-%d", i)));
+  }
+}
+
+TEST_F(LargeDirectoryTest, UnlinkCoalescesNeighbours) {
+  // Removing a run of entries in an order which merges each with both neighbours.
+  for (int i = 100; i < 200; i += 2) {
+    ASSERT_OK(root_->Unlink(Name(i), false));
+  }
+  for (int i = 101; i < 200; i += 2) {
+    ASSERT_OK(root_->Unlink(Name(i), false));
+  }
+  for (int i = 0; i < kEntryCount; i++) {
+    EXPECT_EQ(i < 100 || i >= 200, Exists(Name(i)), "%s", Name(i).c_str());
+  }
+
+  // The tail of the directory can be removed and regrown.
+  for (int i = kEntryCount - 1; i >= kEntryCount - 10; i--) {
+    ASSERT_OK(root_->Unlink(Name(i), false));
+  }
+  for (int i = kEntryCount - 10; i < kEntryCount; i++) {
+    ASSERT_NO_FAILURES(CreateEntry(Name(i)));
+  }
+  for (int i = kEntryCount - 10; i < kEntryCount; i++) {
+    EXPECT_TRUE(Exists(Name(i)));
+  }
+}
+
+TEST_F(LargeDirectoryTest, Rename) {
+  ASSERT_OK(root_->Rename(root_, Name(10), "renamed", false, false));
+  EXPECT_FALSE(Exists(Name(10)));
+  EXPECT_TRUE(Exists("renamed"));
+
+  // Renaming over an existing entry replaces it.
+  ASSERT_OK(root_->Rename(root_, "renamed", Name(20), false, false));
+  EXPECT_FALSE(Exists("renamed"));
+  EXPECT_TRUE(Exists(Name(20)));
+}
+
+}  // namespace
+}  // namespace minfs
@@ -76,7 +76,8 @@ TEST(InspectorDiskStruct, GetInodeString) {
 	dirent_count: 0
 	last_inode: 0
 	next_inode: 0
-	rsvd: uint32_t[3] = { ... }
+	flags: 0
+	rsvd: uint32_t[2] = { ... }
 	dnum: uint32_t[16] = { ... }
 	inum: uint32_t[31] = { ... }
 	dinum: uint32_t[1] = { ... }
@@ -0,0 +1,274 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "extent_map.h"
+
+#include <lib/sync/completion.h>
+
+#include <limits>
+#include <vector>
+
+#include <block-client/cpp/fake-device.h>
+#include <minfs/format.h>
+#include <minfs/fsck.h>
+#include <zxtest/zxtest.h>
+
+#include "directory.h"
+#include "file.h"
+#include "minfs_private.h"
+
+namespace minfs {
+namespace {
+
+using block_client::FakeBlockDevice;
+
+Inode ExtentInode() {
+  Inode inode = {};
+  inode.flags = kMinfsInodeFlagExtents;
+  return inode;
+}
+
+TEST(ExtentMapTest, EmptyMapHasNoBlocks) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  EXPECT_EQ(0, extents.ExtentCount());
+  EXPECT_EQ(0, extents.BlockCount());
+  EXPECT_TRUE(extents.IsValid());
+
+  auto [block, count] = extents.Lookup(10);
+  EXPECT_EQ(0, block);
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), count);
+}
+
+TEST(ExtentMapTest, AppendingContiguousBlocksExtendsExtent) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  for (blk_t i = 0; i < 10; i++) {
+    ASSERT_OK(extents.Set(i, 100 + i));
+  }
+  EXPECT_EQ(1, extents.ExtentCount());
+  EXPECT_EQ(10, extents.BlockCount());
+
+  auto [block, count] = extents.Lookup(4);
+  EXPECT_EQ(104, block);
+  EXPECT_EQ(6, count);
+
+  // A block which is not contiguous on disk starts a new extent.
+  ASSERT_OK(extents.Set(10, 500));
+  EXPECT_EQ(2, extents.ExtentCount());
+  EXPECT_TRUE(extents.IsValid());
+}
+
+TEST(ExtentMapTest, SparseBlocksFillGaps) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  ASSERT_OK(extents.Set(5, 100));
+  EXPECT_EQ(2, extents.ExtentCount());
+  EXPECT_EQ(6, extents.BlockCount());
+
+  auto [block, count] = extents.Lookup(1);
+  EXPECT_EQ(0, block);
+  EXPECT_EQ(4, count);
+
+  // Filling the gap with blocks contiguous with the existing extent merges them all.
+  for (blk_t i = 0; i < 5; i++) {
+    ASSERT_OK(extents.Set(i, 95 + i));
+  }
+  EXPECT_EQ(1, extents.ExtentCount());
+  EXPECT_EQ(95, extents.Lookup(0).first);
+  EXPECT_EQ(6, extents.Lookup(0).second);
+}
+
+TEST(ExtentMapTest, ReplacingBlockSplitsExtent) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  for (blk_t i = 0; i < 10; i++) {
+    ASSERT_OK(extents.Set(i, 100 + i));
+  }
+  ASSERT_OK(extents.Set(4, 300));
+  EXPECT_EQ(3, extents.ExtentCount());
+  EXPECT_EQ(103, extents.Lookup(3).first);
+  EXPECT_EQ(300, extents.Lookup(4).first);
+  EXPECT_EQ(1, extents.Lookup(4).second);
+  EXPECT_EQ(105, extents.Lookup(5).first);
+
+  // Unmapping a block leaves a sparse extent in its place.
+  ASSERT_OK(extents.Set(4, 0));
+  EXPECT_EQ(3, extents.ExtentCount());
+  EXPECT_EQ(0, extents.Lookup(4).first);
+  EXPECT_EQ(10, extents.BlockCount());
+
+  // Unmapping the last block drops it altogether.
+  ASSERT_OK(extents.Set(9, 0));
+  EXPECT_EQ(9, extents.BlockCount());
+  EXPECT_TRUE(extents.IsValid());
+}
+
+TEST(ExtentMapTest, SetFailsWhenInodeIsFull) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  // Every other block leaves a sparse extent between mapped ones.
+  blk_t file_block = 0;
+  while (extents.ExtentCount() + 2 <= kMinfsInodeExtents) {
+    ASSERT_OK(extents.Set(file_block, 1000 + file_block));
+    file_block += 2;
+  }
+  ASSERT_EQ(kMinfsInodeExtents - 1, extents.ExtentCount());
+
+  Inode before = inode;
+  EXPECT_EQ(ZX_ERR_NO_SPACE, extents.Set(file_block, 1000 + file_block));
+  EXPECT_BYTES_EQ(&before, &inode, sizeof(inode));
+
+  // Filling a sparse extent merges it with its neighbours, which makes room again.
+  ASSERT_OK(extents.Set(1, 1001));
+  EXPECT_EQ(kMinfsInodeExtents - 3, extents.ExtentCount());
+}
+
+TEST(ExtentMapTest, Truncate) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  for (blk_t i = 0; i < 10; i++) {
+    ASSERT_OK(extents.Set(i, (i < 5 ? 100 : 200) + i));
+  }
+  ASSERT_EQ(2, extents.ExtentCount());
+
+  extents.Truncate(20);
+  EXPECT_EQ(10, extents.BlockCount());
+
+  extents.Truncate(7);
+  EXPECT_EQ(2, extents.ExtentCount());
+  EXPECT_EQ(7, extents.BlockCount());
+
+  extents.Truncate(5);
+  EXPECT_EQ(1, extents.ExtentCount());
+  EXPECT_EQ(5, extents.BlockCount());
+
+  extents.Truncate(0);
+  EXPECT_EQ(0, extents.ExtentCount());
+  EXPECT_TRUE(extents.IsValid());
+}
+
+TEST(ExtentMapTest, InvalidLayoutsAreRejected) {
+  Inode inode = ExtentInode();
+  ExtentMap extents(&inode);
+  ASSERT_OK(extents.Set(3, 100));
+
+  // A trailing sparse extent.
+  Inode trailing_hole = inode;
+  trailing_hole.dnum[5] = 5;
+  EXPECT_FALSE(ExtentMap(&trailing_hole).IsValid());
+
+  // Data in an unused slot.
+  Inode unused_slot = inode;
+  unused_slot.dinum[0] = 100;
+  EXPECT_FALSE(ExtentMap(&unused_slot).IsValid());
+}
+
+// Exercises extent-mapped files through a filesystem mounted to create them.
+class ExtentMappedFileTest : public zxtest::Test {
+ public:
+  static constexpr uint64_t kBlockCount = 1 << 15;
+
+  void SetUp() override {
+    auto device = std::make_unique<FakeBlockDevice>(kBlockCount, kMinfsBlockSize);
+    std::unique_ptr<Bcache> bcache;
+    ASSERT_OK(Bcache::Create(std::move(device), kBlockCount, &bcache));
+    ASSERT_OK(Mkfs(bcache.get()));
+    MountOptions options;
+    options.extent_mapped_files = true;
+    ASSERT_OK(Minfs::Create(std::move(bcache), options, &fs_));
+
+    fbl::RefPtr<VnodeMinfs> root;
+    ASSERT_OK(fs_->VnodeGet(&root, kMinfsRootIno));
+    root_ = fbl::RefPtr<Directory>::Downcast(std::move(root));
+
+    fbl::RefPtr<fs::Vnode> file;
+    ASSERT_OK(root_->Create(&file, "file", 0));
+    file_ = fbl::RefPtr<File>::Downcast(std::move(file));
+    ASSERT_TRUE(file_->IsExtentMapped());
+  }
+
+  void TearDown() override {
+    if (file_) {
+      ASSERT_OK(file_->Close());
+      file_.reset();
+    }
+    root_.reset();
+    sync_completion_t completion;
+    fs_->Sync([&completion](zx_status_t status) { sync_completion_signal(&completion); });
+    ASSERT_OK(sync_completion_wait(&completion, zx::duration::infinite().get()));
+    std::unique_ptr<Bcache> bcache = Minfs::Destroy(std::move(fs_));
+    ASSERT_OK(Fsck(std::move(bcache), FsckOptions()));
+  }
+
+  void WriteBlock(size_t file_block, uint8_t value) {
+    std::vector<uint8_t> data(kMinfsBlockSize, value);
+    size_t actual;
+    ASSERT_OK(file_->Write(data.data(), data.size(), file_block * kMinfsBlockSize, &actual));
+    ASSERT_EQ(data.size(), actual);
+  }
+
+  void CheckBlock(size_t file_block, uint8_t value) {
+    std::vector<uint8_t> data(kMinfsBlockSize);
+    size_t actual;
+    ASSERT_OK(file_->Read(data.data(), data.size(), file_block * kMinfsBlockSize, &actual));
+    ASSERT_EQ(data.size(), actual);
+    std::vector<uint8_t> expected(kMinfsBlockSize, value);
+    EXPECT_BYTES_EQ(expected.data(), data.data(), data.size());
+  }
+
+  size_t ExtentCount() {
+    Inode inode = *file_->GetInode();
+    return ExtentMap(&inode).ExtentCount();
+  }
+
+ protected:
+  std::unique_ptr<Minfs> fs_;
+  fbl::RefPtr<Directory> root_;
+  fbl::RefPtr<File> file_;
+};
+
+TEST_F(ExtentMappedFileTest, SequentialWriteUsesFewExtents) {
+  for (size_t i = 0; i < 64; i++) {
+    ASSERT_NO_FAILURES(WriteBlock(i, static_cast<uint8_t>(i)));
+  }
+  EXPECT_TRUE(file_->IsExtentMapped());
+  EXPECT_LE(ExtentCount(), 2);
+  for (size_t i = 0; i < 64; i++) {
+    ASSERT_NO_FAILURES(CheckBlock(i, static_cast<uint8_t>(i)));
+  }
+}
+
+TEST_F(ExtentMappedFileTest, TruncateFreesBlocks) {
+  for (size_t i = 0; i < 16; i++) {
+    ASSERT_NO_FAILURES(WriteBlock(i, 0xab));
+  }
+  ASSERT_OK(file_->Truncate(4 * kMinfsBlockSize + 10));
+  EXPECT_TRUE(file_->IsExtentMapped());
+  EXPECT_EQ(5, file_->GetInode()->block_count);
+  ASSERT_NO_FAILURES(CheckBlock(3, 0xab));
+
+  ASSERT_OK(file_->Truncate(0));
+  EXPECT_EQ(0, file_->GetInode()->block_count);
+  EXPECT_EQ(0, ExtentCount());
+}
+
+TEST_F(ExtentMappedFileTest, FragmentedFileConvertsToBlockPointers) {
+  // Writing every other block needs two extents per write.
+  constexpr size_t kWrites = kMinfsInodeExtents;
+  for (size_t i = 0; i < kWrites; i++) {
+    ASSERT_NO_FAILURES(WriteBlock(2 * i, static_cast<uint8_t>(i + 1)));
+  }
+  EXPECT_FALSE(file_->IsExtentMapped());
+  EXPECT_EQ(kWrites, file_->GetInode()->block_count);
+  for (size_t i = 0; i < kWrites; i++) {
+    ASSERT_NO_FAILURES(CheckBlock(2 * i, static_cast<uint8_t>(i + 1)));
+    if (i + 1 < kWrites) {
+      ASSERT_NO_FAILURES(CheckBlock(2 * i + 1, 0));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace minfs
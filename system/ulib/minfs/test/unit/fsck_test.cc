@@ -274,6 +274,43 @@ TEST_F(ConsistencyCheckerFixtureVerbose, MissingDotDotEntry) {
   ASSERT_NOT_OK(Fsck(std::move(bcache), FsckOptions{ .repair = true }, &bcache));
 }
 
+TEST_F(ConsistencyCheckerFixtureVerbose, DuplicateDirectoryEntry) {
+  CreateAndWrite("foo", 0, 0, 0);
+  CreateAndWrite("bar", 0, 0, 0);
+
+  blk_t root_dir_block;
+  {
+    fbl::RefPtr<VnodeMinfs> root;
+    EXPECT_OK(fs().VnodeGet(&root, kMinfsRootIno));
+    root_dir_block = root->GetInode()->dnum[0] + fs().Info().dat_block;
+  }
+  std::unique_ptr<Bcache> bcache;
+  destroy_fs(&bcache);
+
+  // Need this buffer to be a full block.
+  DirentBuffer<kMinfsBlockSize> dirent_buffer;
+  ASSERT_OK(bcache->Readblk(root_dir_block, dirent_buffer.raw));
+
+  // Rename "bar" to "foo" behind the filesystem's back.
+  bool renamed = false;
+  for (size_t off = 0; off + kMinfsDirentSize < kMinfsBlockSize;) {
+    Dirent* de = reinterpret_cast<Dirent*>(&dirent_buffer.raw[off]);
+    if (fbl::StringPiece(de->name, de->namelen) == "bar") {
+      memcpy(de->name, "foo", 3);
+      renamed = true;
+      break;
+    }
+    if (de->reclen & kMinfsReclenLast) {
+      break;
+    }
+    off += MinfsReclen(de, off);
+  }
+  ASSERT_TRUE(renamed);
+  ASSERT_OK(bcache->Writeblk(root_dir_block, dirent_buffer.raw));
+
+  ASSERT_NOT_OK(Fsck(std::move(bcache), FsckOptions{ .repair = false }, &bcache));
+}
+
 void CreateUnlinkedDirectoryWithEntry(
     std::unique_ptr<Minfs> fs, std::unique_ptr<Bcache>* bcache_out) {
   ino_t ino;
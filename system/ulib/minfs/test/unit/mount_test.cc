@@ -41,5 +41,54 @@ TEST(MountTest, OldestRevisionUpdatedOnMount) {
   ASSERT_EQ(kMinfsRevision, superblock.oldest_revision);
 }
 
+TEST(MountTest, ExtentMappedFilesUpdateMajorVersion) {
+  auto device = std::make_unique<FakeBlockDevice>(kBlockCount, kBlockSize);
+  std::unique_ptr<Bcache> bcache;
+  ASSERT_OK(Bcache::Create(std::move(device), kBlockCount, &bcache));
+  ASSERT_OK(Mkfs(bcache.get()));
+  Superblock superblock = {};
+  ASSERT_OK(LoadSuperblock(bcache.get(), &superblock));
+  ASSERT_EQ(kMinfsMajorVersion, superblock.version_major);
+
+  // A mount which cannot create extent-mapped files leaves the filesystem mountable by drivers
+  // which predate them.
+  MountOptions options = {};
+  std::unique_ptr<Minfs> fs;
+  ASSERT_OK(Minfs::Create(std::move(bcache), options, &fs));
+  bcache = Minfs::Destroy(std::move(fs));
+  ASSERT_OK(LoadSuperblock(bcache.get(), &superblock));
+  EXPECT_EQ(kMinfsMajorVersion, superblock.version_major);
+
+  options.extent_mapped_files = true;
+  ASSERT_OK(Minfs::Create(std::move(bcache), options, &fs));
+  bcache = Minfs::Destroy(std::move(fs));
+  ASSERT_OK(LoadSuperblock(bcache.get(), &superblock));
+  EXPECT_EQ(kMinfsExtentsMajorVersion, superblock.version_major);
+
+  // The filesystem can still be mounted without extent-mapped files, and stays marked.
+  options.extent_mapped_files = false;
+  ASSERT_OK(Minfs::Create(std::move(bcache), options, &fs));
+  bcache = Minfs::Destroy(std::move(fs));
+  ASSERT_OK(LoadSuperblock(bcache.get(), &superblock));
+  EXPECT_EQ(kMinfsExtentsMajorVersion, superblock.version_major);
+}
+
+TEST(MountTest, UnknownMajorVersionIsRejected) {
+  auto device = std::make_unique<FakeBlockDevice>(kBlockCount, kBlockSize);
+  std::unique_ptr<Bcache> bcache;
+  ASSERT_OK(Bcache::Create(std::move(device), kBlockCount, &bcache));
+  ASSERT_OK(Mkfs(bcache.get()));
+  Superblock superblock = {};
+  ASSERT_OK(LoadSuperblock(bcache.get(), &superblock));
+
+  superblock.version_major = kMinfsExtentsMajorVersion + 1;
+  UpdateChecksum(&superblock);
+  ASSERT_OK(bcache->Writeblk(kSuperblockStart, &superblock));
+
+  MountOptions options = {};
+  std::unique_ptr<Minfs> fs;
+  EXPECT_EQ(ZX_ERR_NOT_SUPPORTED, Minfs::Create(std::move(bcache), options, &fs));
+}
+
 }  // namespace
 }  // namespace mifns
@@ -29,6 +29,7 @@
 #endif
 
 #include "directory.h"
+#include "extent_map.h"
 #include "file.h"
 #include "minfs_private.h"
 #include "unowned_vmo_buffer.h"
@@ -72,6 +73,9 @@ void VnodeMinfs::InodeSync(PendingWork* transaction, uint32_t flags) {
 // Delete all blocks (relative to a file) from "start" (inclusive) to the end of
 // the file. Does not update mtime/atime.
 zx_status_t VnodeMinfs::BlocksShrink(PendingWork* transaction, blk_t start) {
+  if (IsExtentMapped()) {
+    return ExtentBlocksShrink(transaction, start);
+  }
   VnodeMapper mapper(this);
   VnodeIterator iterator;
   zx_status_t status = iterator.Init(&mapper, transaction, start);
@@ -115,6 +119,24 @@ zx_status_t VnodeMinfs::BlocksShrink(PendingWork* transaction, blk_t start) {
   return ZX_OK;
 }
 
+// Unmapping blocks one at a time, as BlocksShrink does, could split an extent before the rest of it
+// is unmapped, so the extents are cut in one go once their blocks have been deleted.
+zx_status_t VnodeMinfs::ExtentBlocksShrink(PendingWork* transaction, blk_t start) {
+  ExtentMap extents(&inode_);
+  uint64_t file_block = start;
+  while (file_block < extents.BlockCount()) {
+    auto [block, count] = extents.Lookup(file_block);
+    for (uint64_t i = 0; block != 0 && i < count; ++i) {
+      DeleteBlock(transaction, static_cast<blk_t>(file_block + i), static_cast<blk_t>(block + i),
+                  /*indirect=*/false);
+    }
+    file_block += count;
+  }
+  extents.Truncate(start);
+  InodeSync(transaction, kMxFsSyncDefault);
+  return ZX_OK;
+}
+
 zx::status<LazyBuffer*> VnodeMinfs::GetIndirectFile() {
   if (!indirect_file_) {
     zx::status<std::unique_ptr<LazyBuffer>> buffer =
@@ -597,6 +619,10 @@ void VnodeMinfs::Allocate(Minfs* fs, uint32_t type, fbl::RefPtr<VnodeMinfs>* out
     (*out)->inode_.dirent_count = 2;
   } else {
     (*out)->inode_.link_count = 1;
+    if (fs->mount_options().extent_mapped_files &&
+        fs->Info().version_major == kMinfsExtentsMajorVersion) {
+      (*out)->inode_.flags = kMinfsInodeFlagExtents;
+    }
   }
 }
 
@@ -210,6 +210,10 @@ class VnodeMinfs : public fs::Vnode,
   // bnos
   zx_status_t BlocksShrink(PendingWork* transaction, blk_t start);
 
+  // Returns true if the vnode's blocks are mapped by the extents in its inode rather than by block
+  // pointers.
+  bool IsExtentMapped() const { return (inode_.flags & kMinfsInodeFlagExtents) != 0; }
+
   // TODO(smklein): These operations and members are protected as a historical artifact
   // of "File + Directory + Vnode" being a single class. They should be transitioned to
   // private.
@@ -245,6 +249,9 @@ class VnodeMinfs : public fs::Vnode,
   // Does not allocate any blocks, direct or indirect, to acquire this block.
   zx_status_t BlockGetReadable(blk_t n, blk_t* bno);
 
+  // The implementation of |BlocksShrink| for extent-mapped vnodes.
+  zx_status_t ExtentBlocksShrink(PendingWork* transaction, blk_t start);
+
   // Deletes this Vnode from disk, freeing the inode and blocks.
   //
   // Must only be called on Vnodes which
@@ -6,6 +6,7 @@
 
 #include <fs/trace.h>
 
+#include "extent_map.h"
 #include "lazy_buffer.h"
 #include "minfs_private.h"
 #include "vnode.h"
@@ -271,6 +272,13 @@ zx_status_t VnodeIterator::Init(VnodeMapper* mapper, PendingWork* transaction,
   transaction_ = transaction;
   file_block_ = file_block;
   contiguous_block_count_ = 0;
+  extents_ = mapper->vnode().IsExtentMapped();
+  extents_dirty_ = false;
+  if (extents_) {
+    // The extents are in the inode, so there are no levels to set up.
+    level_count_ = 0;
+    return file_block <= VnodeMapper::kMaxBlocks ? ZX_OK : ZX_ERR_OUT_OF_RANGE;
+  }
   // The file block determines the number of levels of views that we need, and the view-getters
   // that we need to use.
   if (file_block < VnodeMapper::kIndirectFileStartBlock) {
@@ -366,8 +374,22 @@ zx_status_t VnodeIterator::SetBlk(Level* level, blk_t block) {
   return ZX_OK;
 }
 
+blk_t VnodeIterator::ExtentBlk() const {
+  return ExtentMap(mapper_->vnode().GetMutableInode()).Lookup(file_block_).first;
+}
+
+zx_status_t VnodeIterator::SetExtentBlk(blk_t block) {
+  ZX_ASSERT(file_block_ < VnodeMapper::kMaxBlocks);
+  zx_status_t status = ExtentMap(mapper_->vnode().GetMutableInode()).Set(file_block_, block);
+  if (status != ZX_OK)
+    return status;
+  extents_dirty_ = true;
+  contiguous_block_count_ = 0;
+  return ZX_OK;
+}
+
 uint64_t VnodeIterator::GetContiguousBlockCount(uint64_t max_blocks) const {
-  if (level_count_ == 0)
+  if (level_count_ == 0 && !extents_)
     return 0;
   if (contiguous_block_count_ == 0)
     contiguous_block_count_ = ComputeContiguousBlockCount();
@@ -375,6 +397,10 @@ uint64_t VnodeIterator::GetContiguousBlockCount(uint64_t max_blocks) const {
 }
 
 uint64_t VnodeIterator::ComputeContiguousBlockCount() const {
+  if (extents_) {
+    return std::min(ExtentMap(mapper_->vnode().GetMutableInode()).Lookup(file_block_).second,
+                    VnodeMapper::kMaxBlocks - file_block_);
+  }
   // For efficiency reasons, handle sparse ranges differently. This is so we can quickly scan the
   // (typically) unallocated/sparse blocks from the end of the file.
   if (Blk() == 0) {
@@ -457,6 +483,13 @@ zx_status_t VnodeIterator::FlushLevel(int level) {
 zx_status_t VnodeIterator::Flush() {
   if (!transaction_)
     return ZX_OK;  // Iterator is read-only.
+  if (extents_) {
+    if (extents_dirty_) {
+      mapper_->vnode().InodeSync(transaction_, kMxFsSyncDefault);
+      extents_dirty_ = false;
+    }
+    return ZX_OK;
+  }
   for (int level = 0; level < level_count_; ++level) {
     zx_status_t status = FlushLevel(level);
     if (status != ZX_OK)
@@ -466,6 +499,18 @@ zx_status_t VnodeIterator::Flush() {
 }
 
 zx_status_t VnodeIterator::Advance(const uint64_t advance) {
+  if (extents_) {
+    // The extents are looked up afresh for each block, so there is nothing to flush.
+    if (advance > VnodeMapper::kMaxBlocks - file_block_)
+      return ZX_ERR_BAD_STATE;
+    file_block_ += advance;
+    if (advance >= contiguous_block_count_) {
+      contiguous_block_count_ = 0;
+    } else {
+      contiguous_block_count_ -= advance;
+    }
+    return ZX_OK;
+  }
   if (level_count_ == 0) {
     return advance == 0 ? ZX_OK : ZX_ERR_BAD_STATE;
   }
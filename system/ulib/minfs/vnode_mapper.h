@@ -74,7 +74,8 @@ class VnodeMapper : public MapperInterface {
 };
 
 // Iterator that keeps track of block pointers for a given file block. Depending on the file
-// block, there can be up to three levels of block pointers.
+// block, there can be up to three levels of block pointers. For extent-mapped vnodes there are no
+// levels, and the iterator reads and updates the extents in the inode instead.
 //
 // Example use, reading a range of blocks:
 //
@@ -119,12 +120,16 @@ class VnodeIterator {
 
   // Returns the target block as a blk_t. Zero is special and means the block is unmapped/sparse.
   blk_t Blk() const {
+    if (extents_)
+      return ExtentBlk();
     return level_count_ > 0 && levels_[0].remaining() > 0 ? levels_[0].blk() : 0;
   }
 
   // Sets the target block. The iterator will need to be flushed after calling this (by calling the
   // Flush method).
-  [[nodiscard]] zx_status_t SetBlk(blk_t block) { return SetBlk(&levels_[0], block); }
+  [[nodiscard]] zx_status_t SetBlk(blk_t block) {
+    return extents_ ? SetExtentBlk(block) : SetBlk(&levels_[0], block);
+  }
 
   // Returns the length in blocks of a contiguous range at most |max_blocks|. For
   // efficiency/simplicity reasons, it might return fewer than there actually are.
@@ -189,6 +194,10 @@ class VnodeIterator {
   // Sets a block pointer in the given level.
   zx_status_t SetBlk(Level* level, blk_t block);
 
+  // The equivalents of Blk and SetBlk for extent-mapped vnodes.
+  blk_t ExtentBlk() const;
+  zx_status_t SetExtentBlk(blk_t block);
+
   // The owning mapper.
   VnodeMapper* mapper_ = nullptr;
   // A transaction to be used for allocations, or nullptr if read-only.
@@ -201,6 +210,10 @@ class VnodeIterator {
   int level_count_ = 0;
   // The level information.
   std::array<Level, kMaxLevels> levels_;
+  // True if the vnode is extent-mapped, in which case there are no levels.
+  bool extents_ = false;
+  // True if the extents have been changed since the inode was last synced.
+  bool extents_dirty_ = false;
 };
 
 }  // namespace minfs
@@ -7,6 +7,7 @@
 
 #include <lib/zx/handle.h>
 #include <lib/zx/object.h>
+#include <lib/zx/vmo.h>
 
 namespace zx {
 
@@ -38,6 +39,10 @@ class fifo final : public object<fifo> {
   zx_status_t read(size_t elem_size, void* buffer, size_t count, size_t* actual_count) const {
     return zx_fifo_read(get(), elem_size, buffer, count, actual_count);
   }
+
+  zx_status_t get_vmo(uint32_t options, vmo* result) const {
+    return zx_fifo_get_vmo(get(), options, result->reset_and_get_address());
+  }
 };
 
 using unowned_fifo = unowned<fifo>;
@@ -5,6 +5,7 @@
 #include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <iterator>
 #include <limits>
 #include <set>
 #include <vector>
@@ -23,6 +24,7 @@
 #include <lib/zx/object.h>
 #include <zircon/compiler.h>
 #include <zircon/errors.h>
+#include <zircon/limits.h>
 #include <zircon/rights.h>
 #include <zircon/types.h>
 
@@ -1370,5 +1372,50 @@ TEST(ChannelTest, ReadAndWriteWithMultipleSizes) {
   }
 }
 
+TEST(ChannelTest, WriteIovecGathersInOrder) {
+  zx::channel local;
+  zx::channel remote;
+  ASSERT_OK(zx::channel::create(0, &local, &remote));
+
+  std::vector<uint8_t> payload(3 * ZX_PAGE_SIZE + 17);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<uint8_t>(i * 7);
+  }
+  // Uneven pieces, including an empty one, that straddle page boundaries in the kernel.
+  const size_t kSplits[] = {0, 1, ZX_PAGE_SIZE - 2, ZX_PAGE_SIZE - 2, 2 * ZX_PAGE_SIZE + 9,
+                            payload.size()};
+  zx_iovec_t iovecs[std::size(kSplits) - 1];
+  for (size_t i = 0; i < std::size(iovecs); ++i) {
+    iovecs[i] = zx_iovec_t{.buffer = payload.data() + kSplits[i],
+                           .capacity = static_cast<uint32_t>(kSplits[i + 1] - kSplits[i])};
+  }
+  ASSERT_OK(local.write(ZX_CHANNEL_WRITE_USE_IOVEC, iovecs, std::size(iovecs), nullptr, 0));
+
+  std::vector<uint8_t> read_data(payload.size());
+  uint32_t actual_bytes = 0;
+  uint32_t actual_handles = 0;
+  ASSERT_OK(remote.read(0, read_data.data(), nullptr, static_cast<uint32_t>(read_data.size()), 0,
+                        &actual_bytes, &actual_handles));
+  ASSERT_EQ(payload.size(), actual_bytes);
+  ASSERT_BYTES_EQ(payload.data(), read_data.data(), payload.size());
+}
+
+TEST(ChannelTest, WriteIovecTooManyOrTooLargeFails) {
+  zx::channel local;
+  zx::channel remote;
+  ASSERT_OK(zx::channel::create(0, &local, &remote));
+
+  uint8_t byte = 0;
+  zx_iovec_t iovecs[ZX_CHANNEL_MAX_MSG_IOVECS + 1];
+  for (auto& iovec : iovecs) {
+    iovec = zx_iovec_t{.buffer = &byte, .capacity = 1};
+  }
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE,
+            local.write(ZX_CHANNEL_WRITE_USE_IOVEC, iovecs, std::size(iovecs), nullptr, 0));
+
+  iovecs[0].capacity = ZX_CHANNEL_MAX_MSG_BYTES + 1;
+  EXPECT_EQ(ZX_ERR_OUT_OF_RANGE, local.write(ZX_CHANNEL_WRITE_USE_IOVEC, iovecs, 1, nullptr, 0));
+}
+
 }  // namespace
 }  // namespace channel
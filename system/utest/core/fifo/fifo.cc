@@ -2,7 +2,17 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <inttypes.h>
+#include <lib/fzl/shared-fifo-ring.h>
+#include <lib/zx/clock.h>
 #include <lib/zx/fifo.h>
+#include <lib/zx/vmo.h>
+#include <zircon/syscalls/fifo.h>
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
 #include <zxtest/zxtest.h>
 
 namespace {
@@ -238,4 +248,176 @@ TEST(FifoTest, EndpointCloseSignalsPeerClosed) {
   ASSERT_EQ(fifo_b.signal_peer(0u, ZX_USER_SIGNAL_0), ZX_ERR_PEER_CLOSED);
 }
 
+TEST(FifoTest, SharedRingOptionIsValidated) {
+  zx::fifo fifo_a, fifo_b;
+  EXPECT_EQ(zx::fifo::create(8, kElementSize, ZX_FIFO_SHARED_RING << 1, &fifo_a, &fifo_b),
+            ZX_ERR_INVALID_ARGS);
+
+  // Plain fifos have no rings to hand out.
+  ASSERT_OK(zx::fifo::create(8, kElementSize, 0, &fifo_a, &fifo_b));
+  zx::vmo vmo;
+  EXPECT_EQ(fifo_a.get_vmo(0u, &vmo), ZX_ERR_BAD_STATE);
+
+  ASSERT_OK(zx::fifo::create(8, kElementSize, ZX_FIFO_SHARED_RING, &fifo_a, &fifo_b));
+  EXPECT_EQ(fifo_a.get_vmo(1u, &vmo), ZX_ERR_INVALID_ARGS);
+  ASSERT_OK(fifo_a.get_vmo(0u, &vmo));
+  uint64_t size;
+  ASSERT_OK(vmo.get_size(&size));
+  EXPECT_EQ(size, ZX_FIFO_RING_VMO_SIZE);
+
+  // The rings stay committed for as long as the fifo lives.
+  EXPECT_EQ(vmo.op_range(ZX_VMO_OP_DECOMMIT, 0, ZX_FIFO_RING_VMO_SIZE, nullptr, 0),
+            ZX_ERR_BAD_STATE);
+
+  // Elements only move through the rings.
+  ElementType element = 1u;
+  size_t actual_count;
+  EXPECT_EQ(fifo_a.write(kElementSize, &element, 1, &actual_count), ZX_ERR_BAD_STATE);
+  EXPECT_EQ(fifo_a.read(kElementSize, &element, 1, &actual_count), ZX_ERR_BAD_STATE);
+}
+
+TEST(FifoTest, SharedRingDoorbellUpdatesSignals) {
+  zx::fifo fifo_a, fifo_b;
+  ASSERT_OK(zx::fifo::create(4, kElementSize, ZX_FIFO_SHARED_RING, &fifo_a, &fifo_b));
+  EXPECT_SIGNALS(fifo_a, ZX_FIFO_WRITABLE);
+  EXPECT_SIGNALS(fifo_b, ZX_FIFO_WRITABLE);
+
+  zx::fifo peer_a, peer_b;
+  ASSERT_OK(fifo_a.duplicate(ZX_RIGHT_SAME_RIGHTS, &peer_a));
+  ASSERT_OK(fifo_b.duplicate(ZX_RIGHT_SAME_RIGHTS, &peer_b));
+  fzl::SharedFifoRing<ElementType> ring_a, ring_b;
+  ASSERT_OK(ring_a.Init(std::move(peer_a), 4));
+  ASSERT_OK(ring_b.Init(std::move(peer_b), 4));
+
+  // Filling an empty ring rings the doorbell; filling a non-empty one does not need to.
+  ElementType expected_elements[] = {1, 2, 3, 4, 5};
+  ASSERT_EQ(ring_a.Write(expected_elements, 1), 1u);
+  EXPECT_SIGNALS(fifo_b, ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+  ASSERT_EQ(ring_a.Write(expected_elements + 1, 4), 3u);
+  ASSERT_OK(fifo_a.read(kElementSize, nullptr, 0, nullptr));
+  EXPECT_SIGNALS(fifo_a, 0u);
+
+  // Draining a full ring rings the doorbell.
+  ElementType actual_elements[4] = {};
+  ASSERT_EQ(ring_b.Read(actual_elements, 2), 2u);
+  EXPECT_EQ(actual_elements[0], 1u);
+  EXPECT_EQ(actual_elements[1], 2u);
+  EXPECT_SIGNALS(fifo_a, ZX_FIFO_WRITABLE);
+  ASSERT_EQ(ring_b.Read(actual_elements, 4), 2u);
+  EXPECT_EQ(actual_elements[0], 3u);
+  EXPECT_EQ(actual_elements[1], 4u);
+  ASSERT_OK(fifo_b.write(kElementSize, nullptr, 0, nullptr));
+  EXPECT_SIGNALS(fifo_b, ZX_FIFO_WRITABLE);
+}
+
+// Moves |count| elements from |writer| to |reader| in batches of |batch| and returns the time it
+// took, or a negative duration if the elements arrived out of order.
+template <typename WriteFn, typename ReadFn>
+zx::duration Transfer(uint64_t count, size_t batch, WriteFn write, ReadFn read) {
+  const zx::time start = zx::clock::get_monotonic();
+  std::thread writer([count, batch, &write] {
+    ElementType elements[64];
+    uint64_t sent = 0;
+    while (sent < count) {
+      const size_t n = std::min<uint64_t>(batch, count - sent);
+      for (size_t i = 0; i < n; i++) {
+        elements[i] = sent + i;
+      }
+      size_t actual = 0;
+      if (!write(elements, n, &actual)) {
+        return;
+      }
+      sent += actual;
+    }
+  });
+
+  bool ordered = true;
+  ElementType elements[64];
+  uint64_t received = 0;
+  while (received < count) {
+    size_t actual = 0;
+    if (!read(elements, batch, &actual)) {
+      break;
+    }
+    for (size_t i = 0; i < actual; i++) {
+      ordered = ordered && (elements[i] == received + i);
+    }
+    received += actual;
+  }
+  writer.join();
+  const zx::duration elapsed = zx::clock::get_monotonic() - start;
+  return (ordered && received == count) ? elapsed : zx::duration(-1);
+}
+
+TEST(FifoTest, SharedRingPreservesOrderAcrossThreads) {
+  zx::fifo fifo_a, fifo_b;
+  ASSERT_OK(zx::fifo::create(16, kElementSize, ZX_FIFO_SHARED_RING, &fifo_a, &fifo_b));
+  fzl::SharedFifoRing<ElementType> ring_a, ring_b;
+  ASSERT_OK(ring_a.Init(std::move(fifo_a), 16));
+  ASSERT_OK(ring_b.Init(std::move(fifo_b), 16));
+
+  const zx::duration elapsed = Transfer(
+      100000, 7,
+      [&ring_a](const ElementType* elements, size_t count, size_t* actual) {
+        *actual = ring_a.Write(elements, count);
+        return *actual != 0 || ring_a.WaitWritable() == ZX_OK;
+      },
+      [&ring_b](ElementType* elements, size_t count, size_t* actual) {
+        *actual = ring_b.Read(elements, count);
+        return *actual != 0 || ring_b.WaitReadable() == ZX_OK;
+      });
+  EXPECT_GE(elapsed.get(), 0);
+}
+
+TEST(FifoTest, SharedRingThroughput) {
+  constexpr uint64_t kCount = 1 << 22;
+  constexpr uint32_t kElementCount = 64;
+
+  for (size_t batch = 1; batch <= kElementCount; batch *= 4) {
+    zx::fifo fifo_a, fifo_b;
+    ASSERT_OK(zx::fifo::create(kElementCount, kElementSize, 0, &fifo_a, &fifo_b));
+    const zx::duration copy_elapsed = Transfer(
+        kCount, batch,
+        [&fifo_a](const ElementType* elements, size_t count, size_t* actual) {
+          zx_status_t status = fifo_a.write(kElementSize, elements, count, actual);
+          if (status == ZX_ERR_SHOULD_WAIT) {
+            *actual = 0;
+            status = fifo_a.wait_one(ZX_FIFO_WRITABLE | ZX_FIFO_PEER_CLOSED, zx::time::infinite(),
+                                     nullptr);
+          }
+          return status == ZX_OK;
+        },
+        [&fifo_b](ElementType* elements, size_t count, size_t* actual) {
+          zx_status_t status = fifo_b.read(kElementSize, elements, count, actual);
+          if (status == ZX_ERR_SHOULD_WAIT) {
+            *actual = 0;
+            status = fifo_b.wait_one(ZX_FIFO_READABLE | ZX_FIFO_PEER_CLOSED, zx::time::infinite(),
+                                     nullptr);
+          }
+          return status == ZX_OK;
+        });
+    ASSERT_GE(copy_elapsed.get(), 0);
+
+    ASSERT_OK(zx::fifo::create(kElementCount, kElementSize, ZX_FIFO_SHARED_RING, &fifo_a, &fifo_b));
+    fzl::SharedFifoRing<ElementType> ring_a, ring_b;
+    ASSERT_OK(ring_a.Init(std::move(fifo_a), kElementCount));
+    ASSERT_OK(ring_b.Init(std::move(fifo_b), kElementCount));
+    const zx::duration ring_elapsed = Transfer(
+        kCount, batch,
+        [&ring_a](const ElementType* elements, size_t count, size_t* actual) {
+          *actual = ring_a.Write(elements, count);
+          return *actual != 0 || ring_a.WaitWritable() == ZX_OK;
+        },
+        [&ring_b](ElementType* elements, size_t count, size_t* actual) {
+          *actual = ring_b.Read(elements, count);
+          return *actual != 0 || ring_b.WaitReadable() == ZX_OK;
+        });
+    ASSERT_GE(ring_elapsed.get(), 0);
+
+    printf("batch %zu: copy %" PRIu64 " ops/sec, shared ring %" PRIu64 " ops/sec\n", batch,
+           kCount * ZX_SEC(1) / std::max<int64_t>(copy_elapsed.get(), 1),
+           kCount * ZX_SEC(1) / std::max<int64_t>(ring_elapsed.get(), 1));
+  }
+}
+
 }  // namespace
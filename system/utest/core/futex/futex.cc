@@ -21,6 +21,9 @@
 #include <ctime>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <fbl/algorithm.h>
 #include <fbl/auto_call.h>
@@ -601,5 +604,68 @@ TEST(FutexTest, EventSignaling) {
   log("signal_thread 3 joined\n");
 }
 
+// Measures futex wait/wake round trips per second for an increasing number of
+// independent pairs of threads, each pair ping-ponging on its own futex.  The
+// pairs share nothing except their process' futex table, so the aggregate
+// throughput should grow with the number of pairs instead of being limited by
+// a single process-wide lock.
+TEST(FutexTest, UnrelatedFutexThroughput) {
+  constexpr zx::duration kRunTime = zx::msec(200);
+  constexpr zx::duration kPollInterval = zx::msec(10);
+  constexpr size_t kPairCounts[] = {1, 2, 4, 8};
+
+  // Keep each pair's futex on its own cache line so that the only thing the
+  // pairs can contend on is the kernel.
+  struct alignas(64) Pair {
+    std::atomic<zx_futex_t> turn{0};
+    uint64_t round_trips = 0;
+  };
+
+  for (size_t pair_count : kPairCounts) {
+    std::unique_ptr<Pair[]> pairs(new Pair[pair_count]);
+    std::atomic<bool> stop{false};
+
+    // Side 0 runs when |turn| is 0 and hands the turn to side 1, and vice versa.
+    auto play = [&stop](Pair* pair, zx_futex_t side) {
+      zx_futex_t* futex = reinterpret_cast<zx_futex_t*>(&pair->turn);
+      while (true) {
+        zx_futex_t turn;
+        while ((turn = pair->turn.load()) != side) {
+          if (stop.load(std::memory_order_relaxed)) {
+            return;
+          }
+          zx_futex_wait(futex, turn, ZX_HANDLE_INVALID, zx::deadline_after(kPollInterval).get());
+        }
+        if (side == 0) {
+          pair->round_trips++;
+        }
+        pair->turn.store(1 - side);
+        zx_futex_wake(futex, 1);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    const zx::time start = zx::clock::get_monotonic();
+    for (size_t i = 0; i < pair_count; i++) {
+      threads.emplace_back(play, &pairs[i], 0);
+      threads.emplace_back(play, &pairs[i], 1);
+    }
+    zx::nanosleep(zx::deadline_after(kRunTime));
+    stop.store(true);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    const zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < pair_count; i++) {
+      EXPECT_GT(pairs[i].round_trips, 0u);
+      total += pairs[i].round_trips;
+    }
+    printf("%zu futex pairs: %" PRIu64 " round trips/sec\n", pair_count,
+           total * ZX_SEC(1) / elapsed.get());
+  }
+}
+
 }  // namespace
 }  // namespace futex
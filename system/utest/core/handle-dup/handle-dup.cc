@@ -5,9 +5,15 @@
 #include <zircon/syscalls.h>
 #include <zircon/syscalls/object.h>
 #include <fbl/vector.h>
+#include <lib/zx/clock.h>
 #include <lib/zx/event.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <zxtest/zxtest.h>
 
+#include <atomic>
+#include <thread>
+
 namespace {
 
 constexpr uint32_t kEventOption = 0u;
@@ -71,4 +77,59 @@ TEST(HandleDup, Duplicate) {
   ASSERT_NO_FATAL_FAILURES(TestDuplicate());
 }
 
+// Measures zx_handle_duplicate + zx_handle_close throughput with an increasing number of threads
+// all working on handles to the same object. The handles all come from the kernel's global handle
+// arena, so this exercises its scaling rather than any per-object state.
+TEST(HandleDup, ParallelDuplicateCloseThroughput) {
+  constexpr zx::duration kRunTime = zx::msec(200);
+  constexpr size_t kThreadCounts[] = {1, 2, 4, 8};
+
+  zx::event event;
+  ASSERT_OK(zx::event::create(kEventOption, &event));
+
+  for (size_t thread_count : kThreadCounts) {
+    std::atomic<bool> start = false;
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> total_ops = 0;
+    std::atomic<zx_status_t> failure = ZX_OK;
+
+    fbl::Vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; i++) {
+      threads.push_back(std::thread([&] {
+        while (!start.load()) {
+          std::this_thread::yield();
+        }
+        uint64_t ops = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          zx_handle_t dup;
+          zx_status_t status = zx_handle_duplicate(event.get(), ZX_RIGHT_SAME_RIGHTS, &dup);
+          if (status == ZX_OK) {
+            status = zx_handle_close(dup);
+          }
+          if (status != ZX_OK) {
+            failure.store(status);
+            break;
+          }
+          ops++;
+        }
+        total_ops.fetch_add(ops);
+      }));
+    }
+
+    const zx::time begin = zx::clock::get_monotonic();
+    start.store(true);
+    zx::nanosleep(zx::deadline_after(kRunTime));
+    stop.store(true);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    const zx::duration elapsed = zx::clock::get_monotonic() - begin;
+
+    ASSERT_OK(failure.load());
+    EXPECT_GT(total_ops.load(), 0u);
+    printf("%zu threads: %" PRIu64 " dup+close/sec\n", thread_count,
+           total_ops.load() * ZX_SEC(1) / elapsed.get());
+  }
+}
+
 }  // namespace
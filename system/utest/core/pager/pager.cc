@@ -159,6 +159,41 @@ VMO_VMAR_TEST(SequentialMultipageTest) {
   ASSERT_TRUE(t.Wait());
 }
 
+// Tests that a fault in a mapping created with ZX_VM_SEQUENTIAL requests the following pages too.
+TEST(Pager, SequentialMappingReadaheadTest) {
+  UserPager pager;
+
+  ASSERT_TRUE(pager.Init());
+
+  Vmo* vmo;
+  constexpr uint32_t kNumPages = 8;
+  ASSERT_TRUE(pager.CreateVmo(kNumPages, &vmo));
+
+  zx_vaddr_t addr;
+  ASSERT_OK(zx::vmar::root_self()->map(0, vmo->vmo(), 0, kNumPages * ZX_PAGE_SIZE,
+                                       ZX_VM_PERM_READ | ZX_VM_SEQUENTIAL, &addr));
+  auto unmap = fbl::MakeAutoCall(
+      [&]() { zx::vmar::root_self()->unmap(addr, kNumPages * ZX_PAGE_SIZE); });
+
+  // Only touch the first page.
+  TestThread t([addr]() -> bool {
+    __UNUSED uint64_t val = *reinterpret_cast<volatile uint64_t*>(addr);
+    return true;
+  });
+
+  ASSERT_TRUE(t.Start());
+
+  ASSERT_TRUE(pager.WaitForPageRead(vmo, 0, kNumPages, ZX_TIME_INFINITE));
+  ASSERT_TRUE(pager.SupplyPages(vmo, 0, kNumPages));
+
+  ASSERT_TRUE(t.Wait());
+
+  // The whole vmo was supplied by the one request, so reading it should not need another.
+  ASSERT_TRUE(vmo->CheckVmar(0, kNumPages));
+  uint64_t offset, length;
+  ASSERT_FALSE(pager.GetPageReadRequest(vmo, 0, &offset, &length));
+}
+
 // Tests that multiple threads can concurrently access different pages.
 VMO_VMAR_TEST(ConcurrentMultipageAccessTest) {
   UserPager pager;
@@ -3,10 +3,19 @@
 // found in the LICENSE file.
 
 #include <fbl/array.h>
+#include <lib/zx/clock.h>
 #include <lib/zx/socket.h>
 #include <lib/zx/vmar.h>
 #include <lib/zx/vmo.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
 #include <utility>
+#include <vector>
+
 #include <zxtest/zxtest.h>
 
 namespace {
@@ -757,4 +766,127 @@ TEST(SocketTest, WriteFromBadBuffer) {
   EXPECT_EQ(ZX_ERR_INVALID_ARGS, b.write(0, buffer, 1, &actual));
 }
 
+// Large writes are queued as a single staged copy of the buffer. Check that the reader still sees
+// the bytes as they were at the time of the write.
+TEST(SocketTest, LargeWriteIsNotAffectedByLaterChanges) {
+  zx::socket local, remote;
+  ASSERT_OK(zx::socket::create(0, &local, &remote));
+
+  constexpr size_t kSize = 64 * 1024;
+  zx::vmo vmo;
+  ASSERT_OK(zx::vmo::create(kSize, 0, &vmo));
+  zx_vaddr_t addr;
+  ASSERT_OK(zx::vmar::root_self()->map(0, vmo, 0, kSize, ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, &addr));
+  auto* buffer = reinterpret_cast<char*>(addr);
+
+  memset(buffer, 'a', kSize);
+  size_t written;
+  ASSERT_OK(local.write(0u, buffer, kSize, &written));
+  ASSERT_EQ(written, kSize);
+  memset(buffer, 'b', kSize);
+
+  std::vector<char> rbuf(kSize);
+  size_t actual;
+  ASSERT_OK(remote.read(0u, rbuf.data(), kSize, &actual));
+  ASSERT_EQ(actual, kSize);
+  for (size_t i = 0; i < kSize; i++) {
+    ASSERT_EQ(rbuf[i], 'a', "byte %zu", i);
+  }
+
+  EXPECT_OK(zx::vmar::root_self()->unmap(addr, kSize));
+}
+
+// Queuing a large write must leave the writer's vmo as it was: without children, and decommittable.
+TEST(SocketTest, LargeWriteLeavesWriterVmoAlone) {
+  zx::socket local, remote;
+  ASSERT_OK(zx::socket::create(0, &local, &remote));
+
+  constexpr size_t kSize = 64 * 1024;
+  zx::vmo vmo;
+  ASSERT_OK(zx::vmo::create(kSize, 0, &vmo));
+  zx_vaddr_t addr;
+  ASSERT_OK(zx::vmar::root_self()->map(0, vmo, 0, kSize, ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, &addr));
+  auto* buffer = reinterpret_cast<char*>(addr);
+
+  memset(buffer, 'a', kSize);
+  size_t written;
+  ASSERT_OK(local.write(0u, buffer, kSize, &written));
+  ASSERT_EQ(written, kSize);
+
+  zx_signals_t pending;
+  EXPECT_OK(vmo.wait_one(ZX_VMO_ZERO_CHILDREN, zx::time::infinite_past(), &pending));
+  EXPECT_OK(vmo.op_range(ZX_VMO_OP_DECOMMIT, 0, kSize, nullptr, 0));
+
+  std::vector<char> rbuf(kSize);
+  size_t actual;
+  ASSERT_OK(remote.read(0u, rbuf.data(), kSize, &actual));
+  ASSERT_EQ(actual, kSize);
+  for (size_t i = 0; i < kSize; i++) {
+    ASSERT_EQ(rbuf[i], 'a', "byte %zu", i);
+  }
+
+  EXPECT_OK(zx::vmar::root_self()->unmap(addr, kSize));
+}
+
+// Measures stream throughput from a writer thread to a reader across a range of write sizes.
+TEST(SocketTest, StreamBandwidth) {
+  constexpr size_t kTotalBytes = 64 * 1024 * 1024;
+  constexpr size_t kMaxMessageSize = 256 * 1024;
+
+  zx::vmo vmo;
+  ASSERT_OK(zx::vmo::create(2 * kMaxMessageSize, 0, &vmo));
+  zx_vaddr_t addr;
+  ASSERT_OK(zx::vmar::root_self()->map(0, vmo, 0, 2 * kMaxMessageSize,
+                                       ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, &addr));
+  auto* send_buffer = reinterpret_cast<char*>(addr);
+  auto* recv_buffer = send_buffer + kMaxMessageSize;
+  memset(send_buffer, 0x5a, kMaxMessageSize);
+
+  for (size_t message_size = 64; message_size <= kMaxMessageSize; message_size *= 4) {
+    zx::socket local, remote;
+    ASSERT_OK(zx::socket::create(0, &local, &remote));
+
+    const zx::time start = zx::clock::get_monotonic();
+    std::thread writer([&local, send_buffer, message_size] {
+      size_t sent = 0;
+      while (sent < kTotalBytes) {
+        size_t actual;
+        zx_status_t status = local.write(0u, send_buffer, message_size, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+          local.wait_one(ZX_SOCKET_WRITABLE | ZX_SOCKET_PEER_CLOSED, zx::time::infinite(), nullptr);
+          continue;
+        }
+        if (status != ZX_OK) {
+          return;
+        }
+        sent += actual;
+      }
+    });
+
+    size_t received = 0;
+    while (received < kTotalBytes) {
+      size_t actual;
+      zx_status_t status = remote.read(0u, recv_buffer, kMaxMessageSize, &actual);
+      if (status == ZX_ERR_SHOULD_WAIT) {
+        remote.wait_one(ZX_SOCKET_READABLE | ZX_SOCKET_PEER_CLOSED, zx::time::infinite(), nullptr);
+        continue;
+      }
+      if (status != ZX_OK) {
+        break;
+      }
+      received += actual;
+    }
+    remote.reset();
+    writer.join();
+    const zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+    EXPECT_GE(received, kTotalBytes);
+
+    printf("%zu byte writes: %" PRIu64 " MiB/sec\n", message_size,
+           kTotalBytes * ZX_SEC(1) / std::max<int64_t>(elapsed.get(), 1) / (1024 * 1024));
+  }
+
+  EXPECT_OK(zx::vmar::root_self()->unmap(addr, 2 * kMaxMessageSize));
+}
+
 }  // namespace
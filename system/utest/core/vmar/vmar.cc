@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <lib/fzl/memory-probe.h>
 #include <lib/zircon-internal/align.h>
+#include <lib/zx/clock.h>
 #include <lib/zx/job.h>
 #include <lib/zx/process.h>
 #include <lib/zx/vmar.h>
@@ -20,11 +21,15 @@
 #include <zircon/syscalls/object.h>
 #include <zircon/types.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cinttypes>
 #include <climits>
+#include <cstdio>
 #include <iterator>
 #include <limits>
 #include <thread>
+#include <vector>
 
 #include <fbl/algorithm.h>
 #include <zxtest/zxtest.h>
@@ -2089,4 +2094,115 @@ TEST(Vmar, ConcurrentUnmapReadMemory) {
   t.join();
 }
 
+// Benchmark for page faults taken by several threads at once, each in its own mapping, while
+// another thread maps and unmaps elsewhere in the address space. Faults in different mappings
+// should not serialize, so the aggregate rate should scale with the number of threads.
+TEST(Vmar, ParallelFaultThroughput) {
+  constexpr size_t kPagesPerThread = 1024;
+  constexpr size_t kMappingSize = kPagesPerThread * ZX_PAGE_SIZE;
+  const size_t max_threads = std::min<size_t>(zx_system_get_num_cpus(), 8);
+
+  for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    std::vector<uintptr_t> addrs(num_threads);
+    for (auto& addr : addrs) {
+      zx::vmo vmo;
+      ASSERT_OK(zx::vmo::create(kMappingSize, 0, &vmo));
+      ASSERT_OK(zx::vmar::root_self()->map(0, vmo, 0, kMappingSize,
+                                           ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, &addr));
+    }
+
+    // Keep the aspace busy with unrelated map and unmap operations.
+    std::atomic<bool> running = true;
+    std::thread churn([&running] {
+      zx::vmo vmo;
+      if (zx::vmo::create(ZX_PAGE_SIZE, 0, &vmo) != ZX_OK) {
+        return;
+      }
+      while (running) {
+        uintptr_t addr;
+        if (zx::vmar::root_self()->map(0, vmo, 0, ZX_PAGE_SIZE, ZX_VM_PERM_READ, &addr) == ZX_OK) {
+          zx::vmar::root_self()->unmap(addr, ZX_PAGE_SIZE);
+        }
+      }
+    });
+
+    std::atomic<size_t> mismatches = 0;
+    const zx::time start = zx::clock::get_monotonic();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back([addr = addrs[i], i, &mismatches] {
+        auto* base = reinterpret_cast<volatile uint64_t*>(addr);
+        const size_t stride = ZX_PAGE_SIZE / sizeof(uint64_t);
+        for (size_t page = 0; page < kPagesPerThread; page++) {
+          base[page * stride] = i * kPagesPerThread + page;
+        }
+        for (size_t page = 0; page < kPagesPerThread; page++) {
+          if (base[page * stride] != i * kPagesPerThread + page) {
+            mismatches++;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    const zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+    running = false;
+    churn.join();
+    for (uintptr_t addr : addrs) {
+      EXPECT_OK(zx::vmar::root_self()->unmap(addr, kMappingSize));
+    }
+
+    EXPECT_EQ(mismatches.load(), 0u);
+    printf("%zu threads: %" PRIu64 " faults/sec\n", num_threads,
+           num_threads * kPagesPerThread * ZX_SEC(1) / std::max<int64_t>(elapsed.get(), 1));
+  }
+}
+
+// Compares random accesses through a mapping the kernel can back with large pages against the same
+// accesses through one it cannot, which is dominated by TLB misses.
+TEST(Vmar, LargePageRandomAccessThroughput) {
+  constexpr size_t kLargePageSize = 2 * 1024 * 1024;
+  constexpr size_t kMappingSize = 32 * kLargePageSize;
+  constexpr size_t kAccesses = 1 << 22;
+
+  // Committing a large page vmo up front gives it the chance to use contiguous runs. The second mapping starts
+  // a page into the vmo, so none of its blocks line up with a run.
+  zx::vmo vmo;
+  ASSERT_OK(zx::vmo::create(kMappingSize + ZX_PAGE_SIZE, ZX_VMO_LARGE_PAGES, &vmo));
+  ASSERT_OK(vmo.op_range(ZX_VMO_OP_COMMIT, 0, kMappingSize + ZX_PAGE_SIZE, nullptr, 0));
+
+  const struct {
+    const char* name;
+    uint64_t vmo_offset;
+  } kCases[] = {
+      {"large pages", 0},
+      {"small pages", ZX_PAGE_SIZE},
+  };
+  for (const auto& test_case : kCases) {
+    uintptr_t addr;
+    ASSERT_OK(zx::vmar::root_self()->map(
+        0, vmo, test_case.vmo_offset, kMappingSize,
+        ZX_VM_PERM_READ | ZX_VM_PERM_WRITE | ZX_VM_MAP_RANGE | ZX_VM_ALIGN_2MB, &addr));
+
+    auto* base = reinterpret_cast<volatile uint64_t*>(addr);
+    const size_t words = kMappingSize / sizeof(uint64_t);
+    uint64_t state = 1;
+    uint64_t sum = 0;
+    const zx::time start = zx::clock::get_monotonic();
+    for (size_t i = 0; i < kAccesses; i++) {
+      state = state * 6364136223846793005ull + 1442695040888963407ull;
+      sum += base[(state >> 16) % words];
+    }
+    const zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+    EXPECT_OK(zx::vmar::root_self()->unmap(addr, kMappingSize));
+    // The vmo was never written, so every word reads as zero.
+    EXPECT_EQ(sum, 0u);
+    printf("%s: %" PRIu64 " accesses/sec\n", test_case.name,
+           kAccesses * ZX_SEC(1) / std::max<int64_t>(elapsed.get(), 1));
+  }
+}
+
 }  // namespace
@@ -0,0 +1,180 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include <digest/digest.h>
+#include <digest/merkle-tree.h>
+#include <digest/node-digest.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/string_printf.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+using digest::Digest;
+using digest::kSha256Length;
+using digest::MerkleTreeCreator;
+using digest::MerkleTreeVerifier;
+using digest::NodeDigest;
+
+// Blob sizes to measure, from a single Merkle tree node up to 1 GiB. The larger sizes take a long
+// time to run with the default number of runs; use --runs to limit them.
+constexpr size_t kDataSizes[] = {
+    8 * 1024,         64 * 1024,         512 * 1024,         4 * 1024 * 1024,
+    32 * 1024 * 1024, 256 * 1024 * 1024, 1024 * 1024 * 1024,
+};
+
+std::unique_ptr<uint8_t[]> MakeData(size_t data_len) {
+  fbl::AllocChecker ac;
+  std::unique_ptr<uint8_t[]> data(new (&ac) uint8_t[data_len]);
+  if (!ac.check()) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < data_len; ++i) {
+    data[i] = static_cast<uint8_t>(rand());
+  }
+  return data;
+}
+
+// Measures hashing the leaf nodes of a Merkle tree one node at a time, as was done before nodes
+// were batched. The leaves account for nearly all of the hashing work in building a tree.
+bool LeafDigestsSerialTest(perftest::RepeatState* state, size_t data_len) {
+  state->SetBytesProcessedPerRun(data_len);
+  std::unique_ptr<uint8_t[]> data = MakeData(data_len);
+  if (!data) {
+    return false;
+  }
+  NodeDigest node_digest;
+  uint8_t out[kSha256Length];
+  while (state->KeepRunning()) {
+    for (size_t off = 0; off < data_len; off += node_digest.node_size()) {
+      if (node_digest.Reset(off, data_len) != ZX_OK) {
+        return false;
+      }
+      node_digest.Append(&data[off], data_len - off);
+      memcpy(out, node_digest.get().get(), sizeof(out));
+    }
+  }
+  return true;
+}
+
+// Measures hashing the leaf nodes of a Merkle tree in batches of |NodeDigest::kMaxParallelNodes|.
+bool LeafDigestsParallelTest(perftest::RepeatState* state, size_t data_len) {
+  state->SetBytesProcessedPerRun(data_len);
+  std::unique_ptr<uint8_t[]> data = MakeData(data_len);
+  if (!data) {
+    return false;
+  }
+  NodeDigest node_digest;
+  const size_t node_size = node_digest.node_size();
+  uint8_t out[NodeDigest::kMaxParallelNodes][kSha256Length];
+  while (state->KeepRunning()) {
+    size_t off = 0;
+    while (data_len - off >= node_size) {
+      const size_t count =
+          std::min((data_len - off) / node_size, NodeDigest::kMaxParallelNodes);
+      node_digest.HashNodes(&data[off], off, count, out);
+      off += count * node_size;
+    }
+    // Any partial node at the end is hashed on its own.
+    if (off < data_len) {
+      if (node_digest.Reset(off, data_len) != ZX_OK) {
+        return false;
+      }
+      node_digest.Append(&data[off], data_len - off);
+    }
+  }
+  return true;
+}
+
+// Measures building a complete Merkle tree.
+bool CreateTest(perftest::RepeatState* state, size_t data_len) {
+  state->SetBytesProcessedPerRun(data_len);
+  std::unique_ptr<uint8_t[]> data = MakeData(data_len);
+  if (!data) {
+    return false;
+  }
+  std::unique_ptr<uint8_t[]> tree;
+  size_t tree_len;
+  Digest root;
+  while (state->KeepRunning()) {
+    if (MerkleTreeCreator::Create(data.get(), data_len, &tree, &tree_len, &root) != ZX_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Measures building a complete Merkle tree with the nodes of each level split across every core.
+bool CreateParallelTest(perftest::RepeatState* state, size_t data_len) {
+  state->SetBytesProcessedPerRun(data_len);
+  std::unique_ptr<uint8_t[]> data = MakeData(data_len);
+  if (!data) {
+    return false;
+  }
+  const size_t num_threads = std::thread::hardware_concurrency();
+  std::unique_ptr<uint8_t[]> tree;
+  size_t tree_len;
+  Digest root;
+  while (state->KeepRunning()) {
+    if (MerkleTreeCreator::Create(data.get(), data_len, &tree, &tree_len, &root, num_threads) !=
+        ZX_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Measures verifying all of the data against a Merkle tree.
+bool VerifyTest(perftest::RepeatState* state, size_t data_len) {
+  state->SetBytesProcessedPerRun(data_len);
+  std::unique_ptr<uint8_t[]> data = MakeData(data_len);
+  if (!data) {
+    return false;
+  }
+  std::unique_ptr<uint8_t[]> tree;
+  size_t tree_len;
+  Digest root;
+  if (MerkleTreeCreator::Create(data.get(), data_len, &tree, &tree_len, &root) != ZX_OK) {
+    return false;
+  }
+  while (state->KeepRunning()) {
+    if (MerkleTreeVerifier::Verify(data.get(), data_len, 0, data_len, tree.get(), tree_len,
+                                   root) != ZX_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RegisterTests() {
+  for (size_t data_len : kDataSizes) {
+    const size_t kib = data_len / 1024;
+    perftest::RegisterTest(fbl::StringPrintf("MerkleTree/LeafDigests/Serial/%zuKiB", kib).c_str(),
+                           LeafDigestsSerialTest, data_len);
+    perftest::RegisterTest(
+        fbl::StringPrintf("MerkleTree/LeafDigests/Parallel/%zuKiB", kib).c_str(),
+        LeafDigestsParallelTest, data_len);
+    perftest::RegisterTest(fbl::StringPrintf("MerkleTree/Create/%zuKiB", kib).c_str(), CreateTest,
+                           data_len);
+    perftest::RegisterTest(fbl::StringPrintf("MerkleTree/CreateParallel/%zuKiB", kib).c_str(),
+                           CreateParallelTest, data_len);
+    perftest::RegisterTest(fbl::StringPrintf("MerkleTree/Verify/%zuKiB", kib).c_str(), VerifyTest,
+                           data_len);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  RegisterTests();
+  return perftest::PerfTestMain(argc, argv, "fuchsia.digest");
+}
@@ -0,0 +1,139 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <block-client/cpp/fake-device.h>
+#include <fbl/string.h>
+#include <fbl/string_printf.h>
+#include <minfs/bcache.h>
+#include <minfs/format.h>
+#include <perftest/perftest.h>
+
+#include "directory.h"
+#include "minfs_private.h"
+
+namespace minfs_micro_benchmanrk {
+namespace {
+
+using block_client::FakeBlockDevice;
+
+// Directory sizes to measure, in entries. The smallest is not large enough to be indexed.
+constexpr size_t kEntryCounts[] = {100, 1000, 10000, 30000};
+
+constexpr uint64_t kBlockCount = 1 << 16;
+
+fbl::String EntryName(size_t i) { return fbl::StringPrintf("entry-%zu", i); }
+
+// An in-memory filesystem whose root directory holds |entry_count| entries. The entries are hard
+// links to a single file, so that large directories do not run out of inodes.
+class Filesystem {
+ public:
+  bool Init(size_t entry_count) {
+    auto device = std::make_unique<FakeBlockDevice>(kBlockCount, minfs::kMinfsBlockSize);
+    std::unique_ptr<minfs::Bcache> bcache;
+    if (minfs::Bcache::Create(std::move(device), kBlockCount, &bcache) != ZX_OK ||
+        minfs::Mkfs(bcache.get()) != ZX_OK ||
+        minfs::Minfs::Create(std::move(bcache), minfs::MountOptions(), &fs_) != ZX_OK) {
+      return false;
+    }
+
+    fbl::RefPtr<minfs::VnodeMinfs> root;
+    if (fs_->VnodeGet(&root, minfs::kMinfsRootIno) != ZX_OK) {
+      return false;
+    }
+    root_ = fbl::RefPtr<minfs::Directory>::Downcast(std::move(root));
+
+    fbl::RefPtr<fs::Vnode> target;
+    if (root_->Create(&target, "target", 0) != ZX_OK) {
+      return false;
+    }
+    for (size_t i = 0; i < entry_count; i++) {
+      if (root_->Link(EntryName(i), target) != ZX_OK) {
+        fprintf(stderr, "Failed to create entry %zu\n", i);
+        return false;
+      }
+    }
+    return target->Close() == ZX_OK;
+  }
+
+  minfs::Directory* root() { return root_.get(); }
+
+ private:
+  std::unique_ptr<minfs::Minfs> fs_;
+  fbl::RefPtr<minfs::Directory> root_;
+};
+
+// Measures looking up existing entries of a directory in a random order.
+bool LookupTest(perftest::RepeatState* state, size_t entry_count) {
+  Filesystem fs;
+  if (!fs.Init(entry_count)) {
+    return false;
+  }
+
+  std::vector<fbl::String> names;
+  for (size_t i = 0; i < entry_count; i++) {
+    names.push_back(EntryName(i));
+  }
+  std::shuffle(names.begin(), names.end(), std::default_random_engine(entry_count));
+
+  size_t next = 0;
+  while (state->KeepRunning()) {
+    fbl::RefPtr<fs::Vnode> vnode;
+    if (fs.root()->Lookup(&vnode, names[next]) != ZX_OK) {
+      return false;
+    }
+    next = (next + 1) % names.size();
+  }
+  return true;
+}
+
+// Measures creating a new file in a directory, and removing it again so that the directory keeps
+// its size from run to run.
+bool CreateTest(perftest::RepeatState* state, size_t entry_count) {
+  state->DeclareStep("create");
+  state->DeclareStep("unlink");
+
+  Filesystem fs;
+  if (!fs.Init(entry_count)) {
+    return false;
+  }
+
+  while (state->KeepRunning()) {
+    fbl::RefPtr<fs::Vnode> vnode;
+    if (fs.root()->Create(&vnode, "new-entry", 0) != ZX_OK || vnode->Close() != ZX_OK) {
+      return false;
+    }
+    state->NextStep();
+    if (fs.root()->Unlink("new-entry", false) != ZX_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RegisterTests() {
+  for (size_t entry_count : kEntryCounts) {
+    perftest::RegisterTest(
+        fbl::StringPrintf("MinfsDirectory/Lookup/%zuEntries", entry_count).c_str(), LookupTest,
+        entry_count);
+    perftest::RegisterTest(
+        fbl::StringPrintf("MinfsDirectory/Create/%zuEntries", entry_count).c_str(), CreateTest,
+        entry_count);
+  }
+}
+
+}  // namespace
+}  // namespace minfs_micro_benchmanrk
+
+int main(int argc, char** argv) {
+  minfs_micro_benchmanrk::RegisterTests();
+  return perftest::PerfTestMain(argc, argv, "fuchsia.minfs");
+}
@@ -0,0 +1,156 @@
+// Copyright 2020 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include <block-client/cpp/fake-device.h>
+#include <fbl/string_printf.h>
+#include <minfs/bcache.h>
+#include <minfs/format.h>
+#include <perftest/perftest.h>
+
+#include "directory.h"
+#include "minfs_private.h"
+
+namespace minfs_micro_benchmanrk {
+namespace {
+
+using block_client::FakeBlockDevice;
+
+// File sizes to measure, in MiB.
+constexpr size_t kFileSizes[] = {1, 16, 64};
+
+// The size of each read and write.
+constexpr size_t kChunkSize = 64 * 1024;
+
+constexpr uint64_t kBlockCount = 1 << 16;
+
+constexpr char kFileName[] = "file";
+
+// An in-memory filesystem whose files are created either extent-mapped or with block pointers.
+class Filesystem {
+ public:
+  bool Init(bool extent_mapped) {
+    auto device = std::make_unique<FakeBlockDevice>(kBlockCount, minfs::kMinfsBlockSize);
+    std::unique_ptr<minfs::Bcache> bcache;
+    minfs::MountOptions options;
+    options.extent_mapped_files = extent_mapped;
+    if (minfs::Bcache::Create(std::move(device), kBlockCount, &bcache) != ZX_OK ||
+        minfs::Mkfs(bcache.get()) != ZX_OK ||
+        minfs::Minfs::Create(std::move(bcache), options, &fs_) != ZX_OK) {
+      return false;
+    }
+
+    fbl::RefPtr<minfs::VnodeMinfs> root;
+    if (fs_->VnodeGet(&root, minfs::kMinfsRootIno) != ZX_OK) {
+      return false;
+    }
+    root_ = fbl::RefPtr<minfs::Directory>::Downcast(std::move(root));
+    return true;
+  }
+
+  minfs::Directory* root() { return root_.get(); }
+
+ private:
+  std::unique_ptr<minfs::Minfs> fs_;
+  fbl::RefPtr<minfs::Directory> root_;
+};
+
+// Writes |size| bytes to |file| from the start, one chunk at a time.
+bool WriteFile(fs::Vnode* file, size_t size) {
+  std::vector<uint8_t> data(kChunkSize, 0xab);
+  for (size_t off = 0; off < size; off += kChunkSize) {
+    size_t actual;
+    if (file->Write(data.data(), data.size(), off, &actual) != ZX_OK || actual != data.size()) {
+      fprintf(stderr, "Failed to write at offset %zu\n", off);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Measures writing a new file sequentially, and removing it again between runs.
+bool SequentialWriteTest(perftest::RepeatState* state, bool extent_mapped, size_t size) {
+  state->SetBytesProcessedPerRun(size);
+
+  Filesystem fs;
+  if (!fs.Init(extent_mapped)) {
+    return false;
+  }
+
+  while (state->KeepRunning()) {
+    fbl::RefPtr<fs::Vnode> file;
+    if (fs.root()->Create(&file, kFileName, 0) != ZX_OK || !WriteFile(file.get(), size) ||
+        file->Close() != ZX_OK) {
+      return false;
+    }
+    file.reset();
+    if (fs.root()->Unlink(kFileName, false) != ZX_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Measures reading a file sequentially. The file is looked up afresh for each run, so that its
+// contents are read from the device rather than from the vnode's cache.
+bool SequentialReadTest(perftest::RepeatState* state, bool extent_mapped, size_t size) {
+  state->SetBytesProcessedPerRun(size);
+
+  Filesystem fs;
+  if (!fs.Init(extent_mapped)) {
+    return false;
+  }
+  {
+    fbl::RefPtr<fs::Vnode> file;
+    if (fs.root()->Create(&file, kFileName, 0) != ZX_OK || !WriteFile(file.get(), size) ||
+        file->Close() != ZX_OK) {
+      return false;
+    }
+  }
+
+  std::vector<uint8_t> data(kChunkSize);
+  while (state->KeepRunning()) {
+    fbl::RefPtr<fs::Vnode> file;
+    if (fs.root()->Lookup(&file, kFileName) != ZX_OK) {
+      return false;
+    }
+    for (size_t off = 0; off < size; off += kChunkSize) {
+      size_t actual;
+      if (file->Read(data.data(), data.size(), off, &actual) != ZX_OK ||
+          actual != data.size()) {
+        fprintf(stderr, "Failed to read at offset %zu\n", off);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void RegisterTests() {
+  for (bool extent_mapped : {true, false}) {
+    const char* format = extent_mapped ? "Extents" : "BlockPointers";
+    for (size_t size_mib : kFileSizes) {
+      size_t size = size_mib * 1024 * 1024;
+      perftest::RegisterTest(
+          fbl::StringPrintf("MinfsFile/SequentialWrite/%s/%zuMiB", format, size_mib).c_str(),
+          SequentialWriteTest, extent_mapped, size);
+      perftest::RegisterTest(
+          fbl::StringPrintf("MinfsFile/SequentialRead/%s/%zuMiB", format, size_mib).c_str(),
+          SequentialReadTest, extent_mapped, size);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace minfs_micro_benchmanrk
+
+int main(int argc, char** argv) {
+  minfs_micro_benchmanrk::RegisterTests();
+  return perftest::PerfTestMain(argc, argv, "fuchsia.minfs");
+}
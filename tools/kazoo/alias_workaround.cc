@@ -95,6 +95,10 @@ bool AliasWorkaround(const std::string& name, const SyscallLibrary& library, Typ
         Constness::kConst);
     return true;
   }
+  if (name == "vector_PortPacket") {
+    *type = Type(TypeVector(Type(library.TypeFromIdentifier("zx/PortPacket"))), Constness::kConst);
+    return true;
+  }
   if (name == "vector_handle_u32size") {
     *type = Type(TypeVector(Type(TypeHandle(std::string())), UseUint32ForVectorSizeTag{}),
                  Constness::kConst);